@@ -0,0 +1,134 @@
+// Baud Rate Negotiation Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// UART Interface:
+//   UART0 is switched from 115200 baud to the rate agreed with the host
+// Hibernation Module:
+//   RTC seconds time the fallback
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "tm4c123gh6pm.h"
+#include "uart0.h"
+#include "baud.h"
+
+typedef struct _BAUD
+{
+    uint32_t rate;                      // In use, 0 for BAUD_DEFAULT
+    uint32_t previous;                  // To fall back to
+    uint32_t deadline;                  // RTC second of the fallback
+    bool pending;                       // Switched, not yet confirmed
+} BAUD;
+
+#ifdef SIM_HOST
+// Each simulated pot has its own
+#include "simhw.h"
+const char baudKey = 0;
+#define baud (*(BAUD *)simGlobal(&baudKey, sizeof(BAUD)))
+#else
+BAUD baud;
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Once everything queued has left the line, so no character is sent at two
+// rates
+void switchUart0(uint32_t rate)
+{
+    while (UART0_FR_R & UART_FR_BUSY);
+    UART0_CTL_R = 0;
+    setUart0BaudRate(rate, 40e6);
+    UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN;    // the divisor takes effect on this write
+    UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN;
+    UART0_ECR_R = 0;                                    // framing errors from here on count
+}
+
+uint32_t getBaudRate()
+{
+    BAUD *b = &baud;
+    return b->rate ? b->rate : BAUD_DEFAULT;
+}
+
+bool isBaudPending()
+{
+    return baud.pending;
+}
+
+// Answers and switches to rate, to fall back unless confirmed; false if the
+// rate cannot be set.  A switch before the last is confirmed keeps the rate
+// from before that one to fall back to.
+bool startBaud(uint32_t rate, uint32_t seconds)
+{
+    BAUD *b = &baud;
+    char str[40];
+    if (rate < BAUD_MIN || rate > BAUD_MAX)
+        return false;
+    if (!b->pending)
+        b->previous = getBaudRate();
+    snprintf(str, sizeof(str), "baud : %lu switching\n\r", (unsigned long)rate);
+    putsUart0(str);
+    switchUart0(rate);
+    b->rate = rate;
+    b->deadline = seconds + BAUD_FALLBACK_SECONDS;
+    b->pending = true;
+    return true;
+}
+
+// Keeps the rate switched to, unless characters have arrived with framing
+// errors since; false if none was waiting
+bool confirmBaud()
+{
+    BAUD *b = &baud;
+    char str[48];
+    if (!b->pending)
+        return false;
+    if (UART0_RSR_R & UART_RSR_FE)
+    {
+        snprintf(str, sizeof(str), "baud : %lu framing errors\n\r", (unsigned long)b->rate);
+        putsUart0(str);
+        return true;
+    }
+    b->pending = false;
+    snprintf(str, sizeof(str), "baud : %lu ok\n\r", (unsigned long)b->rate);
+    putsUart0(str);
+    return true;
+}
+
+// Call while waiting for input; true if the rate fell back
+bool serviceBaud(uint32_t seconds)
+{
+    BAUD *b = &baud;
+    char str[40];
+    if (!b->pending || (int32_t)(seconds - b->deadline) < 0)
+        return false;
+    b->pending = false;
+    b->rate = b->previous;
+    switchUart0(b->rate);
+    snprintf(str, sizeof(str), "baud : %lu fallback\n\r", (unsigned long)b->rate);
+    putsUart0(str);
+    return true;
+}
+
+void sendBaudTest()
+{
+    char c;
+    putsUart0("baud test : ");
+    for (c = BAUD_TEST_FIRST; c <= BAUD_TEST_LAST; c++)
+        putcUart0(c);
+    putsUart0("\n\r");
+}
@@ -0,0 +1,69 @@
+// Baud Rate Negotiation Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// UART Interface:
+//   UART0 is switched from 115200 baud to the rate agreed with the host
+// Hibernation Module:
+//   RTC seconds time the fallback
+
+// "baud RATE" moves UART0 to a faster rate for a host with a lot to read,
+// such as an "export" of the history log.  The pot answers
+//
+//   baud : RATE switching
+//
+// at the old rate, waits for it to leave the line, and switches.  The host
+// switches too, sends "baud TEST" to check the link both ways, and then
+// "baud OK" to keep the rate, answered "baud : RATE ok" at the new rate.
+// Without "baud OK" within BAUD_FALLBACK_SECONDS (2 to 3 s, by the RTC) the
+// pot goes back to the old rate and says so, "baud : OLD fallback".  A
+// command garbled by the wrong rate is never "baud OK", and a rate only a
+// little off can still cost stop bits: with any framing error since the
+// switch (UART0 RSR FE) the pot answers "baud : RATE framing errors" and
+// waits to fall back.  A receive overrun in the meantime clears RSR
+// (stats.h), and with it that check.
+//
+// "baud TEST" answers "baud test : " and the 95 printable characters, space
+// to '~', for the host to count the bytes that arrive wrong.  "baud" alone
+// answers the rate in use.  A reset goes back to 115200.
+//
+// The rate is 40 MHz / 16 / divisor with the divisor in 64ths, so rates up
+// to BAUD_MAX can be set, a little off at most of them.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef BAUD_H_
+#define BAUD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BAUD_DEFAULT 115200
+#define BAUD_MIN 9600
+#define BAUD_MAX 2500000                // 40 MHz / 16
+#define BAUD_FALLBACK_SECONDS 3
+
+#define BAUD_TEST_FIRST ' '
+#define BAUD_TEST_LAST '~'
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool startBaud(uint32_t rate, uint32_t seconds);
+bool confirmBaud();
+bool isBaudPending();
+bool serviceBaud(uint32_t seconds);
+void sendBaudTest();
+uint32_t getBaudRate();
+
+#endif
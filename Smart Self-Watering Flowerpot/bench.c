@@ -0,0 +1,95 @@
+// Benchmark Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT times each run (dwt.h)
+// UART Interface:
+//   The report is sent on UART0
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "tm4c123gh6pm.h"
+#include "uart0.h"
+#include "dwt.h"
+#include "bench.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void printBenchHeader()
+{
+    putsUart0("bench,routine,clock,n,min,median,p99\n");
+}
+
+// Insertion sort; the sample counts are small
+void sortSamples(uint32_t samples[], uint16_t count)
+{
+    uint16_t i, j;
+    uint32_t sample;
+    for (i = 1; i < count; i++)
+    {
+        sample = samples[i];
+        for (j = i; j > 0 && samples[j - 1] > sample; j--)
+            samples[j] = samples[j - 1];
+        samples[j] = sample;
+    }
+}
+
+void printSamples(const char *name, const char *clock, uint32_t samples[], uint16_t count)
+{
+    char line[100];
+    sortSamples(samples, count);
+    // Nearest rank
+    sprintf(line, "bench,%s,%s,%u,%lu,%lu,%lu\n", name, clock, count,
+            (unsigned long)samples[0], (unsigned long)samples[(count - 1) / 2],
+            (unsigned long)samples[(99 * count + 99) / 100 - 1]);
+    putsUart0(line);
+}
+
+// Run a routine and report the cycles each run took
+void runBench(const BENCH *bench, uint16_t runs)
+{
+    uint32_t cycles[BENCH_MAX_RUNS];
+#ifdef SIM_HOST
+    uint32_t nanoseconds[BENCH_MAX_RUNS];
+    uint64_t host;
+#endif
+    uint32_t start;
+    uint16_t i;
+    if (runs > BENCH_MAX_RUNS)
+        runs = BENCH_MAX_RUNS;
+    if (runs == 0)
+        return;
+    for (i = 0; i < runs; i++)
+    {
+        if (bench->prepare)
+            bench->prepare(bench->context);
+#ifdef SIM_HOST
+        host = simHostNanoseconds();
+#endif
+        start = DWT_CYCCNT_R;
+        bench->run(bench->context);
+        cycles[i] = DWT_CYCCNT_R - start;
+#ifdef SIM_HOST
+        nanoseconds[i] = simHostNanoseconds() - host;
+#endif
+    }
+    printSamples(bench->name, "cycles", cycles, runs);
+#ifdef SIM_HOST
+    printSamples(bench->name, "host_ns", nanoseconds, runs);
+#endif
+}
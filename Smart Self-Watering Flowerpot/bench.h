@@ -0,0 +1,51 @@
+// Benchmark Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT times each run (dwt.h)
+// UART Interface:
+//   The report is sent on UART0
+
+// Each routine is run a number of times and the CYCCNT difference across
+// every run is kept.  The report is comma-separated, one line per routine
+// and clock, under a header line:
+//
+//   bench,routine,clock,n,min,median,p99
+//
+// The clock is "cycles" on the target.  The host build also reports
+// "host_ns", host nanoseconds, because the simulated cycle counter only
+// advances on register accesses and waits, not on computation.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#define BENCH_MAX_RUNS 200
+
+typedef struct _BENCH
+{
+    const char *name;
+    void (*prepare)(void *context);     // Before each run, not timed (optional)
+    void (*run)(void *context);
+    void *context;
+} BENCH;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void printBenchHeader();
+void runBench(const BENCH *bench, uint16_t runs);
+
+#endif
@@ -0,0 +1,164 @@
+// Board Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// UART Interface:
+//   U0RX (PA0) and U0TX (PA1), configured by uart0.c
+// Pumps:
+//   PA2, PA4-PA7 and PB0-PB2 drive the pump motors of pots 1-8
+// Speaker:
+//   PA3 is toggled by the Timer 2A interrupt
+// Water level:
+//   PC7 is the C0- comparator input; PE5 (DEINT) discharges the capacitor
+// Sensors:
+//   AIN0 (PE3) battery voltage, AIN2 (PE1) light
+//   Moisture of pots 1-8 on AIN1 (PE2), AIN3 (PE0), AIN4-AIN7 (PD3-PD0),
+//   AIN9 (PE4) and AIN10 (PB4)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal.h"
+#include "board.h"
+
+using namespace hal;
+
+typedef Pin<Port::A, 0> Uart0Rx;
+typedef Pin<Port::A, 1> Uart0Tx;
+typedef Pin<Port::A, 3> Speaker;
+typedef Pin<Port::C, 7> Comp;
+typedef Pin<Port::E, 5> Deint;
+typedef AnalogInput<0> Battery;
+typedef AnalogInput<2> Light;
+typedef Timer<2> Tone;
+
+typedef Pin<Port::A, 2> Pump0;
+typedef Pin<Port::A, 4> Pump1;
+typedef Pin<Port::A, 5> Pump2;
+typedef Pin<Port::A, 6> Pump3;
+typedef Pin<Port::A, 7> Pump4;
+typedef Pin<Port::B, 0> Pump5;
+typedef Pin<Port::B, 1> Pump6;
+typedef Pin<Port::B, 2> Pump7;
+typedef AnalogInput<1> Moisture0;
+typedef AnalogInput<3> Moisture1;
+typedef AnalogInput<4> Moisture2;
+typedef AnalogInput<5> Moisture3;
+typedef AnalogInput<6> Moisture4;
+typedef AnalogInput<7> Moisture5;
+typedef AnalogInput<9> Moisture6;
+typedef AnalogInput<10> Moisture7;
+
+static_assert(pinsDistinct<Uart0Rx, Uart0Tx, Speaker, Comp, Deint, Battery, Light,
+                           Pump0, Pump1, Pump2, Pump3, Pump4, Pump5, Pump6, Pump7,
+                           Moisture0, Moisture1, Moisture2, Moisture3,
+                           Moisture4, Moisture5, Moisture6, Moisture7>(),
+              "two functions share a pin");
+
+// Pot number to pin, so a pot is still one store
+const uint32_t PUMP_DATA[BOARD_POTS] =
+{
+    Pump0::Data::alias, Pump1::Data::alias, Pump2::Data::alias, Pump3::Data::alias,
+    Pump4::Data::alias, Pump5::Data::alias, Pump6::Data::alias, Pump7::Data::alias,
+};
+
+const uint8_t MOISTURE_INPUT[BOARD_POTS] =
+{
+    Moisture0::input, Moisture1::input, Moisture2::input, Moisture3::input,
+    Moisture4::input, Moisture5::input, Moisture6::input, Moisture7::input,
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Pack expansion in an array, not a C++17 fold, for the TI compiler
+template <class... Pins>
+static void makeOutputs()
+{
+    int each[] = { (Pins::makeOutput(), 0)... };
+    (void)each;
+}
+
+template <class... Inputs>
+static void initInputs()
+{
+    int each[] = { (Inputs::init(), 0)... };
+    (void)each;
+}
+
+// Call with the GPIO port clocks on
+void initBoardPins()
+{
+    Comp::Dir::write(0);
+    Comp::Amsel::write(1);
+    Deint::makeOutput();
+    Speaker::makeOutput();
+    makeOutputs<Pump0, Pump1, Pump2, Pump3, Pump4, Pump5, Pump6, Pump7>();
+    Battery::init();
+    Light::init();
+    initInputs<Moisture0, Moisture1, Moisture2, Moisture3, Moisture4, Moisture5, Moisture6, Moisture7>();
+}
+
+void setPump(uint8_t pot, bool on)
+{
+    if (pot < BOARD_POTS)
+        reg(PUMP_DATA[pot]) = on;
+}
+
+bool isPumpOn(uint8_t pot)
+{
+    return pot < BOARD_POTS && reg(PUMP_DATA[pot]);
+}
+
+void setDeint(bool on)
+{
+    Deint::write(on);
+}
+
+void toggleSpeaker()
+{
+    Speaker::toggle();
+}
+
+void startTone(uint32_t period)
+{
+    Tone::start();
+    Tone::setLoad(period);
+}
+
+void stopTone()
+{
+    Tone::stop();
+}
+
+void clearToneTimeout()
+{
+    Tone::clearTimeout();
+}
+
+void selectLightInput()
+{
+    Light::select();
+}
+
+void selectMoistureInput(uint8_t pot)
+{
+    if (pot < BOARD_POTS)
+        selectAnalogInput(MOISTURE_INPUT[pot]);
+}
+
+void selectBatteryInput()
+{
+    Battery::select();
+}
@@ -0,0 +1,65 @@
+// Board Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// UART Interface:
+//   U0RX (PA0) and U0TX (PA1), configured by uart0.c
+// Pumps:
+//   PA2, PA4-PA7 and PB0-PB2 drive the pump motors of pots 1-8
+// Speaker:
+//   PA3 is toggled by the Timer 2A interrupt
+// Water level:
+//   PC7 is the C0- comparator input; PE5 (DEINT) discharges the capacitor
+// Sensors:
+//   AIN0 (PE3) battery voltage, AIN2 (PE1) light
+//   Moisture of pots 1-8 on AIN1 (PE2), AIN3 (PE0), AIN4-AIN7 (PD3-PD0),
+//   AIN9 (PE4) and AIN10 (PB4)
+
+// The pins and peripherals above, for C.  board.cpp describes them with
+// hal.h, which checks at compile time that no two share a pin.  Pots are
+// numbered from 0 here; a board with fewer pots leaves the rest unwired.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BOARD_POTS 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initBoardPins();
+void setPump(uint8_t pot, bool on);
+bool isPumpOn(uint8_t pot);
+void setDeint(bool on);
+void toggleSpeaker();
+void startTone(uint32_t period);
+void stopTone();
+void clearToneTimeout();
+void selectLightInput();
+void selectMoistureInput(uint8_t pot);
+void selectBatteryInput();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,91 @@
+// Sensor Capture Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    -
+
+// Hardware configuration:
+// Hibernation module:
+//   HIB_DATA (battery-backed) holds the capture state across resets
+// UART Interface:
+//   Capture records are sent on UART0 in between the text output
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "uart0.h"
+#include "capture.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Write a hibernation module register once the previous write has completed
+void writeCaptureState(uint32_t state)
+{
+    while (!(HIB_CTL_R & HIB_CTL_WRC));
+    HIB_DATA_R = state;
+    while (!(HIB_CTL_R & HIB_CTL_WRC));
+}
+
+// Start capturing if it was armed before this reset
+// Call after the RTC has been enabled
+void initCapture()
+{
+    uint32_t state = HIB_DATA_R;
+    if (state == CAPTURE_ARMED || state == CAPTURE_ACTIVE)
+    {
+        writeCaptureState(CAPTURE_ACTIVE);
+        captureRecord(CAPTURE_BOOT, CAPTURE_VERSION);
+    }
+    else if (state != 0)
+        writeCaptureState(0);
+}
+
+// Arm capture from the next reset on, or stop it now
+void armCapture(bool on)
+{
+    writeCaptureState(on ? CAPTURE_ARMED : 0);
+}
+
+// Send one record whether capturing or not
+void sendRecord(uint8_t kind, uint32_t time, uint32_t value)
+{
+    uint8_t record[CAPTURE_RECORD_SIZE];
+    uint8_t sum = 0;
+    uint8_t i;
+    record[0] = CAPTURE_RECORD | kind;
+    for (i = 0; i < 4; i++)
+    {
+        record[1 + i] = time >> (8 * i);
+        record[5 + i] = value >> (8 * i);
+    }
+    for (i = 0; i < CAPTURE_RECORD_SIZE - 1; i++)
+        sum += record[i];
+    record[CAPTURE_RECORD_SIZE - 1] = -sum;
+    for (i = 0; i < CAPTURE_RECORD_SIZE; i++)
+        putcUart0(record[i]);
+}
+
+// Send one record if capturing
+void captureRecord(uint8_t kind, uint32_t value)
+{
+    uint32_t seconds, time;
+    if (HIB_DATA_R != CAPTURE_ACTIVE)
+        return;
+    do
+    {
+        seconds = HIB_RTCC_R;
+        time = (seconds << 15) | (HIB_RTCSS_R & HIB_RTCSS_RTCSSC_M);
+    }
+    while (seconds != HIB_RTCC_R);
+    sendRecord(kind, time, value);
+}
@@ -0,0 +1,67 @@
+// Sensor Capture Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    -
+
+// Hardware configuration:
+// Hibernation module:
+//   HIB_DATA (battery-backed) holds the capture state across resets
+// UART Interface:
+//   Capture records are sent on UART0 in between the text output
+
+// Every input the firmware acts on (ADC results, the volume timer count,
+// RTC reads, UART characters, EEPROM reads) is sent as a 10-byte record:
+//
+//   0xF8 | kind
+//   time:     RTC seconds << 15 | RTC subseconds, 4 bytes little endian
+//   value:    4 bytes little endian
+//   checksum: two's complement of the sum of the first 9 bytes
+//
+// The first byte is never printable text.  "capture ON" arms capture and it
+// starts at the next reset with a BOOT record, so a trace always begins at
+// power-on and can be replayed from there.  It stays on across resets until
+// "capture OFF".
+//
+// The same records carry other binary telemetry: a STATS record holds a
+// counter number (STATS_* in stats.h) in place of the time.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#define CAPTURE_VERSION 1
+
+// Record kinds
+#define CAPTURE_BOOT   0
+#define CAPTURE_ADC    1
+#define CAPTURE_TIMER1 2
+#define CAPTURE_RTC    3
+#define CAPTURE_UART   4
+#define CAPTURE_EEPROM 5
+#define CAPTURE_STATS  6                // Sent by "stats BIN" (stats.h)
+
+#define CAPTURE_RECORD 0xF8
+#define CAPTURE_RECORD_SIZE 10
+
+// HIB_DATA values
+#define CAPTURE_ARMED  0xCA97A7ED
+#define CAPTURE_ACTIVE 0xCA97AC7E
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initCapture();
+void armCapture(bool on);
+void captureRecord(uint8_t kind, uint32_t value);
+void sendRecord(uint8_t kind, uint32_t time, uint32_t value);
+
+#endif
@@ -0,0 +1,262 @@
+// Channel Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Pumps and moisture sensors:
+//   One of each per pot (board.h)
+// Hibernation module:
+//   The RTC times each pump run and soak, and the drying samples
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "tm4c123gh6pm.h"
+#include "board.h"
+#include "stats.h"
+#include "trace.h"
+#include "channel.h"
+
+#ifdef SIM_HOST
+const char channelsKey = 0;
+#else
+CHANNELS channels;
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initChannels(uint16_t count)
+{
+    CHANNELS *c = &channels;
+    uint8_t i;
+    memset(c, 0, sizeof(CHANNELS));
+    for (i = 0; i < CHANNELS_MAX; i++)
+    {
+        // 9 o'clock in the morning to 5 in the evening
+        setScheduleWindow(&c->channel[i].schedule, 0, 32400, 61200, SCHEDULE_EVERY_DAY);
+        c->channel[i].level = 30;
+        initControl(&c->channel[i].control);
+        initPredict(&c->channel[i].predict);
+    }
+    setChannelCount(count);
+}
+
+// Any count outside 1-CHANNELS_MAX, such as blank EEPROM, gives one pot.
+// Doses in progress stop; thresholds and windows are kept.
+void setChannelCount(uint16_t count)
+{
+    CHANNELS *c = &channels;
+    uint8_t i;
+    for (i = 0; i < CHANNELS_MAX; i++)
+    {
+        if (c->channel[i].state == CHANNEL_PUMPING)
+            setChannelPump(i, false);
+        c->channel[i].state = CHANNEL_IDLE;
+        c->channel[i].dosing = false;
+    }
+    c->count = count >= 1 && count <= CHANNELS_MAX ? count : 1;
+    c->next = 0;
+}
+
+// Anything else, such as blank EEPROM, gives CHANNEL_FIXED
+void setChannelPolicy(uint16_t policy)
+{
+    channels.policy = policy == CHANNEL_PI ? CHANNEL_PI : CHANNEL_FIXED;
+}
+
+// Sets window of pot n's schedule; a window with no days is not used
+void setChannelWindow(uint8_t n, uint8_t window, uint32_t start, uint32_t end, uint8_t days)
+{
+    CHANNEL *channel = &channels.channel[n];
+    setScheduleWindow(&channel->schedule, window, start, end, days);
+    channel->changesAt = 0;
+}
+
+// Looks at the schedule again at its next boundary, or if the clock was set
+// back
+bool isChannelWateringAllowed(CHANNEL *channel, uint32_t seconds)
+{
+    if (seconds >= channel->changesAt || seconds < channel->checkedAt)
+    {
+        uint32_t next = scheduleNextChange(&channel->schedule, seconds);
+        channel->open = isScheduleOpen(&channel->schedule, seconds);
+        channel->checkedAt = seconds;
+        channel->changesAt = next > SCHEDULE_NEVER - seconds ? SCHEDULE_NEVER : seconds + next;
+    }
+    return channel->open;
+}
+
+void setChannelPump(uint8_t n, bool on)
+{
+    setPump(n, on);
+    statsPump(on);
+    if (on)
+        channels.channel[n].watered = true;
+    TRACE_MARK(TRACE_PUMP, TRACE_MOTOR, ((uint32_t)n << 8) | on);
+}
+
+// True while any pot's pump runs
+bool isChannelPumping()
+{
+    CHANNELS *c = &channels;
+    uint8_t i;
+    for (i = 0; i < c->count; i++)
+        if (c->channel[i].state == CHANNEL_PUMPING)
+            return true;
+    return false;
+}
+
+// Seconds until the pot is predicted to reach its level, PREDICT_NEVER if
+// it cannot be said
+uint32_t channelDrySeconds(const CHANNEL *channel, uint32_t seconds)
+{
+    return predictSeconds(&channel->predict, seconds,
+                          (int32_t)((channel->moisture - channel->level) * PREDICT_ONE));
+}
+
+// True for a pot in the last CHANNEL_LEAD of an open schedule that will be
+// below its level before the schedule opens again
+static bool isDryBeforeWindow(const CHANNEL *channel, uint32_t seconds)
+{
+    uint32_t opens;
+    if (channel->changesAt == SCHEDULE_NEVER || channel->changesAt - seconds > CHANNEL_LEAD ||
+        channel->moisture >= channel->level + CHANNEL_EARLY_MAX)
+        return false;
+    opens = scheduleNextChange(&channel->schedule, channel->changesAt);
+    return opens != SCHEDULE_NEVER && channelDrySeconds(channel, seconds) < channel->changesAt - seconds + opens;
+}
+
+// The RTC in CHANNEL_TICKS, which wraps every 36 hours; only differences
+// of it are used
+static uint32_t rtcTicks()
+{
+    uint32_t seconds, ticks;
+    do
+    {
+        seconds = HIB_RTCC_R;
+        ticks = (seconds << 15) | (HIB_RTCSS_R & HIB_RTCSS_RTCSSC_M);
+    }
+    while (seconds != HIB_RTCC_R);
+    return ticks;
+}
+
+// True once the pump has run its time, with how long in ran.  The
+// subseconds are only read in the run's last second, or if the clock was
+// set back, so the loop reads the same thing pass after pass until then.
+static bool isRunDone(const CHANNEL *channel, uint32_t seconds, uint32_t *ran)
+{
+    uint32_t run = (uint32_t)channel->run * CHANNEL_TICKS;
+    int32_t elapsed = (int32_t)((seconds << 15) - channel->pumpedAt);
+    if (elapsed >= -CHANNEL_TICKS && elapsed + CHANNEL_TICKS <= (int32_t)run)
+        return false;
+    *ran = rtcTicks() - channel->pumpedAt;
+    return *ran >= run;
+}
+
+// True once seconds reaches until, or if the clock was set back past the
+// start of the wait
+static bool isDue(uint32_t seconds, uint32_t until)
+{
+    return seconds >= until || until - seconds > CONTROL_SETTLE_MAX + CONTROL_DOSE_MAX;
+}
+
+void serviceChannels(uint32_t seconds, float light)
+{
+    CHANNELS *c = &channels;
+    bool pumping = false;
+    uint8_t i;
+    for (i = 0; i < c->count; i++)
+    {
+        CHANNEL *channel = &c->channel[i];
+        if (predictSample(&channel->predict, seconds, channel->moisture, light,
+                          channel->watered || channel->state != CHANNEL_IDLE))
+            channel->watered = false;
+        uint32_t ran;
+        if (channel->state == CHANNEL_PUMPING && isRunDone(channel, seconds, &ran))
+        {
+            setChannelPump(i, false);
+            channel->state = CHANNEL_SOAKING;
+            if (c->policy == CHANNEL_PI)
+            {
+                controlDoseEnded(&channel->control, seconds, channel->moisture, (float)ran / CHANNEL_TICKS);
+                channel->until = seconds + controlSettleSeconds(&channel->control);
+            }
+            else
+                channel->until = seconds + CHANNEL_SOAK_SECONDS;
+        }
+        else if (channel->state == CHANNEL_SOAKING)
+        {
+            if (c->policy == CHANNEL_PI)
+                controlSample(&channel->control, seconds, channel->moisture);
+            // Soak on while the moisture is still coming up
+            if (isDue(seconds, channel->until) && c->policy == CHANNEL_PI &&
+                isControlSettling(&channel->control, seconds))
+                channel->until = seconds + 1;
+            else if (isDue(seconds, channel->until))
+            {
+                channel->state = CHANNEL_IDLE;
+                if (c->policy == CHANNEL_PI)
+                {
+                    controlSettled(&channel->control, channel->moisture, channel->target);
+                    if (channel->moisture >= channel->target)
+                        channel->dosing = false;
+                }
+            }
+        }
+        if (channel->state == CHANNEL_PUMPING)
+            pumping = true;
+    }
+    if (pumping)
+        return;
+
+    // Round-robin from the pot after the last one dosed
+    for (i = 0; i < c->count; i++)
+    {
+        uint8_t n = (c->next + i) % c->count;
+        CHANNEL *channel = &c->channel[n];
+        uint32_t dose = CHANNEL_PUMP_SECONDS;
+        if (channel->state != CHANNEL_IDLE || !isChannelWateringAllowed(channel, seconds))
+            continue;
+        if (c->policy == CHANNEL_PI)
+        {
+            if (!channel->dosing && channel->moisture < channel->level)
+            {
+                channel->dosing = true;
+                channel->target = channel->level + CONTROL_BAND;
+            }
+            else if (!channel->dosing && isDryBeforeWindow(channel, seconds))
+            {
+                channel->dosing = true;
+                channel->target = channel->moisture + CONTROL_BAND;
+            }
+            if (!channel->dosing)
+                continue;
+            dose = controlDose(&channel->control, channel->moisture, channel->target);
+            if (dose == 0)
+            {
+                channel->dosing = false;
+                continue;
+            }
+        }
+        else if (channel->moisture >= channel->level && !isDryBeforeWindow(channel, seconds))
+            continue;
+        setChannelPump(n, true);
+        channel->state = CHANNEL_PUMPING;
+        channel->pumpedAt = rtcTicks();
+        channel->run = dose;
+        c->next = (n + 1) % c->count;
+        return;
+    }
+}
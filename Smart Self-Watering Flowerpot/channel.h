@@ -0,0 +1,130 @@
+// Channel Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Pumps and moisture sensors:
+//   One of each per pot (board.h)
+// Hibernation module:
+//   The RTC times each pump run and soak, and the drying samples
+
+// One channel per pot: its moisture, the threshold and watering schedule it
+// is watered by (schedule.h), where its history goes and where it is in a
+// dose.  The pots share the reservoir, the light sensor and the battery.
+//
+// The main loop reads every pot's moisture in turn, then calls
+// serviceChannels() with the time and the light.  A pot below its level
+// while its schedule is open gets a dose, then soaks before it can be dosed
+// again.  One pump runs at a time, so the supply only ever sees one motor,
+// and pots waiting for it are served round-robin.  Doses are timed on the
+// RTC to its subseconds, so the loop keeps answering commands through them
+// and a dose of N seconds runs N seconds, not anything from N - 1 up.  The
+// low water and battery alerts block, so isChannelPumping() holds them off.
+//
+// The policy sizes the doses.  CHANNEL_FIXED pumps for CHANNEL_PUMP_SECONDS
+// and soaks for CHANNEL_SOAK_SECONDS, over and over until the pot reads at
+// its level.  CHANNEL_PI keeps dosing until it reads CONTROL_BAND above,
+// with doses and soaks sized by each pot's controller (control.h).
+//
+// Whether a pot's schedule is open is worked out again only when the next
+// window boundary comes, or when the clock is set back.
+//
+// Each pot also learns how fast it dries (predict.h).  In the last
+// CHANNEL_LEAD before its schedule closes a pot still above its level is
+// dosed as if it were below, if it is predicted to reach the level before
+// the schedule opens again, so it does not go dry overnight.  A pot already
+// CHANNEL_EARLY_MAX above its level is left, whatever the prediction.
+// Under CHANNEL_PI those doses aim at CONTROL_BAND above the moisture they
+// start from.
+//
+// The number of pots and the policy are kept in EEPROM; pot n's history is
+// in block n.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CHANNEL_H_
+#define CHANNEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "board.h"
+#include "control.h"
+#include "predict.h"
+#include "schedule.h"
+
+#define CHANNELS_MAX BOARD_POTS
+#define CHANNEL_CONFIG_BLOCK 16         // Word 0: number of pots, 1: policy
+#define CHANNEL_PUMP_SECONDS 5
+#define CHANNEL_SOAK_SECONDS 30
+#define CHANNEL_LEAD 3600               // Seconds before the schedule closes
+#define CHANNEL_EARLY_MAX 20            // Percent above the level
+#define CHANNEL_TICKS 32768             // RTC ticks a second
+
+#define CHANNEL_IDLE    0
+#define CHANNEL_PUMPING 1
+#define CHANNEL_SOAKING 2
+
+// Policies
+#define CHANNEL_FIXED 0
+#define CHANNEL_PI    1
+
+typedef struct _CHANNEL
+{
+    SCHEDULE schedule;
+    bool open;                          // The schedule, as of checkedAt
+    uint32_t checkedAt;                 // RTC seconds
+    uint32_t changesAt;                 // The next boundary after it
+    uint16_t level;                     // Watered below this moisture percent
+    float moisture;                     // Last reading, percent
+    uint16_t historyOffset;
+    uint8_t state;
+    bool dosing;                        // Below the PI target since the level
+    float target;                       // The PI target while dosing
+    uint32_t until;                     // RTC seconds the soak ends
+    uint32_t pumpedAt;                  // RTC ticks the run started
+    uint16_t run;                       // Seconds it is to last
+    bool watered;                       // Dosed since the last drying sample
+    CONTROL control;
+    PREDICT predict;
+} CHANNEL;
+
+typedef struct _CHANNELS
+{
+    uint8_t count;
+    uint8_t next;                       // First in line for the pump
+    uint8_t policy;
+    CHANNEL channel[CHANNELS_MAX];
+} CHANNELS;
+
+#ifdef SIM_HOST
+// Each simulated pot has its own
+#include "simhw.h"
+extern const char channelsKey;
+#define channels (*(CHANNELS *)simGlobal(&channelsKey, sizeof(CHANNELS)))
+#else
+extern CHANNELS channels;
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initChannels(uint16_t count);
+void setChannelCount(uint16_t count);
+void setChannelPolicy(uint16_t policy);
+void setChannelWindow(uint8_t n, uint8_t window, uint32_t start, uint32_t end, uint8_t days);
+bool isChannelWateringAllowed(CHANNEL *channel, uint32_t seconds);
+void setChannelPump(uint8_t n, bool on);
+bool isChannelPumping();
+uint32_t channelDrySeconds(const CHANNEL *channel, uint32_t seconds);
+void serviceChannels(uint32_t seconds, float light);
+
+#endif
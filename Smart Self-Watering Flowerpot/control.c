@@ -0,0 +1,115 @@
+// Moisture Control Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Hibernation module:
+//   The RTC times each dose and soak (channel.h)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "control.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static float clamp(float value, float low, float high)
+{
+    return value < low ? low : value > high ? high : value;
+}
+
+void initControl(CONTROL *control)
+{
+    control->gain = CONTROL_GAIN_START;
+    control->settle = CONTROL_SETTLE_START;
+    control->integral = 0;
+    control->dose = 0;
+}
+
+// Seconds to pump now, 0 if the pot is at its target
+uint16_t controlDose(CONTROL *control, float moisture, float target)
+{
+    float error = target - moisture;
+    if (error <= 0)
+        return 0;
+    float seconds = (CONTROL_KP * error + CONTROL_KI * control->integral) / control->gain;
+    uint16_t dose = seconds >= CONTROL_DOSE_MAX ? CONTROL_DOSE_MAX : seconds < 1 ? 1 : (uint16_t)(seconds + 0.5f);
+    control->dose = dose;
+    control->before = moisture;
+    return dose;
+}
+
+// ran is how long the pump was on, to learn the gain from
+void controlDoseEnded(CONTROL *control, uint32_t seconds, float moisture, float ran)
+{
+    control->ran = ran;
+    control->doseEnd = seconds;
+    control->highest = moisture;
+    control->risen = moisture;
+    control->risenAt = seconds;
+}
+
+// Call with each reading while the pot soaks
+void controlSample(CONTROL *control, uint32_t seconds, float moisture)
+{
+    if (moisture > control->highest)
+        control->highest = moisture;
+    if (moisture >= control->risen + CONTROL_RISE)
+    {
+        control->risen = moisture;
+        control->risenAt = seconds;
+    }
+}
+
+// Least soak after a dose
+uint32_t controlSettleSeconds(const CONTROL *control)
+{
+    return (uint32_t)(control->settle + 0.5f);
+}
+
+// True while the moisture may still be rising from the dose
+bool isControlSettling(const CONTROL *control, uint32_t seconds)
+{
+    uint32_t rising = control->risenAt - control->doseEnd;
+    uint32_t quiet = 2 * rising > CONTROL_SETTLE_MARGIN ? 2 * rising : CONTROL_SETTLE_MARGIN;
+    if (seconds - control->doseEnd >= CONTROL_SETTLE_MAX)
+        return false;
+    // Nothing yet from the dose: the water has not reached the probe
+    if (control->highest < control->before + CONTROL_RISE)
+        return true;
+    return seconds - control->risenAt < quiet;
+}
+
+// Learn from the dose once the soak is over
+void controlSettled(CONTROL *control, float moisture, float target)
+{
+    if (control->dose == 0)
+        return;
+
+    // From the end of the dose to the last rise, and the least quiet after
+    // it; the soak itself always lasts at least the settle time, so it is
+    // no measure of it
+    float settled = (float)(control->risenAt - control->doseEnd + CONTROL_SETTLE_MARGIN);
+    control->settle = clamp(control->settle + CONTROL_LEARN * (settled - control->settle),
+                            CONTROL_SETTLE_MIN, CONTROL_SETTLE_MAX);
+
+    float rise = control->highest - control->before;
+    float gain = rise > 0 && control->ran > 0 ? rise / control->ran : 0;
+    control->gain = clamp(control->gain + CONTROL_LEARN * (gain - control->gain), CONTROL_GAIN_MIN, CONTROL_GAIN_MAX);
+
+    // No integration on a dose that was already as long as allowed
+    float error = target - moisture;
+    if (!(control->dose >= CONTROL_DOSE_MAX && error > 0))
+        control->integral = clamp(control->integral + error, -CONTROL_INTEGRAL_LIMIT, CONTROL_INTEGRAL_LIMIT);
+}
@@ -0,0 +1,84 @@
+// Moisture Control Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Hibernation module:
+//   The RTC times each dose and soak (channel.h)
+
+// Sizes doses to bring a pot from below its level up to a target
+// CONTROL_BAND above it, in place of the fixed 5 s doses.  Each dose is
+//
+//   seconds = (KP * error + KI * integral) / gain
+//
+// where error is the target minus the moisture, integral the sum of the
+// errors left after past doses, and gain the moisture rise per pump second.
+// The integral stops growing while doses are at CONTROL_DOSE_MAX and is
+// limited, so a dry reservoir or a stuck probe cannot wind it up.
+//
+// After a dose the pot soaks for at least the settle time, and on until the
+// probe has risen by CONTROL_RISE and then gone twice as long as its last
+// rise took without another, so a slow probe is waited for.  How far the
+// moisture rose teaches the gain, and how long until its last rise the
+// settle time for the next dose, which can fall as well as rise.  The
+// learned figures are kept per pot and start from what the fixed doses
+// assume.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef CONTROL_H_
+#define CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONTROL_BAND 5                  // Target above the level, percent
+#define CONTROL_KP 0.8f
+#define CONTROL_KI 0.2f
+#define CONTROL_INTEGRAL_LIMIT 50.0f    // Percent
+#define CONTROL_DOSE_MAX 20             // Seconds
+#define CONTROL_GAIN_START 1.0f         // Percent per pump second
+#define CONTROL_GAIN_MIN 0.05f
+#define CONTROL_GAIN_MAX 10.0f
+#define CONTROL_SETTLE_START 30.0f      // Seconds
+#define CONTROL_SETTLE_MIN 5.0f
+#define CONTROL_SETTLE_MAX 900.0f
+#define CONTROL_SETTLE_MARGIN 5         // Seconds without a rise, at least
+#define CONTROL_RISE 0.5f               // Percent, less is noise
+#define CONTROL_LEARN 0.25f             // Weight of each new observation
+
+typedef struct _CONTROL
+{
+    float gain;
+    float settle;
+    float integral;
+    uint16_t dose;                      // Seconds of the last dose
+    float ran;                          // Seconds it actually ran
+    float before;                       // Moisture when it started
+    float highest;                      // Since it ended
+    float risen;                        // Moisture at the last rise
+    uint32_t doseEnd;                   // RTC seconds
+    uint32_t risenAt;
+} CONTROL;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initControl(CONTROL *control);
+uint16_t controlDose(CONTROL *control, float moisture, float target);
+void controlDoseEnded(CONTROL *control, uint32_t seconds, float moisture, float ran);
+void controlSample(CONTROL *control, uint32_t seconds, float moisture);
+uint32_t controlSettleSeconds(const CONTROL *control);
+bool isControlSettling(const CONTROL *control, uint32_t seconds);
+void controlSettled(CONTROL *control, float moisture, float target);
+
+#endif
@@ -0,0 +1,34 @@
+// DWT Cycle Counter Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT counts core clock cycles once trace is enabled in DEMCR
+//   (NVIC_DBG_INT in tm4c123gh6pm.h) and CYCCNTENA is set
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "dwt.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Start the cycle counter used by the benchmarks, trace points and statistics
+void initDwt()
+{
+    NVIC_DBG_INT_R |= NVIC_DBG_INT_TRCENA;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+}
@@ -0,0 +1,38 @@
+// DWT Cycle Counter Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT counts core clock cycles once trace is enabled in DEMCR
+//   (NVIC_DBG_INT in tm4c123gh6pm.h) and CYCCNTENA is set
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef DWT_H_
+#define DWT_H_
+
+// Not in tm4c123gh6pm.h
+#ifndef DWT_CTRL_R
+#define DWT_CTRL_R   (*((volatile uint32_t *)0xE0001000))
+#define DWT_CYCCNT_R (*((volatile uint32_t *)0xE0001004))
+#endif
+
+#define DWT_CTRL_CYCCNTENA 0x00000001   // Enable CYCCNT
+#define NVIC_DBG_INT_TRCENA 0x01000000  // Enable DWT and ITM (DEMCR)
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initDwt();
+
+#endif
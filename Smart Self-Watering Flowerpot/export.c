@@ -0,0 +1,65 @@
+// History Export Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    -
+
+// Hardware configuration:
+// UART Interface:
+//   Export blocks are sent on UART0 after the echo of the command
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart0.h"
+#include "export.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, from 0xFFFF) carried on over data,
+// a bit at a time: a block is at most 38 bytes
+uint16_t exportCrc(uint16_t crc, const uint8_t *data, uint8_t length)
+{
+    uint8_t i, bit;
+    for (i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+// Send count words (up to EXPORT_WORDS) as one block
+void sendExportBlock(uint16_t offset, const uint16_t *words, uint8_t count)
+{
+    uint8_t block[6 + 2 * EXPORT_WORDS];
+    uint8_t length = 0;
+    uint8_t i;
+    uint16_t crc;
+    if (count > EXPORT_WORDS)
+        count = EXPORT_WORDS;
+    block[length++] = EXPORT_BLOCK;
+    block[length++] = offset;
+    block[length++] = offset >> 8;
+    block[length++] = count;
+    for (i = 0; i < count; i++)
+    {
+        block[length++] = words[i];
+        block[length++] = words[i] >> 8;
+    }
+    crc = exportCrc(0xFFFF, block, length);
+    block[length++] = crc;
+    block[length++] = crc >> 8;
+    for (i = 0; i < length; i++)
+        putcUart0(block[i]);
+}
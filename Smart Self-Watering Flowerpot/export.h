@@ -0,0 +1,59 @@
+// History Export Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    -
+
+// Hardware configuration:
+// UART Interface:
+//   Export blocks are sent on UART0 after the echo of the command
+
+// "export [WORD]" sends the history log in binary, for a gateway filling in
+// what it missed: far fewer bytes than "History" and every pot in one
+// command.  The log is each pot's EEPROM block of HISTORY_WORDS words, pot 1
+// first, numbered from 0 across the pots.  Each word holds a 16-bit reading.
+// The words from WORD on (0 if not given) go out in blocks of up to
+// EXPORT_WORDS:
+//
+//   0xFF
+//   offset:   word number of the first word, 2 bytes little endian
+//   count:    words in the block, 1 byte
+//   words:    count words, 2 bytes little endian each
+//   crc:      CRC-16/CCITT-FALSE of the bytes before, 2 bytes little endian
+//
+// and then an end block, with offset EXPORT_END and a word per pot: where
+// that pot's next reading will be written, so the oldest comes first after
+// it.  The number of pots is the end block's count.
+//
+// A receiver that loses a block or finds one damaged asks again from the
+// first word it is missing.  0xFF is not a capture record's lead byte
+// (capture.h), and any capture records sent while capturing come between
+// blocks.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef EXPORT_H_
+#define EXPORT_H_
+
+#include <stdint.h>
+
+#define HISTORY_WORDS 15                // Per pot: 5 readings of 3 words
+
+#define EXPORT_BLOCK 0xFF
+#define EXPORT_WORDS 16
+#define EXPORT_END   0xFFFF
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint16_t exportCrc(uint16_t crc, const uint8_t *data, uint8_t length);
+void sendExportBlock(uint16_t offset, const uint16_t *words, uint8_t count);
+
+#endif
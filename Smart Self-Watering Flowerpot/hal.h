@@ -0,0 +1,286 @@
+// Hardware Abstraction Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// GPIO ports A-F (APB aperture)
+// ADC0 analog inputs AIN0-AIN11 through sample sequencer 3
+// 32-bit timers 0-5 (subtimer A)
+
+// Header-only C++: every pin, analog input and timer is a type whose
+// register addresses are compile-time constants, so each method is one load
+// or store, through the bit-band alias wherever it changes a single bit.
+// The addresses are the ones in tm4c123gh6pm.h; its bit fields are checked
+// against them here, and the host build checks every address against a
+// list it generates from the header.  pinsDistinct<...>() lets a
+// static_assert catch two functions given the same pin.
+//
+// The host build (SIM_HOST) sends the same accesses to the simulated
+// register file through simRegister().  C code uses board.h.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#ifndef __cplusplus
+#error "hal.h is C++; C code uses board.h"
+#endif
+
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+#ifdef SIM_HOST
+#include "simhw.h"
+#include "tm4c123gh6pm_addresses.h"
+#endif
+
+namespace hal {
+
+//-----------------------------------------------------------------------------
+// Registers
+//-----------------------------------------------------------------------------
+
+inline volatile uint32_t &reg(uint32_t address)
+{
+#ifdef SIM_HOST
+    return *(volatile uint32_t *)simRegister(address);
+#else
+    return *(volatile uint32_t *)(uintptr_t)address;
+#endif
+}
+
+// Alias word of one bit of a peripheral register
+constexpr uint32_t bitBand(uint32_t address, uint8_t bit)
+{
+    return 0x42000000 + (address - 0x40000000) * 32 + bit * 4;
+}
+
+template <uint32_t Address, uint8_t Bit>
+struct RegisterBit
+{
+    static_assert(Address >= 0x40000000 && Address < 0x40100000, "not in the peripheral bit-band region");
+    static_assert(Bit < 32, "registers are 32 bits");
+
+    static constexpr uint32_t alias = bitBand(Address, Bit);
+
+    static void write(bool on) { reg(bitBand(Address, Bit)) = on; }
+    static bool read() { return reg(bitBand(Address, Bit)); }
+};
+
+//-----------------------------------------------------------------------------
+// GPIO
+//-----------------------------------------------------------------------------
+
+enum class Port : uint8_t { A, B, C, D, E, F };
+
+constexpr uint32_t portBase(Port port)
+{
+    return port == Port::A ? 0x40004000 :
+           port == Port::B ? 0x40005000 :
+           port == Port::C ? 0x40006000 :
+           port == Port::D ? 0x40007000 :
+           port == Port::E ? 0x40024000 : 0x40025000;
+}
+
+const uint32_t GPIO_DATA  = 0x3FC;      // All bits unmasked
+const uint32_t GPIO_DIR   = 0x400;
+const uint32_t GPIO_AFSEL = 0x420;
+const uint32_t GPIO_DEN   = 0x51C;
+const uint32_t GPIO_AMSEL = 0x528;
+
+template <Port P, uint8_t Bit>
+struct Pin
+{
+    static_assert(Bit < 8, "a port has 8 pins");
+
+    static constexpr Port port = P;
+    static constexpr uint8_t bit = Bit;
+    static constexpr uint8_t mask = 1 << Bit;
+    static constexpr uint8_t id = (uint8_t)P * 8 + Bit;
+
+    typedef RegisterBit<portBase(P) + GPIO_DATA, Bit> Data;
+    typedef RegisterBit<portBase(P) + GPIO_DIR, Bit> Dir;
+    typedef RegisterBit<portBase(P) + GPIO_AFSEL, Bit> Afsel;
+    typedef RegisterBit<portBase(P) + GPIO_DEN, Bit> Den;
+    typedef RegisterBit<portBase(P) + GPIO_AMSEL, Bit> Amsel;
+
+    static void write(bool on) { Data::write(on); }
+    static bool read() { return Data::read(); }
+
+    static void toggle()
+    {
+        volatile uint32_t &data = reg(bitBand(portBase(P) + GPIO_DATA, Bit));
+        data = data ^ 1;
+    }
+
+    static void makeOutput()
+    {
+        Dir::write(1);
+        Den::write(1);
+    }
+
+    static void makeInput()
+    {
+        Dir::write(0);
+        Den::write(1);
+    }
+
+    // Analog input with the digital input buffer off
+    static void makeAnalog()
+    {
+        Dir::write(0);
+        Den::write(0);
+        Amsel::write(1);
+    }
+};
+
+// True if no two of the pins are the same
+template <class... Pins>
+constexpr bool pinsDistinct()
+{
+    const uint8_t ids[] = { Pins::id... };
+    for (unsigned i = 0; i < sizeof...(Pins); i++)
+        for (unsigned j = i + 1; j < sizeof...(Pins); j++)
+            if (ids[i] == ids[j])
+                return false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// ADC0
+//-----------------------------------------------------------------------------
+
+const uint32_t ADC0_BASE   = 0x40038000;
+const uint32_t ADC_ACTSS   = 0x000;
+const uint32_t ADC_SSMUX3  = 0x0A0;
+const uint8_t ADC_ASEN3    = 3;
+
+// Make input the one sample sequencer 3 samples (adc0.h)
+inline void selectAnalogInput(uint8_t input)
+{
+    typedef RegisterBit<ADC0_BASE + ADC_ACTSS, ADC_ASEN3> Asen3;
+    Asen3::write(0);
+    reg(ADC0_BASE + ADC_SSMUX3) = input;
+    Asen3::write(1);
+}
+
+// Pins of AIN0-AIN11
+constexpr Port ainPort(uint8_t input)
+{
+    return input <= 3 || input == 8 || input == 9 ? Port::E : input <= 7 ? Port::D : Port::B;
+}
+
+constexpr uint8_t ainBit(uint8_t input)
+{
+    return input <= 3 ? 3 - input :
+           input <= 7 ? 7 - input :
+           input <= 9 ? 13 - input : input - 6;
+}
+
+template <uint8_t Input>
+struct AnalogInput
+{
+    static_assert(Input < 12, "the TM4C123GH6PM has AIN0-AIN11");
+
+    typedef hal::Pin<ainPort(Input), ainBit(Input)> Pin;
+    static constexpr uint8_t id = Pin::id;
+    static constexpr uint8_t input = Input;
+
+    static void init()
+    {
+        Pin::makeAnalog();
+        Pin::Afsel::write(1);
+    }
+
+    static void select() { selectAnalogInput(Input); }
+};
+
+//-----------------------------------------------------------------------------
+// Timers
+//-----------------------------------------------------------------------------
+
+const uint32_t TIMER_CFG   = 0x000;
+const uint32_t TIMER_TAMR  = 0x004;
+const uint32_t TIMER_CTL   = 0x00C;
+const uint32_t TIMER_IMR   = 0x018;
+const uint32_t TIMER_ICR   = 0x024;
+const uint32_t TIMER_TAILR = 0x028;
+const uint32_t TIMER_TAV   = 0x050;
+const uint8_t TIMER_TAEN   = 0;
+const uint8_t TIMER_TATO   = 0;         // Time-out bit in IMR and ICR
+
+template <uint8_t N>
+struct Timer
+{
+    static_assert(N < 6, "the TM4C123GH6PM has 16/32-bit timers 0-5");
+
+    static constexpr uint32_t base = 0x40030000 + N * 0x1000;
+
+    typedef RegisterBit<base + TIMER_CTL, TIMER_TAEN> Enable;
+
+    static void start() { Enable::write(1); }
+    static void stop() { Enable::write(0); }
+    static void setLoad(uint32_t load) { reg(base + TIMER_TAILR) = load; }
+    static uint32_t value() { return reg(base + TIMER_TAV); }
+    static void clearTimeout() { reg(base + TIMER_ICR) = 1 << TIMER_TATO; }
+};
+
+//-----------------------------------------------------------------------------
+// Checks against tm4c123gh6pm.h
+//-----------------------------------------------------------------------------
+
+static_assert(1u << ADC_ASEN3 == ADC_ACTSS_ASEN3, "ADC_ASEN3");
+static_assert(1u << TIMER_TAEN == TIMER_CTL_TAEN, "TIMER_TAEN");
+static_assert(1u << TIMER_TATO == TIMER_IMR_TATOIM && 1u << TIMER_TATO == TIMER_ICR_TATOCINT, "TIMER_TATO");
+
+#ifdef SIM_HOST
+
+#define HAL_CHECK_PORT(P)                                                                        \
+    static_assert(portBase(Port::P) + GPIO_DATA == GPIO_PORT##P##_DATA_R_ADDRESS, "port " #P);   \
+    static_assert(portBase(Port::P) + GPIO_DIR == GPIO_PORT##P##_DIR_R_ADDRESS, "port " #P);     \
+    static_assert(portBase(Port::P) + GPIO_AFSEL == GPIO_PORT##P##_AFSEL_R_ADDRESS, "port " #P); \
+    static_assert(portBase(Port::P) + GPIO_DEN == GPIO_PORT##P##_DEN_R_ADDRESS, "port " #P);     \
+    static_assert(portBase(Port::P) + GPIO_AMSEL == GPIO_PORT##P##_AMSEL_R_ADDRESS, "port " #P)
+
+#define HAL_CHECK_TIMER(N)                                                                       \
+    static_assert(Timer<N>::base + TIMER_CFG == TIMER##N##_CFG_R_ADDRESS, "timer " #N);          \
+    static_assert(Timer<N>::base + TIMER_TAMR == TIMER##N##_TAMR_R_ADDRESS, "timer " #N);        \
+    static_assert(Timer<N>::base + TIMER_CTL == TIMER##N##_CTL_R_ADDRESS, "timer " #N);          \
+    static_assert(Timer<N>::base + TIMER_IMR == TIMER##N##_IMR_R_ADDRESS, "timer " #N);          \
+    static_assert(Timer<N>::base + TIMER_ICR == TIMER##N##_ICR_R_ADDRESS, "timer " #N);          \
+    static_assert(Timer<N>::base + TIMER_TAILR == TIMER##N##_TAILR_R_ADDRESS, "timer " #N);      \
+    static_assert(Timer<N>::base + TIMER_TAV == TIMER##N##_TAV_R_ADDRESS, "timer " #N)
+
+HAL_CHECK_PORT(A);
+HAL_CHECK_PORT(B);
+HAL_CHECK_PORT(C);
+HAL_CHECK_PORT(D);
+HAL_CHECK_PORT(E);
+HAL_CHECK_PORT(F);
+
+static_assert(ADC0_BASE + ADC_ACTSS == ADC0_ACTSS_R_ADDRESS, "ADC0");
+static_assert(ADC0_BASE + ADC_SSMUX3 == ADC0_SSMUX3_R_ADDRESS, "ADC0");
+
+HAL_CHECK_TIMER(0);
+HAL_CHECK_TIMER(1);
+HAL_CHECK_TIMER(2);
+HAL_CHECK_TIMER(3);
+HAL_CHECK_TIMER(4);
+HAL_CHECK_TIMER(5);
+
+#undef HAL_CHECK_PORT
+#undef HAL_CHECK_TIMER
+
+#endif
+
+}
+
+#endif
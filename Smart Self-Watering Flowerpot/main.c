@@ -21,6 +21,7 @@
 //-----------------------------------------------------------------------------
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -28,38 +29,30 @@
 #include "uart0.h"
 #include "wait.h"
 #include "adc0.h"
+#include "capture.h"
+#include "dwt.h"
+#include "bench.h"
+#include "trace.h"
+#include "stats.h"
+#include "stack.h"
+#include "board.h"
+#include "channel.h"
+#include "export.h"
+#include "baud.h"
 
 #define MAX_CHARS 80
-#define MAX_FIELDS 5
+#define MAX_FIELDS 8
 typedef struct _USER_DATA
 {
  char buffer[MAX_CHARS+1];
  uint8_t fieldCount;
     uint8_t fieldPosition[MAX_FIELDS];
-    char fieldType[MAX_FIELDS];
+    char fieldType[MAX_FIELDS+1];
 } USER_DATA;
 
 
 
 
-// Bitband aliases
-
-#define COMP (*((volatile uint32_t *)(0x42000000 + (0x400063FC-0x40000000)*32 + 7*4)))
-#define DEINT (*((volatile uint32_t *)(0x42000000 + (0x400243FC-0x40000000)*32 + 5*4)))
-#define MOTOR (*((volatile uint32_t *)(0x42000000 + (0x400043FC-0x40000000)*32 + 2*4)))
-#define SPEAKER (*((volatile uint32_t *)(0x42000000 + (0x400043FC-0x40000000)*32 + 3*4)))
-
-#define COMP_MASK 128
-#define DEINT_MASK 32
-
-// PortE masks
-#define AIN1_MASK 4
-#define AIN2_MASK 2
-#define AIN0_MASK 8
-//PORT A masks
-#define MOTOR_MASK 4
-#define SPEAKER_MASK 8
-
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
@@ -75,7 +68,7 @@ void initHw()
     SYSCTL_GPIOHBCTL_R = 0;
 
     // Enable clocks
-    SYSCTL_RCGCGPIO_R = SYSCTL_RCGCGPIO_R4 | SYSCTL_RCGCGPIO_R2 |SYSCTL_RCGCGPIO_R5|SYSCTL_RCGCGPIO_R0;
+    SYSCTL_RCGCGPIO_R = SYSCTL_RCGCGPIO_R4 | SYSCTL_RCGCGPIO_R3 | SYSCTL_RCGCGPIO_R2 |SYSCTL_RCGCGPIO_R5|SYSCTL_RCGCGPIO_R1|SYSCTL_RCGCGPIO_R0;
     //CONFIGURE ADC0
     SYSCTL_RCGCADC_R = SYSCTL_RCGCADC_R0 ;
     SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1|SYSCTL_RCGCTIMER_R2;
@@ -83,23 +76,13 @@ void initHw()
     SYSCTL_RCGCHIB_R = SYSCTL_RCGCHIB_R0 ;
     _delay_cycles(3);
 
+    // Comparator, DEINT, motor, speaker and sensor pins (board.h)
+    initBoardPins();
+
     //CONFIGURE COMPARATOR
-       GPIO_PORTC_DIR_R  &= ~COMP_MASK;
-       // GPIO_PORTC_PCTL_R &= ~GPIO_PCTL_PC7_M;
-       GPIO_PORTC_AMSEL_R = 0x00000080;
        COMP_ACREFCTL_R = 0x0000020F;
        COMP_ACCTL0_R |= 0x0000040C;
 
-       //CONFIGURE DEINT
-       GPIO_PORTE_DIR_R |= DEINT_MASK;
-       GPIO_PORTE_DEN_R |= DEINT_MASK;
-
-       GPIO_PORTA_DIR_R|=MOTOR_MASK;
-       GPIO_PORTA_DEN_R|=MOTOR_MASK;
-
-       GPIO_PORTA_DIR_R|=SPEAKER_MASK;
-       GPIO_PORTA_DEN_R|=SPEAKER_MASK;
-
 
        //CONFIGURE TIMER 1 FOR COUNT UP 25 NS
        TIMER1_CTL_R &= ~TIMER_CTL_TAEN;                 // turn-off timer before reconfiguring
@@ -139,88 +122,82 @@ void initEEPROM()
 
 void Store_Hist( uint16_t data, uint16_t block, uint16_t offset)
 {
+    TRACE_ENTER(TRACE_EEPROM, TRACE_STORE_HIST, ((uint32_t)block << 16) | offset);
     while( EEPROM_EEDONE_R &= EEPROM_EEDONE_WORKING)
         EEPROM_EEBLOCK_R=block;
         EEPROM_EEOFFSET_R=offset;
         EEPROM_EERDWR_R=data;
+    statsEepromWrite();
+    TRACE_EXIT(TRACE_EEPROM, TRACE_STORE_HIST, data);
 
 
 }
 uint16_t Read_Hist(uint16_t block, uint16_t offset)
 {
+    TRACE_ENTER(TRACE_EEPROM, TRACE_READ_HIST, ((uint32_t)block << 16) | offset);
 while(EEPROM_EEDONE_R &= EEPROM_EEDONE_WORKING)
     EEPROM_EEBLOCK_R=block;
     EEPROM_EEOFFSET_R=offset;
-    return EEPROM_EERDWR_R;
+    uint32_t data=EEPROM_EERDWR_R;
+    captureRecord(CAPTURE_EEPROM,data);
+    TRACE_EXIT(TRACE_EEPROM, TRACE_READ_HIST, data);
+    return data;
 
 }
 
 void Erase_Hist(uint16_t block, uint16_t offset)
 {
+    TRACE_ENTER(TRACE_EEPROM, TRACE_ERASE_HIST, ((uint32_t)block << 16) | offset);
     while( EEPROM_EEDONE_R &= EEPROM_EEDONE_WORKING)
            EEPROM_EEBLOCK_R=block;
            EEPROM_EEOFFSET_R=offset;
            EEPROM_EERDWR_R=0;
+    statsEepromWrite();
+    TRACE_EXIT(TRACE_EEPROM, TRACE_ERASE_HIST, 0);
 
 }
 void timer1Isr()
 {
-    SPEAKER ^= 1;
-    TIMER2_ICR_R = TIMER_ICR_TATOCINT;               // clear interrupt flag
+    uint32_t start = DWT_CYCCNT_R;
+    toggleSpeaker();
+    clearToneTimeout();                              // clear interrupt flag
+    statsIsr(STATS_ISR_TIMER2A, start);
 }
 
 void playBatteryLowAlert()
 {
 
-    TIMER2_CTL_R |= TIMER_CTL_TAEN;
-    TIMER2_TAILR_R=19111.3235;
+    startTone(19111);
+    waitMicrosecond(2000000);
+    stopTone();
+    startTone(102040);
     waitMicrosecond(2000000);
-    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
-       //TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
-    TIMER2_CTL_R |= TIMER_CTL_TAEN;
-       TIMER2_TAILR_R=102040.816;
-           waitMicrosecond(2000000);
-              TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
+    stopTone();
 
 }
 void playWaterLowAlert()
 {
 
-    TIMER2_CTL_R |= TIMER_CTL_TAEN;
-      TIMER2_TAILR_R=19111.3235;
-      waitMicrosecond(2000000);
-      TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
-         //TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
-      TIMER2_CTL_R |= TIMER_CTL_TAEN;
-         TIMER2_TAILR_R=102040.816;
-             waitMicrosecond(2000000);
-                TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
+    startTone(19111);
+    waitMicrosecond(2000000);
+    stopTone();
+    startTone(102040);
+    waitMicrosecond(2000000);
+    stopTone();
 
 }
 
 
-void enablePump()
-{
-
-    MOTOR=1;
-    //waitMicrosecond(4000000);
-    //MOTOR=0;
-}
-void disablePump()
-{
-    MOTOR=0;
-}
-
 float getLightPercentage()
 {
     uint16_t raw;
     float instantLight = 0;
-    GPIO_PORTE_AFSEL_R |= AIN2_MASK;
-    GPIO_PORTE_DEN_R &= ~AIN2_MASK;
-    GPIO_PORTE_AMSEL_R |= AIN2_MASK;
-    setAdc0Ss3Mux(2);
+    TRACE_ENTER(TRACE_SENSORS, TRACE_LIGHT, 0);
+    selectLightInput();
     setAdc0Ss3Log2AverageCount(2);
      raw = readAdc0Ss3();
+     captureRecord(CAPTURE_ADC, raw);
+     TRACE_EXIT(TRACE_SENSORS, TRACE_LIGHT, raw);
     instantLight = (((raw+0.5) / 4096.0 )*3.3) ;
    // char lightvoltage[100];
    // sprintf(lightvoltage,"lightvoltage : %4.1f",instantLight);
@@ -229,17 +206,17 @@ float getLightPercentage()
     lightpercentage=(instantLight/3.3)*100;;
     return lightpercentage;
 }
-float getMoisturePercentage()
+float getMoisturePercentage(uint8_t pot)
 {
     uint16_t raw1;
     float instantMoisture=0;
-    GPIO_PORTE_AFSEL_R |= AIN1_MASK;
-    GPIO_PORTE_DEN_R &= ~AIN1_MASK;
-    GPIO_PORTE_AMSEL_R |= AIN1_MASK;
-    setAdc0Ss3Mux(1);
+    TRACE_ENTER(TRACE_SENSORS, TRACE_MOISTURE, pot);
+    selectMoistureInput(pot);
     setAdc0Ss3Log2AverageCount(2);
     // Read sensor
     raw1 = readAdc0Ss3();
+    captureRecord(CAPTURE_ADC, raw1);
+    TRACE_EXIT(TRACE_SENSORS, TRACE_MOISTURE, raw1);
     instantMoisture = (((raw1+0.5) / 4096.0 )*3.3) ;
     //char moisturevoltage[100];
     //sprintf(moisturevoltage,"moisturevoltage : %4.1f",instantMoisture);
@@ -253,13 +230,13 @@ float getBatteryVoltage()
 {
     uint16_t raw2;
     float instantVoltage=0;
-    GPIO_PORTE_AFSEL_R |= AIN0_MASK;
-    GPIO_PORTE_DEN_R &= ~AIN0_MASK;
-    GPIO_PORTE_AMSEL_R |= AIN0_MASK;
-    setAdc0Ss3Mux(0);
+    TRACE_ENTER(TRACE_SENSORS, TRACE_BATTERY, 0);
+    selectBatteryInput();
     setAdc0Ss3Log2AverageCount(2);
     // Read sensor
     raw2 = readAdc0Ss3();
+    captureRecord(CAPTURE_ADC, raw2);
+    TRACE_EXIT(TRACE_SENSORS, TRACE_BATTERY, raw2);
     instantVoltage = (((raw2+0.5) / 4096.0 )*3.3) ;
     return instantVoltage;
 }
@@ -303,22 +280,9 @@ char* getFieldString(USER_DATA* data, uint8_t fieldNumber)
       {
           return NULL;
       }
-    int i=data->fieldPosition[fieldNumber];
-
-    char check[MAX_CHARS];
-    int loop=1;
-    int store=0;
-    while(loop)
-    {
-      char value= data->buffer[i];
-      check[store]=value;
-      if (data->buffer[i]=='\0')
-      {
-          return check;
-      }
-      i++;
-      store++;
-    }
+    // Fields are null-terminated in place by parseFields(), so return the
+    // field itself rather than a copy that would not outlive this call
+    return &data->buffer[data->fieldPosition[fieldNumber]];
 }
 int32_t getFieldInteger(USER_DATA* data, uint8_t fieldNumber)
 {
@@ -421,6 +385,14 @@ parseFields(USER_DATA* data)
     }
 }
 
+uint32_t getCurrentSeconds()
+{
+    uint32_t time= HIB_RTCC_R;
+    captureRecord(CAPTURE_RTC, time);
+    return time;
+
+}
+
 //-----------------------------------------------------------------------------
 // getsUart0
 //-----------------------------------------------------------------------------
@@ -429,7 +401,13 @@ getsUart0(USER_DATA* data)
     int count=0;
     while(1)
     {
+    // A baud switch not confirmed falls back even part way through a line,
+    // which was most likely garbled by the wrong rate (baud.h)
+    while (isBaudPending() && !kbhitUart0())
+        if (serviceBaud(getCurrentSeconds()))
+            count=0;
     char c = getcUart0();
+    captureRecord(CAPTURE_UART, (uint8_t)c);
     if (c==8||c==127)
     {
         if (count>0)
@@ -458,32 +436,201 @@ getsUart0(USER_DATA* data)
 
 uint32_t getVolume()
 {
-    DEINT=1;
+    TRACE_ENTER(TRACE_VOLUME, TRACE_GET_VOLUME, 0);
+    setDeint(true);
     waitMicrosecond(1000);
-    DEINT=0;
+    setDeint(false);
     TIMER1_TAV_R=0;
     while(COMP_ACSTAT0_R && COMP_ACSTAT0_OVAL );
-    return TIMER1_TAV_R;
+    uint32_t count=TIMER1_TAV_R;
+    captureRecord(CAPTURE_TIMER1, count);
+    TRACE_EXIT(TRACE_VOLUME, TRACE_GET_VOLUME, count);
+    return count;
 }
-uint32_t getCurrentSeconds()
+// Read every pot's moisture in turn into its channel
+void readChannels()
 {
-    uint32_t time= HIB_RTCC_R;
-    return time;
+    uint8_t i;
+    for (i = 0; i < channels.count; i++)
+        channels.channel[i].moisture = getMoisturePercentage(i);
+}
+
+// Pot number in field, 1-based, or 0 for all pots if there is no such field.
+// Returns false for a pot that is not there.
+bool getPotField(USER_DATA* data, uint8_t field, uint8_t *pot)
+{
+    *pot = 0;
+    if (data->fieldCount <= field)
+        return true;
+    int32_t n = getFieldInteger(data, field);
+    if (n < 1 || n > channels.count)
+    {
+        putsUart0("No such pot\n\r");
+        return false;
+    }
+    *pot = n;
+    return true;
+}
+
+// Report the sensors, add them to the history of each pot from block on and
+// sound any alert
+void reportStatus(uint16_t block)
+{
+    char volume[100];
+    uint32_t timer;
+    float vol;
+    timer=getVolume();
+    //timer=(timer*25)/100000;
+    vol= (0.5330*(timer-322));
+    sprintf(volume,"Volume: %f mililiters\n\r",vol);
+    putsUart0(volume);
+
+    // For light sensor
+    float lightpercentage=getLightPercentage();
+    char lightpercentagec[50];
+    sprintf(lightpercentagec,"lightpercentage : %4.1f\n\r",lightpercentage);
+    putsUart0(lightpercentagec);
+
+    //For moisture sensor, one line per pot
+    uint8_t pot;
+    float moisturepercentage[CHANNELS_MAX];
+    for (pot=0;pot<channels.count;pot++)
+    {
+        moisturepercentage[pot]=getMoisturePercentage(pot);
+        char moisturepercentagec[50];
+        if (channels.count==1)
+            sprintf(moisturepercentagec,"moisturepercentage : %4.1f\n\r",moisturepercentage[pot]);
+        else
+            sprintf(moisturepercentagec,"moisturepercentage %u : %4.1f\n\r",pot+1,moisturepercentage[pot]);
+        putsUart0(moisturepercentagec);
+    }
+
+    // Pumps, a digit per pot, 1 while it runs
+    char pumpsc[20]="pumps : ";
+    for (pot=0;pot<channels.count;pot++)
+        pumpsc[8+pot]=isPumpOn(pot)?'1':'0';
+    strcpy(pumpsc+8+channels.count,"\n\r");
+    putsUart0(pumpsc);
+
+    //For voltage sensor
+    float BatteryVoltage= 0;
+    BatteryVoltage=getBatteryVoltage();
+    char batteryvoltage[100];
+    BatteryVoltage= (BatteryVoltage/47000)*(47000+100000);
+    sprintf(batteryvoltage,"batteryvoltage : %4.1f\n\r",BatteryVoltage);
+    putsUart0(batteryvoltage);
+    for (pot=0;pot<channels.count;pot++)
+    {
+        uint16_t *offset=&channels.channel[pot].historyOffset;
+        Store_Hist(moisturepercentage[pot],block+pot,*offset);
+        (*offset)++;
+        Store_Hist(lightpercentage,block+pot,*offset);
+        (*offset)++;
+        Store_Hist(vol,block+pot,*offset);
+        (*offset)++;
+        if (*offset==15)
+        {
+            *offset=0;
+        }
+    }
 
+    // The alerts block, so not while a dose is timed (channel.h)
+    if (lightpercentage>10&&vol<50&&!isChannelPumping())
+    {
+        playWaterLowAlert();
+    }
+    if (lightpercentage>10&&BatteryVoltage<1.0&&!isChannelPumping())
+    {
+        playBatteryLowAlert();
+    }
 }
-bool isWateringAllowed(uint32_t start,uint32_t end)
+
+#ifdef BENCHMARK
+//-----------------------------------------------------------------------------
+// Benchmarks
+//-----------------------------------------------------------------------------
+
+// Built with BENCHMARK defined as the number of runs, the firmware times its
+// hot routines, sends the report (bench.h) and stops.  EEPROM writes go to
+// blocks the history and settings do not use, one per pot.
+
+#define BENCH_BLOCK 24
+
+void benchNothing(void *context)
 {
-    uint32_t current_time=getCurrentSeconds();
-if (end>current_time&&current_time>start)
+}
+void prepareParseFields(void *context)
 {
-return true;
+    strcpy(((USER_DATA*)context)->buffer, "water 7 0 19 0");
 }
-else {
-    return false;
+void benchParseFields(void *context)
+{
+    parseFields((USER_DATA*)context);
+}
+void benchReadAdc0Ss3(void *context)
+{
+    readAdc0Ss3();
+}
+void benchGetVolume(void *context)
+{
+    getVolume();
+}
+// Time the call, not the previous write
+void prepareEeprom(void *context)
+{
+    while (EEPROM_EEDONE_R & EEPROM_EEDONE_WORKING);
+}
+void benchStoreHist(void *context)
+{
+    Store_Hist(0x5A5A, BENCH_BLOCK, 0);
+}
+void benchReportStatus(void *context)
+{
+    reportStatus(BENCH_BLOCK);
 }
 
+// Eight hours of steps over a morning, drying too slowly to reach the
+// level inside the horizon, so the prediction takes its longest walk
+void preparePredict(void *context)
+{
+    PREDICT *predict=(PREDICT*)context;
+    uint8_t i;
+    initPredict(predict);
+    for (i=0;i<=PREDICT_STEPS;i++)
+        predictSample(predict,i*PREDICT_PERIOD,80-i*0.01f,i*2.0f,false);
+}
+void benchPredictFit(void *context)
+{
+    predictFit((PREDICT*)context);
+}
+void benchPredictSeconds(void *context)
+{
+    predictSeconds((PREDICT*)context,1800,50*PREDICT_ONE);
 }
 
+void runBenchmarks()
+{
+    USER_DATA data;
+    PREDICT predict;
+    const BENCH benches[] =
+    {
+        { "nothing", 0, benchNothing, 0 },
+        { "parseFields", prepareParseFields, benchParseFields, &data },
+        { "readAdc0Ss3", 0, benchReadAdc0Ss3, 0 },
+        { "getVolume", 0, benchGetVolume, 0 },
+        { "Store_Hist", prepareEeprom, benchStoreHist, 0 },
+        { "reportStatus", prepareEeprom, benchReportStatus, 0 },
+        { "predictFit", preparePredict, benchPredictFit, &predict },
+        { "predictSeconds", preparePredict, benchPredictSeconds, &predict },
+    };
+    uint8_t i;
+    // Leaves SS3 sampling the first pot's moisture sensor
+    getMoisturePercentage(0);
+    printBenchHeader();
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+        runBench(&benches[i], BENCHMARK);
+}
+#endif
 
 //-----------------------------------------------------------------------------
 // Main
@@ -492,6 +639,7 @@ else {
 int main(void)
 {
     USER_DATA data;
+    paintStack();
     initHw();
     initUart0();
     initAdc0Ss3();
@@ -504,11 +652,16 @@ int main(void)
     while(!(HIB_CTL_R & 0x80000000));
     //HIB_RTCLD_R = 43200;
     HIB_CTL_R |= HIB_CTL_RTCEN;
+    initCapture();
+    initDwt();
+    initStats();
+    initChannels(Read_Hist(CHANNEL_CONFIG_BLOCK, 0));
+    setChannelPolicy(Read_Hist(CHANNEL_CONFIG_BLOCK, 1));
+#ifdef BENCHMARK
+    runBenchmarks();
+    return 0;
+#endif
     //uint32_t current_time=getCurrentSeconds();
-    uint16_t offset=0;
-    uint32_t start_time= 32400; //9 o'clock in the morning
-    uint32_t end_time= 61200;   //5o'clock in the evening
-    uint32_t water_level=30;
            //while(1)
                       //{
 
@@ -517,6 +670,7 @@ int main(void)
                      // }
     while(1)
     {
+        statsLoop();
         //playBatteryLowAlert();
         if (kbhitUart0())
         {
@@ -526,6 +680,7 @@ int main(void)
     putsUart0(data.buffer);
     // Parse fields
     parseFields(&data);
+    TRACE_ENTER(TRACE_COMMANDS, TRACE_COMMAND, traceText(data.buffer));
     // Echo back the parsed field information (type and fields)
     uint8_t i;
     putcUart0('\n');
@@ -543,75 +698,191 @@ int main(void)
     bool valid=false;
     if (isCommand(&data, "status", 0))
     {
-      char volume[100];
-      uint32_t timer;
-      float vol;
-      timer=getVolume();
-      //timer=(timer*25)/100000;
-      vol= (0.5330*(timer-322));
-      sprintf(volume,"Volume: %f mililiters\n\r",vol);
-      putsUart0(volume);
-
-      // For light sensor
-      float lightpercentage=getLightPercentage();
-      char lightpercentagec[50];
-      sprintf(lightpercentagec,"lightpercentage : %4.1f\n\r",lightpercentage);
-      putsUart0(lightpercentagec);
-
-      //For moisture sensor
-      float moisturepercentage=0;
-      moisturepercentage=getMoisturePercentage();
-      char moisturepercentagec[50];
-      sprintf(moisturepercentagec,"moisturepercentage : %4.1f\n\r",moisturepercentage);
-      putsUart0(moisturepercentagec);
-
-      //For voltage sensor
-      float BatteryVoltage= 0;
-      BatteryVoltage=getBatteryVoltage();
-      char batteryvoltage[100];
-      BatteryVoltage= (BatteryVoltage/47000)*(47000+100000);
-      sprintf(batteryvoltage,"batteryvoltage : %4.1f\n\r",BatteryVoltage);
-      putsUart0(batteryvoltage);
+      reportStatus(0);
       valid=true;
-      Store_Hist(moisturepercentage,0,offset);
-      offset++;
-       Store_Hist(lightpercentage,0,offset);
-       offset++;
-
-       Store_Hist(vol,0,offset);
-       offset++;
-       if (offset==15)
-                      {
-                          offset=0;
-                      }
-
-      if (lightpercentage>10&&vol<50)
-      {
-          playWaterLowAlert();
-      }
-      if (lightpercentage>10&&BatteryVoltage<1.0)
-      {
-          playBatteryLowAlert();
-      }
     }
     if (isCommand(&data, "Pump", 1))
+    {
+        char *str  = getFieldString(&data, 1);
+        uint8_t pot;
+        if (getPotField(&data, 2, &pot))
+        {
+            if (pot>0)
+                pot--;
+            if (strcmp(str,"ON")==0)
+            {
+                setChannelPump(pot, true);
+                putsUart0("On now");
+            }
+            if (strcmp(str,"OFF")==0)
+            {
+                setChannelPump(pot, false);
+                putsUart0("Off now");
+            }
+        }
+        valid=true;
+    }
+    if (isCommand(&data, "pots", 0))
+    {
+        if (data.fieldCount > 1)
+        {
+            int32_t count=getFieldInteger(&data,1);
+            if (count>=1&&count<=CHANNELS_MAX)
+            {
+                setChannelCount(count);
+                Store_Hist(count,CHANNEL_CONFIG_BLOCK,0);
+            }
+            else
+                putsUart0("Pots are 1 to 8\n\r");
+        }
+        char potsc[20];
+        sprintf(potsc,"pots : %u\n\r",channels.count);
+        putsUart0(potsc);
+        valid=true;
+    }
+    if (isCommand(&data, "control", 0))
+    {
+        char *str = data.fieldCount > 1 ? getFieldString(&data, 1) : "";
+        if (strcmp(str,"PI")==0||strcmp(str,"FIXED")==0)
+        {
+            setChannelPolicy(strcmp(str,"PI")==0 ? CHANNEL_PI : CHANNEL_FIXED);
+            Store_Hist(channels.policy,CHANNEL_CONFIG_BLOCK,1);
+        }
+        putsUart0(channels.policy==CHANNEL_PI ? "control : PI\n\r" : "control : FIXED\n\r");
+        if (channels.policy==CHANNEL_PI)
+        {
+            uint8_t pot;
+            for (pot=0;pot<channels.count;pot++)
+            {
+                const CONTROL *control=&channels.channel[pot].control;
+                char controlc[80];
+                sprintf(controlc,"pot %u : gain %4.2f %%/s, settle %4.0f s, integral %5.1f\n\r",
+                        pot+1,control->gain,control->settle,control->integral);
+                putsUart0(controlc);
+            }
+        }
+        valid=true;
+    }
+    if (isCommand(&data, "window", 0))
+    {
+        uint8_t pot=0;
+        // window N H1 M1 H2 M2 DAYS [pot], DAYS as digits 1 (Monday) to 7
+        if (data.fieldCount>6&&getPotField(&data, 7, &pot))
+        {
+            uint32_t window=getFieldInteger(&data,1);
+            uint32_t digits=getFieldInteger(&data,6);
+            uint8_t days=0;
+            for (;digits>0;digits/=10)
+                if (digits%10>=1&&digits%10<=7)
+                    days|=1<<(digits%10-1);
+            uint8_t i;
+            if (window>=1&&window<=SCHEDULE_WINDOWS)
+            {
+                for (i=0;i<channels.count;i++)
+                    if (pot==0||pot==i+1)
+                        setChannelWindow(i,window-1,getFieldInteger(&data,2)*3600+getFieldInteger(&data,3)*60,
+                                         getFieldInteger(&data,4)*3600+getFieldInteger(&data,5)*60,days);
+            }
+            else
+                putsUart0("Windows are 1 to 4\n\r");
+        }
+        uint32_t seconds=getCurrentSeconds();
+        uint8_t i,window,day;
+        for (i=0;i<channels.count;i++)
+        {
+            CHANNEL *channel=&channels.channel[i];
+            for (window=0;window<SCHEDULE_WINDOWS;window++)
+            {
+                const WINDOW *w=&channel->schedule.window[window];
+                char windowc[60];
+                char days[8];
+                uint8_t n=0;
+                if (w->days==0)
+                    continue;
+                for (day=0;day<7;day++)
+                    if (w->days>>day&1)
+                        days[n++]='1'+day;
+                days[n]=0;
+                sprintf(windowc,"pot %u window %u : %02u:%02u-%02u:%02u %s\n\r",i+1,window+1,
+                        w->start/3600,w->start/60%60,w->end/3600,w->end/60%60,days);
+                putsUart0(windowc);
+            }
+            uint32_t next=scheduleNextChange(&channel->schedule,seconds);
+            char nextc[60];
+            if (next==SCHEDULE_NEVER)
+                sprintf(nextc,"pot %u : never open\n\r",i+1);
+            else
+                sprintf(nextc,"pot %u : %s for %u min\n\r",i+1,
+                        isScheduleOpen(&channel->schedule,seconds) ? "open" : "closed",(next+59)/60);
+            putsUart0(nextc);
+        }
+        valid=true;
+    }
+    if (isCommand(&data, "predict", 0))
+    {
+        uint32_t seconds=getCurrentSeconds();
+        uint8_t pot;
+        for (pot=0;pot<channels.count;pot++)
+        {
+            const CHANNEL *channel=&channels.channel[pot];
+            uint32_t dry=channelDrySeconds(channel,seconds);
+            char predictc[80];
+            if (channel->predict.count<PREDICT_MIN_STEPS)
+                sprintf(predictc,"pot %u : learning\n\r",pot+1);
+            else if (dry==PREDICT_NEVER)
+                sprintf(predictc,"pot %u : drying %4.2f %%/h, level not in %u h\n\r",pot+1,
+                        predictRate(&channel->predict,channel->predict.light)*(3600.0f/PREDICT_PERIOD)/PREDICT_ONE,
+                        PREDICT_HORIZON/3600);
+            else
+                sprintf(predictc,"pot %u : drying %4.2f %%/h, level in %4.1f h\n\r",pot+1,
+                        predictRate(&channel->predict,channel->predict.light)*(3600.0f/PREDICT_PERIOD)/PREDICT_ONE,
+                        dry/3600.0f);
+            putsUart0(predictc);
+        }
+        valid=true;
+    }
+    if (isCommand(&data, "capture", 1))
     {
         char *str  = getFieldString(&data, 1);
         if (strcmp(str,"ON")==0)
         {
-            enablePump();
-            putsUart0("On now");
+            armCapture(true);
+            putsUart0("Capture starts at next reset\n\r");
         }
         if (strcmp(str,"OFF")==0)
         {
-            disablePump();
-            putsUart0("Off now");
+            armCapture(false);
+            putsUart0("Capture off\n\r");
+        }
+        valid=true;
+    }
+    if (isCommand(&data, "stats", 0))
+    {
+        char *str = data.fieldCount > 1 ? getFieldString(&data, 1) : "";
+        if (strcmp(str,"RESET")==0)
+        {
+            resetStats();
+            putsUart0("Stats reset\n\r");
         }
+        else if (strcmp(str,"BIN")==0)
+            exportStats();
+        else
+            reportStats();
+        valid=true;
+    }
+    if (isCommand(&data, "trace", 0))
+    {
+        dumpTrace();
         valid=true;
     }
     if (isCommand(&data, "History", 0))
     {
         int i =0;
+        uint8_t pot;
+        if (getPotField(&data, 1, &pot))
+        {
+            if (pot>0)
+                pot--;
 
             putsUart0("Moisture Light and Volume Respectively\n\r");
 
@@ -620,7 +891,7 @@ int main(void)
                        {
 
 
-                   uint16_t moisture_history = Read_Hist(0,i);
+                   uint16_t moisture_history = Read_Hist(pot,i);
                    char historym[100];
                    sprintf(historym,"%4.2lu ",moisture_history);
                    putsUart0(historym);
@@ -633,16 +904,70 @@ int main(void)
 
             putcUart0('\n');
                    putcUart0('\r');
+        }
 
             valid=true;
 
         }
+    if (isCommand(&data, "export", 0))
+    {
+        // The log from the word asked for on, then the end block (export.h)
+        uint32_t total=channels.count*HISTORY_WORDS;
+        uint32_t word=data.fieldCount>1 ? getFieldInteger(&data,1) : 0;
+        uint16_t words[EXPORT_WORDS];
+        uint8_t count=0;
+        for (;word<total;word++)
+        {
+            words[count++]=Read_Hist(word/HISTORY_WORDS,word%HISTORY_WORDS);
+            if (count==EXPORT_WORDS||word+1==total)
+            {
+                sendExportBlock(word+1-count,words,count);
+                count=0;
+            }
+        }
+        uint8_t pot;
+        for (pot=0;pot<channels.count;pot++)
+            words[pot]=channels.channel[pot].historyOffset;
+        sendExportBlock(EXPORT_END,words,channels.count);
+        valid=true;
+    }
+    if (isCommand(&data, "baud", 0))
+    {
+        // Switch-over, test and confirm of a faster rate (baud.h)
+        char *str=data.fieldCount>1 ? getFieldString(&data,1) : "";
+        char reply[40];
+        if (data.fieldCount<2)
+        {
+            snprintf(reply,sizeof(reply),"baud : %lu\n\r",(unsigned long)getBaudRate());
+            putsUart0(reply);
+        }
+        else if (strcmp(str,"TEST")==0)
+            sendBaudTest();
+        else if (strcmp(str,"OK")==0)
+        {
+            if (!confirmBaud())
+            {
+                snprintf(reply,sizeof(reply),"baud : %lu\n\r",(unsigned long)getBaudRate());
+                putsUart0(reply);
+            }
+        }
+        else if (!startBaud(getFieldInteger(&data,1),getCurrentSeconds()))
+        {
+            snprintf(reply,sizeof(reply),"Baud rates are %lu to %lu\n\r",(unsigned long)BAUD_MIN,(unsigned long)BAUD_MAX);
+            putsUart0(reply);
+        }
+        valid=true;
+    }
     if (isCommand(&data, "Time", 2))
         {
         uint32_t hr=getFieldInteger(&data,1);
 
         uint32_t min=getFieldInteger(&data,2);
-        HIB_RTCLD_R=hr*3600+min*60;
+        // Day 1 is Monday; without one the day stays (schedule.h)
+        uint32_t day=data.fieldCount>3 ? getFieldInteger(&data,3)-1 : scheduleWeekday(getCurrentSeconds());
+        if (day>6)
+            day=0;
+        HIB_RTCLD_R=day*SCHEDULE_DAY+hr*3600+min*60;
 
                             valid=true;
         }
@@ -650,21 +975,45 @@ int main(void)
     if (isCommand(&data, "Erase", 0))
        {
            int i =0;
-
-
+           uint8_t pot;
+           if (getPotField(&data, 1, &pot))
+           {
+               uint8_t first=pot?pot-1:0;
+               uint8_t last=pot?pot:channels.count;
+               for (;first<last;first++)
+               {
                for (i=0;i<15;i++)
                {
-                   Erase_Hist(0,i);
+                   Erase_Hist(first,i);
                }
-               offset=0;
+               channels.channel[first].historyOffset=0;
+               }
+           }
                valid=true;
        }
 
-    if (isCommand(&data, "LEVEL", 1))
+    if (isCommand(&data, "LEVEL", 0))
+    {
+    uint8_t pot;
+    uint8_t i;
+    if (data.fieldCount==1)
     {
-    uint32_t level=getFieldInteger(&data,1);
-    water_level=level;
-    putsUart0("Level changed\n\r");
+        // LEVEL on its own reads every pot's level back
+        for (i=0;i<channels.count;i++)
+        {
+            char levelc[30];
+            sprintf(levelc,"pot %u level : %u\n\r",i+1,channels.channel[i].level);
+            putsUart0(levelc);
+        }
+    }
+    else if (getPotField(&data, 2, &pot))
+    {
+        uint32_t level=getFieldInteger(&data,1);
+        for (i=0;i<channels.count;i++)
+            if (pot==0||pot==i+1)
+                channels.channel[i].level=level;
+        putsUart0("Level changed\n\r");
+    }
 
     valid=true;
     }
@@ -675,10 +1024,21 @@ int main(void)
         uint32_t hr2=getFieldInteger(&data,3);
         uint32_t min2=getFieldInteger(&data,4);
 
-            start_time=hr1*3600+min1*60;
-            end_time=hr2*3600+min2*60;
+        uint8_t pot;
+        if (getPotField(&data, 5, &pot))
+        {
+            uint8_t i,window;
+            for (i=0;i<channels.count;i++)
+                if (pot==0||pot==i+1)
+                {
+                    // One window every day, in place of any others
+                    setChannelWindow(i,0,hr1*3600+min1*60,hr2*3600+min2*60,SCHEDULE_EVERY_DAY);
+                    for (window=1;window<SCHEDULE_WINDOWS;window++)
+                        setChannelWindow(i,window,0,0,0);
+                }
 
             putsUart0("time1 changed\n\r");
+        }
             valid=true;
             }
 
@@ -689,10 +1049,10 @@ int main(void)
 
     if (!valid)
     putsUart0("Invalid command\n");
+    TRACE_EXIT(TRACE_COMMANDS, TRACE_COMMAND, valid);
    }
         else{
-                uint16_t moisturepercentage=0;
-                moisturepercentage=getMoisturePercentage();
+                readChannels();
 
                 uint16_t lightpercentage=getLightPercentage();
 
@@ -704,27 +1064,18 @@ int main(void)
                 float BatteryVoltage= 0;
                 BatteryVoltage=getBatteryVoltage();
 
-                if ((moisturepercentage<water_level )&& (isWateringAllowed(start_time,end_time)))
-                {
-
-
-                       // int i=0;
-                        //for(i=0;i<5;i++)
-                        //{
-                        enablePump();
-                        waitMicrosecond(5000000);
-                        disablePump();
-                        waitMicrosecond(30000000);
-                        //waitMicrosecond(5000000);
-                        //}
-
-                }
+                // Dry pots take turns at the pump (channel.h)
+                serviceChannels(getCurrentSeconds(),lightpercentage);
+                // Falls back from a baud switch not confirmed in time
+                if (isBaudPending())
+                    serviceBaud(getCurrentSeconds());
                 //playWaterLowAlert();
-                if (vol<100)
+                // The alerts block, so not while a dose is timed (channel.h)
+                if (vol<100&&!isChannelPumping())
                 {
                     playWaterLowAlert();
                 }
-                if (BatteryVoltage<1.5)
+                if (BatteryVoltage<1.5&&!isChannelPumping())
                 {
                     playBatteryLowAlert();
                 }
@@ -0,0 +1,143 @@
+// Drying Prediction Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Hibernation module:
+//   The RTC times the samples and gives the hour of the day
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "predict.h"
+
+#define DAY_SECONDS 86400
+#define HOUR_SECONDS 3600
+#define SLOPE_MAX (16L << 16)           // Limits the fit on noisy steps
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+static int16_t toFixed(float percent)
+{
+    float fixed = percent * PREDICT_ONE;
+    return fixed >= 32767 ? 32767 : fixed <= -32767 ? -32767 : (int16_t)fixed;
+}
+
+void initPredict(PREDICT *predict)
+{
+    memset(predict, 0, sizeof(PREDICT));
+}
+
+// Call on every pass; watered is true if there has been a dose since the
+// last sample.  Returns true when it took a sample.
+bool predictSample(PREDICT *predict, uint32_t seconds, float moisture, float light, bool watered)
+{
+    uint32_t elapsed = seconds - predict->lastAt;
+    int32_t now = toFixed(moisture);
+    uint8_t hour = (seconds % DAY_SECONDS) / HOUR_SECONDS;
+    if (predict->sampled && elapsed < PREDICT_PERIOD)
+        return false;
+
+    predict->light = toFixed(light);
+    if (predict->hoursSeen & (1UL << hour))
+        predict->hourLight[hour] += (predict->light - predict->hourLight[hour]) / 8;
+    else
+        predict->hourLight[hour] = predict->light;
+    predict->hoursSeen |= 1UL << hour;
+
+    // A clock set back or a long gap gives no step, and nor does a rise,
+    // which is water still soaking in rather than drying
+    if (predict->sampled && !watered && elapsed <= PREDICT_GAP_MAX && now <= predict->last)
+    {
+        int32_t drop = (predict->last - now) * PREDICT_PERIOD / (int32_t)elapsed;
+        PREDICT_STEP *step = &predict->step[predict->next];
+        step->drop = drop >= 32767 ? 32767 : drop;
+        step->light = predict->light;
+        predict->next = (predict->next + 1) % PREDICT_STEPS;
+        if (predict->count < PREDICT_STEPS)
+            predict->count++;
+        predictFit(predict);
+    }
+    predict->last = now;
+    predict->lastAt = seconds;
+    predict->sampled = true;
+    return true;
+}
+
+// Least squares over the steps kept
+void predictFit(PREDICT *predict)
+{
+    int32_t n = predict->count;
+    int32_t sx = 0, sy = 0;
+    int64_t sxx = 0, sxy = 0, spread;
+    uint8_t i;
+    if (n == 0)
+        return;
+    for (i = 0; i < n; i++)
+    {
+        int32_t x = predict->step[i].light;
+        int32_t y = predict->step[i].drop;
+        sx += x;
+        sy += y;
+        sxx += (int64_t)x * x;
+        sxy += (int64_t)x * y;
+    }
+
+    // n * sxx - sx * sx is n squared times the variance of the light
+    spread = (int64_t)n * PREDICT_SPREAD * PREDICT_ONE;
+    if (n >= PREDICT_MIN_STEPS && n * sxx - (int64_t)sx * sx >= spread * spread)
+    {
+        int64_t slope = (((int64_t)n * sxy - (int64_t)sx * sy) << 16) / (n * sxx - (int64_t)sx * sx);
+        // More light never slows the drying
+        predict->slope = slope < 0 ? 0 : slope > SLOPE_MAX ? SLOPE_MAX : (int32_t)slope;
+    }
+    predict->base = (sy - (int32_t)(((int64_t)predict->slope * sx) >> 16)) / n;
+}
+
+// Drop per period at this light
+int32_t predictRate(const PREDICT *predict, int32_t light)
+{
+    return predict->base + (int32_t)(((int64_t)predict->slope * light) >> 16);
+}
+
+// Seconds until the moisture has dropped by margin, PREDICT_NEVER if not
+// within PREDICT_HORIZON or there are too few steps to say
+uint32_t predictSeconds(const PREDICT *predict, uint32_t seconds, int32_t margin)
+{
+    uint32_t ahead = 0;
+    int32_t light = predict->light;     // Until the end of this hour
+    uint8_t hour;
+    if (predict->count < PREDICT_MIN_STEPS)
+        return PREDICT_NEVER;
+    if (margin <= 0)
+        return 0;
+    while (ahead < PREDICT_HORIZON)
+    {
+        uint32_t step = HOUR_SECONDS - (seconds + ahead) % HOUR_SECONDS;
+        int32_t rate = predictRate(predict, light);
+        if (rate > 0)
+        {
+            int32_t drop = rate * (int32_t)step / PREDICT_PERIOD;
+            if (drop >= margin)
+                return ahead + (uint32_t)(margin * PREDICT_PERIOD / rate);
+            margin -= drop;
+        }
+        ahead += step;
+        hour = ((seconds + ahead) % DAY_SECONDS) / HOUR_SECONDS;
+        if (predict->hoursSeen & (1UL << hour))
+            light = predict->hourLight[hour];
+    }
+    return PREDICT_NEVER;
+}
@@ -0,0 +1,94 @@
+// Drying Prediction Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Hibernation module:
+//   The RTC times the samples and gives the hour of the day
+
+// Learns how fast a pot dries and predicts when it will reach its level.
+// Every PREDICT_PERIOD the pot's moisture and the light are sampled.  The
+// drop since the last sample, with the light it dried under, is one step;
+// steps with a dose in them, or a rise, are left out.  The last
+// PREDICT_STEPS steps are fitted by least squares to
+//
+//   drop per period = base + slope * light
+//
+// so a pot dries faster in the sun.  When the light hardly changed over the
+// steps the slope is kept from the last fit that could tell, and only the
+// base is fitted.  The mean light of each hour of the day is learned too,
+// and a prediction walks forward an hour at a time at the rate for the
+// light expected then.  An hour not sampled yet is expected to have the
+// light of the last sample, which errs towards watering.
+//
+// Everything is fixed point: moisture and light in 1/256 percent, the
+// slope in 1/65536.  A fit takes PREDICT_STEPS passes over the steps and a
+// prediction at most PREDICT_HORIZON / 3600 + 1, so both cost a bounded
+// time (the benchmark build times them).
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef PREDICT_H_
+#define PREDICT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PREDICT_PERIOD 900              // Seconds between samples
+#define PREDICT_STEPS 32                // Steps fitted, 8 hours
+#define PREDICT_MIN_STEPS 4             // Fewer and there is no prediction
+#define PREDICT_GAP_MAX 3600            // Longer between samples is no step
+#define PREDICT_SPREAD 5                // Light percent the steps must span for a slope
+#define PREDICT_HORIZON 172800          // Seconds looked ahead, 2 days
+#define PREDICT_NEVER 0xFFFFFFFF
+
+#define PREDICT_ONE 256                 // 1 percent
+
+typedef struct _PREDICT_STEP
+{
+    int16_t drop;                       // Moisture lost over the period
+    int16_t light;
+} PREDICT_STEP;
+
+typedef struct _PREDICT
+{
+    PREDICT_STEP step[PREDICT_STEPS];
+    uint8_t count;
+    uint8_t next;
+    bool sampled;                       // last is a sample to step from
+    int32_t last;                       // Moisture at the last sample
+    uint32_t lastAt;                    // RTC seconds
+    int16_t light;                      // At the last sample
+    int16_t hourLight[24];              // Mean light for each hour of the day
+    uint32_t hoursSeen;                 // Bit n: hourLight[n] has been sampled
+    int32_t base;                       // Drop per period in the dark
+    int32_t slope;                      // More per unit of light, 1/65536
+} PREDICT;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initPredict(PREDICT *predict);
+bool predictSample(PREDICT *predict, uint32_t seconds, float moisture, float light, bool watered);
+void predictFit(PREDICT *predict);
+int32_t predictRate(const PREDICT *predict, int32_t light);
+uint32_t predictSeconds(const PREDICT *predict, uint32_t seconds, int32_t margin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
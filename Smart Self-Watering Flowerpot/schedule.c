@@ -0,0 +1,99 @@
+// Schedule Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Hibernation module:
+//   The RTC counts seconds from 00:00 on a Monday
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "schedule.h"
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void clearSchedule(SCHEDULE *schedule)
+{
+    memset(schedule, 0, sizeof(SCHEDULE));
+}
+
+// Returns false for a window or time that is not there
+bool setScheduleWindow(SCHEDULE *schedule, uint8_t n, uint32_t start, uint32_t end, uint8_t days)
+{
+    if (n >= SCHEDULE_WINDOWS || start >= SCHEDULE_DAY || end >= SCHEDULE_DAY)
+        return false;
+    schedule->window[n].start = start;
+    schedule->window[n].end = end;
+    schedule->window[n].days = days & SCHEDULE_EVERY_DAY;
+    return true;
+}
+
+// 0 for Monday
+uint8_t scheduleWeekday(uint32_t seconds)
+{
+    return (seconds / SCHEDULE_DAY) % 7;
+}
+
+static bool isWindowOpen(const WINDOW *window, uint32_t seconds)
+{
+    uint32_t time = seconds % SCHEDULE_DAY;
+    uint8_t today = scheduleWeekday(seconds);
+    uint8_t yesterday = (today + 6) % 7;
+    if (window->start < window->end)
+        return (window->days >> today & 1) && window->start < time && time < window->end;
+    if (window->start > window->end)
+        return ((window->days >> today & 1) && time > window->start) ||
+               ((window->days >> yesterday & 1) && time < window->end);
+    return false;
+}
+
+bool isScheduleOpen(const SCHEDULE *schedule, uint32_t seconds)
+{
+    uint8_t i;
+    for (i = 0; i < SCHEDULE_WINDOWS; i++)
+        if (isWindowOpen(&schedule->window[i], seconds))
+            return true;
+    return false;
+}
+
+// Seconds until the schedule opens or closes, SCHEDULE_NEVER if it stays
+// as it is.  Each window opens a second after its start and closes at its
+// end, so those are the only times to try.
+uint32_t scheduleNextChange(const SCHEDULE *schedule, uint32_t seconds)
+{
+    bool open = isScheduleOpen(schedule, seconds);
+    uint32_t today = seconds - seconds % SCHEDULE_DAY;
+    uint32_t next = SCHEDULE_NEVER;
+    uint8_t i, day;
+    for (i = 0; i < SCHEDULE_WINDOWS; i++)
+    {
+        const WINDOW *window = &schedule->window[i];
+        if (window->days == 0 || window->start == window->end)
+            continue;
+        // From yesterday, for a window still open past midnight, to a week on
+        for (day = 0; day <= 8; day++)
+        {
+            int64_t midnight = (int64_t)today + ((int32_t)day - 1) * SCHEDULE_DAY;
+            int64_t opens = midnight + window->start + 1;
+            int64_t closes = midnight + window->end + (window->end < window->start ? SCHEDULE_DAY : 0);
+            if (opens > seconds && opens - seconds < next && isScheduleOpen(schedule, opens) != open)
+                next = opens - seconds;
+            if (closes > seconds && closes - seconds < next && isScheduleOpen(schedule, closes) != open)
+                next = closes - seconds;
+        }
+    }
+    return next;
+}
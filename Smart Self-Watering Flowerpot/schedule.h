@@ -0,0 +1,75 @@
+// Schedule Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// Hibernation module:
+//   The RTC counts seconds from 00:00 on a Monday
+
+// A pot's watering schedule: up to SCHEDULE_WINDOWS windows, each with a
+// start and end time of day and the weekdays it opens on.  A window whose
+// end is before its start runs past midnight into the next day, and belongs
+// to the day it opens on.  A window is open strictly between its start and
+// end, and one with no days or the same start and end is not used.
+//
+// The RTC is taken as seconds since 00:00 on a Monday, so the time of day
+// is the seconds modulo SCHEDULE_DAY and the weekday the days modulo 7.
+// "Time" sets the time of day and, optionally, the weekday.
+//
+// scheduleNextChange() gives the seconds until the schedule next opens or
+// closes, so a caller can leave it alone until then.  It looks at most a
+// week ahead, checking each window's ends on each day.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHEDULE_WINDOWS 4
+#define SCHEDULE_DAY 86400
+#define SCHEDULE_WEEK (7 * SCHEDULE_DAY)
+#define SCHEDULE_EVERY_DAY 0x7F         // Bit 0 Monday to bit 6 Sunday
+#define SCHEDULE_NEVER 0xFFFFFFFF
+
+typedef struct _WINDOW
+{
+    uint32_t start;                     // Seconds of the day
+    uint32_t end;
+    uint8_t days;
+} WINDOW;
+
+typedef struct _SCHEDULE
+{
+    WINDOW window[SCHEDULE_WINDOWS];
+} SCHEDULE;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void clearSchedule(SCHEDULE *schedule);
+bool setScheduleWindow(SCHEDULE *schedule, uint8_t n, uint32_t start, uint32_t end, uint8_t days);
+bool isScheduleOpen(const SCHEDULE *schedule, uint32_t seconds);
+uint32_t scheduleNextChange(const SCHEDULE *schedule, uint32_t seconds);
+uint8_t scheduleWeekday(uint32_t seconds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
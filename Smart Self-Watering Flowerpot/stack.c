@@ -0,0 +1,75 @@
+// Stack Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// SRAM:
+//   The .stack section the linker reserves (--stack_size), from __stack up
+//   to __STACK_END
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "stack.h"
+
+#ifndef SIM_HOST
+// Defined by the linker
+extern uint32_t __stack;
+extern uint32_t __STACK_END;
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void getStackBounds(uint32_t **bottom, uint32_t **top)
+{
+#ifdef SIM_HOST
+    simStackBounds(bottom, top);
+    if (*top - *bottom > STACK_HOST_SIZE / 4)
+        *bottom = *top - STACK_HOST_SIZE / 4;
+#else
+    *bottom = &__stack;
+    *top = &__STACK_END;
+#endif
+}
+
+// Everything below the caller's frame is free; interrupt handlers that run
+// while it paints leave nothing behind that is still in use
+void paintStack()
+{
+    volatile uint32_t here = 0;
+    uint32_t *bottom, *top, *p, *end;
+    getStackBounds(&bottom, &top);
+    end = (uint32_t *)((uintptr_t)&here - STACK_MARGIN);
+    if (end > top)
+        end = top;
+    for (p = bottom; p < end; p++)
+        *p = STACK_PAINT;
+}
+
+uint32_t getStackSize()
+{
+    uint32_t *bottom, *top;
+    getStackBounds(&bottom, &top);
+    return (top - bottom) * 4;
+}
+
+// Bytes from the top of the stack to the deepest word overwritten
+uint32_t getStackUsed()
+{
+    uint32_t *bottom, *top, *p;
+    getStackBounds(&bottom, &top);
+    for (p = bottom; p < top && *p == STACK_PAINT; p++);
+    return (top - p) * 4;
+}
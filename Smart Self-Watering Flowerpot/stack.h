@@ -0,0 +1,46 @@
+// Stack Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// SRAM:
+//   The .stack section the linker reserves (--stack_size), from __stack up
+//   to __STACK_END
+
+// paintStack() fills the stack below the caller with a pattern, and
+// getStackUsed() finds the deepest word overwritten since, so the worst
+// case the firmware has actually reached can be read back over the UART
+// ("stats").  The host build measures the top STACK_HOST_SIZE bytes of the
+// stack the firmware runs on instead, its fiber's or else its thread's; its
+// frames are x86-64 frames, so only the target's figures say how far
+// --stack_size can come down.  flowerpot_stack gives the worst case the
+// compiler's call graph allows.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef STACK_H_
+#define STACK_H_
+
+#include <stdint.h>
+
+#define STACK_PAINT      0xC5C5C5C5
+#define STACK_MARGIN     256            // Bytes left unpainted below the caller
+#define STACK_HOST_SIZE  32768
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void paintStack();
+uint32_t getStackSize();
+uint32_t getStackUsed();
+
+#endif
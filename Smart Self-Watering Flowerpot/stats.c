@@ -0,0 +1,176 @@
+// Statistics Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT times loop passes, interrupt handlers and the pump (dwt.h)
+// UART Interface:
+//   Receive overruns are read from UART0 RSR
+// SRAM:
+//   Stack use is measured by painting (stack.h)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "tm4c123gh6pm.h"
+#include "uart0.h"
+#include "dwt.h"
+#include "capture.h"
+#include "stack.h"
+#include "stats.h"
+
+#define CYCLES_PER_MS 40000
+#define CYCLES_PER_US 40
+
+#ifdef SIM_HOST
+// Each simulated pot has its own
+const char statsKey = 0;
+#define stats (*(STATS *)simGlobal(&statsKey, sizeof(STATS)))
+#else
+STATS stats;
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Call once the cycle counter runs
+void initStats()
+{
+    resetStats();
+}
+
+void resetStats()
+{
+    STATS *s = &stats;
+    bool pumpOn = s->pumpOn;
+    memset(s, 0, sizeof(STATS));
+    s->loopStart = DWT_CYCCNT_R;
+    s->pumpOn = pumpOn;
+    s->pumpStart = s->loopStart;
+#ifdef SIM_HOST
+    s->skippedLoops = simSkippedLoops();
+    s->skippedCycles = simSkippedCycles();
+#endif
+    paintStack();
+}
+
+// Call at the start of every main loop pass
+void statsLoop()
+{
+    STATS *s = &stats;
+    uint32_t now = DWT_CYCCNT_R;
+    uint64_t elapsed = now - s->loopStart;
+    uint64_t wrapped = 0;
+    uint32_t passes = 1;
+#ifdef SIM_HOST
+    // The simulator skips idle passes that would repeat this one, and can
+    // skip more time than CYCCNT holds
+    uint64_t skipped = simSkippedCycles() - s->skippedCycles;
+    wrapped = skipped + (uint32_t)(elapsed - (uint32_t)skipped) - elapsed;
+    elapsed += wrapped;
+    passes += simSkippedLoops() - s->skippedLoops;
+    s->skippedCycles = simSkippedCycles();
+    s->skippedLoops = simSkippedLoops();
+#endif
+    s->loopStart = now;
+    s->loops += passes;
+    s->loopCycles += elapsed;
+    if (elapsed / passes > s->worstLoop)
+        s->worstLoop = elapsed / passes;
+    // Fold in the pump time often enough that CYCCNT cannot wrap under it
+    if (s->pumpOn)
+    {
+        s->pumpCycles += (uint32_t)(now - s->pumpStart) + wrapped;
+        s->pumpStart = now;
+    }
+    if (UART0_RSR_R & UART_RSR_OE)
+    {
+        s->uartOverruns++;
+        UART0_ECR_R = 0;
+    }
+}
+
+// Call at the end of an interrupt handler with CYCCNT read on entry
+void statsIsr(uint8_t isr, uint32_t start)
+{
+    STATS *s = &stats;
+    s->isrCalls[isr]++;
+    s->isrCycles[isr] += DWT_CYCCNT_R - start;
+}
+
+void statsEepromWrite()
+{
+    stats.eepromWrites++;
+}
+
+void statsPump(bool on)
+{
+    STATS *s = &stats;
+    uint32_t now = DWT_CYCCNT_R;
+    if (s->pumpOn)
+        s->pumpCycles += now - s->pumpStart;
+    s->pumpStart = now;
+    s->pumpOn = on;
+}
+
+uint32_t getStatsCounter(uint8_t counter)
+{
+    STATS *s = &stats;
+    switch (counter)
+    {
+    case STATS_LOOPS:         return s->loops;
+    case STATS_LOOP_TIME:     return s->loopCycles / CYCLES_PER_MS;
+    case STATS_WORST_LOOP:    return s->worstLoop / CYCLES_PER_US;
+    case STATS_TIMER2A_CALLS: return s->isrCalls[STATS_ISR_TIMER2A];
+    case STATS_TIMER2A_TIME:  return s->isrCycles[STATS_ISR_TIMER2A] / CYCLES_PER_US;
+    case STATS_UART_OVERRUNS: return s->uartOverruns;
+    case STATS_EEPROM_WRITES: return s->eepromWrites;
+    case STATS_PUMP_TIME:     return s->pumpCycles / CYCLES_PER_MS;
+    case STATS_STACK_USED:    return getStackUsed();
+    default:                  return 0;
+    }
+}
+
+void reportStats()
+{
+    STATS *s = &stats;
+    char line[100];
+    float rate = s->loopCycles ? s->loops * (float)(CYCLES_PER_MS * 1000) / s->loopCycles : 0;
+    sprintf(line, "loops : %lu, %.1f per second\n\r", (unsigned long)s->loops, rate);
+    putsUart0(line);
+    sprintf(line, "worst loop : %lu us\n\r", (unsigned long)getStatsCounter(STATS_WORST_LOOP));
+    putsUart0(line);
+    sprintf(line, "timer2a isr : %lu calls, %lu us\n\r", (unsigned long)getStatsCounter(STATS_TIMER2A_CALLS),
+            (unsigned long)getStatsCounter(STATS_TIMER2A_TIME));
+    putsUart0(line);
+    sprintf(line, "uart overruns : %lu\n\r", (unsigned long)s->uartOverruns);
+    putsUart0(line);
+    sprintf(line, "eeprom writes : %lu\n\r", (unsigned long)s->eepromWrites);
+    putsUart0(line);
+    sprintf(line, "pump on : %.1f s\n\r", getStatsCounter(STATS_PUMP_TIME) / 1000.0);
+    putsUart0(line);
+    sprintf(line, "stack : %lu of %lu bytes\n\r", (unsigned long)getStackUsed(),
+            (unsigned long)getStackSize());
+    putsUart0(line);
+}
+
+// Every counter as a STATS record
+void exportStats()
+{
+    uint8_t i;
+    for (i = 0; i < STATS_COUNTERS; i++)
+        sendRecord(CAPTURE_STATS, i, getStatsCounter(i));
+}
@@ -0,0 +1,81 @@
+// Statistics Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT times loop passes, interrupt handlers and the pump (dwt.h)
+// UART Interface:
+//   Receive overruns are read from UART0 RSR
+// SRAM:
+//   Stack use is measured by painting (stack.h)
+
+// Counters for the "stats" command, kept since reset or "stats RESET",
+// which also repaints the stack.
+// "stats BIN" sends each counter as a STATS record (capture.h) with its
+// number below in place of the time.  Times are kept in cycles and reported
+// in the units given.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef STATS_H_
+#define STATS_H_
+
+// Counter numbers
+#define STATS_LOOPS          0          // Main loop passes
+#define STATS_LOOP_TIME      1          // ms spent in them
+#define STATS_WORST_LOOP     2          // us, longest pass
+#define STATS_TIMER2A_CALLS  3
+#define STATS_TIMER2A_TIME   4          // us
+#define STATS_UART_OVERRUNS  5
+#define STATS_EEPROM_WRITES  6
+#define STATS_PUMP_TIME      7          // ms
+#define STATS_STACK_USED     8          // Bytes, deepest since reset (stack.h)
+#define STATS_COUNTERS       9
+
+// Interrupt handlers
+#define STATS_ISR_TIMER2A 0
+#define STATS_ISRS        1
+
+typedef struct _STATS
+{
+    uint32_t loops;
+    uint64_t loopCycles;
+    uint32_t worstLoop;
+    uint32_t loopStart;
+    uint32_t isrCalls[STATS_ISRS];
+    uint64_t isrCycles[STATS_ISRS];
+    uint32_t uartOverruns;
+    uint32_t eepromWrites;
+    uint64_t pumpCycles;
+    uint32_t pumpStart;
+    bool pumpOn;
+#ifdef SIM_HOST
+    uint64_t skippedLoops;
+    uint64_t skippedCycles;
+#endif
+} STATS;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void initStats();
+void resetStats();
+void statsLoop();
+void statsIsr(uint8_t isr, uint32_t start);
+void statsEepromWrite();
+void statsPump(bool on);
+uint32_t getStatsCounter(uint8_t counter);
+void reportStats();
+void exportStats();
+
+#endif
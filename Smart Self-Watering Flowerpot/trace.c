@@ -0,0 +1,81 @@
+// Trace Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT timestamps each event (dwt.h)
+// UART Interface:
+//   The "trace" command sends the buffer on UART0
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "tm4c123gh6pm.h"
+#include "uart0.h"
+#include "trace.h"
+
+#ifdef SIM_HOST
+const char traceKey = 0;
+#else
+TRACE_BUFFER traceBuffer;
+#endif
+
+const char *traceNames[TRACE_IDS] =
+{
+    "?", "light", "moisture", "battery", "getVolume",
+    "Store_Hist", "Read_Hist", "Erase_Hist", "motor", "command"
+};
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Up to the first 4 characters of text as an argument, first in the low byte
+uint32_t traceText(const char *text)
+{
+    uint32_t argument = 0;
+    uint8_t i;
+    for (i = 0; i < 4 && text[i]; i++)
+        argument |= (uint32_t)(uint8_t)text[i] << (8 * i);
+    return argument;
+}
+
+// Send the buffer, oldest event first
+void dumpTrace()
+{
+    TRACE_BUFFER *buffer = &traceBuffer;
+    TRACE_EVENT *entry;
+    uint32_t count = buffer->count;
+    uint32_t i = count > TRACE_EVENTS ? count - TRACE_EVENTS : 0;
+    uint16_t id;
+    char kind;
+    char line[80];
+    sprintf(line, "trace,begin,%lu,%lu\n", (unsigned long)count, 40000000UL);
+    putsUart0(line);
+    for (; i < count; i++)
+    {
+        entry = &buffer->events[i & (TRACE_EVENTS - 1)];
+        id = entry->event & ~TRACE_KIND_MASK;
+        switch (entry->event & TRACE_KIND_MASK)
+        {
+        case TRACE_KIND_ENTER: kind = 'B'; break;
+        case TRACE_KIND_EXIT:  kind = 'E'; break;
+        default:               kind = 'I'; break;
+        }
+        sprintf(line, "trace,%lu,%c,%s,%lu\n", (unsigned long)entry->time, kind,
+                traceNames[id < TRACE_IDS ? id : 0], (unsigned long)entry->argument);
+        putsUart0(line);
+    }
+    putsUart0("trace,end\n");
+}
@@ -0,0 +1,119 @@
+// Trace Library
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Hardware configuration:
+// DWT (data watchpoint and trace unit):
+//   CYCCNT timestamps each event (dwt.h)
+// UART Interface:
+//   The "trace" command sends the buffer on UART0
+
+// Trace points record events in a RAM ring buffer that keeps the last
+// TRACE_EVENTS of them: the cycle count, an event ID marking the start or
+// end of a span or a single point, and a 32-bit argument.  Recording one is
+// a handful of stores.  TRACE selects the groups of trace points built in
+// (all of them by default); build with TRACE=0 to leave every one out.
+//
+// dumpTrace() sends the buffer oldest event first:
+//
+//   trace,begin,<events recorded since reset>,<cycles per second>
+//   trace,<cycles>,<B|E|I>,<name>,<argument>
+//   ...
+//   trace,end
+//
+// flowerpot_trace converts a dump to Chrome trace-event JSON.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "dwt.h"
+
+// Groups of trace points
+#define TRACE_SENSORS  0x01
+#define TRACE_VOLUME   0x02
+#define TRACE_EEPROM   0x04
+#define TRACE_PUMP     0x08
+#define TRACE_COMMANDS 0x10
+#define TRACE_ALL      0x1F
+
+#ifndef TRACE
+#define TRACE TRACE_ALL
+#endif
+
+// Event IDs (names in trace.c)
+#define TRACE_LIGHT    1
+#define TRACE_MOISTURE 2                // Argument: pot
+#define TRACE_BATTERY  3
+#define TRACE_GET_VOLUME 4
+#define TRACE_STORE_HIST 5
+#define TRACE_READ_HIST  6
+#define TRACE_ERASE_HIST 7
+#define TRACE_MOTOR    8                // Argument: pot << 8, 1 on or 0 off
+#define TRACE_COMMAND  9                // Argument: first 4 characters
+#define TRACE_IDS      10
+
+// Kind, in the top bits of the event
+#define TRACE_KIND_MARK  0x0000
+#define TRACE_KIND_ENTER 0x4000
+#define TRACE_KIND_EXIT  0x8000
+#define TRACE_KIND_MASK  0xC000
+
+#define TRACE_EVENTS 128                // A power of 2
+
+typedef struct _TRACE_EVENT
+{
+    uint32_t time;
+    uint32_t argument;
+    uint16_t event;
+} TRACE_EVENT;
+
+typedef struct _TRACE_BUFFER
+{
+    uint32_t count;
+    TRACE_EVENT events[TRACE_EVENTS];
+} TRACE_BUFFER;
+
+#ifdef SIM_HOST
+// Each simulated pot has its own
+extern const char traceKey;
+#define traceBuffer (*(TRACE_BUFFER *)simGlobal(&traceKey, sizeof(TRACE_BUFFER)))
+#else
+extern TRACE_BUFFER traceBuffer;
+#endif
+
+// Not for use in interrupt handlers
+static inline void traceEvent(uint16_t event, uint32_t argument)
+{
+    TRACE_BUFFER *buffer = &traceBuffer;
+    TRACE_EVENT *entry = &buffer->events[buffer->count++ & (TRACE_EVENTS - 1)];
+    entry->time = DWT_CYCCNT_R;
+    entry->argument = argument;
+    entry->event = event;
+}
+
+// Trace points; those in groups left out of TRACE compile to nothing
+#define TRACE_ENTER(group, id, argument) \
+    do { if ((TRACE) & (group)) traceEvent(TRACE_KIND_ENTER | (id), (argument)); } while (0)
+#define TRACE_EXIT(group, id, argument) \
+    do { if ((TRACE) & (group)) traceEvent(TRACE_KIND_EXIT | (id), (argument)); } while (0)
+#define TRACE_MARK(group, id, argument) \
+    do { if ((TRACE) & (group)) traceEvent(TRACE_KIND_MARK | (id), (argument)); } while (0)
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint32_t traceText(const char *text);
+void dumpTrace();
+
+#endif
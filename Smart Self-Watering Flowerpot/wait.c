@@ -20,6 +20,13 @@
 // Subroutines
 //-----------------------------------------------------------------------------
 
+#ifdef SIM_HOST
+// Host simulator build: advance the virtual clock instead of spinning
+void waitMicrosecond(uint32_t us)
+{
+    simWaitMicrosecond(us);
+}
+#else
 // Approximate busy waiting (in units of microseconds), given a 40 MHz system clock
 void waitMicrosecond(uint32_t us)
 {
@@ -36,3 +43,4 @@ void waitMicrosecond(uint32_t us)
     __asm("WMS_DONE0:");                        // ---
                                                 // 40 clocks/us + error
 }
+#endif
@@ -0,0 +1,28 @@
+# Generate tm4c123gh6pm_addresses.h
+#
+# Lists the address of every fixed-address 32-bit register in the TI header
+# as a plain constant, NAME_R_ADDRESS, which the header's own definitions
+# cannot give since they are dereferenced pointers.  hal.h checks its
+# hand-written addresses against these in the host build.
+#
+# Usage: cmake -DINPUT=<tm4c123gh6pm.h> -DOUTPUT=<generated.h> -P GenerateRegisterAddresses.cmake
+
+if(NOT INPUT OR NOT OUTPUT)
+    message(FATAL_ERROR "INPUT and OUTPUT must be set")
+endif()
+
+file(STRINGS "${INPUT}" registers
+    REGEX "^#define [A-Za-z0-9_]+_R[ \t]+\\(\\*\\(\\(volatile unsigned long \\*\\)0x[0-9A-Fa-f]+\\)\\)")
+
+set(header "// Generated from tm4c123gh6pm.h -- do not edit\n\n")
+string(APPEND header "#ifndef TM4C123GH6PM_ADDRESSES_H_\n#define TM4C123GH6PM_ADDRESSES_H_\n\n")
+foreach(register ${registers})
+    string(REGEX REPLACE "^#define ([A-Za-z0-9_]+)[ \t]+.*(0x[0-9A-Fa-f]+).*$" "#define \\1_ADDRESS \\2u\n"
+           line "${register}")
+    string(APPEND header "${line}")
+endforeach()
+string(APPEND header "\n#endif\n")
+
+file(WRITE "${OUTPUT}.tmp" "${header}")
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
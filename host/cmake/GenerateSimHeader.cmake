@@ -0,0 +1,32 @@
+# Generate the host-side tm4c123gh6pm.h
+#
+# Rewrites every fixed-address register definition in the TI header so that
+# the access goes through simRegister() instead of dereferencing a physical
+# address, and narrows "unsigned long" registers to 32 bits for LP64 hosts.
+# The include guard is kept, so force-including the generated header makes
+# the firmware's own #include "tm4c123gh6pm.h" a no-op.
+#
+# Usage: cmake -DINPUT=<tm4c123gh6pm.h> -DOUTPUT=<generated.h> -P GenerateSimHeader.cmake
+
+if(NOT INPUT OR NOT OUTPUT)
+    message(FATAL_ERROR "INPUT and OUTPUT must be set")
+endif()
+
+file(READ "${INPUT}" header)
+
+string(REGEX REPLACE
+    "\\(\\(volatile unsigned long \\*\\)(0x[0-9A-Fa-f]+)\\)"
+    "((volatile uint32_t *)simRegister(\\1))"
+    header "${header}")
+string(REGEX REPLACE
+    "\\(\\(volatile unsigned (char|short) \\*\\)(0x[0-9A-Fa-f]+)\\)"
+    "((volatile unsigned \\1 *)simRegister(\\2))"
+    header "${header}")
+string(REPLACE
+    "#define __TM4C123GH6PM_H__\n"
+    "#define __TM4C123GH6PM_H__\n\n// Generated for the host simulator -- do not edit\n#include <stdint.h>\n#include \"simhw.h\"\n"
+    header "${header}")
+
+file(WRITE "${OUTPUT}.tmp" "${header}")
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,217 @@
+// Fleet Analytics
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "analytics.h"
+
+namespace gateway {
+
+namespace {
+
+const double MS_PER_DAY = 86400000.0;
+
+// A rise in moisture of more than this from one reading to the next is a
+// watering, in tenths
+const int32_t WATERING_RISE = 50;
+
+// The firmware's alert conditions (reportStatus() in main.c), in tenths
+const int32_t ALERT_LIGHT = 100;
+const int32_t ALERT_VOLUME = 500;
+const int32_t ALERT_BATTERY = 10;
+
+int32_t toTenths(float value)
+{
+    return (int32_t)lrintf(value * 10);
+}
+
+Quantiles quantiles(std::vector<float> &values)
+{
+    Quantiles q = {};
+    if (values.empty())
+        return q;
+    std::sort(values.begin(), values.end());
+    size_t last = values.size() - 1;
+    q.p50 = values[last * 50 / 100];
+    q.p90 = values[last * 90 / 100];
+    q.p99 = values[last * 99 / 100];
+    q.max = values[last];
+    return q;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Analytics
+//-----------------------------------------------------------------------------
+
+Analytics::Analytics(const AnalyticsOptions &options)
+    : options_(options), pool_(options.threads), columns_(pool_.threads())
+{
+}
+
+void Analytics::run(const StoreReader &store, std::vector<PotSummary> &pots, FleetSummary &fleet)
+{
+    std::vector<uint32_t> ids;
+    for (unsigned m = 0; m < (unsigned)Metric::Count; m++)
+        ids.insert(ids.end(), store.pots((Metric)m).begin(), store.pots((Metric)m).end());
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    pots.assign(ids.size(), PotSummary());
+    for (size_t i = 0; i < ids.size(); i++)
+        pots[i].pot = ids[i];
+    pool_.parallelFor(pots.size(), [this, &store, &pots](size_t index, unsigned worker)
+    {
+        summarise(store, columns_[worker], pots[index]);
+    });
+
+    // The fleet, from the pots' summaries
+    memset(&fleet, 0, sizeof(fleet));
+    fleet.pots = (uint32_t)pots.size();
+    std::vector<float> water, alerts, drift, moisture;
+    for (const PotSummary &pot : pots)
+    {
+        fleet.waterUsed += pot.waterUsed;
+        fleet.alerting += pot.waterAlerts || pot.batteryAlerts;
+        fleet.drifting += pot.drifting;
+        fleet.stuck += pot.stuck;
+        water.push_back(pot.waterUsed);
+        alerts.push_back((float)pot.waterAlerts);
+        drift.push_back(fabsf(pot.drift));
+        if (pot.samples)
+            moisture.push_back(pot.moistureMean);
+    }
+    for (Columns &columns : columns_)
+    {
+        fleet.samples += columns.samples;
+        columns.samples = 0;
+    }
+    fleet.water = quantiles(water);
+    fleet.waterAlerts = quantiles(alerts);
+    fleet.drift = quantiles(drift);
+    fleet.moisture = quantiles(moisture);
+}
+
+void Analytics::summarise(const StoreReader &store, Columns &columns, PotSummary &summary) const
+{
+    for (unsigned m = 0; m < (unsigned)Metric::Count; m++)
+    {
+        columns.times[m].clear();
+        columns.values[m].clear();
+        columns.samples += store.query(summary.pot, (Metric)m, options_.from, options_.to, columns.times[m],
+                                       columns.values[m]);
+    }
+
+    // Moisture: range, mean, and the peak after each watering, the highest
+    // reading from one watering to the next
+    const std::vector<int64_t> &times = columns.times[(unsigned)Metric::Moisture];
+    const std::vector<int32_t> &moisture = columns.values[(unsigned)Metric::Moisture];
+    std::vector<std::pair<int64_t, int32_t>> &peaks = columns.peaks;
+    size_t count = moisture.size();
+    summary.samples = (uint32_t)count;
+    peaks.clear();
+    if (count)
+    {
+        int64_t sum = moisture[0];
+        int32_t low = moisture[0], high = moisture[0];
+        for (size_t i = 1; i < count; i++)
+        {
+            int32_t value = moisture[i];
+            sum += value;
+            low = std::min(low, value);
+            high = std::max(high, value);
+            if (value - moisture[i - 1] > WATERING_RISE)
+                peaks.push_back({ times[i], value });
+            else if (!peaks.empty() && value > peaks.back().second)
+                peaks.back() = { times[i], value };
+        }
+        summary.moistureMean = (float)sum / (float)count / 10;
+        summary.moistureMin = (float)low / 10;
+        summary.moistureMax = (float)high / 10;
+        summary.waterings = (uint32_t)peaks.size();
+    }
+    if (peaks.size() >= 3)
+    {
+        // Least squares, about the mean time so that the sums stay small
+        double meanTime = 0, meanValue = 0;
+        for (const auto &peak : peaks)
+        {
+            meanTime += (double)(peak.first - peaks[0].first);
+            meanValue += peak.second;
+        }
+        meanTime /= (double)peaks.size();
+        meanValue /= (double)peaks.size();
+        double covariance = 0, variance = 0;
+        for (const auto &peak : peaks)
+        {
+            double t = (double)(peak.first - peaks[0].first) - meanTime;
+            covariance += t * (peak.second - meanValue);
+            variance += t * t;
+        }
+        summary.drift = (float)(covariance / variance * MS_PER_DAY / 10);
+        summary.drifting = fabsf(summary.drift) > options_.driftLimit;
+    }
+
+    // Volume: falls past the deadband are water used, rises past it refills
+    const std::vector<int32_t> &volume = columns.values[(unsigned)Metric::Volume];
+    if (!volume.empty())
+    {
+        int32_t deadband = toTenths(options_.deadband);
+        int32_t level = volume[0];
+        int32_t low = volume[0], high = volume[0];
+        int64_t used = 0;
+        uint32_t refills = 0;
+        for (int32_t value : volume)
+        {
+            low = std::min(low, value);
+            high = std::max(high, value);
+            if (value < level - deadband)
+            {
+                used += level - value;
+                level = value;
+            }
+            else if (value > level + deadband)
+            {
+                refills++;
+                level = value;
+            }
+        }
+        summary.waterUsed = (float)used / 10;
+        summary.refills = refills;
+        summary.stuck = volume.size() > 1 && low == high;
+    }
+
+    // Alerts: light, volume and battery are stored with the same time for
+    // each reply, so a reading's three values are joined on time
+    const std::vector<int64_t> &lightTimes = columns.times[(unsigned)Metric::Light];
+    const std::vector<int32_t> &light = columns.values[(unsigned)Metric::Light];
+    const std::vector<int64_t> &volumeTimes = columns.times[(unsigned)Metric::Volume];
+    const std::vector<int64_t> &batteryTimes = columns.times[(unsigned)Metric::Battery];
+    const std::vector<int32_t> &battery = columns.values[(unsigned)Metric::Battery];
+    size_t v = 0, b = 0;
+    for (size_t i = 0; i < light.size(); i++)
+    {
+        if (light[i] <= ALERT_LIGHT)
+            continue;
+        int64_t time = lightTimes[i];
+        while (v < volume.size() && volumeTimes[v] < time)
+            v++;
+        while (b < battery.size() && batteryTimes[b] < time)
+            b++;
+        summary.waterAlerts += v < volume.size() && volumeTimes[v] == time && volume[v] < ALERT_VOLUME;
+        summary.batteryAlerts += b < battery.size() && batteryTimes[b] == time && battery[b] < ALERT_BATTERY;
+    }
+}
+
+}
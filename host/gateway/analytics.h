@@ -0,0 +1,125 @@
+// Fleet Analytics
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Summarises what a telemetry store (store.h) holds for every pot over a
+// span of time, for a daily report:
+//
+//   water used      ml drawn from the reservoir, counting only falls in
+//                   volume larger than a deadband so that sensor noise and
+//                   refills are not counted
+//   alerts          readings at which the firmware sounds its water low
+//                   (light above 10%, volume below 50 ml) or battery low
+//                   (light above 10%, battery below 1 V) alert
+//   drift           least squares slope, in percent a day, of the moisture
+//                   reading just after each watering, when the soil is wet
+//                   through and should read the same every time; a pot
+//                   watered fewer than three times is not judged
+//   stuck volume    a volume reading that never changed, which getVolume()
+//                   gives when the float sensor is jammed or unplugged
+//
+// and the fleet as a whole, with percentiles of the per-pot figures.
+//
+// Pots are partitions: each is summarised by one worker of a work-stealing
+// thread pool (pool.h), which decodes the pot's four series into columns of
+// times and values it keeps from pot to pot, and writes the summary into the
+// pot's own slot, so workers share nothing but the store's mapping.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_ANALYTICS_H_
+#define GATEWAY_ANALYTICS_H_
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "pool.h"
+#include "store.h"
+
+namespace gateway {
+
+struct AnalyticsOptions
+{
+    int64_t from = INT64_MIN;         // Unix milliseconds, inclusive
+    int64_t to = INT64_MAX;
+    unsigned threads = 0;             // 0: one per hardware thread
+    float deadband = 1.0f;            // ml
+    float driftLimit = 0.25f;         // Percent a day
+};
+
+struct PotSummary
+{
+    uint32_t pot;
+    uint32_t samples;                 // Moisture readings
+    float waterUsed;                  // ml
+    uint32_t refills;
+    uint32_t waterings;               // Rises in moisture
+    uint32_t waterAlerts;             // Readings that sound an alert
+    uint32_t batteryAlerts;
+    float moistureMean;               // Percent
+    float moistureMin;
+    float moistureMax;
+    float drift;                      // Percent a day
+    bool drifting;                    // |drift| above the limit
+    bool stuck;                       // Volume never changed
+};
+
+struct Quantiles
+{
+    float p50;
+    float p90;
+    float p99;
+    float max;
+};
+
+struct FleetSummary
+{
+    uint32_t pots;
+    uint64_t samples;                 // Of every metric
+    double waterUsed;                 // ml
+    uint32_t alerting;                // Pots with any alert
+    uint32_t drifting;
+    uint32_t stuck;
+    Quantiles water;
+    Quantiles waterAlerts;
+    Quantiles drift;                  // Of |drift|
+    Quantiles moisture;               // Of the mean
+};
+
+class Analytics
+{
+public:
+    explicit Analytics(const AnalyticsOptions &options);
+
+    unsigned threads() const { return pool_.threads(); }
+    uint64_t steals() const { return pool_.steals(); }
+
+    // Summarises every pot in the store, in pot order
+    void run(const StoreReader &store, std::vector<PotSummary> &pots, FleetSummary &fleet);
+
+private:
+    // A worker's columns, one pair per metric, and the moisture peaks
+    struct alignas(64) Columns
+    {
+        std::vector<int64_t> times[(unsigned)Metric::Count];
+        std::vector<int32_t> values[(unsigned)Metric::Count];
+        std::vector<std::pair<int64_t, int32_t>> peaks;
+        uint64_t samples = 0;
+    };
+
+    void summarise(const StoreReader &store, Columns &columns, PotSummary &summary) const;
+
+    AnalyticsOptions options_;
+    sim::ThreadPool pool_;
+    std::vector<Columns> columns_;
+};
+
+}
+
+#endif
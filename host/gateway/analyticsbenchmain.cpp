@@ -0,0 +1,330 @@
+// Fleet Analytics Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Makes a telemetry store (store.h) of a fleet's readings with faults
+// planted in it, then times the fleet analytics (analytics.h) over all of
+// it, on one thread and on all of them, and checks every pot's summary.
+//
+//   flowerpot_analytics_bench [--pots N] [--days D] [--period SECONDS]
+//                             [--threads N] [--dir DIRECTORY] [--reuse]
+//                             [--keep]
+//
+//   --pots     pots (default 10000)
+//   --days     days of readings (default 30)
+//   --period   seconds between a pot's readings (default 60)
+//   --threads  threads for the second run (default one per hardware thread)
+//   --dir      store to write (default /tmp/flowerpot_analytics_bench); it
+//              is emptied first and removed after unless --keep
+//   --reuse    use the store already in DIRECTORY, made by an earlier run
+//              with the same --pots, --days and --period and --keep
+//
+// Each pot is watered four times a week, drawing its own dose from a 2 l
+// reservoir that is refilled weekly; pots with a large dose run dry before
+// the refill and sound the water low alert in daylight.  Readings carry a
+// tenth of noise.  Some pots have faults planted:
+//
+//   pot % 97 == 13   volume sensor stuck at 1234.5 ml
+//   pot % 89 == 5    moisture sensor drifting 0.5% a day, up or down
+//   pot % 101 == 7   battery at 0.8 V, sounding the battery low alert
+//
+// Every reading is worked out from the pot and reading number, so the
+// expected summary of each pot is too.  The check passes if the analytics
+// finds exactly the planted faults, counts every alert and is within two
+// tenths of a ml a watering of the water used; the exit status is 1 if not.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analytics.h"
+
+namespace {
+
+const int64_t START_MS = 1767225600000;   // 2026-01-01
+const int64_t WATERING_S = 151200;        // Four times a week
+const int64_t REFILL_S = 604800;
+const int32_t RESERVOIR = 20000;          // Tenths of a ml
+const int32_t STUCK_VOLUME = 12345;
+
+struct Options
+{
+    uint32_t pots = 10000;
+    uint32_t days = 30;
+    uint32_t period = 60;
+    unsigned threads = 0;
+    std::string directory = "/tmp/flowerpot_analytics_bench";
+    bool reuse = false;
+    bool keep = false;
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_analytics_bench [--pots N] [--days D] [--period SECONDS]\n"
+        "                                 [--threads N] [--dir DIRECTORY] [--reuse]\n"
+        "                                 [--keep]\n");
+    exit(2);
+}
+
+bool stuck(uint32_t pot)
+{
+    return pot % 97 == 13;
+}
+
+bool drifting(uint32_t pot)
+{
+    return pot % 89 == 5;
+}
+
+bool lowBattery(uint32_t pot)
+{
+    return pot % 101 == 7;
+}
+
+uint32_t mix(uint32_t pot, uint32_t sample, uint32_t salt)
+{
+    uint64_t x = (uint64_t)pot << 32 ^ sample ^ (uint64_t)salt << 56;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+int32_t noise(uint32_t pot, uint32_t sample, gateway::Metric metric)
+{
+    return (int32_t)(mix(pot, sample, (uint32_t)metric) % 3) - 1;
+}
+
+// A reading's readings, in tenths, without noise where that matters to the
+// expected summary
+struct Reading
+{
+    int32_t moisture;
+    int32_t light;
+    int32_t volume;                   // Before noise
+    int32_t battery;
+};
+
+Reading reading(const Options &options, uint32_t pot, uint32_t sample)
+{
+    int64_t elapsed = (int64_t)sample * options.period;
+    int64_t seconds = elapsed + (int64_t)pot * 977;
+    Reading r;
+
+    r.moisture = 600 - (int32_t)(300 * (seconds % WATERING_S) / WATERING_S) +
+                 noise(pot, sample, gateway::Metric::Moisture);
+    if (drifting(pot))
+        r.moisture += (int32_t)((pot & 1 ? 5 : -5) * elapsed / 86400);
+
+    double day = (double)(seconds % 86400) / 86400;
+    r.light = day < 0.25 || day > 0.75 ? 0 : (int32_t)(900 * sin(M_PI * (day - 0.25) * 2)) +
+                                             noise(pot, sample, gateway::Metric::Light);
+
+    int32_t dose = 3000 + (int32_t)(pot * 37 % 400) * 10;
+    int32_t waterings = (int32_t)(seconds % REFILL_S / WATERING_S);
+    r.volume = stuck(pot) ? STUCK_VOLUME : std::max(0, RESERVOIR - dose * waterings);
+
+    r.battery = (lowBattery(pot) ? 8 : 91) + noise(pot, sample, gateway::Metric::Battery);
+    return r;
+}
+
+int32_t volumeReading(const Reading &r, uint32_t pot, uint32_t sample)
+{
+    return stuck(pot) ? r.volume : r.volume + noise(pot, sample, gateway::Metric::Volume);
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void removeStore(const std::string &directory)
+{
+    unlink((directory + "/data").c_str());
+    unlink((directory + "/index").c_str());
+    rmdir(directory.c_str());
+}
+
+bool generate(const Options &options, uint32_t samples)
+{
+    removeStore(options.directory);
+    std::string error;
+    gateway::StoreWriter writer;
+    if (!writer.open(options.directory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t sample = 0; sample < samples; sample++)
+    {
+        for (uint32_t pot = 0; pot < options.pots; pot++)
+        {
+            int64_t time = START_MS + (int64_t)sample * options.period * 1000 + pot * 7;
+            Reading r = reading(options, pot, sample);
+            bool ok = writer.append(pot, gateway::Metric::Moisture, time, (float)r.moisture / 10) &&
+                      writer.append(pot, gateway::Metric::Light, time, (float)r.light / 10) &&
+                      writer.append(pot, gateway::Metric::Volume, time, (float)volumeReading(r, pot, sample) / 10) &&
+                      writer.append(pot, gateway::Metric::Battery, time, (float)r.battery / 10);
+            if (!ok)
+            {
+                fprintf(stderr, "%s\n", writer.error().c_str());
+                return false;
+            }
+        }
+    }
+    if (!writer.close())
+    {
+        fprintf(stderr, "%s\n", writer.error().c_str());
+        return false;
+    }
+    double seconds = secondsSince(start);
+    printf("generate  %llu samples in %.1f s (%.1f M samples/s), %.1f MB\n", (unsigned long long)writer.samples(),
+           seconds, (double)writer.samples() / seconds / 1e6, (double)writer.bytes() / 1e6);
+    return true;
+}
+
+// A pot's summary against the model
+bool check(const Options &options, uint32_t samples, const gateway::PotSummary &summary)
+{
+    uint32_t pot = summary.pot;
+    double used = 0;
+    uint32_t falls = 0, waterAlerts = 0, batteryAlerts = 0;
+    int32_t previous = 0;
+    for (uint32_t sample = 0; sample < samples; sample++)
+    {
+        Reading r = reading(options, pot, sample);
+        if (sample && r.volume < previous)
+        {
+            used += (double)(previous - r.volume) / 10;
+            falls++;
+        }
+        previous = r.volume;
+        if (r.light > 100)
+        {
+            waterAlerts += volumeReading(r, pot, sample) < 500;
+            batteryAlerts += r.battery < 10;
+        }
+    }
+    const char *wrong = nullptr;
+    if (summary.samples != samples)
+        wrong = "samples";
+    else if (summary.stuck != stuck(pot))
+        wrong = "stuck";
+    else if (summary.drifting != drifting(pot))
+        wrong = "drifting";
+    else if (summary.waterAlerts != waterAlerts)
+        wrong = "water alerts";
+    else if (summary.batteryAlerts != batteryAlerts)
+        wrong = "battery alerts";
+    else if (fabs(summary.waterUsed - used) > 0.2 * falls)
+        wrong = "water used";
+    if (wrong)
+        fprintf(stderr, "pot %u: %s wrong (water used %.1f, expected %.1f)\n", pot, wrong, summary.waterUsed, used);
+    return !wrong;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--reuse") == 0)
+        {
+            options.reuse = true;
+            continue;
+        }
+        if (strcmp(arg, "--keep") == 0)
+        {
+            options.keep = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            options.pots = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--days") == 0)
+            options.days = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--period") == 0)
+            options.period = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--dir") == 0)
+            options.directory = value;
+        else
+            usage();
+    }
+    if (options.pots == 0 || options.days == 0 || options.period == 0)
+        usage();
+    uint32_t samples = (uint32_t)((uint64_t)options.days * 86400 / options.period);
+
+    if (!options.reuse && !generate(options, samples))
+        return 1;
+
+    gateway::StoreReader store;
+    std::string error;
+    if (!store.open(options.directory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    // One thread, then all of them
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<gateway::PotSummary> pots;
+    gateway::FleetSummary fleet;
+    std::vector<unsigned> runs = { 1 };
+    if (threads > 1)
+        runs.push_back(threads);
+    double single = 0;
+    for (unsigned run : runs)
+    {
+        gateway::AnalyticsOptions analyticsOptions;
+        analyticsOptions.threads = run;
+        gateway::Analytics analytics(analyticsOptions);
+        auto start = std::chrono::steady_clock::now();
+        analytics.run(store, pots, fleet);
+        double seconds = secondsSince(start);
+        single = run == 1 ? seconds : single;
+        printf("analyse   %u pots, %llu samples on %u threads in %.2f s: %.0f M samples/s, %.2fx\n", fleet.pots,
+               (unsigned long long)fleet.samples, run, seconds, (double)fleet.samples / seconds / 1e6,
+               single / seconds);
+    }
+    printf("fleet     water used %.1f l, %u pots alerting, %u drifting, %u stuck; water used p50 %.0f p99 %.0f ml\n",
+           fleet.waterUsed / 1000, fleet.alerting, fleet.drifting, fleet.stuck, fleet.water.p50, fleet.water.p99);
+
+    bool ok = pots.size() == options.pots;
+    for (size_t i = 0; i < pots.size() && ok; i++)
+        ok = check(options, samples, pots[i]);
+    printf("check     %s\n", ok ? "ok" : "FAILED");
+
+    store.close();
+    if (!options.keep)
+        removeStore(options.directory);
+    return ok ? 0 : 1;
+}
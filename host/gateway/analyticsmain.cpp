@@ -0,0 +1,165 @@
+// Fleet Analytics Report
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Reports on every pot in a telemetry store (see store.h and analytics.h):
+// water used, alerts, moisture sensors that drift and volume sensors that
+// are stuck.
+//
+//   flowerpot_analytics DIRECTORY [--days D] [--threads N] [--deadband ML]
+//                       [--drift PERCENT] [--csv]
+//
+//   --days      the last D days of the store (default 1); 0 for all of it
+//   --threads   worker threads (default one per hardware thread)
+//   --deadband  changes in volume up to this are noise (default 1 ml)
+//   --drift     moisture drifting faster than this many percent a day is
+//               reported (default 0.25); it takes three waterings to tell,
+//               so a week or more
+//   --csv       print one line per pot instead of the fleet report:
+//
+//               POT,SAMPLES,WATER_ML,REFILLS,WATERINGS,WATER_ALERTS,
+//               BATTERY_ALERTS,MOISTURE_MEAN,MOISTURE_MIN,MOISTURE_MAX,
+//               DRIFT,DRIFTING,STUCK
+//
+// How long the store took to open and the pots took to summarise goes to
+// stderr.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "analytics.h"
+
+namespace {
+
+const int64_t DAY_MS = 86400000;
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_analytics DIRECTORY [--days D] [--threads N] [--deadband ML]\n"
+        "                           [--drift PERCENT] [--csv]\n");
+    exit(2);
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printQuantiles(const char *name, const gateway::Quantiles &q, const char *unit)
+{
+    printf("  %-14s p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f %s\n", name, q.p50, q.p90, q.p99, q.max, unit);
+}
+
+// Up to ten of the pots a flag picks out
+void printPots(const char *name, const std::vector<gateway::PotSummary> &pots, bool gateway::PotSummary::*flag)
+{
+    unsigned shown = 0;
+    printf("%s:", name);
+    for (const gateway::PotSummary &pot : pots)
+    {
+        if (!(pot.*flag))
+            continue;
+        if (shown++ == 10)
+        {
+            printf(" ...");
+            break;
+        }
+        printf(" %u", pot.pot);
+    }
+    printf(shown ? "\n" : " none\n");
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        usage();
+    const char *directory = argv[1];
+    gateway::AnalyticsOptions options;
+    double days = 1;
+    bool csv = false;
+    for (int i = 2; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--csv") == 0)
+        {
+            csv = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--days") == 0)
+            days = atof(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--deadband") == 0)
+            options.deadband = (float)atof(value);
+        else if (strcmp(arg, "--drift") == 0)
+            options.driftLimit = (float)atof(value);
+        else
+            usage();
+    }
+    if (days < 0)
+        usage();
+
+    auto start = std::chrono::steady_clock::now();
+    gateway::StoreReader store;
+    std::string error;
+    if (!store.open(directory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    fprintf(stderr, "opened in %.2f ms\n", millisecondsSince(start));
+    if (days > 0)
+    {
+        options.to = store.last();
+        options.from = options.to - (int64_t)(days * DAY_MS);
+    }
+
+    start = std::chrono::steady_clock::now();
+    gateway::Analytics analytics(options);
+    std::vector<gateway::PotSummary> pots;
+    gateway::FleetSummary fleet;
+    analytics.run(store, pots, fleet);
+    double elapsed = millisecondsSince(start);
+    fprintf(stderr, "%u pots, %llu samples in %.1f ms on %u threads\n", fleet.pots,
+            (unsigned long long)fleet.samples, elapsed, analytics.threads());
+
+    if (csv)
+    {
+        for (const gateway::PotSummary &pot : pots)
+            printf("%u,%u,%.1f,%u,%u,%u,%u,%.1f,%.1f,%.1f,%.3f,%d,%d\n", pot.pot, pot.samples, pot.waterUsed,
+                   pot.refills, pot.waterings, pot.waterAlerts, pot.batteryAlerts, pot.moistureMean,
+                   pot.moistureMin, pot.moistureMax, pot.drift, pot.drifting, pot.stuck);
+        return 0;
+    }
+    printf("%u pots, %llu samples\n", fleet.pots, (unsigned long long)fleet.samples);
+    printf("water used %.1f l, %u pots alerting, %u drifting, %u with volume stuck\n", fleet.waterUsed / 1000,
+           fleet.alerting, fleet.drifting, fleet.stuck);
+    printQuantiles("water used", fleet.water, "ml");
+    printQuantiles("water alerts", fleet.waterAlerts, "readings");
+    printQuantiles("drift", fleet.drift, "%/day");
+    printQuantiles("moisture", fleet.moisture, "%");
+    printPots("drifting", pots, &gateway::PotSummary::drifting);
+    printPots("stuck", pots, &gateway::PotSummary::stuck);
+    return 0;
+}
@@ -0,0 +1,307 @@
+// Anomaly Detection
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "anomaly.h"
+
+namespace gateway {
+
+namespace {
+
+const double MS_PER_HOUR = 3.6e6;
+
+// Weight of each new reading in a pot's drift: a time constant of an hour
+const double DRIFT_HOURS = 1;
+
+// Weight of each watering in where a pot gets watered
+const float TROUGH_WEIGHT = 0.2f;
+
+// Waterings seen before Unwatered is judged
+const uint16_t TROUGHS_NEEDED = 3;
+
+// Response windows running without a response before NoResponse
+const uint8_t MISSES_NEEDED = 2;
+
+const char *KIND_NAMES[] = { "flatline", "no-response", "unwatered", "leak" };
+
+struct Option
+{
+    const char *name;
+    double AnomalyOptions::*field;
+};
+
+const Option OPTIONS[] =
+{
+    { "flat-hours",         &AnomalyOptions::flatHours },
+    { "flat-band",          &AnomalyOptions::flatBand },
+    { "pump-drop",          &AnomalyOptions::pumpDrop },
+    { "response-minutes",   &AnomalyOptions::responseMinutes },
+    { "response-rise",      &AnomalyOptions::responseRise },
+    { "dry-margin",         &AnomalyOptions::dryMargin },
+    { "dry-hours",          &AnomalyOptions::dryHours },
+    { "leak-rate",          &AnomalyOptions::leakRate },
+    { "leak-hours",         &AnomalyOptions::leakHours },
+};
+
+uint8_t bit(AnomalyKind kind)
+{
+    return (uint8_t)(1u << (unsigned)kind);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+const char *anomalyKindName(AnomalyKind kind)
+{
+    return KIND_NAMES[(unsigned)kind];
+}
+
+//-----------------------------------------------------------------------------
+// AnomalyOptions
+//-----------------------------------------------------------------------------
+
+bool AnomalyOptions::set(const std::string &assignment, std::string &error)
+{
+    size_t equals = assignment.find('=');
+    std::string name = assignment.substr(0, equals);
+    for (const Option &option : OPTIONS)
+    {
+        if (name != option.name)
+            continue;
+        char *end;
+        const char *text = equals == std::string::npos ? "" : assignment.c_str() + equals + 1;
+        double value = strtod(text, &end);
+        if (*text == '\0' || *end != '\0' || value < 0)
+        {
+            error = "bad value in '" + assignment + "'";
+            return false;
+        }
+        this->*option.field = value;
+        return true;
+    }
+    error = "unknown anomaly option '" + name + "'";
+    return false;
+}
+
+std::string AnomalyOptions::describe() const
+{
+    std::string text;
+    for (const Option &option : OPTIONS)
+    {
+        char line[64];
+        snprintf(line, sizeof(line), "%-18s %g\n", option.name, this->*option.field);
+        text += line;
+    }
+    return text;
+}
+
+//-----------------------------------------------------------------------------
+// AnomalyDetector
+//-----------------------------------------------------------------------------
+
+AnomalyDetector::AnomalyDetector(const AnomalyOptions &options, AnomalySink &sink, size_t boards)
+    : options_(options), sink_(sink), boards_(boards, Board())
+{
+}
+
+void AnomalyDetector::observe(uint32_t id, int64_t time, const StatusReply &reply)
+{
+    if (id >= boards_.size())
+        boards_.resize(id + 1, Board());
+    Board &board = boards_[id];
+    if (!board.seen || reply.pots != board.pots)
+    {
+        start(id, board, time, reply);
+        return;
+    }
+    if (time <= board.last)
+        return;
+    double hours = (double)(time - board.last) / MS_PER_HOUR;
+
+    // A step in the volume is a pump run or a refill
+    float change = reply.volume - board.volume;
+    if (fabsf(change) >= options_.pumpDrop)
+        board.offset -= change;
+    if (change <= -options_.pumpDrop)
+    {
+        if (!board.windowEnd)
+        {
+            board.windowEnd = time + (int64_t)(options_.responseMinutes * 60000);
+            board.responded = 0;
+            board.drawn = 0;
+            for (uint8_t i = 0; i < board.pots; i++)
+            {
+                board.pot[i].base = board.pot[i].last;
+                board.pot[i].cusum = 0;
+            }
+        }
+        board.drawn -= change;
+    }
+    fitLeak(id, board, time, reply.volume + board.offset, hours);
+
+    float allowance = (float)options_.responseRise / 4;
+    int64_t flatMs = (int64_t)(options_.flatHours * MS_PER_HOUR);
+    int64_t dryMs = (int64_t)(options_.dryHours * MS_PER_HOUR);
+    for (uint8_t i = 0; i < board.pots; i++)
+    {
+        Pot &pot = board.pot[i];
+        uint8_t number = (uint8_t)(i + 1);
+        float moisture = reply.moisture[i];
+        float moved = moisture - pot.last;
+
+        if (fabsf(moisture - pot.anchor) > options_.flatBand)
+        {
+            pot.anchor = moisture;
+            pot.anchored = time;
+            report(id, number, pot.raised, AnomalyKind::Flatline, false, time, moisture);
+        }
+        else if (time - pot.anchored >= flatMs)
+            report(id, number, pot.raised, AnomalyKind::Flatline, true, time, pot.anchor);
+
+        if (board.windowEnd)
+        {
+            pot.cusum = std::max(0.0f, pot.cusum + moved - pot.drift * (float)hours - allowance);
+            if (!(board.responded & 1u << i) && pot.cusum >= options_.responseRise)
+            {
+                board.responded |= (uint8_t)(1u << i);
+                if (pot.troughs)
+                {
+                    float deviation = fabsf(pot.base - pot.trough);
+                    pot.trough += (pot.base - pot.trough) * TROUGH_WEIGHT;
+                    pot.troughDeviation += (deviation - pot.troughDeviation) * TROUGH_WEIGHT;
+                }
+                else
+                    pot.trough = pot.base;
+                pot.troughs = (uint16_t)std::min(pot.troughs + 1, 0xffff);
+                pot.dryFrom = 0;
+                report(id, number, pot.raised, AnomalyKind::Unwatered, false, time, moisture);
+            }
+        }
+        else
+        {
+            float weight = (float)(hours / (hours + DRIFT_HOURS));
+            pot.drift += ((float)(moved / hours) - pot.drift) * weight;
+        }
+
+        if (pot.troughs >= TROUGHS_NEEDED)
+        {
+            float threshold = pot.trough - std::max((float)options_.dryMargin, 3 * pot.troughDeviation);
+            if (moisture >= threshold)
+            {
+                pot.dryFrom = 0;
+                report(id, number, pot.raised, AnomalyKind::Unwatered, false, time, moisture);
+            }
+            else if (!pot.dryFrom)
+                pot.dryFrom = time;
+            else if (time - pot.dryFrom >= dryMs)
+                report(id, number, pot.raised, AnomalyKind::Unwatered, true, time, moisture);
+        }
+        pot.last = moisture;
+    }
+
+    if (board.windowEnd && time >= board.windowEnd)
+        closeWindow(id, board, time);
+    board.volume = reply.volume;
+    board.last = time;
+}
+
+bool AnomalyDetector::raised(uint32_t id, uint8_t pot, AnomalyKind kind) const
+{
+    if (id >= boards_.size())
+        return false;
+    const Board &board = boards_[id];
+    if (pot == 0)
+        return board.raised & bit(kind);
+    return pot <= board.pots && board.pot[pot - 1].raised & bit(kind);
+}
+
+// Forgets what was known of a board, on its first reply or when its number
+// of pots changes
+void AnomalyDetector::start(uint32_t id, Board &board, int64_t time, const StatusReply &reply)
+{
+    for (unsigned kind = 0; kind < kAnomalyKinds; kind++)
+    {
+        report(id, 0, board.raised, (AnomalyKind)kind, false, time, 0);
+        for (uint8_t i = 0; i < board.pots; i++)
+            report(id, (uint8_t)(i + 1), board.pot[i].raised, (AnomalyKind)kind, false, time, 0);
+    }
+    board = Board();
+    board.seen = true;
+    board.pots = (uint8_t)std::min<unsigned>(reply.pots, kMaxPots);
+    board.last = time;
+    board.volume = reply.volume;
+    board.origin = time;
+    for (uint8_t i = 0; i < board.pots; i++)
+    {
+        Pot &pot = board.pot[i];
+        pot.last = reply.moisture[i];
+        pot.anchor = reply.moisture[i];
+        pot.anchored = time;
+    }
+}
+
+// Adds a reading of the volume with its steps taken out to the weighted fit,
+// and judges the slope
+void AnomalyDetector::fitLeak(uint32_t id, Board &board, int64_t time, double volume, double hours)
+{
+    double t = (double)(time - board.origin) / MS_PER_HOUR;
+    double decay = exp(-hours / options_.leakHours);
+    board.weight = board.weight * decay + 1;
+    board.sumT = board.sumT * decay + t;
+    board.sumV = board.sumV * decay + volume;
+    board.sumTT = board.sumTT * decay + t * t;
+    board.sumTV = board.sumTV * decay + t * volume;
+    if (t < options_.leakHours)
+        return;
+
+    double spread = board.weight * board.sumTT - board.sumT * board.sumT;
+    if (spread <= 0)
+        return;
+    double leak = -(board.weight * board.sumTV - board.sumT * board.sumV) / spread;
+    if (leak > options_.leakRate)
+        report(id, 0, board.raised, AnomalyKind::Leak, true, time, (float)leak);
+    else if (leak < options_.leakRate / 2)
+        report(id, 0, board.raised, AnomalyKind::Leak, false, time, (float)leak);
+}
+
+void AnomalyDetector::closeWindow(uint32_t id, Board &board, int64_t time)
+{
+    uint8_t pot = board.pots == 1 ? 1 : 0;
+    uint8_t &raised = pot ? board.pot[0].raised : board.raised;
+    board.windowEnd = 0;
+    if (board.responded)
+    {
+        board.misses = 0;
+        report(id, pot, raised, AnomalyKind::NoResponse, false, time, 0);
+    }
+    else if ((board.misses = (uint8_t)std::min(board.misses + 1, 0xff)) >= MISSES_NEEDED)
+        report(id, pot, raised, AnomalyKind::NoResponse, true, time, board.drawn);
+}
+
+// Tells the sink when an anomaly changes, keeping which are raised in raised
+void AnomalyDetector::report(uint32_t id, uint8_t pot, uint8_t &raised, AnomalyKind kind, bool on, int64_t time,
+                             float value)
+{
+    if (((raised & bit(kind)) != 0) == on)
+        return;
+    raised ^= bit(kind);
+    Anomaly anomaly = { id, pot, kind, on, time, value };
+    sink_.onAnomaly(anomaly);
+}
+
+}
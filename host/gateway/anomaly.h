@@ -0,0 +1,179 @@
+// Anomaly Detection
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Watches status replies as they arrive and raises an anomaly when a board's
+// readings stop looking like a working pot, well before the water low alert
+// would sound.  Each reply costs a fixed amount of work and a board's state
+// is a few hundred bytes, however long it has been watched:
+//
+//   Flatline    a pot's moisture has not moved in flat-hours, which a
+//               living plant never manages; the probe is dead or unplugged
+//
+//   NoResponse  the reservoir dropped, so a pump ran, but no pot on the
+//               board got any wetter in the response time, twice running:
+//               the hose is off, or the probe of the pot being watered is
+//               dead
+//
+//   Unwatered   a pot has dried dry-margin below the moisture it is usually
+//               watered at and stayed there dry-hours; its pump is stuck or
+//               its hose blocked
+//
+//   Leak        the reservoir is falling faster than leak-rate, with pump
+//               runs and refills taken out
+//
+// A pump run shows as a fall of pump-drop or more in the volume between
+// two readings.  From then until the response time has passed, each pot
+// runs a one-sided CUSUM of its moisture changes, less the drift it
+// usually has between waterings (an exponentially weighted mean of its
+// rate of change) and an allowance of a quarter of the rise; a pot whose
+// sum passes the rise has responded.  The moisture each responding pot was
+// at before the run feeds a running mean and mean deviation of where it
+// gets watered, which Unwatered is judged against after three waterings.
+//
+// The reservoir's leak rate is the slope of an exponentially weighted least
+// squares fit, with a time constant of leak-hours, to the volume with every
+// step of pump-drop or more taken out.  It is judged once a board has been
+// watched for leak-hours and cleared when it falls below half the rate.
+//
+// An anomaly is raised once, when it starts, and cleared once, when it
+// ends: a probe that moves, a pump run that gets a response, a pot back
+// above its threshold, a leak that slows.  NoResponse is reported against
+// the board (pot 0) unless it has one pot, since the volume does not say
+// which pump ran.
+//
+// Boards are numbered by the caller, densely from 0.  One detector can
+// watch boards from several threads as long as each board is always
+// observed from the same thread and the detector was made with room for
+// every board, so that it never grows.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_ANOMALY_H_
+#define GATEWAY_ANOMALY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "reply.h"
+
+namespace gateway {
+
+struct AnomalyOptions
+{
+    double flatHours = 8;
+    double flatBand = 0.05;           // Percent; smaller moves are not moves
+    double pumpDrop = 4;              // Milliliters between two readings
+    double responseMinutes = 30;
+    double responseRise = 1;          // Percent
+    double dryMargin = 3;             // Percent
+    double dryHours = 1;
+    double leakRate = 2;              // Milliliters an hour
+    double leakHours = 6;
+
+    // name=value with the names listed by describe()
+    bool set(const std::string &assignment, std::string &error);
+    std::string describe() const;
+};
+
+enum class AnomalyKind : uint8_t
+{
+    Flatline,
+    NoResponse,
+    Unwatered,
+    Leak
+};
+
+const unsigned kAnomalyKinds = 4;
+
+const char *anomalyKindName(AnomalyKind kind);
+
+struct Anomaly
+{
+    uint32_t board;
+    uint8_t pot;                      // 1-based, 0 for the board as a whole
+    AnomalyKind kind;
+    bool raised;                      // false when it clears
+    int64_t time;                     // Milliseconds, as passed to observe()
+    float value;                      // Flatline: the stuck reading (%)
+                                      // NoResponse: ml drawn without a response
+                                      // Unwatered: moisture (%)
+                                      // Leak: ml an hour
+};
+
+class AnomalySink
+{
+public:
+    virtual ~AnomalySink() {}
+    virtual void onAnomaly(const Anomaly &anomaly) = 0;
+};
+
+class AnomalyDetector
+{
+public:
+    AnomalyDetector(const AnomalyOptions &options, AnomalySink &sink, size_t boards = 0);
+
+    // Takes a board's status reply read at time (milliseconds, increasing
+    // for each board)
+    void observe(uint32_t board, int64_t time, const StatusReply &reply);
+
+    // Whether an anomaly is raised now, on a pot (1-based) or the board (0)
+    bool raised(uint32_t board, uint8_t pot, AnomalyKind kind) const;
+
+private:
+    struct Pot
+    {
+        float last;                   // Moisture at the last reading
+        float anchor;                 // Moisture last moved to
+        int64_t anchored;             // and when
+        float drift;                  // %/h between waterings, weighted mean
+        float base;                   // Moisture before the pump run
+        float cusum;
+        float trough;                 // Moisture at watering, running mean
+        float troughDeviation;        // and mean absolute deviation
+        uint16_t troughs;
+        int64_t dryFrom;              // 0 while above the threshold
+        uint8_t raised;               // Bit per AnomalyKind
+    };
+
+    struct Board
+    {
+        bool seen;
+        uint8_t pots;
+        uint8_t responded;            // Bit per pot in this response window
+        uint8_t misses;               // Windows running without a response
+        uint8_t raised;
+        int64_t last;
+        int64_t windowEnd;            // 0 when no window is open
+        float volume;
+        float drawn;                  // ml drawn in this response window
+        double offset;                // Steps taken out of the volume
+        int64_t origin;               // Of the leak fit, and its sums
+        double weight;
+        double sumT;
+        double sumV;
+        double sumTT;
+        double sumTV;
+        Pot pot[kMaxPots];
+    };
+
+    void start(uint32_t id, Board &board, int64_t time, const StatusReply &reply);
+    void fitLeak(uint32_t id, Board &board, int64_t time, double volume, double hours);
+    void closeWindow(uint32_t id, Board &board, int64_t time);
+    void report(uint32_t id, uint8_t pot, uint8_t &raised, AnomalyKind kind, bool on, int64_t time, float value);
+
+    AnomalyOptions options_;
+    AnomalySink &sink_;
+    std::vector<Board> boards_;
+};
+
+}
+
+#endif
@@ -0,0 +1,476 @@
+// Anomaly Detection Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Checks the anomaly detector (anomaly.h) against pots with faults and times
+// it over a fleet.
+//
+//   flowerpot_anomaly_bench [--pots N] [--days D] [--fault-hour H]
+//                           [--boards N] [--fleet-days D] [--period SECONDS]
+//                           [--set NAME=VALUE]...
+//
+//   --pots        simulated pots per scenario (default 8)
+//   --days        days each scenario runs (default 4)
+//   --fault-hour  hour the pump and probe faults start (default 48)
+//   --boards      boards in the fleet (default 10000)
+//   --fleet-days  days of the fleet's readings (default 7)
+//   --period      seconds between a board's status replies, in both
+//                 (default 60)
+//   --set         set an option of the detector
+//
+// Scenarios run the firmware on simulated boards wired to the plant model
+// (fleet.h), each told "water 6 0 22 0" and "LEVEL 35", and feed their
+// status replies to the detector as the simulated gateway polls them:
+//
+//   healthy      no faults; nothing should be raised
+//   leak         the reservoir leaks 5 ml an hour from power-on
+//   pump-fail    the pump moves nothing from the fault hour
+//   probe-fail   the probe sticks at the fault hour
+//
+// A board is detected if the scenario's anomaly is raised after its fault
+// starts; any other anomaly, or one raised before, is false.
+//
+// The fleet is made of readings worked out from the board and time, four
+// pots a board, each watered every 12 to 24 hours with 20 ml from a shared
+// reservoir refilled weekly, with a tenth of noise on the moisture and half
+// a ml on the volume.  From day 3:
+//
+//   board % 97 == 13   the reservoir leaks 5 ml an hour
+//   board % 89 == 5    pot 1's probe sticks
+//   board % 101 == 7   pot 1 is no longer watered, unless its probe sticks
+//
+// Only the detector is timed.  The check passes if every scenario and
+// every board of the fleet gives what was planted, and nothing else; the
+// exit status is 1 if not.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "anomaly.h"
+#include "firmware.h"
+#include "fleet.h"
+
+namespace {
+
+const char SETUP[] = "water 6 0 22 0\rLEVEL 35\r";
+const int64_t HOUR_MS = 3600000;
+const unsigned FLEET_POTS = 4;
+const int64_t FLEET_FAULT_MS = 3 * 24 * HOUR_MS;
+const int64_t WEEK_MS = 7 * 24 * HOUR_MS;
+const float RESERVOIR = 1500;
+const float DOSE = 20;
+
+struct Options
+{
+    unsigned pots = 8;
+    double days = 4;
+    double faultHour = 48;
+    uint32_t boards = 10000;
+    double fleetDays = 7;
+    double period = 60;
+    gateway::AnomalyOptions anomalies;
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_anomaly_bench [--pots N] [--days D] [--fault-hour H]\n"
+        "                               [--boards N] [--fleet-days D] [--period SECONDS]\n"
+        "                               [--set NAME=VALUE]...\n");
+    exit(2);
+}
+
+uint8_t bit(gateway::AnomalyKind kind)
+{
+    return (uint8_t)(1u << (unsigned)kind);
+}
+
+// Each board's anomalies: which kinds were raised, and the first time each
+// was
+class Tally : public gateway::AnomalySink
+{
+public:
+    explicit Tally(size_t boards) : boards_(boards, Board()) {}
+
+    void onAnomaly(const gateway::Anomaly &anomaly) override
+    {
+        if (!anomaly.raised)
+            return;
+        std::lock_guard<std::mutex> guard(lock_);
+        Board &board = boards_[anomaly.board];
+        unsigned kind = (unsigned)anomaly.kind;
+        if (!(board.kinds & 1u << kind))
+            board.first[kind] = anomaly.time;
+        board.kinds |= (uint8_t)(1u << kind);
+    }
+
+    uint8_t kinds(size_t board) const { return boards_[board].kinds; }
+    int64_t first(size_t board, gateway::AnomalyKind kind) const { return boards_[board].first[(unsigned)kind]; }
+
+private:
+    struct Board
+    {
+        uint8_t kinds;
+        int64_t first[gateway::kAnomalyKinds];
+    };
+
+    std::vector<Board> boards_;
+    std::mutex lock_;
+};
+
+std::string kindNames(uint8_t kinds)
+{
+    std::string names;
+    for (unsigned kind = 0; kind < gateway::kAnomalyKinds; kind++)
+        if (kinds & 1u << kind)
+            names += std::string(names.empty() ? "" : "+") + gateway::anomalyKindName((gateway::AnomalyKind)kind);
+    return names.empty() ? "none" : names;
+}
+
+// Scenarios
+
+struct Scenario
+{
+    const char *name;
+    const char *fault;                // Plant parameter, without its value
+    bool atFaultHour;                 // or from power-on
+    uint8_t expected;                 // Anomaly kinds the fault may raise
+};
+
+// A simulated pot's UART0 output, cut into lines and status replies
+struct Listener
+{
+    char line[gateway::ReplyParser::kLineMax + 1];
+    size_t length;
+    gateway::StatusReply reply;
+};
+
+bool runScenario(const Options &options, const Scenario &scenario)
+{
+    sim::PlantParameters base;
+    std::string error;
+    double onsetHours = scenario.atFaultHour ? options.faultHour : 0;
+    if (scenario.fault)
+    {
+        std::string value = scenario.atFaultHour ? std::to_string(options.faultHour) : "5";
+        if (!base.set(std::string(scenario.fault) + "=" + value, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return false;
+        }
+    }
+
+    sim::FleetOptions fleetOptions;
+    fleetOptions.pots = options.pots;
+    fleetOptions.pollPeriod = (uint64_t)(options.period * sim::kCyclesPerSecond);
+    sim::Fleet fleet(fleetOptions, base, sim::flowerpotFirmware());
+    Tally tally(fleet.size());
+    gateway::AnomalyDetector detector(options.anomalies, tally, fleet.size());
+    std::vector<Listener> listeners(fleet.size(), Listener());
+    for (size_t i = 0; i < fleet.size(); i++)
+    {
+        sim::Machine &machine = fleet.pot(i).machine();
+        machine.setRxFlowControl(true);
+        machine.setRtc((uint32_t)(base.startHour * 3600));
+        machine.schedule(sim::kCyclesPerSecond / 5, [](sim::Machine &m) { m.receive(SETUP, strlen(SETUP)); });
+        Listener *listener = &listeners[i];
+        machine.setTxSink([listener, &detector, &machine, i](uint8_t c)
+        {
+            if (c == '\r')
+                return;
+            if (c != '\n')
+            {
+                if (listener->length < gateway::ReplyParser::kLineMax)
+                    listener->line[listener->length++] = (char)c;
+                return;
+            }
+            if (listener->length == 6 && memcmp(listener->line, "status", 6) == 0)
+                listener->reply = gateway::StatusReply();
+            else if (gateway::parseStatusLine(listener->line, listener->length, listener->reply) ==
+                     gateway::StatusLine::Last)
+            {
+                int64_t time = (int64_t)(machine.now() / (sim::kCyclesPerSecond / 1000));
+                detector.observe((uint32_t)i, time, listener->reply);
+                listener->reply = gateway::StatusReply();
+            }
+            listener->length = 0;
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t end = (uint64_t)(options.days * 86400 * sim::kCyclesPerSecond);
+    while (fleet.now() < end)
+        fleet.step(end);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int64_t onset = (int64_t)(onsetHours * HOUR_MS);
+    unsigned detected = 0;
+    unsigned wrong = 0;
+    uint8_t wrongKinds = 0;
+    std::vector<double> delays;
+    for (size_t i = 0; i < fleet.size(); i++)
+    {
+        uint8_t kinds = tally.kinds(i);
+        int64_t first = -1;
+        uint8_t early = 0;
+        for (unsigned kind = 0; kind < gateway::kAnomalyKinds; kind++)
+        {
+            if (!(kinds & 1u << kind) || !(scenario.expected & 1u << kind))
+                continue;
+            int64_t time = tally.first(i, (gateway::AnomalyKind)kind);
+            if (time < onset)
+                early |= (uint8_t)(1u << kind);
+            else if (first < 0 || time < first)
+                first = time;
+        }
+        uint8_t unexpected = (uint8_t)((kinds & ~scenario.expected) | early);
+        if (unexpected)
+        {
+            wrong++;
+            wrongKinds |= unexpected;
+        }
+        if (first >= 0)
+        {
+            detected++;
+            delays.push_back((double)(first - onset) / HOUR_MS);
+        }
+    }
+
+    bool ok = wrong == 0 && (scenario.expected ? detected == fleet.size() : detected == 0);
+    printf("%-11s %3zu pots  %3u detected  %3u false", scenario.name, fleet.size(), detected, wrong);
+    if (!delays.empty())
+    {
+        std::sort(delays.begin(), delays.end());
+        printf("  after %5.1f h median %5.1f h max", delays[delays.size() / 2], delays.back());
+    }
+    else
+        printf("                              ");
+    printf("  (%.1f s)%s", wall, ok ? "" : "  FAILED");
+    if (wrong)
+        printf(" raised %s", kindNames(wrongKinds).c_str());
+    printf("\n");
+    return ok;
+}
+
+// Fleet
+
+uint32_t mix(uint32_t board, uint32_t sample, uint32_t salt)
+{
+    uint64_t x = (uint64_t)board << 32 ^ sample ^ (uint64_t)salt << 56;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+float noise(uint32_t board, uint32_t sample, uint32_t salt, float size)
+{
+    return (float)((int)(mix(board, sample, salt) % 3) - 1) * size;
+}
+
+bool leaking(uint32_t board)
+{
+    return board % 97 == 13;
+}
+
+bool stuckProbe(uint32_t board)
+{
+    return board % 89 == 5;
+}
+
+// A stuck probe would hide it
+bool unwatered(uint32_t board)
+{
+    return board % 101 == 7 && !stuckProbe(board);
+}
+
+uint8_t planted(uint32_t board)
+{
+    uint8_t kinds = 0;
+    if (leaking(board))
+        kinds |= bit(gateway::AnomalyKind::Leak);
+    if (stuckProbe(board))
+        kinds |= bit(gateway::AnomalyKind::Flatline);
+    if (unwatered(board))
+        kinds |= bit(gateway::AnomalyKind::Unwatered);
+    return kinds;
+}
+
+// Waterings of a pot watered every interval, offset by phase, up to time
+int64_t waterings(int64_t time, int64_t interval, int64_t phase)
+{
+    return (time + phase) / interval;
+}
+
+// A board's status reply at time since the readings began
+void fleetReply(uint32_t board, uint32_t sample, int64_t time, gateway::StatusReply &reply)
+{
+    reply.pots = FLEET_POTS;
+    reply.light = 50;
+    reply.battery = 9;
+    int64_t refill = time / WEEK_MS * WEEK_MS;
+    int64_t drawn = 0;
+    for (unsigned pot = 0; pot < FLEET_POTS; pot++)
+    {
+        uint32_t seed = mix(board, pot, 99);
+        int64_t interval = 12 * HOUR_MS + (int64_t)(seed % 1000) * 12 * HOUR_MS / 1000;
+        int64_t phase = (int64_t)(seed / 1000 % 1000) * interval / 1000;
+        int64_t at = time;
+        if (pot == 0 && unwatered(board))
+            at = std::min(time, FLEET_FAULT_MS);
+        if (pot == 0 && stuckProbe(board) && time >= FLEET_FAULT_MS)
+        {
+            // Stuck at what it read when the fault started
+            int64_t since = (FLEET_FAULT_MS + phase) % interval;
+            reply.moisture[pot] = 36 - 6 * (float)since / (float)interval;
+        }
+        else
+        {
+            int64_t watered = waterings(at, interval, phase) * interval - phase;
+            float dried = 6 * (float)(time - watered) / (float)interval;
+            reply.moisture[pot] = std::max(5.0f, 36 - dried) + noise(board, sample, pot, 0.1f);
+        }
+        drawn += waterings(at, interval, phase) - waterings(std::min(at, refill), interval, phase);
+    }
+    float volume = RESERVOIR - DOSE * (float)drawn;
+    if (leaking(board) && time > FLEET_FAULT_MS)
+        volume -= 5 * (float)(time - FLEET_FAULT_MS) / HOUR_MS;
+    reply.volume = std::max(0.0f, volume) + noise(board, sample, 7, 0.5f);
+}
+
+bool runFleet(const Options &options)
+{
+    Tally tally(options.boards);
+    gateway::AnomalyDetector detector(options.anomalies, tally, options.boards);
+    int64_t period = (int64_t)(options.period * 1000);
+    uint32_t samples = (uint32_t)(options.fleetDays * 86400 / options.period);
+    std::vector<gateway::StatusReply> replies(options.boards, gateway::StatusReply());
+    std::vector<int64_t> times(options.boards);
+    double seconds = 0;
+    for (uint32_t sample = 0; sample < samples; sample++)
+    {
+        for (uint32_t board = 0; board < options.boards; board++)
+        {
+            times[board] = (int64_t)sample * period + (int64_t)board * period / options.boards;
+            fleetReply(board, sample, times[board], replies[board]);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t board = 0; board < options.boards; board++)
+            detector.observe(board, times[board], replies[board]);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    unsigned counts[gateway::kAnomalyKinds] = {};
+    unsigned missed = 0;
+    unsigned wrong = 0;
+    int64_t example = -1;
+    for (uint32_t board = 0; board < options.boards; board++)
+    {
+        uint8_t expected = planted(board);
+        uint8_t allowed = expected;
+        if (stuckProbe(board))
+            allowed |= bit(gateway::AnomalyKind::NoResponse);
+        uint8_t kinds = tally.kinds(board);
+        for (unsigned kind = 0; kind < gateway::kAnomalyKinds; kind++)
+            counts[kind] += (kinds >> kind) & 1;
+        bool early = false;
+        for (unsigned kind = 0; kind < gateway::kAnomalyKinds; kind++)
+            early |= (kinds & 1u << kind) && tally.first(board, (gateway::AnomalyKind)kind) < FLEET_FAULT_MS;
+        if ((kinds & expected) != expected)
+            missed++;
+        if ((kinds & ~allowed) || early)
+            wrong++;
+        if (example < 0 && ((kinds & expected) != expected || (kinds & ~allowed) || early))
+            example = board;
+    }
+
+    uint64_t replyCount = (uint64_t)samples * options.boards;
+    printf("fleet       %u boards x %u pots x %.0f days: %.1f M replies in %.2f s, %.1f M replies/s, %.0f ns a "
+           "reply\n",
+           options.boards, FLEET_POTS, options.fleetDays, (double)replyCount / 1e6, seconds,
+           (double)replyCount / seconds / 1e6, seconds / (double)replyCount * 1e9);
+    printf("            polled every %.0f s, the fleet needs %.4f%% of a core\n", options.period,
+           100 * seconds / (double)replyCount * options.boards / options.period);
+    printf("            raised");
+    for (unsigned kind = 0; kind < gateway::kAnomalyKinds; kind++)
+        printf(" %u %s", counts[kind], gateway::anomalyKindName((gateway::AnomalyKind)kind));
+    printf("; %u missed, %u false\n", missed, wrong);
+    if (example >= 0)
+        printf("            board %lld: planted %s, raised %s\n", (long long)example,
+               kindNames(planted((uint32_t)example)).c_str(), kindNames(tally.kinds((size_t)example)).c_str());
+    return missed == 0 && wrong == 0;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    std::string error;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            options.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--days") == 0)
+            options.days = atof(value);
+        else if (strcmp(arg, "--fault-hour") == 0)
+            options.faultHour = atof(value);
+        else if (strcmp(arg, "--boards") == 0)
+            options.boards = (uint32_t)atol(value);
+        else if (strcmp(arg, "--fleet-days") == 0)
+            options.fleetDays = atof(value);
+        else if (strcmp(arg, "--period") == 0)
+            options.period = atof(value);
+        else if (strcmp(arg, "--set") == 0)
+        {
+            if (!options.anomalies.set(value, error))
+            {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+        else
+            usage();
+    }
+    if (options.pots == 0 || options.days <= 0 || options.faultHour <= 0 || options.faultHour >= options.days * 24 ||
+        options.boards == 0 || options.fleetDays <= 3 || options.period < 1)
+        usage();
+
+    const Scenario scenarios[] =
+    {
+        { "healthy", nullptr, false, 0 },
+        { "leak", "leak", false, bit(gateway::AnomalyKind::Leak) },
+        { "pump-fail", "pump-fail", true, bit(gateway::AnomalyKind::Unwatered) },
+        { "probe-fail", "probe-fail", true,
+          (uint8_t)(bit(gateway::AnomalyKind::Flatline) | bit(gateway::AnomalyKind::NoResponse)) },
+    };
+    bool ok = true;
+    for (const Scenario &scenario : scenarios)
+        ok = runScenario(options, scenario) && ok;
+    ok = runFleet(options) && ok;
+    printf("check       %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
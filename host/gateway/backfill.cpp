@@ -0,0 +1,383 @@
+// History Backfill
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "backfill.h"
+#include "baud.h"
+#include "link.h"
+
+namespace gateway {
+
+namespace {
+
+const char *RESULT_NAMES[] = { "ok", "refused", "timeout", "error" };
+
+// Text kept to find "Invalid command" in
+const size_t TAIL = 32;
+
+double monotonicSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+uint16_t le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+uint16_t exportCrc(uint16_t crc, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (unsigned bit = 0; bit < 8; bit++)
+            crc = (uint16_t)(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+    }
+    return crc;
+}
+
+const char *backfillResultName(BackfillResult result)
+{
+    return RESULT_NAMES[(unsigned)result];
+}
+
+//-----------------------------------------------------------------------------
+// ExportSession
+//-----------------------------------------------------------------------------
+
+ExportSession::ExportSession(unsigned retries)
+    : retries_(retries)
+{
+}
+
+void ExportSession::next(std::string &out)
+{
+    if (done_ || !due_)
+        return;
+    out += "export " + std::to_string(words_.size()) + "\r";
+    due_ = false;
+    requests_++;
+    awaiting_++;
+}
+
+void ExportSession::feed(const uint8_t *data, size_t length)
+{
+    if (done_)
+        return;
+    rxBytes_ += length;
+    pending_.insert(pending_.end(), data, data + length);
+
+    // A lead byte starts a block if the CRC of the length it gives checks;
+    // otherwise it is damage, or a 0xFF word of a damaged block, and the
+    // search goes on from the byte after it
+    size_t size = pending_.size();
+    size_t at = 0;
+    while (!done_ && at < size)
+    {
+        const uint8_t *lead = (const uint8_t *)memchr(&pending_[at], kExportLead, size - at);
+        size_t start = lead ? (size_t)(lead - pending_.data()) : size;
+        text(&pending_[at], start - at);
+        at = start;
+        if (size - at < 4)
+            break;
+        uint8_t count = pending_[at + 3];
+        size_t frameLength = 4 + 2 * (size_t)count + 2;
+        if (count > kExportWords)
+        {
+            at++;
+            continue;
+        }
+        if (size - at < frameLength)
+            break;
+        const uint8_t *block = &pending_[at];
+        if (le16(block + frameLength - 2) != exportCrc(0xFFFF, block, frameLength - 2))
+        {
+            damaged_ += !resyncing_;
+            resyncing_ = true;
+            at++;
+            continue;
+        }
+        resyncing_ = false;
+        frame(le16(block + 1), block + 4, count);
+        at += frameLength;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + (ptrdiff_t)std::min(at, pending_.size()));
+}
+
+void ExportSession::expire()
+{
+    if (done_)
+        return;
+    pending_.clear();
+    awaiting_ = 0;
+    retry();
+}
+
+void ExportSession::report(BackfillReport &report) const
+{
+    report.result = result_;
+    report.detail = detail_;
+    report.pots = pots_;
+    report.words = words_;
+    memcpy(report.next, next_, sizeof(next_));
+    report.requests = requests_;
+    report.damaged = damaged_;
+    report.rxBytes = rxBytes_;
+}
+
+void ExportSession::frame(uint16_t offset, const uint8_t *words, uint8_t count)
+{
+    if (offset == kExportEnd)
+    {
+        pots_ = (uint8_t)std::min<unsigned>(count, kMaxPots);
+        for (uint8_t pot = 0; pot < pots_; pot++)
+            next_[pot] = le16(words + 2 * pot);
+        if (awaiting_)
+            awaiting_--;
+        size_t total = pots_ * kHistoryWords;
+        if (words_.size() >= total)
+        {
+            words_.resize(total);
+            finish(BackfillResult::Ok, std::string());
+        }
+        else if (!awaiting_)
+            retry();
+        return;
+    }
+    // Blocks after a gap are left for the next request
+    if (offset > words_.size())
+        return;
+    for (size_t i = words_.size() - offset; i < count; i++)
+        words_.push_back(le16(words + 2 * i));
+}
+
+void ExportSession::text(const uint8_t *data, size_t length)
+{
+    if (!length)
+        return;
+    tail_.append((const char *)data, length);
+    if (tail_.find("Invalid command") != std::string::npos)
+        finish(BackfillResult::Refused, "no export command");
+    else if (tail_.size() > TAIL)
+        tail_.erase(0, tail_.size() - TAIL);
+}
+
+void ExportSession::retry()
+{
+    if (requests_ > retries_)
+    {
+        std::string had = std::to_string(words_.size()) + " words";
+        finish(BackfillResult::Timeout,
+               pots_ ? had + " of " + std::to_string(pots_ * kHistoryWords) : had + ", no end block");
+        return;
+    }
+    due_ = true;
+}
+
+void ExportSession::finish(BackfillResult result, const std::string &detail)
+{
+    done_ = true;
+    result_ = result;
+    detail_ = detail;
+}
+
+//-----------------------------------------------------------------------------
+// Backfiller
+//-----------------------------------------------------------------------------
+
+void Backfiller::run(const std::vector<std::string> &paths, std::vector<BackfillReport> &reports)
+{
+    reports.assign(paths.size(), BackfillReport());
+    for (size_t i = 0; i < paths.size(); i++)
+        reports[i].path = paths[i];
+    unsigned threads = std::max(1u, std::min(options_.threads, (unsigned)paths.size()));
+    std::vector<std::thread> workers;
+    for (unsigned shard = 1; shard < threads; shard++)
+        workers.emplace_back(&Backfiller::runShard, this, std::cref(paths), std::ref(reports), shard);
+    runShard(paths, reports, 0);
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+// Links shard, shard + threads, ... on this thread, each writing only its
+// own report
+void Backfiller::runShard(const std::vector<std::string> &paths, std::vector<BackfillReport> &reports,
+                          unsigned shard)
+{
+    // A link moves to the rate asked for, reads the log, then moves back
+    enum class Phase : uint8_t
+    {
+        Up,
+        Export,
+        Down,
+        Done
+    };
+
+    struct Active
+    {
+        size_t index;
+        int fd;
+        ExportSession session;
+        double started;
+        double heard;                 // Last read, or the last request
+        Phase phase;
+        std::unique_ptr<BaudSession> baud;
+        uint32_t speed;               // Of the host side
+    };
+
+    unsigned threads = std::max(1u, std::min(options_.threads, (unsigned)paths.size()));
+    bool faster = options_.baud && options_.baud != kBaudDefault;
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<std::unique_ptr<Active>> links;
+    size_t remaining = 0;
+    double now = monotonicSeconds();
+    for (size_t i = shard; i < paths.size(); i += threads)
+    {
+        std::string error;
+        int fd;
+        if (!openSerial(paths[i], fd, error))
+        {
+            reports[i].result = BackfillResult::Error;
+            reports[i].detail = error;
+            continue;
+        }
+        links.emplace_back(new Active{ i, fd, ExportSession(options_.retries), now, now, Phase::Export, nullptr,
+                                       kBaudDefault });
+        if (faster)
+        {
+            links.back()->phase = Phase::Up;
+            links.back()->baud.reset(new BaudSession(kBaudDefault, options_.baud, options_.baudOptions));
+        }
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = links.size() - 1;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+        remaining++;
+    }
+
+    auto finish = [epoll, &remaining, &reports](Active &link, double now)
+    {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, link.fd, nullptr);
+        reports[link.index].seconds = now - link.started;
+        link.phase = Phase::Done;
+        remaining--;
+    };
+
+    // Writes what is due and moves the link on through its phases.  Requests
+    // and baud commands are a dozen bytes, so they always fit in the link's
+    // buffer; a change of speed waits for what is queued.
+    auto advance = [this, &reports, &finish](Active &link, double now)
+    {
+        std::string out;
+        while (link.phase != Phase::Done)
+        {
+            if (link.phase == Phase::Export)
+            {
+                link.session.next(out);
+                if (!link.session.done())
+                    break;
+                if (link.speed == kBaudDefault)
+                {
+                    finish(link, now);
+                    break;
+                }
+                link.phase = Phase::Down;
+                link.baud.reset(new BaudSession(link.speed, kBaudDefault, options_.baudOptions));
+                continue;
+            }
+            link.baud->step(now, out);
+            std::string error;
+            if (link.baud->rate() != link.speed && setSerialSpeed(link.fd, link.baud->rate(), error))
+                link.speed = link.baud->rate();
+            if (!link.baud->done())
+                break;
+            BaudReport baud;
+            link.baud->report(baud);
+            BackfillReport &report = reports[link.index];
+            if (link.phase == Phase::Up)
+            {
+                report.baud = baud.rate;
+                report.baudDetail = baud.detail;
+                link.phase = Phase::Export;
+                continue;
+            }
+            if (baud.result != BaudResult::Ok)
+                report.baudDetail = "left at " + std::to_string(link.speed) + " baud: " + baud.detail;
+            finish(link, now);
+        }
+        if (out.empty())
+            return;
+        ssize_t written = write(link.fd, out.data(), out.size());
+        (void)written;
+        link.heard = now;
+    };
+
+    for (auto &link : links)
+        advance(*link, now);
+
+    struct epoll_event events[64];
+    uint8_t buffer[4096];
+    double nextScan = now + 0.05;
+    while (remaining)
+    {
+        int count = epoll_wait(epoll, events, 64, 50);
+        now = monotonicSeconds();
+        for (int e = 0; e < count; e++)
+        {
+            Active &link = *links[events[e].data.u64];
+            if (link.phase == Phase::Done)
+                continue;
+            ssize_t n;
+            while ((n = read(link.fd, buffer, sizeof(buffer))) > 0)
+            {
+                if (link.phase == Phase::Export)
+                    link.session.feed(buffer, (size_t)n);
+                else
+                    link.baud->feed(now, buffer, (size_t)n);
+            }
+            link.heard = now;
+            advance(link, now);
+        }
+        if (now < nextScan)
+            continue;
+        nextScan = now + 0.05;
+        for (auto &link : links)
+        {
+            if (link->phase == Phase::Export && !link->session.done() && now - link->heard > options_.timeout)
+                link->session.expire();
+            advance(*link, now);
+        }
+    }
+
+    for (auto &link : links)
+    {
+        link->session.report(reports[link->index]);
+        close(link->fd);
+    }
+    close(epoll);
+}
+
+}
@@ -0,0 +1,148 @@
+// History Backfill
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Reads the whole history log of many pots at once with the firmware's
+// "export" command (export.h in the firmware), for a gateway catching up
+// after an outage.  A pot answers with binary blocks of up to 16 words,
+// each with a CRC, and an end block giving its number of pots and where
+// each pot's log will next be written.
+//
+// Blocks are taken in order.  A block that fails its CRC is dropped, and
+// so is any block after a gap, so the words kept always run from word 0
+// without a hole.  When the end block shows words missing, or the link has
+// been silent for the timeout, the pot is asked again from the first word
+// missing, as "export N", up to the retries.  Blocks repeated by a resent
+// request are trimmed to the words not yet had.
+//
+// With a baud rate given, each link is first moved to it (baud.h), the log
+// read at it, and the link moved back to 115200 for the gateway.  A link
+// that will not take the rate is read at 115200.
+//
+// Links are dealt out round-robin to threads, each with its own epoll set.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_BACKFILL_H_
+#define GATEWAY_BACKFILL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "baud.h"
+#include "reply.h"
+
+namespace gateway {
+
+// As in the firmware's export.h
+const unsigned kHistoryWords = 15;    // Per pot
+const unsigned kExportWords = 16;     // Per block, at most
+const uint8_t kExportLead = 0xFF;
+const uint16_t kExportEnd = 0xFFFF;
+
+// CRC-16/CCITT-FALSE carried on over data, from 0xFFFF for a new block
+uint16_t exportCrc(uint16_t crc, const uint8_t *data, size_t length);
+
+struct BackfillOptions
+{
+    unsigned threads = 1;
+    double timeout = 2;               // Seconds a link may be silent
+    unsigned retries = 5;             // Requests after the first
+    uint32_t baud = 0;                // To read at, 0 to stay at 115200
+    BaudOptions baudOptions;
+};
+
+enum class BackfillResult : uint8_t
+{
+    Ok,
+    Refused,                          // "Invalid command": firmware without export
+    Timeout,                          // Out of retries with words missing
+    Error                             // The device could not be opened
+};
+
+const char *backfillResultName(BackfillResult result);
+
+struct BackfillReport
+{
+    std::string path;
+    BackfillResult result = BackfillResult::Error;
+    std::string detail;
+    uint8_t pots = 0;
+    std::vector<uint16_t> words;      // Pot p's log is words p * 15 on
+    uint16_t next[kMaxPots] = {};     // Word of each pot's log written next
+    uint32_t requests = 0;
+    uint32_t damaged = 0;             // Runs of blocks that failed their CRC
+    uint64_t rxBytes = 0;
+    uint32_t baud = kBaudDefault;     // The log was read at
+    std::string baudDetail;           // Why it was not the rate asked for
+    double seconds = 0;               // From the first write to the end
+};
+
+// One link's backfill: what to write next and what its blocks say
+class ExportSession
+{
+public:
+    explicit ExportSession(unsigned retries);
+
+    // Appends "export N\r" when a request is due
+    void next(std::string &out);
+
+    // Takes bytes read from the link
+    void feed(const uint8_t *data, size_t length);
+
+    bool done() const { return done_; }
+
+    // The link has been silent too long: asks again, or gives up
+    void expire();
+
+    // Fills in everything but the path and seconds
+    void report(BackfillReport &report) const;
+
+private:
+    void frame(uint16_t offset, const uint8_t *words, uint8_t count);
+    void text(const uint8_t *data, size_t length);
+    void retry();
+    void finish(BackfillResult result, const std::string &detail);
+
+    unsigned retries_;
+    std::vector<uint8_t> pending_;    // Bytes not yet taken as a block or text
+    std::vector<uint16_t> words_;     // From word 0, without a gap
+    std::string tail_;                // Of the text, for "Invalid command"
+    uint8_t pots_ = 0;
+    uint16_t next_[kMaxPots] = {};
+    bool due_ = true;                 // A request is to be written
+    uint32_t awaiting_ = 0;           // Requests whose end block is yet to come
+    uint32_t requests_ = 0;
+    uint32_t damaged_ = 0;
+    bool resyncing_ = false;          // No good block since a damaged one
+    uint64_t rxBytes_ = 0;
+    bool done_ = false;
+    BackfillResult result_ = BackfillResult::Ok;
+    std::string detail_;
+};
+
+class Backfiller
+{
+public:
+    explicit Backfiller(const BackfillOptions &options) : options_(options) {}
+
+    // Backfills every device and returns when each has finished, with a
+    // report per device in the same order
+    void run(const std::vector<std::string> &paths, std::vector<BackfillReport> &reports);
+
+private:
+    void runShard(const std::vector<std::string> &paths, std::vector<BackfillReport> &reports, unsigned shard);
+
+    BackfillOptions options_;
+};
+
+}
+
+#endif
@@ -0,0 +1,284 @@
+// History Backfill Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Reads the history logs of simulated boards in virtual time three ways and
+// reports the log bytes each delivers a second: "History N" for each pot in
+// turn, as the gateway does, then "export" (backfill.h) over a clean link,
+// then "export" over a link that damages bytes.
+//
+//   flowerpot_backfill_bench [--boards N] [--pots N] [--damage RATE]
+//                            [--timeout SECONDS] [--seed N]
+//
+//   --boards   simulated boards (default 20)
+//   --pots     pots on each board, 1-8 (default 8)
+//   --damage   chance of each byte from the board being damaged on the
+//              last run (default 0.002)
+//   --timeout  virtual seconds of silence before the board is asked
+//              again (default 0.1)
+//   --seed     of the damage (default 1)
+//
+// Each board is polled with "status" a few times first, so that its log is
+// full.  Log bytes are two a word, 15 words a pot, however they are sent;
+// the time of a read is from the first byte of the first command to the
+// last byte of the last reply, on UART0 at 115200 baud.  The exit status is
+// 1 unless each export read exactly what "History" did.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "backfill.h"
+#include "firmware.h"
+#include "plant.h"
+#include "simulation.h"
+
+namespace {
+
+// Host side steps, in cycles
+const uint64_t STEP = sim::kCyclesPerSecond / 10000;
+
+// Status polls to fill the log, five readings a pot
+const unsigned FILLS = 6;
+
+struct Options
+{
+    unsigned boards = 20;
+    unsigned pots = 8;
+    double damage = 0.002;
+    double timeout = 0.1;
+    uint32_t seed = 1;
+};
+
+struct Tally
+{
+    double seconds = 0;
+    uint64_t rxBytes = 0;
+    uint64_t requests = 0;
+    uint64_t damaged = 0;
+    unsigned wrong = 0;               // Boards read differently from History
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_backfill_bench [--boards N] [--pots N] [--damage RATE]\n"
+        "                                [--timeout SECONDS] [--seed N]\n");
+    exit(2);
+}
+
+// One board, its UART0 output going to whichever read is running
+class Bench
+{
+public:
+    Bench(const Options &options, unsigned id)
+        : options_(options),
+          board_(sim::PlantParameters(), options.pots),
+          simulation_(board_, sim::flowerpotFirmware()),
+          random_(options.seed * 7919u + id)
+    {
+        sim::Machine &machine = simulation_.machine();
+        machine.setRxFlowControl(true);
+        machine.setTxSink([this](uint8_t c) { take(c); });
+    }
+
+    void fill()
+    {
+        std::string setup = "pots " + std::to_string(options_.pots) + "\r";
+        for (unsigned i = 0; i < FILLS; i++)
+            setup += "status\r";
+        send(setup);
+        simulation_.runFor(2 * sim::kCyclesPerSecond);
+    }
+
+    // "History N" for each pot, each sent once the last has been answered
+    void readText(Tally &tally)
+    {
+        mode_ = Mode::Text;
+        text_.clear();
+        uint64_t start = simulation_.machine().now();
+        rxBytes_ = 0;
+        for (unsigned pot = 1; pot <= options_.pots; pot++)
+        {
+            lines_ = 0;
+            send("History " + std::to_string(pot) + "\r");
+            while (lines_ < 3)
+                simulation_.runFor(STEP);
+        }
+        tally.seconds += (double)(last_ - start) / sim::kCyclesPerSecond;
+        tally.rxBytes += rxBytes_;
+        tally.requests += options_.pots;
+    }
+
+    // "export" until the session is done, damaging bytes at rate
+    void readExport(double rate, Tally &tally)
+    {
+        mode_ = Mode::Export;
+        rate_ = rate;
+        gateway::ExportSession session(100);
+        session_ = &session;
+        sim::Machine &machine = simulation_.machine();
+        uint64_t start = machine.now();
+        uint64_t timeout = (uint64_t)(options_.timeout * sim::kCyclesPerSecond);
+        heard_ = start;
+        while (!session.done())
+        {
+            std::string out;
+            session.next(out);
+            if (!out.empty())
+            {
+                send(out);
+                heard_ = machine.now();
+            }
+            simulation_.runFor(STEP);
+            if (!session.done() && machine.now() - heard_ > timeout)
+            {
+                session.expire();
+                heard_ = machine.now();
+            }
+        }
+        session_ = nullptr;
+        gateway::BackfillReport report;
+        session.report(report);
+        tally.seconds += (double)(last_ - start) / sim::kCyclesPerSecond;
+        tally.rxBytes += report.rxBytes;
+        tally.requests += report.requests;
+        tally.damaged += report.damaged;
+        if (report.result != gateway::BackfillResult::Ok || report.words != text_)
+            tally.wrong++;
+    }
+
+private:
+    enum class Mode : uint8_t
+    {
+        Idle,
+        Text,
+        Export
+    };
+
+    void send(const std::string &text)
+    {
+        simulation_.machine().receive(text.data(), text.size());
+    }
+
+    void take(uint8_t c)
+    {
+        last_ = simulation_.machine().now();
+        if (mode_ == Mode::Export)
+        {
+            if (std::uniform_real_distribution<double>(0, 1)(random_) < rate_)
+                c ^= (uint8_t)std::uniform_int_distribution<int>(1, 255)(random_);
+            heard_ = last_;
+            session_->feed(&c, 1);
+            return;
+        }
+        if (mode_ != Mode::Text)
+            return;
+        // The echo, the heading, then the values
+        rxBytes_++;
+        if (c == '\r')
+            return;
+        if (c != '\n')
+        {
+            line_ += (char)c;
+            return;
+        }
+        if (++lines_ == 3)
+        {
+            const char *p = line_.c_str();
+            char *end;
+            for (unsigned long value = strtoul(p, &end, 10); end != p; value = strtoul(p, &end, 10))
+            {
+                text_.push_back((uint16_t)value);
+                p = end;
+            }
+        }
+        line_.clear();
+    }
+
+    Options options_;
+    sim::PlantBoard board_;
+    sim::Simulation simulation_;
+    std::mt19937 random_;
+    Mode mode_ = Mode::Idle;
+    double rate_ = 0;
+    gateway::ExportSession *session_ = nullptr;
+    uint64_t heard_ = 0;
+    uint64_t last_ = 0;               // Time of the last byte from the board
+    uint64_t rxBytes_ = 0;
+    unsigned lines_ = 0;
+    std::string line_;
+    std::vector<uint16_t> text_;      // The log as History showed it
+};
+
+void report(const char *name, const Options &options, const Tally &tally)
+{
+    double logBytes = 2.0 * gateway::kHistoryWords * options.pots * options.boards;
+    printf("%-15s %8.1f ms a board  %6.0f B on the line  %6.0f log B/s  %5.1f%% of the line  %5.2f requests"
+           "  %u damaged  %u wrong\n",
+           name, 1000 * tally.seconds / options.boards, (double)tally.rxBytes / options.boards,
+           logBytes / tally.seconds, 100 * logBytes / tally.seconds / 11520,
+           (double)tally.requests / options.boards, (unsigned)tally.damaged, tally.wrong);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--boards") == 0)
+            options.boards = (unsigned)atoi(value);
+        else if (strcmp(arg, "--pots") == 0)
+            options.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--damage") == 0)
+            options.damage = atof(value);
+        else if (strcmp(arg, "--timeout") == 0)
+            options.timeout = atof(value);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = (uint32_t)atoi(value);
+        else
+            usage();
+    }
+    if (options.boards == 0 || options.pots == 0 || options.pots > gateway::kMaxPots || options.damage < 0 ||
+        options.damage >= 1 || options.timeout <= 0)
+        usage();
+
+    Tally text, clean, damaged;
+    for (unsigned id = 0; id < options.boards; id++)
+    {
+        Bench bench(options, id);
+        bench.fill();
+        bench.readText(text);
+        bench.readExport(0, clean);
+        bench.readExport(options.damage, damaged);
+    }
+
+    printf("%u boards of %u pots, %u log bytes a board, line 11520 B/s\n", options.boards, options.pots,
+           2 * gateway::kHistoryWords * options.pots);
+    report("History", options, text);
+    report("export", options, clean);
+    char name[32];
+    snprintf(name, sizeof(name), "export %g", options.damage);
+    report(name, options, damaged);
+    return clean.wrong || damaged.wrong ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+// History Backfill Tool
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Reads the history log of many pots at once with "export" (see
+// backfill.h), in place of a "History N" per pot, to fill in what a
+// gateway missed.
+//
+//   flowerpot_backfill [--timeout SECONDS] [--retries N] [--threads N]
+//                      [--baud RATE] [--dir DIRECTORY] [DEVICE]...
+//
+//   --timeout  seconds a link may be silent before it is asked again
+//              (default 2)
+//   --retries  requests after the first before a link is given up
+//              (default 5)
+//   --threads  threads (default 1)
+//   --baud     rate to read at, moving each link to it and back to 115200
+//              after (baud.h); a termios speed up to 2500000 (default
+//              115200)
+//   --dir      read every device in DIRECTORY as well, such as the links
+//              flowerpot_pots --dir makes
+//
+// Output is comma separated, a line per device and then one per pot of
+// each device that was read:
+//
+//   result,DEVICE,RESULT,POTS,REQUESTS,SECONDS,BAUD,DETAIL
+//   history,DEVICE,POT,NEXT,V1 V2 ... V15
+//
+// RESULT is ok, refused, timeout or error, and BAUD the rate the log was
+// read at.  DETAIL adds why the link was not at the rate asked for, or was
+// not moved back.  V1 to V15 are the pot's log as
+// "History" shows it, moisture, light and volume five times over, and NEXT
+// is the word written next, from 0, so V(NEXT + 1) is the oldest.  A
+// summary goes to stderr, and the exit status is 1 unless every device is
+// ok.  The gateway should not be polling the same devices at the time.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "backfill.h"
+#include "link.h"
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_backfill [--timeout SECONDS] [--retries N] [--threads N]\n"
+        "                          [--baud RATE] [--dir DIRECTORY] [DEVICE]...\n");
+    exit(2);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    gateway::BackfillOptions options;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] != '-')
+        {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--timeout") == 0)
+            options.timeout = atof(value);
+        else if (strcmp(arg, "--retries") == 0)
+            options.retries = (unsigned)atoi(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--baud") == 0)
+            options.baud = (uint32_t)atol(value);
+        else if (strcmp(arg, "--dir") == 0)
+        {
+            if (!gateway::listDirectory(value, paths))
+            {
+                fprintf(stderr, "%s: %s\n", value, strerror(errno));
+                return 1;
+            }
+        }
+        else
+            usage();
+    }
+    if (paths.empty() || options.threads == 0 || options.timeout <= 0 ||
+        (options.baud && (options.baud > gateway::kBaudMax || !gateway::isSerialSpeed(options.baud))))
+        usage();
+
+    auto start = std::chrono::steady_clock::now();
+    gateway::Backfiller backfiller(options);
+    std::vector<gateway::BackfillReport> reports;
+    backfiller.run(paths, reports);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned counts[4] = {};
+    uint64_t rxBytes = 0;
+    for (const gateway::BackfillReport &report : reports)
+    {
+        std::string detail = report.detail;
+        if (!report.baudDetail.empty())
+            detail += (detail.empty() ? "" : "; ") + report.baudDetail;
+        printf("result,%s,%s,%u,%u,%.3f,%u,%s\n", report.path.c_str(), gateway::backfillResultName(report.result),
+               report.pots, report.requests, report.seconds, report.baud, detail.c_str());
+        counts[(unsigned)report.result]++;
+        rxBytes += report.rxBytes;
+        if (report.result != gateway::BackfillResult::Ok)
+            continue;
+        for (unsigned pot = 0; pot < report.pots; pot++)
+        {
+            printf("history,%s,%u,%u,", report.path.c_str(), pot + 1, report.next[pot]);
+            for (unsigned i = 0; i < gateway::kHistoryWords; i++)
+                printf(i ? " %u" : "%u", report.words[pot * gateway::kHistoryWords + i]);
+            printf("\n");
+        }
+    }
+    fprintf(stderr, "%zu devices in %.2f s, %llu bytes read: %u ok, %u refused, %u timeout, %u error\n",
+            reports.size(), seconds, (unsigned long long)rxBytes, counts[0], counts[1], counts[2], counts[3]);
+    return counts[0] == reports.size() ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+// Baud Rate Negotiation
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#include "baud.h"
+
+namespace gateway {
+
+namespace {
+
+const char *RESULT_NAMES[] = { "ok", "failed", "refused", "lost" };
+
+// Text kept of what is read after a command
+const size_t TEXT = 4096;
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+const char *baudResultName(BaudResult result)
+{
+    return RESULT_NAMES[(unsigned)result];
+}
+
+//-----------------------------------------------------------------------------
+// BaudSession
+//-----------------------------------------------------------------------------
+
+BaudSession::BaudSession(uint32_t from, uint32_t to, const BaudOptions &options)
+    : from_(from),
+      to_(to),
+      options_(options),
+      rate_(from)
+{
+    expected_ = "baud TEST\n\rbaud test : ";
+    for (char c = kBaudTestFirst; c <= kBaudTestLast; c++)
+        expected_ += c;
+    expected_ += "\n\r";
+}
+
+void BaudSession::step(double now, std::string &out)
+{
+    if (state_ == State::Done)
+        return;
+    if (due_)
+    {
+        if (state_ == State::Switch)
+            send(now, "baud " + std::to_string(to_), out);
+        else if (state_ == State::Test)
+            send(now, "baud TEST", out);
+        else if (state_ == State::Confirm)
+            send(now, "baud OK", out);
+        else if (state_ == State::Probe)
+            send(now, "baud", out);
+        return;
+    }
+    if (now < deadline_)
+        return;
+
+    // The answer awaited has not come
+    switch (state_)
+    {
+    case State::Switch:
+        // The pot may have switched just before the deadline
+        switched_ = deadline_;
+        recover("no answer to baud " + std::to_string(to_));
+        break;
+    case State::Test:
+        test();
+        break;
+    case State::Confirm:
+        recover("no answer to baud OK");
+        break;
+    case State::Recover:
+        state_ = State::Probe;
+        due_ = true;
+        step(now, out);
+        break;
+    case State::Probe:
+        if (rate_ == from_)
+        {
+            rate_ = to_;
+            due_ = true;
+            step(now, out);
+        }
+        else
+            finish(BaudResult::Lost, why_ + ", no answer at either rate");
+        break;
+    case State::Done:
+        break;
+    }
+}
+
+void BaudSession::feed(double now, const uint8_t *data, size_t length)
+{
+    if (state_ == State::Done)
+        return;
+    text_.append((const char *)data, length);
+    if (text_.size() > TEXT)
+        text_.erase(0, text_.size() - TEXT);
+
+    std::string from = std::to_string(from_);
+    std::string to = std::to_string(to_);
+    switch (state_)
+    {
+    case State::Switch:
+        // The whole line, so nothing more comes at the old rate
+        if (text_.find("baud : " + to + " switching\n\r") != std::string::npos)
+        {
+            rate_ = to_;
+            switched_ = now;
+            state_ = State::Test;
+            due_ = true;
+        }
+        else if (text_.find("Baud rates are") != std::string::npos)
+            finish(BaudResult::Refused, "rate out of range");
+        else if (text_.find("Invalid command") != std::string::npos)
+            finish(BaudResult::Refused, "no baud command");
+        break;
+    case State::Test:
+        if (text_.size() >= expected_.size())
+            test();
+        break;
+    case State::Confirm:
+        if (text_.find("baud : " + to + " ok\n") != std::string::npos)
+            finish(BaudResult::Ok, std::string());
+        else if (text_.find("baud : " + to + " framing errors\n") != std::string::npos)
+            recover("the pot saw framing errors");
+        break;
+    case State::Recover:
+        if (text_.find("baud : " + from + " fallback\n") != std::string::npos)
+            finish(BaudResult::Failed, why_);
+        break;
+    case State::Probe:
+        if (rate_ == from_ && text_.find("baud : " + from + "\n") != std::string::npos)
+            finish(BaudResult::Failed, why_);
+        else if (rate_ == to_ && text_.find("baud : " + to + "\n") != std::string::npos)
+            finish(BaudResult::Ok, "kept, the answer to baud OK was lost");
+        break;
+    case State::Done:
+        break;
+    }
+}
+
+void BaudSession::report(BaudReport &report) const
+{
+    report.result = result_;
+    report.detail = detail_;
+    report.rate = result_ == BaudResult::Ok ? to_ : from_;
+    report.testBytes = testBytes_;
+    report.testErrors = testErrors_;
+}
+
+void BaudSession::send(double now, const std::string &command, std::string &out)
+{
+    out += command + "\r";
+    text_.clear();
+    due_ = false;
+    deadline_ = now + options_.timeout;
+}
+
+// Counts the bytes of the answer to "baud TEST" that are wrong or missing
+void BaudSession::test()
+{
+    uint64_t errors = 0;
+    for (size_t i = 0; i < expected_.size(); i++)
+        errors += i >= text_.size() || text_[i] != expected_[i];
+    testBytes_ += expected_.size();
+    testErrors_ += errors;
+    if (++tests_ < options_.tests)
+    {
+        due_ = true;
+        return;
+    }
+    double rate = (double)testErrors_ / (double)testBytes_;
+    if (rate <= options_.maxErrors)
+    {
+        state_ = State::Confirm;
+        due_ = true;
+        return;
+    }
+    char why[64];
+    snprintf(why, sizeof(why), "byte error rate %.3g", rate);
+    recover(why);
+}
+
+// Back to the old rate to hear the pot fall back, a little after it must have
+void BaudSession::recover(const std::string &why)
+{
+    why_ = why;
+    rate_ = from_;
+    state_ = State::Recover;
+    due_ = false;
+    deadline_ = switched_ + kBaudFallbackSeconds + options_.timeout;
+    text_.clear();
+}
+
+void BaudSession::finish(BaudResult result, const std::string &detail)
+{
+    state_ = State::Done;
+    result_ = result;
+    detail_ = detail;
+}
+
+}
@@ -0,0 +1,138 @@
+// Baud Rate Negotiation
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Moves a pot's link from 115200 baud to a faster rate with the firmware's
+// "baud" command (baud.h in the firmware), and back again if the faster
+// rate does not carry cleanly:
+//
+//   1. "baud RATE" at the old rate.  On "baud : RATE switching" the host
+//      side switches as well.
+//   2. "baud TEST" a few times.  Each reply, the echo and the 95-character
+//      pattern, is compared byte for byte with what it should be, and bytes
+//      wrong or missing count as errors.  A command the pot could not read
+//      comes back wrong in full.
+//   3. With the byte error rate at most maxErrors, "baud OK", answered
+//      "baud : RATE ok": done.  The pot refuses it, "baud : RATE framing
+//      errors", if any character it read since the switch had a bad stop
+//      bit, which can happen with the data still right.
+//
+// Otherwise the host side goes back to the old rate at once and waits for
+// the pot's "baud : OLD fallback", which comes within the firmware's
+// fallback time of the switch.  Should that not come, say because "baud OK"
+// got through but its answer did not, the pot is asked "baud" at each rate
+// in turn to find where it is.
+//
+// A session does no I/O of its own: it is fed what is read and stepped for
+// what to write, and rate() is the rate the host side must be at before
+// writing it.  The backfill (backfill.h) negotiates this way to read logs
+// faster, and back to 115200 after.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_BAUD_H_
+#define GATEWAY_BAUD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace gateway {
+
+// As in the firmware's baud.h
+const uint32_t kBaudDefault = 115200;
+const uint32_t kBaudMax = 2500000;
+const double kBaudFallbackSeconds = 3;
+const char kBaudTestFirst = ' ';
+const char kBaudTestLast = '~';
+
+struct BaudOptions
+{
+    double timeout = 0.5;             // Seconds to wait for each answer
+    unsigned tests = 4;               // "baud TEST" rounds
+    double maxErrors = 0;             // Byte error rate accepted
+};
+
+enum class BaudResult : uint8_t
+{
+    Ok,                               // At the new rate
+    Failed,                           // Back at the old rate
+    Refused,                          // "Invalid command" or a rate out of range
+    Lost                              // No answer at either rate
+};
+
+const char *baudResultName(BaudResult result);
+
+struct BaudReport
+{
+    BaudResult result = BaudResult::Lost;
+    std::string detail;
+    uint32_t rate = 0;                // The link's rate at the end
+    uint64_t testBytes = 0;           // Expected in the "baud TEST" answers
+    uint64_t testErrors = 0;          // Of them, wrong or missing
+};
+
+// One link's negotiation from one rate to another
+class BaudSession
+{
+public:
+    BaudSession(uint32_t from, uint32_t to, const BaudOptions &options);
+
+    // Appends what is to be written at now, at rate() (which this may change)
+    void step(double now, std::string &out);
+
+    // Takes bytes read from the link
+    void feed(double now, const uint8_t *data, size_t length);
+
+    // When step() is next due, if nothing is read before
+    double wake() const { return due_ ? 0 : deadline_; }
+
+    // The host side's rate
+    uint32_t rate() const { return rate_; }
+
+    bool done() const { return state_ == State::Done; }
+
+    void report(BaudReport &report) const;
+
+private:
+    enum class State : uint8_t
+    {
+        Switch,                       // "baud RATE" sent
+        Test,                         // "baud TEST" sent
+        Confirm,                      // "baud OK" sent
+        Recover,                      // Waiting for the fallback
+        Probe,                        // "baud" sent at rate_
+        Done
+    };
+
+    void send(double now, const std::string &command, std::string &out);
+    void test();
+    void recover(const std::string &why);
+    void finish(BaudResult result, const std::string &detail);
+
+    uint32_t from_;
+    uint32_t to_;
+    BaudOptions options_;
+    State state_ = State::Switch;
+    uint32_t rate_;
+    bool due_ = true;                 // A command is to be written
+    double deadline_ = 0;             // Of the answer awaited
+    double switched_ = 0;             // When the pot will have switched by
+    std::string text_;                // Read since the last command
+    std::string expected_;            // Answer to "baud TEST"
+    unsigned tests_ = 0;
+    uint64_t testBytes_ = 0;
+    uint64_t testErrors_ = 0;
+    std::string why_;                 // The faster rate was given up
+    BaudResult result_ = BaudResult::Lost;
+    std::string detail_;
+};
+
+}
+
+#endif
@@ -0,0 +1,303 @@
+// Baud Rate Negotiation Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Moves simulated boards from 115200 baud to each of a list of rates
+// (baud.h) in virtual time, with the host side's rate off from the rate it
+// asked for by each of a list of skews, as a USB serial bridge's divisor can
+// leave it.  The simulated UART samples each character at the receiver's
+// rate (machine.h), so a large enough skew shows up as framing errors and
+// wrong bytes.  Each board's history log is then read with "export" at the
+// rate agreed, to show what the faster rate is worth.
+//
+//   flowerpot_baud_bench [--rates LIST] [--skews LIST] [--pots N]
+//                        [--tests N] [--max-errors RATE]
+//
+//   --rates       comma separated rates to move to (default
+//                 230400,460800,921600,1500000,2500000)
+//   --skews       comma separated percentages the host side's rate is off
+//                 by at those rates (default 0,-3,3,-6,6)
+//   --pots        pots on each board, 1-8 (default 8)
+//   --tests       "baud TEST" rounds (default 4)
+//   --max-errors  byte error rate accepted in them (default 0)
+//
+// At 115200 the host side's rate is exact.  The time to negotiate is from
+// the first byte of "baud RATE" to the last of the answer that ends it; a
+// fallback takes the firmware's 2 to 3 s.  The exit status is 1 unless
+// every board ended at a rate where its export read the whole log, and every
+// rate with no skew was kept.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "backfill.h"
+#include "baud.h"
+#include "firmware.h"
+#include "plant.h"
+#include "simulation.h"
+
+namespace {
+
+// Host side steps, in cycles
+const uint64_t STEP = sim::kCyclesPerSecond / 10000;
+
+// Status polls to fill the log, five readings a pot
+const unsigned FILLS = 6;
+
+// Longest a negotiation can take: the fallback, then "baud" at each rate
+const double LONGEST = gateway::kBaudFallbackSeconds + 4;
+
+struct Options
+{
+    std::vector<uint32_t> rates = { 230400, 460800, 921600, 1500000, 2500000 };
+    std::vector<double> skews = { 0, -3, 3, -6, 6 };
+    unsigned pots = 8;
+    gateway::BaudOptions baud;
+};
+
+struct Row
+{
+    uint32_t asked = 0;
+    double skew = 0;
+    gateway::BaudReport baud;
+    double negotiate = 0;             // Seconds
+    uint64_t rxFraming = 0;           // Seen by the board
+    uint64_t txFraming = 0;           // Seen by the host side
+    double read = 0;                  // Seconds for the export
+    bool wrong = false;               // The export did not read the log
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_baud_bench [--rates LIST] [--skews LIST] [--pots N]\n"
+        "                            [--tests N] [--max-errors RATE]\n");
+    exit(2);
+}
+
+template <typename T>
+bool parseList(const char *text, std::vector<T> &values)
+{
+    values.clear();
+    const char *p = text;
+    while (*p)
+    {
+        char *end;
+        double value = strtod(p, &end);
+        if (end == p || (*end && *end != ','))
+            return false;
+        values.push_back((T)value);
+        p = *end ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+// One board and the host side of its link
+class Bench
+{
+public:
+    Bench(const Options &options, double skew)
+        : options_(options),
+          skew_(skew),
+          board_(sim::PlantParameters(), options.pots),
+          simulation_(board_, sim::flowerpotFirmware())
+    {
+        sim::Machine &machine = simulation_.machine();
+        machine.setRxFlowControl(true);
+        machine.setHostBaudRate(gateway::kBaudDefault);
+        machine.setTxSink([this](uint8_t c) { take(c); });
+    }
+
+    void fill()
+    {
+        std::string setup = "pots " + std::to_string(options_.pots) + "\r";
+        for (unsigned i = 0; i < FILLS; i++)
+            setup += "status\r";
+        send(setup);
+        simulation_.runFor(2 * sim::kCyclesPerSecond);
+        read_.clear();
+    }
+
+    void negotiate(uint32_t to, Row &row)
+    {
+        sim::Machine &machine = simulation_.machine();
+        gateway::BaudSession session(gateway::kBaudDefault, to, options_.baud);
+        double start = machine.seconds();
+        double end = start + LONGEST;
+        while (!session.done() && machine.seconds() < end)
+        {
+            std::string out;
+            session.step(machine.seconds(), out);
+            setRate(session.rate());
+            send(out);
+            simulation_.runFor(STEP);
+            // The sink has each byte as it is queued, and the host side must
+            // not switch before the pot's answer has left the line
+            if (!read_.empty() && machine.txIdle())
+            {
+                session.feed(machine.seconds(), read_.data(), read_.size());
+                read_.clear();
+            }
+        }
+        session.report(row.baud);
+        row.negotiate = (double)last_ / sim::kCyclesPerSecond - start;
+        row.rxFraming = machine.rxFramingErrors();
+        row.txFraming = machine.txFramingErrors();
+        setRate(row.baud.rate);
+    }
+
+    // "export" until the session is done, at whatever rate the link is at
+    void readExport(Row &row)
+    {
+        sim::Machine &machine = simulation_.machine();
+        gateway::ExportSession session(5);
+        uint64_t start = machine.now();
+        uint64_t timeout = sim::kCyclesPerSecond / 10;
+        uint64_t heard = start;
+        read_.clear();
+        while (!session.done())
+        {
+            std::string out;
+            session.next(out);
+            if (!out.empty())
+            {
+                send(out);
+                heard = machine.now();
+            }
+            simulation_.runFor(STEP);
+            if (!read_.empty())
+            {
+                session.feed(read_.data(), read_.size());
+                read_.clear();
+                heard = machine.now();
+            }
+            if (!session.done() && machine.now() - heard > timeout)
+            {
+                session.expire();
+                heard = machine.now();
+            }
+        }
+        gateway::BackfillReport report;
+        session.report(report);
+        row.read = (double)(last_ - start) / sim::kCyclesPerSecond;
+        row.wrong = report.result != gateway::BackfillResult::Ok ||
+                    report.words.size() != gateway::kHistoryWords * options_.pots;
+    }
+
+private:
+    // The host side's rate when it asks for rate
+    void setRate(uint32_t rate)
+    {
+        double actual = rate == gateway::kBaudDefault ? rate : rate * (1 + skew_ / 100);
+        simulation_.machine().setHostBaudRate((uint32_t)lround(actual));
+    }
+
+    void send(const std::string &text)
+    {
+        if (!text.empty())
+            simulation_.machine().receive(text.data(), text.size());
+    }
+
+    void take(uint8_t c)
+    {
+        last_ = simulation_.machine().now();
+        read_.push_back(c);
+    }
+
+    Options options_;
+    double skew_;
+    sim::PlantBoard board_;
+    sim::Simulation simulation_;
+    std::vector<uint8_t> read_;       // From the board since last taken
+    uint64_t last_ = 0;               // Time of the last byte from the board
+};
+
+void report(const Options &options, const Row &row, double baseline)
+{
+    double logBytes = 2.0 * gateway::kHistoryWords * options.pots;
+    double errorRate = row.baud.testBytes ? (double)row.baud.testErrors / row.baud.testBytes : 0;
+    printf("%8u %5.1f%%  %-7s %8.1f ms  %7.4f  %6llu %6llu  %8u  %7.2f ms %8.0f  %5.2fx%s%s%s\n", row.asked,
+           row.skew, gateway::baudResultName(row.baud.result), 1000 * row.negotiate, errorRate,
+           (unsigned long long)row.rxFraming, (unsigned long long)row.txFraming, row.baud.rate, 1000 * row.read,
+           logBytes / row.read, baseline / row.read, row.wrong ? "  WRONG" : "",
+           row.baud.detail.empty() ? "" : "  ", row.baud.detail.c_str());
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--rates") == 0)
+        {
+            if (!parseList(value, options.rates))
+                usage();
+        }
+        else if (strcmp(arg, "--skews") == 0)
+        {
+            if (!parseList(value, options.skews))
+                usage();
+        }
+        else if (strcmp(arg, "--pots") == 0)
+            options.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--tests") == 0)
+            options.baud.tests = (unsigned)atoi(value);
+        else if (strcmp(arg, "--max-errors") == 0)
+            options.baud.maxErrors = atof(value);
+        else
+            usage();
+    }
+    if (options.pots == 0 || options.pots > gateway::kMaxPots || options.baud.tests == 0 ||
+        options.baud.maxErrors < 0)
+        usage();
+    for (uint32_t rate : options.rates)
+        if (rate <= gateway::kBaudDefault || rate > gateway::kBaudMax)
+            usage();
+
+    // The log read at 115200, for the speed-up
+    Row baseline;
+    Bench plain(options, 0);
+    plain.fill();
+    plain.readExport(baseline);
+    bool failed = baseline.wrong;
+
+    double logBytes = 2.0 * gateway::kHistoryWords * options.pots;
+    printf("%u pots, %.0f log bytes; export at 115200 in %.2f ms, %.0f log B/s\n", options.pots, logBytes,
+           1000 * baseline.read, logBytes / baseline.read);
+    printf("    rate   skew  result    negotiate  errors  rx FE  tx FE  read at     export   log B/s  speed-up\n");
+    for (uint32_t rate : options.rates)
+        for (double skew : options.skews)
+        {
+            Row row;
+            row.asked = rate;
+            row.skew = skew;
+            Bench bench(options, skew);
+            bench.fill();
+            bench.negotiate(rate, row);
+            bench.readExport(row);
+            report(options, row, baseline.read);
+            failed |= row.wrong || (skew == 0 && row.baud.result != gateway::BaudResult::Ok);
+        }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,474 @@
+// Pot Client
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "client.h"
+#include "link.h"
+
+namespace gateway {
+
+namespace {
+
+const char *ERROR_NAMES[] = { "ok", "refused", "timeout", "closed" };
+
+// Longest epoll_wait with no timer due, so a loop with nothing to wait on
+// still notices stop()
+const int IDLE_MS = 1000;
+
+template <size_t N>
+bool startsWith(const char *line, size_t length, const char (&prefix)[N])
+{
+    return length >= N - 1 && memcmp(line, prefix, N - 1) == 0;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+const char *potErrorName(PotError error)
+{
+    return ERROR_NAMES[(unsigned)error];
+}
+
+//-----------------------------------------------------------------------------
+// ClientLoop
+//-----------------------------------------------------------------------------
+
+ClientLoop::ClientLoop() : epoll_(epoll_create1(EPOLL_CLOEXEC)) {}
+
+ClientLoop::~ClientLoop()
+{
+    if (epoll_ >= 0)
+        close(epoll_);
+}
+
+double ClientLoop::now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+void ClientLoop::spawn(Task<void> task)
+{
+    tasks_++;
+    drive(std::move(task));
+}
+
+ClientLoop::Detached ClientLoop::drive(Task<void> task)
+{
+    co_await task;
+    tasks_--;
+}
+
+uint64_t ClientLoop::attach(int fd, PotClient *client)
+{
+    uint64_t id = nextId_++;
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event);
+    clients_[id] = client;
+    return id;
+}
+
+void ClientLoop::watch(int fd, uint64_t id, bool writable)
+{
+    struct epoll_event event = {};
+    event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.u64 = id;
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &event);
+}
+
+// Its timers are left in the heap and skipped when they come due
+void ClientLoop::detach(int fd, uint64_t id)
+{
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+    clients_.erase(id);
+}
+
+// Including any readied by the ones resumed
+void ClientLoop::resumeReady()
+{
+    while (!ready_.empty())
+    {
+        std::coroutine_handle<> handle = ready_.front();
+        ready_.pop_front();
+        handle.resume();
+    }
+}
+
+void ClientLoop::run()
+{
+    stopped_ = false;
+    struct epoll_event events[64];
+    resumeReady();
+    while (tasks_ && !stopped_)
+    {
+        int wait = IDLE_MS;
+        if (!timers_.empty())
+        {
+            double due = timers_.top().when - now();
+            wait = due <= 0 ? 0 : std::min(IDLE_MS, (int)ceil(due * 1000));
+        }
+        int count = epoll_wait(epoll_, events, 64, wait);
+        for (int e = 0; e < count; e++)
+        {
+            auto found = clients_.find(events[e].data.u64);
+            if (found == clients_.end())
+                continue;
+            PotClient &client = *found->second;
+            if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                client.readable();
+            if (client.isOpen())
+                client.pump();
+        }
+        double time = now();
+        while (!timers_.empty() && timers_.top().when <= time)
+        {
+            uint64_t id = timers_.top().client;
+            timers_.pop();
+            auto found = clients_.find(id);
+            if (found != clients_.end())
+                found->second->expire(time);
+        }
+        resumeReady();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// PotClient
+//-----------------------------------------------------------------------------
+
+PotClient::PotClient(ClientLoop &loop, const ClientOptions &options) : loop_(loop), options_(options) {}
+
+PotClient::~PotClient()
+{
+    close();
+}
+
+bool PotClient::open(const std::string &path, std::string &error)
+{
+    close();
+    if (!openSerial(path, fd_, error))
+    {
+        fd_ = -1;
+        return false;
+    }
+    id_ = loop_.attach(fd_, this);
+    return true;
+}
+
+void PotClient::close()
+{
+    if (fd_ >= 0)
+    {
+        loop_.detach(fd_, id_);
+        ::close(fd_);
+        fd_ = -1;
+    }
+    while (!queue_.empty())
+        complete(PotError::Closed, "closed");
+    unechoed_ = 0;
+    out_.clear();
+    writable_ = false;
+    length_ = 0;
+    discarding_ = false;
+}
+
+PotRequest<StatusReply> PotClient::status()
+{
+    return PotRequest<StatusReply>(submit(Pending::Kind::Status, "status"));
+}
+
+PotRequest<HistoryReply> PotClient::history(uint8_t pot)
+{
+    std::shared_ptr<Pending> command = submit(Pending::Kind::History, "History " + std::to_string(pot));
+    command->history.pot = pot;
+    return PotRequest<HistoryReply>(command);
+}
+
+Task<PotReply<std::vector<HistoryReply>>> PotClient::history(uint8_t first, uint8_t last)
+{
+    std::vector<PotRequest<HistoryReply>> requests;
+    for (unsigned pot = first; pot <= last; pot++)
+        requests.push_back(history((uint8_t)pot));
+    PotReply<std::vector<HistoryReply>> result;
+    result.error = PotError::None;
+    for (PotRequest<HistoryReply> &request : requests)
+    {
+        PotReply<HistoryReply> reply = co_await request;
+        if (!result.ok())
+            continue;
+        if (!reply.ok())
+        {
+            result.error = reply.error;
+            result.detail = reply.detail;
+            result.value.clear();
+            continue;
+        }
+        result.value.push_back(reply.value);
+    }
+    co_return result;
+}
+
+PotRequest<Accepted> PotClient::setWindow(uint16_t start, uint16_t end, uint8_t pot)
+{
+    char text[40];
+    int length = snprintf(text, sizeof(text), "water %u %u %u %u", start / 60, start % 60, end / 60, end % 60);
+    if (pot)
+        snprintf(text + length, sizeof(text) - length, " %u", pot);
+    return PotRequest<Accepted>(submit(Pending::Kind::Water, text));
+}
+
+PotRequest<Accepted> PotClient::setLevel(uint16_t percent, uint8_t pot)
+{
+    char text[20];
+    int length = snprintf(text, sizeof(text), "LEVEL %u", percent);
+    if (pot)
+        snprintf(text + length, sizeof(text) - length, " %u", pot);
+    return PotRequest<Accepted>(submit(Pending::Kind::Level, text));
+}
+
+std::shared_ptr<PotClient::Pending> PotClient::submit(Pending::Kind kind, std::string text)
+{
+    std::shared_ptr<Pending> command = std::make_shared<Pending>();
+    command->kind = kind;
+    command->text = std::move(text);
+    commands_++;
+    if (!isOpen())
+    {
+        command->done = true;
+        command->error = PotError::Closed;
+        command->detail = "not open";
+        return command;
+    }
+    queue_.push_back(command);
+    pump();
+    return command;
+}
+
+// Gives the command at the front, if written, its timeout from now: from
+// its write, or from the reply before it, so one queued behind a slow reply
+// is not failed for it
+void PotClient::startTimeout()
+{
+    if (!written_ || queue_.front()->deadline)
+        return;
+    queue_.front()->deadline = ClientLoop::now() + options_.timeout;
+    loop_.at(queue_.front()->deadline, id_);
+}
+
+// Writes what the window allows; only the command at the front is timed
+void PotClient::pump()
+{
+    while (written_ < queue_.size())
+    {
+        Pending &command = *queue_[written_];
+        size_t length = command.text.size() + 1;
+        bool idle = written_ == 0;
+        if (!idle && (options_.window == 0 || unechoed_ + length > options_.window))
+            break;
+        out_ += command.text;
+        out_ += '\r';
+        command.written = true;
+        unechoed_ += length;
+        written_++;
+        ahead_ = std::max(ahead_, (uint32_t)written_);
+    }
+    startTimeout();
+    flush();
+}
+
+// Asks for EPOLLOUT while a write is held up
+void PotClient::flush()
+{
+    if (!out_.empty())
+    {
+        ssize_t written = write(fd_, out_.data(), out_.size());
+        if (written > 0)
+            out_.erase(0, (size_t)written);
+    }
+    bool blocked = !out_.empty();
+    if (blocked != writable_)
+    {
+        loop_.watch(fd_, id_, blocked);
+        writable_ = blocked;
+    }
+}
+
+void PotClient::readable()
+{
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd_, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR))
+    {
+        if (n < 0)
+            continue;
+        const char *data = buffer;
+        const char *end = buffer + n;
+        while (data < end)
+        {
+            const char *newline = (const char *)memchr(data, '\n', (size_t)(end - data));
+            const char *stop = newline ? newline : end;
+            for (; data < stop; data++)
+            {
+                if (*data == '\r' || discarding_)
+                    continue;
+                if (length_ == ReplyParser::kLineMax)
+                {
+                    discarding_ = true;
+                    continue;
+                }
+                line_[length_++] = *data;
+            }
+            if (!newline)
+                break;
+            data++;
+            if (!discarding_)
+            {
+                line_[length_] = 0;
+                line(line_, length_);
+            }
+            length_ = 0;
+            discarding_ = false;
+        }
+    }
+    // The far end has gone
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        close();
+}
+
+void PotClient::expire(double now)
+{
+    bool expired = false;
+    while (written_ && queue_.front()->deadline <= now)
+    {
+        timeouts_++;
+        complete(PotError::Timeout, "no reply to " + queue_.front()->text);
+        expired = true;
+    }
+    if (expired)
+        pump();
+}
+
+void PotClient::line(const char *text, size_t length)
+{
+    if (!written_)
+    {
+        stray_++;
+        return;
+    }
+    Pending &command = *queue_.front();
+    if (!command.echoed)
+    {
+        // The echo of a later command means the ones before it were lost
+        size_t echo = 0;
+        while (echo < written_ && (queue_[echo]->text.size() != length ||
+                                   memcmp(queue_[echo]->text.data(), text, length) != 0))
+            echo++;
+        if (echo == written_)
+        {
+            stray_++;
+            return;
+        }
+        for (; echo; echo--)
+        {
+            timeouts_++;
+            complete(PotError::Timeout, "no echo of " + queue_.front()->text);
+        }
+        queue_.front()->echoed = true;
+        unechoed_ -= length + 1;
+        return;
+    }
+    if (startsWith(text, length, "No such pot") || startsWith(text, length, "Invalid command"))
+    {
+        complete(PotError::Refused, command.text + ": " + text);
+        return;
+    }
+
+    switch (command.kind)
+    {
+    case Pending::Kind::Status:
+    {
+        StatusLine status = parseStatusLine(text, length, command.status);
+        if (status == StatusLine::Unknown)
+            stray_++;
+        else if (status == StatusLine::Last)
+            complete(PotError::None, std::string());
+        break;
+    }
+    case Pending::Kind::History:
+        if (!command.header)
+        {
+            if (startsWith(text, length, "Moisture Light and Volume"))
+                command.header = true;
+            else
+                stray_++;
+            break;
+        }
+        for (const char *p = text; command.history.count < kHistoryValues;)
+        {
+            char *end;
+            unsigned long value = strtoul(p, &end, 10);
+            if (end == p)
+                break;
+            command.history.value[command.history.count++] = (uint16_t)value;
+            p = end;
+        }
+        complete(PotError::None, std::string());
+        break;
+    case Pending::Kind::Water:
+        if (startsWith(text, length, "time1 changed"))
+            complete(PotError::None, std::string());
+        else
+            stray_++;
+        break;
+    case Pending::Kind::Level:
+        if (startsWith(text, length, "Level changed"))
+            complete(PotError::None, std::string());
+        else
+            stray_++;
+        break;
+    }
+}
+
+// Ends the command at the front, which is resumed once the loop gets to it
+void PotClient::complete(PotError error, const std::string &detail)
+{
+    std::shared_ptr<Pending> command = std::move(queue_.front());
+    queue_.pop_front();
+    if (command->written)
+    {
+        written_--;
+        if (!command->echoed)
+            unechoed_ -= command->text.size() + 1;
+    }
+    command->done = true;
+    command->error = error;
+    command->detail = detail;
+    if (command->waiter)
+        loop_.ready(command->waiter);
+    startTimeout();
+}
+
+}
@@ -0,0 +1,306 @@
+// Pot Client
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Coroutines for talking to pots, in place of each integration writing its
+// own send-and-wait over the echo-then-reply text protocol:
+//
+//   Task<void> waterIfDry(PotClient &pot)
+//   {
+//       PotReply<StatusReply> status = co_await pot.status();
+//       if (status.ok() && status.value.moisture[0] < 30)
+//           co_await pot.setWindow(6 * 60, 6 * 60 + 10, 1);
+//   }
+//
+//   ClientLoop loop;
+//   PotClient pot(loop);
+//   if (!pot.open("/dev/ttyACM0", error))
+//       ...
+//   loop.spawn(waterIfDry(pot));
+//   loop.run();
+//
+// Everything runs on the thread in run(): one epoll set for every link and
+// a heap of timers for the timeouts.  A call writes its command straight
+// away, or as soon as the pipelining window lets it, and returns something
+// to co_await for the reply.  So a coroutine can have several commands out
+// on a pot at once by calling first and awaiting later, as history() of a
+// range of pots does, and several coroutines can share a pot.
+//
+// Pipelining is as in push.h: a link is sent the next command without
+// waiting for the echo of the last, as long as the bytes not yet echoed fit
+// in the window, 16 bytes by default, the size of UART0's receive FIFO.
+// Replies come back in order and are matched to their commands by the
+// echoes.  A command not answered within the timeout fails with
+// PotError::Timeout, and the link picks up again at the next command's
+// echo; lines before an echo are counted as stray.  The timeout runs from
+// the command's write or, behind others, from the end of the reply before
+// it, so a status held up by the pot's alerts does not fail the commands
+// queued after it.  The replies
+// are as reply.h describes; "water" is answered "time1 changed" and
+// "LEVEL" "Level changed".
+//
+// A reply is resumed from run() after the link's read is dealt with, never
+// from inside a call.  Neither the loop nor a client may be used from more
+// than one thread.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_CLIENT_H_
+#define GATEWAY_CLIENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coroutine>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "reply.h"
+#include "task.h"
+
+namespace gateway {
+
+class PotClient;
+
+enum class PotError : uint8_t
+{
+    None,
+    Refused,                          // "No such pot" or "Invalid command"
+    Timeout,
+    Closed                            // Not open, or closed while waiting
+};
+
+const char *potErrorName(PotError error);
+
+template <typename T>
+struct PotReply
+{
+    PotError error = PotError::Closed;
+    std::string detail;               // What went wrong, if anything
+    T value = {};
+
+    bool ok() const { return error == PotError::None; }
+};
+
+// The value of a command that only says it was done
+struct Accepted
+{
+};
+
+struct ClientOptions
+{
+    size_t window = 16;               // Bytes sent ahead of their echoes, 0
+                                      // to wait for each reply
+    double timeout = 2;               // Seconds from writing, or from the
+                                      // reply before, to the reply
+};
+
+//-----------------------------------------------------------------------------
+// ClientLoop
+//-----------------------------------------------------------------------------
+
+class ClientLoop
+{
+public:
+    ClientLoop();
+    ~ClientLoop();
+    ClientLoop(const ClientLoop &) = delete;
+    ClientLoop &operator=(const ClientLoop &) = delete;
+
+    // Starts a task that nothing awaits; it runs until it first waits, and
+    // run() keeps going until every such task has returned
+    void spawn(Task<void> task);
+
+    // Runs until every spawned task has returned or stop() is called
+    void run();
+    void stop() { stopped_ = true; }
+
+    // Monotonic seconds
+    static double now();
+
+    size_t tasks() const { return tasks_; }
+
+private:
+    friend class PotClient;
+
+    // A coroutine that frees itself when it returns
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+
+    struct Timer
+    {
+        double when;
+        uint64_t client;
+
+        bool operator>(const Timer &other) const { return when > other.when; }
+    };
+
+    Detached drive(Task<void> task);
+
+    uint64_t attach(int fd, PotClient *client);
+    void watch(int fd, uint64_t id, bool writable);
+    void detach(int fd, uint64_t id);
+    void at(double when, uint64_t id) { timers_.push(Timer{ when, id }); }
+    void ready(std::coroutine_handle<> handle) { ready_.push_back(handle); }
+    void resumeReady();
+
+    int epoll_;
+    bool stopped_ = false;
+    size_t tasks_ = 0;
+    uint64_t nextId_ = 1;
+    std::unordered_map<uint64_t, PotClient *> clients_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    std::deque<std::coroutine_handle<>> ready_;
+};
+
+//-----------------------------------------------------------------------------
+// PotClient
+//-----------------------------------------------------------------------------
+
+namespace detail {
+
+// A command, shared by the client and whatever awaits its reply
+struct PendingCommand
+{
+    enum class Kind : uint8_t
+    {
+        Status,
+        History,
+        Water,
+        Level
+    };
+
+    Kind kind;
+    std::string text;                 // Without the '\r'
+    bool written = false;
+    bool echoed = false;
+    bool header = false;              // History's header line seen
+    bool done = false;
+    double deadline = 0;              // 0 until it is at the front
+    PotError error = PotError::None;
+    std::string detail;
+    StatusReply status = {};
+    HistoryReply history = {};
+    std::coroutine_handle<> waiter;
+};
+
+inline void takeValue(const PendingCommand &command, StatusReply &value) { value = command.status; }
+inline void takeValue(const PendingCommand &command, HistoryReply &value) { value = command.history; }
+inline void takeValue(const PendingCommand &, Accepted &) {}
+
+}
+
+// Awaits the reply to a command already on its way
+template <typename T>
+class PotRequest
+{
+public:
+    explicit PotRequest(std::shared_ptr<detail::PendingCommand> command) : command_(std::move(command)) {}
+
+    bool await_ready() const noexcept { return command_->done; }
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept { command_->waiter = awaiting; }
+
+    PotReply<T> await_resume() const
+    {
+        PotReply<T> reply;
+        reply.error = command_->error;
+        reply.detail = command_->detail;
+        if (reply.ok())
+            detail::takeValue(*command_, reply.value);
+        return reply;
+    }
+
+private:
+    std::shared_ptr<detail::PendingCommand> command_;
+};
+
+class PotClient
+{
+public:
+    explicit PotClient(ClientLoop &loop, const ClientOptions &options = ClientOptions());
+    ~PotClient();
+    PotClient(const PotClient &) = delete;
+    PotClient &operator=(const PotClient &) = delete;
+
+    // Opens path as openSerial() (link.h) does and watches it
+    bool open(const std::string &path, std::string &error);
+
+    // Fails every command outstanding with PotError::Closed
+    void close();
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    PotRequest<StatusReply> status();
+
+    // "History N", pot from 1
+    PotRequest<HistoryReply> history(uint8_t pot);
+
+    // Pots first to last, all sent before the first reply is awaited; fails
+    // with the first that fails
+    Task<PotReply<std::vector<HistoryReply>>> history(uint8_t first, uint8_t last);
+
+    // One window from start to end, minutes after midnight, every day, in
+    // place of any others; pot 0 for every pot
+    PotRequest<Accepted> setWindow(uint16_t start, uint16_t end, uint8_t pot = 0);
+
+    // Watering level, percent; pot 0 for every pot
+    PotRequest<Accepted> setLevel(uint16_t percent, uint8_t pot = 0);
+
+    // Since construction
+    uint64_t commands() const { return commands_; }
+    uint64_t timeouts() const { return timeouts_; }
+    uint64_t stray() const { return stray_; }
+    uint32_t ahead() const { return ahead_; }   // Most commands written and unanswered at once
+
+private:
+    friend class ClientLoop;
+
+    using Pending = detail::PendingCommand;
+
+    std::shared_ptr<Pending> submit(Pending::Kind kind, std::string text);
+    void startTimeout();
+    void pump();
+    void flush();
+    void readable();
+    void expire(double now);
+    void line(const char *text, size_t length);
+    void complete(PotError error, const std::string &detail);
+
+    ClientLoop &loop_;
+    ClientOptions options_;
+    int fd_ = -1;
+    uint64_t id_ = 0;
+    std::deque<std::shared_ptr<Pending>> queue_;   // Written ones first, in order
+    size_t written_ = 0;              // Of queue_
+    size_t unechoed_ = 0;             // Bytes written whose echo is yet to come
+    std::string out_;                 // Not yet taken by the device
+    bool writable_ = false;           // Waiting for EPOLLOUT
+    char line_[ReplyParser::kLineMax + 1];
+    size_t length_ = 0;
+    bool discarding_ = false;         // Rest of an overlong line
+    uint64_t commands_ = 0;
+    uint64_t timeouts_ = 0;
+    uint64_t stray_ = 0;
+    uint32_t ahead_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,285 @@
+// Pot Client Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs coroutines against a fleet of simulated pots on pseudo-terminals
+// (ptyfarm.h) with the pot client (client.h), each doing one operation after
+// another for a while, and reports operations a second and their latency,
+// first with each pot's commands one at a time and then pipelined.
+//
+//   flowerpot_client_bench [--pots N] [--concurrency N] [--op OP]
+//                          [--seconds S] [--window BYTES] [--timeout SECONDS]
+//                          [--farm-threads N] [--tick SECONDS]
+//                          [--warmup SECONDS]
+//
+//   --pots          simulated pots (default 100)
+//   --concurrency   coroutines per pot (default 4)
+//   --op            status, history (every pot on the board) or window
+//                   (default status)
+//   --seconds       seconds to measure each run for (default 5)
+//   --window        pipelining window of the second run (default 16)
+//   --timeout       seconds to wait for a reply (default 2)
+//   --farm-threads  threads stepping the pots (default 1)
+//   --tick          seconds between steps of the pots (default 0.005)
+//   --warmup        seconds the pots run before the first run, for them to
+//                   boot (default 1)
+//
+// Everything on the host side runs on one thread.  An operation is timed
+// from its call to its result.  The exit status is 1 unless both runs
+// finished operations and none failed.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client.h"
+#include "firmware.h"
+#include "histogram.h"
+#include "ptyfarm.h"
+
+namespace {
+
+enum class Op : uint8_t
+{
+    Status,
+    History,
+    Window
+};
+
+struct Options
+{
+    sim::PtyFarmOptions farm;
+    unsigned concurrency = 4;
+    Op op = Op::Status;
+    double seconds = 5;
+    size_t window = 16;
+    double timeout = 2;
+    double warmup = 1;
+};
+
+struct Run
+{
+    size_t window = 0;
+    double wall = 0;
+    uint64_t ops = 0;
+    uint64_t failed = 0;              // Refused or closed
+    uint64_t timeouts = 0;
+    uint64_t commands = 0;
+    uint64_t stray = 0;
+    uint32_t ahead = 0;
+    gateway::Histogram latency;       // Microseconds
+    std::string detail;               // Of the first failure
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_client_bench [--pots N] [--concurrency N] [--op OP]\n"
+        "                              [--seconds S] [--window BYTES] [--timeout SECONDS]\n"
+        "                              [--farm-threads N] [--tick SECONDS]\n"
+        "                              [--warmup SECONDS]\n");
+    exit(2);
+}
+
+const char *opName(Op op)
+{
+    return op == Op::Status ? "status" : op == Op::History ? "history" : "window";
+}
+
+double cpuSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// One coroutine's operations on a pot until end
+gateway::Task<void> worker(gateway::PotClient &pot, Op op, double end, Run &run)
+{
+    using gateway::ClientLoop;
+    using gateway::PotError;
+
+    // How many pots the board has, for History of each
+    uint8_t pots = 1;
+    if (op == Op::History)
+    {
+        gateway::PotReply<gateway::StatusReply> status = co_await pot.status();
+        if (status.ok() && status.value.pots)
+            pots = status.value.pots;
+    }
+    while (ClientLoop::now() < end)
+    {
+        double begin = ClientLoop::now();
+        PotError error;
+        std::string detail;
+        if (op == Op::Status)
+        {
+            gateway::PotReply<gateway::StatusReply> reply = co_await pot.status();
+            error = reply.error;
+            detail = reply.detail;
+        }
+        else if (op == Op::History)
+        {
+            gateway::PotReply<std::vector<gateway::HistoryReply>> reply = co_await pot.history(1, pots);
+            error = reply.error;
+            detail = reply.detail;
+        }
+        else
+        {
+            gateway::PotReply<gateway::Accepted> reply = co_await pot.setWindow(6 * 60, 6 * 60 + 10);
+            error = reply.error;
+            detail = reply.detail;
+        }
+        if (error == PotError::None)
+        {
+            run.ops++;
+            run.latency.record((uint64_t)((ClientLoop::now() - begin) * 1e6));
+            continue;
+        }
+        if (error == PotError::Timeout)
+            run.timeouts++;
+        else
+            run.failed++;
+        if (run.detail.empty())
+            run.detail = detail;
+        if (error == PotError::Closed)
+            co_return;
+    }
+}
+
+bool measure(sim::PtyFarm &farm, const Options &options, size_t window, Run &run, std::string &error)
+{
+    gateway::ClientLoop loop;
+    gateway::ClientOptions clientOptions;
+    clientOptions.window = window;
+    clientOptions.timeout = options.timeout;
+    std::vector<std::unique_ptr<gateway::PotClient>> pots;
+    for (size_t i = 0; i < farm.size(); i++)
+    {
+        pots.emplace_back(new gateway::PotClient(loop, clientOptions));
+        if (!pots.back()->open(farm.path(i), error))
+            return false;
+    }
+
+    run.window = window;
+    double start = gateway::ClientLoop::now();
+    double end = start + options.seconds;
+    for (auto &pot : pots)
+        for (unsigned i = 0; i < options.concurrency; i++)
+            loop.spawn(worker(*pot, options.op, end, run));
+    loop.run();
+    run.wall = gateway::ClientLoop::now() - start;
+    for (auto &pot : pots)
+    {
+        run.commands += pot->commands();
+        run.stray += pot->stray();
+        run.ahead = std::max(run.ahead, pot->ahead());
+    }
+    return true;
+}
+
+void report(const Run &run, double cpu)
+{
+    printf("%6zu  %8llu %9.0f  %6llu %6llu %6llu  %7llu %7llu %7llu  %5u  %5.2f s%s%s\n", run.window,
+           (unsigned long long)run.ops, run.ops / run.wall, (unsigned long long)run.failed,
+           (unsigned long long)run.timeouts, (unsigned long long)run.stray,
+           (unsigned long long)run.latency.quantile(0.5), (unsigned long long)run.latency.quantile(0.99),
+           (unsigned long long)run.latency.max(), run.ahead, cpu, run.detail.empty() ? "" : "  ",
+           run.detail.c_str());
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            options.farm.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--concurrency") == 0)
+            options.concurrency = (unsigned)atoi(value);
+        else if (strcmp(arg, "--op") == 0)
+        {
+            if (strcmp(value, "status") == 0)
+                options.op = Op::Status;
+            else if (strcmp(value, "history") == 0)
+                options.op = Op::History;
+            else if (strcmp(value, "window") == 0)
+                options.op = Op::Window;
+            else
+                usage();
+        }
+        else if (strcmp(arg, "--seconds") == 0)
+            options.seconds = atof(value);
+        else if (strcmp(arg, "--window") == 0)
+            options.window = (size_t)atoi(value);
+        else if (strcmp(arg, "--timeout") == 0)
+            options.timeout = atof(value);
+        else if (strcmp(arg, "--farm-threads") == 0)
+            options.farm.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--tick") == 0)
+            options.farm.tick = atof(value);
+        else if (strcmp(arg, "--warmup") == 0)
+            options.warmup = atof(value);
+        else
+            usage();
+    }
+    if (options.farm.pots == 0 || options.concurrency == 0 || options.seconds <= 0 || options.timeout <= 0 ||
+        options.farm.tick <= 0 || options.farm.tick > 1 || options.warmup < 0)
+        usage();
+
+    std::string error;
+    sim::PtyFarm farm(options.farm, sim::PlantParameters(), sim::flowerpotFirmware());
+    if (!farm.open(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::atomic<bool> stop(false);
+    std::thread farmThread([&farm, &stop]() { farm.run(stop); });
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+
+    printf("%u pots, %u coroutines a pot, %s, %.1f s a run\n", options.farm.pots, options.concurrency,
+           opName(options.op), options.seconds);
+    printf("window       ops     ops/s  failed  t/out  stray   p50 us  p99 us  max us  ahead  host cpu\n");
+    bool failed = false;
+    for (size_t window : { (size_t)0, options.window })
+    {
+        Run run;
+        double cpu = cpuSeconds();
+        if (!measure(farm, options, window, run, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            failed = true;
+            break;
+        }
+        report(run, cpuSeconds() - cpu);
+        failed |= run.ops == 0 || run.failed || run.timeouts;
+    }
+    stop = true;
+    farmThread.join();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,383 @@
+// Frame Decoder
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRAMES_X86 1
+#endif
+
+#include "frames.h"
+
+namespace gateway {
+
+namespace {
+
+// Lead bytes are 0xF8 | kind, for the kinds up to CAPTURE_STATS
+const uint8_t LEAD_FIRST = 0xF8;
+const uint8_t LEAD_LAST = 0xFE;
+
+// Line ends found per call of a kernel
+const size_t LINE_BLOCK = 4096;
+
+struct Kernels
+{
+    // Bytes before the first lead byte
+    size_t (*textRun)(const uint8_t *data, size_t length);
+
+    // Decodes the whole, valid records from data on into out; returns how
+    // many
+    size_t (*recordRun)(const uint8_t *data, size_t length, Record *out);
+
+    // Offsets of the first '\n's, up to capacity of them; returns how many
+    size_t (*lineEnds)(const char *data, size_t length, uint32_t *ends, size_t capacity);
+};
+
+inline bool isLead(uint8_t c)
+{
+    return c >= LEAD_FIRST && c <= LEAD_LAST;
+}
+
+inline bool isRecord(const uint8_t *data)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < kRecordSize; i++)
+        sum += data[i];
+    return isLead(data[0]) && sum == 0;
+}
+
+inline void takeRecord(const uint8_t *data, Record &record)
+{
+    record.kind = data[0] & 7;
+    memcpy(&record.time, data + 1, 4);
+    memcpy(&record.value, data + 5, 4);
+}
+
+//-----------------------------------------------------------------------------
+// Scalar kernels
+//-----------------------------------------------------------------------------
+
+size_t textRunScalar(const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+    while (i < length && !isLead(data[i]))
+        i++;
+    return i;
+}
+
+inline size_t recordTail(const uint8_t *data, size_t length, Record *out)
+{
+    size_t count = 0;
+    for (; length >= kRecordSize && isRecord(data); data += kRecordSize, length -= kRecordSize)
+        takeRecord(data, out[count++]);
+    return count;
+}
+
+size_t recordRunScalar(const uint8_t *data, size_t length, Record *out)
+{
+    return recordTail(data, length, out);
+}
+
+size_t lineEndsScalar(const char *data, size_t length, uint32_t *ends, size_t capacity)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < length && count < capacity; i++)
+        if (data[i] == '\n')
+            ends[count++] = (uint32_t)i;
+    return count;
+}
+
+const Kernels SCALAR = { textRunScalar, recordRunScalar, lineEndsScalar };
+
+#ifdef FRAMES_X86
+
+//-----------------------------------------------------------------------------
+// SSE4.1 kernels
+//-----------------------------------------------------------------------------
+
+// Lanes that hold a lead byte
+__attribute__((target("sse4.1"))) inline __m128i leadBytes128(__m128i v)
+{
+    __m128i above = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8((char)LEAD_FIRST)), v);
+    __m128i below = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8((char)LEAD_LAST)), v);
+    return _mm_and_si128(above, below);
+}
+
+__attribute__((target("sse4.1"))) size_t textRunSse4(const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i leads = leadBytes128(_mm_loadu_si128((const __m128i *)(data + i)));
+        if (!_mm_testz_si128(leads, leads))
+            return i + (size_t)__builtin_ctz((unsigned)_mm_movemask_epi8(leads));
+    }
+    return i + textRunScalar(data + i, length - i);
+}
+
+// One record per register: the lead byte checked in lane 0, the ten bytes
+// summed with the last six masked off
+__attribute__((target("sse4.1"))) size_t recordRunSse4(const uint8_t *data, size_t length, Record *out)
+{
+    const __m128i tenBytes = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0);
+    const __m128i lowByte = _mm_setr_epi8(-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t count = 0;
+
+    // Four records and the six bytes the last load reads past them
+    while (length >= 4 * kRecordSize + 6)
+    {
+        unsigned valid = 0;
+        for (unsigned r = 0; r < 4; r++)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(data + r * kRecordSize));
+            __m128i sums = _mm_sad_epu8(_mm_and_si128(v, tenBytes), _mm_setzero_si128());
+            __m128i sum = _mm_add_epi64(sums, _mm_srli_si128(sums, 8));
+            __m128i ok = _mm_and_si128(leadBytes128(v), _mm_cmpeq_epi8(sum, _mm_setzero_si128()));
+            valid |= (unsigned)_mm_testc_si128(ok, lowByte) << r;
+        }
+        unsigned run = (unsigned)__builtin_ctz(~valid);
+        for (unsigned r = 0; r < run; r++)
+            takeRecord(data + r * kRecordSize, out[count++]);
+        if (run < 4)
+            return count;
+        data += 4 * kRecordSize;
+        length -= 4 * kRecordSize;
+    }
+    return count + recordTail(data, length, out + count);
+}
+
+__attribute__((target("sse4.1"))) size_t lineEndsSse4(const char *data, size_t length, uint32_t *ends,
+                                                     size_t capacity)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), newline));
+        for (; mask; mask &= mask - 1)
+        {
+            if (count == capacity)
+                return count;
+            ends[count++] = (uint32_t)(i + (size_t)__builtin_ctz(mask));
+        }
+    }
+    for (; i < length && count < capacity; i++)
+        if (data[i] == '\n')
+            ends[count++] = (uint32_t)i;
+    return count;
+}
+
+const Kernels SSE4 = { textRunSse4, recordRunSse4, lineEndsSse4 };
+
+//-----------------------------------------------------------------------------
+// AVX2 kernels
+//-----------------------------------------------------------------------------
+
+__attribute__((target("avx2"))) inline __m256i leadBytes256(__m256i v)
+{
+    __m256i above = _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8((char)LEAD_FIRST)), v);
+    __m256i below = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8((char)LEAD_LAST)), v);
+    return _mm256_and_si256(above, below);
+}
+
+__attribute__((target("avx2"))) size_t textRunAvx2(const uint8_t *data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(leadBytes256(_mm256_loadu_si256((const __m256i *)(data + i))));
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + textRunScalar(data + i, length - i);
+}
+
+// Two records per register, one in each 128-bit lane, so lanes 0 and 16
+// hold their lead bytes and the sums land in the low byte of each lane
+__attribute__((target("avx2"))) size_t recordRunAvx2(const uint8_t *data, size_t length, Record *out)
+{
+    const __m256i tenBytes = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0,
+                                              -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0);
+    size_t count = 0;
+
+    // Eight records and the six bytes the last load reads past them
+    while (length >= 8 * kRecordSize + 6)
+    {
+        unsigned valid = 0;
+        for (unsigned pair = 0; pair < 4; pair++)
+        {
+            const uint8_t *first = data + 2 * pair * kRecordSize;
+            __m256i v = _mm256_loadu2_m128i((const __m128i *)(first + kRecordSize), (const __m128i *)first);
+            __m256i sums = _mm256_sad_epu8(_mm256_and_si256(v, tenBytes), _mm256_setzero_si256());
+            __m256i sum = _mm256_add_epi64(sums, _mm256_srli_si256(sums, 8));
+            __m256i ok = _mm256_and_si256(leadBytes256(v), _mm256_cmpeq_epi8(sum, _mm256_setzero_si256()));
+            unsigned mask = (unsigned)_mm256_movemask_epi8(ok);
+            valid |= ((mask & 1) | (mask >> 15 & 2)) << (2 * pair);
+        }
+        unsigned run = (unsigned)__builtin_ctz(~valid);
+        for (unsigned r = 0; r < run; r++)
+            takeRecord(data + r * kRecordSize, out[count++]);
+        if (run < 8)
+            return count;
+        data += 8 * kRecordSize;
+        length -= 8 * kRecordSize;
+    }
+    return count + recordTail(data, length, out + count);
+}
+
+__attribute__((target("avx2"))) size_t lineEndsAvx2(const char *data, size_t length, uint32_t *ends,
+                                                   size_t capacity)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + i)), newline));
+        for (; mask; mask &= mask - 1)
+        {
+            if (count == capacity)
+                return count;
+            ends[count++] = (uint32_t)(i + (size_t)__builtin_ctz(mask));
+        }
+    }
+    for (; i < length && count < capacity; i++)
+        if (data[i] == '\n')
+            ends[count++] = (uint32_t)i;
+    return count;
+}
+
+const Kernels AVX2 = { textRunAvx2, recordRunAvx2, lineEndsAvx2 };
+
+#endif
+
+const Kernels &kernels(Isa isa)
+{
+    if (!isaSupported(isa))
+        isa = bestIsa();
+#ifdef FRAMES_X86
+    if (isa == Isa::Avx2)
+        return AVX2;
+    if (isa == Isa::Sse4)
+        return SSE4;
+#endif
+    return SCALAR;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool isaSupported(Isa isa)
+{
+#ifdef FRAMES_X86
+    if (isa == Isa::Avx2)
+        return __builtin_cpu_supports("avx2");
+    if (isa == Isa::Sse4)
+        return __builtin_cpu_supports("sse4.1");
+#endif
+    return isa == Isa::Scalar;
+}
+
+Isa bestIsa()
+{
+    static const Isa best = isaSupported(Isa::Avx2) ? Isa::Avx2 : isaSupported(Isa::Sse4) ? Isa::Sse4 : Isa::Scalar;
+    return best;
+}
+
+const char *isaName(Isa isa)
+{
+    return isa == Isa::Avx2 ? "avx2" : isa == Isa::Sse4 ? "sse4.1" : "scalar";
+}
+
+size_t decodeRecords(const uint8_t *data, size_t length, RecordBatch &batch, Isa isa)
+{
+    const Kernels &k = kernels(isa);
+    std::vector<Record> &records = batch.records;
+    size_t count = records.size();
+    records.resize(count + length / kRecordSize + 1);
+
+    size_t used = 0;
+    while (used < length)
+    {
+        size_t text = k.textRun(data + used, length - used);
+        batch.text.append((const char *)data + used, text);
+        used += text;
+        if (used == length || length - used < kRecordSize)
+            break;
+        size_t run = k.recordRun(data + used, length - used, &records[count]);
+        if (run)
+        {
+            count += run;
+            used += run * kRecordSize;
+            continue;
+        }
+        // A lead byte that does not start a record is text
+        batch.text += (char)data[used++];
+    }
+    records.resize(count);
+    return used;
+}
+
+size_t decodeStatusReplies(const char *data, size_t length, std::vector<StatusReply> &out, Isa isa)
+{
+    const Kernels &k = kernels(isa);
+    uint32_t ends[LINE_BLOCK];
+    StatusReply reply;
+    bool inReply = false;
+    size_t replyStart = 0;            // Of the "status" line, while inReply
+
+    // Lines start after the '\n' of the line before and end at their own,
+    // with the firmware's "\r"s on either side dropped
+    size_t start = 0;
+    size_t found;
+    while ((found = k.lineEnds(data + start, length - start, ends, LINE_BLOCK)) > 0)
+    {
+        size_t base = start;
+        for (size_t i = 0; i < found; i++)
+        {
+            const char *line = data + start;
+            size_t lineStart = start;
+            size_t end = base + ends[i];
+            size_t size = end - start;
+            start = end + 1;
+            while (size && *line == '\r')
+            {
+                line++;
+                size--;
+            }
+            while (size && line[size - 1] == '\r')
+                size--;
+
+            if (size == 6 && memcmp(line, "status", 6) == 0)
+            {
+                memset(&reply, 0, sizeof(reply));
+                inReply = true;
+                replyStart = lineStart;
+            }
+            else if (inReply && parseStatusLine(line, size, reply) == StatusLine::Last)
+            {
+                out.push_back(reply);
+                inReply = false;
+            }
+        }
+    }
+    // A reply cut off by the end is decoded again from its "status" line
+    return inReply ? replyStart : start;
+}
+
+}
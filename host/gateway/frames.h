@@ -0,0 +1,89 @@
+// Frame Decoder
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Decodes what pots send in bulk, a buffer of thousands of frames at a
+// time, such as a log or capture being worked through.  The gateway
+// (gateway.h) does not use it: it has one command out on a link at a time,
+// so a read brings it a reply at most, and ReplyParser has to follow the
+// echoes and history replies between reads anyway.  Two kinds of frame are
+// decoded:
+//
+//   records  the firmware's 10-byte binary records (capture.h), which carry
+//            capture streams and "stats BIN" counters in among the text
+//            output, each with a checksum
+//   status   text status replies (reply.h)
+//
+// The work that is the same for every byte is done 16 or 32 bytes at a
+// time with SSE4.1 or AVX2, picked when the program runs: finding where
+// records start in text, checking the lead byte and checksum of 8 records
+// at once (4 with SSE4.1) and finding line ends.  What is left, taking the
+// fields apart and parsing numbers, is the same scalar code on every path,
+// and so every path gives the same result as the scalar one.  Other
+// processors use the scalar path only.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_FRAMES_H_
+#define GATEWAY_FRAMES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "reply.h"
+
+namespace gateway {
+
+enum class Isa : uint8_t
+{
+    Scalar,
+    Sse4,
+    Avx2
+};
+
+// The widest this processor runs
+Isa bestIsa();
+bool isaSupported(Isa isa);
+const char *isaName(Isa isa);
+
+const size_t kRecordSize = 10;
+
+// A binary record as sent: the kind is CAPTURE_* (capture.h), time is the
+// RTC time or, for a STATS record, the counter number
+struct Record
+{
+    uint32_t time;
+    uint32_t value;
+    uint8_t kind;
+};
+
+struct RecordBatch
+{
+    std::vector<Record> records;
+    std::string text;                 // Bytes that were not part of a record
+};
+
+// Separates the records in a buffer from the text around them, as
+// CaptureDecoder does a byte at a time: a lead byte starts a record if the
+// ten bytes from it sum to zero, and is text otherwise.  Returns the bytes
+// used; a record cut off by the end of the buffer is left for the next call.
+size_t decodeRecords(const uint8_t *data, size_t length, RecordBatch &batch, Isa isa = bestIsa());
+
+// Decodes every status reply in a buffer of them, each from its echoed
+// "status" line to its batteryvoltage line, and appends them to out.
+// Returns the bytes used: up to the end of the last whole line, or to the
+// start of a reply cut off by the end of the buffer, which is left for the
+// next call.
+size_t decodeStatusReplies(const char *data, size_t length, std::vector<StatusReply> &out,
+                           Isa isa = bestIsa());
+
+}
+
+#endif
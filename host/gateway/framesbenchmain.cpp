@@ -0,0 +1,346 @@
+// Frame Decoder Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Times the bulk frame decoder (frames.h) on every instruction set this
+// processor runs, against the byte-at-a-time decoders it stands in for,
+// and checks they all agree.
+//
+//   flowerpot_frames_bench [--records N] [--replies N] [--text-every N]
+//                          [--corrupt-every N] [--rounds N]
+//
+//   --records        binary records in the record buffer (default 1000000)
+//   --replies        status replies in the reply buffer (default 200000)
+//   --text-every     a line of text after every N records, 0 for none
+//                    (default 64)
+//   --corrupt-every  every N'th record has a bad checksum, 0 for none
+//                    (default 1000)
+//   --rounds         times each decoder is run; the fastest is reported
+//                    (default 5)
+//
+// Records are checked against CaptureDecoder, which flowerpot_capture uses,
+// and status replies against ReplyParser, which the gateway uses, whole and
+// split across buffers.  Awkward numbers in status lines are checked
+// against their values first.  The exit status is 1 if any path disagrees.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frames.h"
+#include "replay.h"
+
+namespace {
+
+struct Options
+{
+    size_t records = 1000000;
+    size_t replies = 200000;
+    size_t textEvery = 64;
+    size_t corruptEvery = 1000;
+    unsigned rounds = 5;
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_frames_bench [--records N] [--replies N] [--text-every N]\n"
+        "                              [--corrupt-every N] [--rounds N]\n");
+    exit(2);
+}
+
+std::vector<uint8_t> recordBuffer(const Options &options)
+{
+    std::mt19937 random(1);
+    std::vector<uint8_t> buffer;
+    const char text[] = "moisturepercentage : 41.0\n\r";
+    uint32_t time = 0;
+    for (size_t n = 0; n < options.records; n++)
+    {
+        uint8_t kind = (uint8_t)(random() % 7);
+        time += random() % 64;
+        uint32_t wire = kind == 6 ? random() % 32 : time;
+        uint32_t value = random() % 4096;
+        uint8_t record[10];
+        record[0] = (uint8_t)(0xF8 | kind);
+        memcpy(record + 1, &wire, 4);
+        memcpy(record + 5, &value, 4);
+        uint8_t sum = 0;
+        for (unsigned i = 0; i < 9; i++)
+            sum += record[i];
+        record[9] = (uint8_t)-sum;
+        if (options.corruptEvery && n % options.corruptEvery == options.corruptEvery - 1)
+            record[9] ^= 0x40;
+        buffer.insert(buffer.end(), record, record + 10);
+        if (options.textEvery && n % options.textEvery == options.textEvery - 1)
+            buffer.insert(buffer.end(), text, text + sizeof(text) - 1);
+    }
+    return buffer;
+}
+
+// Replies as the firmware sends them, from one to three pots each
+std::vector<std::string> replyTexts(const Options &options)
+{
+    std::mt19937 random(2);
+    std::vector<std::string> replies;
+    char line[64];
+    for (size_t n = 0; n < options.replies; n++)
+    {
+        std::string reply = "status\n\r";
+        snprintf(line, sizeof(line), "Volume: %f mililiters\n\r", (double)(random() % 200000) / 100);
+        reply += line;
+        snprintf(line, sizeof(line), "lightpercentage : %4.1f\n\r", (double)(random() % 1000) / 10);
+        reply += line;
+        unsigned pots = 1 + random() % 3;
+        for (unsigned pot = 0; pot < pots; pot++)
+        {
+            double moisture = (double)(random() % 1000) / 10;
+            if (pots == 1)
+                snprintf(line, sizeof(line), "moisturepercentage : %4.1f\n\r", moisture);
+            else
+                snprintf(line, sizeof(line), "moisturepercentage %u : %4.1f\n\r", pot + 1, moisture);
+            reply += line;
+        }
+        reply += "pumps : ";
+        for (unsigned pot = 0; pot < pots; pot++)
+            reply += random() % 8 ? '0' : '1';
+        reply += "\n\r";
+        snprintf(line, sizeof(line), "batteryvoltage : %4.1f\n\r", (double)(random() % 120) / 10);
+        reply += line;
+        replies.push_back(reply);
+    }
+    return replies;
+}
+
+// Fastest of the rounds, in seconds
+double fastest(unsigned rounds, const std::function<void()> &run)
+{
+    double best = 1e30;
+    for (unsigned i = 0; i < rounds; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = seconds < best ? seconds : best;
+    }
+    return best;
+}
+
+void report(const char *name, size_t frames, size_t bytes, double seconds, double baseline)
+{
+    printf("  %-22s %8.1f M/s  %7.0f MB/s  %5.2fx\n", name, (double)frames / seconds / 1e6,
+           (double)bytes / seconds / 1e6, baseline / seconds);
+}
+
+bool sameRecords(const gateway::RecordBatch &a, const gateway::RecordBatch &b)
+{
+    if (a.records.size() != b.records.size() || a.text != b.text)
+        return false;
+    for (size_t i = 0; i < a.records.size(); i++)
+        if (a.records[i].kind != b.records[i].kind || a.records[i].time != b.records[i].time ||
+            a.records[i].value != b.records[i].value)
+            return false;
+    return true;
+}
+
+bool sameReplies(const std::vector<gateway::StatusReply> &a, const std::vector<gateway::StatusReply> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (memcmp(&a[i], &b[i], sizeof(a[i])) != 0)
+            return false;
+    return true;
+}
+
+// Volume lines whose numbers are at the edges of what parseDecimal takes
+bool checkDecimals()
+{
+    struct Case
+    {
+        const char *line;
+        float volume;
+    };
+    const Case cases[] = {
+        { "Volume: 212.199997 mililiters", 212.199997f },
+        { "Volume: -3.25 mililiters", -3.25f },
+        { "Volume: 0.000000000000000000000000000001 mililiters", 0 },
+        { "Volume: 0.000000000000000001 mililiters", 1e-18f },
+        { "Volume: 1234567890123456789012 mililiters", 1234567890123456789012.0f },
+        { "Volume: 0.1234567890123456789012345 mililiters", 0.1234567890123456789f },
+    };
+    bool ok = true;
+    for (const Case &c : cases)
+    {
+        gateway::StatusReply reply = {};
+        if (gateway::parseStatusLine(c.line, strlen(c.line), reply) != gateway::StatusLine::Field ||
+            reply.volume != c.volume)
+        {
+            printf("  \"%s\": volume %g, not %g\n", c.line, (double)reply.volume, (double)c.volume);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Decodes the replies fed a piece at a time, of sizes from 1 to 509 bytes,
+// with what each call leaves fed again at the front of the next
+std::vector<gateway::StatusReply> splitReplies(const std::string &replies, gateway::Isa isa)
+{
+    std::vector<gateway::StatusReply> out;
+    std::string pending;
+    size_t chunk = 1;
+    for (size_t at = 0; at < replies.size(); at += chunk, chunk = chunk * 7 % 509 + 1)
+    {
+        pending.append(replies, at, chunk);
+        pending.erase(0, gateway::decodeStatusReplies(pending.data(), pending.size(), out, isa));
+    }
+    return out;
+}
+
+class Collector : public gateway::ReplySink
+{
+public:
+    explicit Collector(std::vector<gateway::StatusReply> &replies) : replies_(replies) {}
+    void onStatus(const gateway::StatusReply &reply) override { replies_.push_back(reply); }
+    void onHistory(const gateway::HistoryReply &) override {}
+    void onFailed(const char *) override {}
+
+private:
+    std::vector<gateway::StatusReply> &replies_;
+};
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--records") == 0)
+            options.records = (size_t)atol(value);
+        else if (strcmp(arg, "--replies") == 0)
+            options.replies = (size_t)atol(value);
+        else if (strcmp(arg, "--text-every") == 0)
+            options.textEvery = (size_t)atol(value);
+        else if (strcmp(arg, "--corrupt-every") == 0)
+            options.corruptEvery = (size_t)atol(value);
+        else if (strcmp(arg, "--rounds") == 0)
+            options.rounds = (unsigned)atoi(value);
+        else
+            usage();
+    }
+    if (options.rounds == 0)
+        usage();
+
+    const gateway::Isa isas[] = { gateway::Isa::Scalar, gateway::Isa::Sse4, gateway::Isa::Avx2 };
+    bool ok = checkDecimals();
+
+    // Binary records, CaptureDecoder first
+    std::vector<uint8_t> records = recordBuffer(options);
+    gateway::RecordBatch expected;
+    double baseline = fastest(options.rounds, [&]()
+    {
+        expected = gateway::RecordBatch();
+        sim::CaptureDecoder decoder([&expected](const sim::CaptureRecord &record)
+        {
+            if (record.kind == sim::CAP_TX)
+                expected.text += (char)record.value;
+            else
+                expected.records.push_back({ record.kind == sim::CAP_STATS ? record.counter : (uint32_t)record.time,
+                                             record.value, record.kind });
+        });
+        decoder.put(records.data(), records.size());
+    });
+    printf("%zu records, %zu bytes of text, %zu bytes:\n", expected.records.size(), expected.text.size(),
+           records.size());
+    report("CaptureDecoder", expected.records.size(), records.size(), baseline, baseline);
+    for (gateway::Isa isa : isas)
+    {
+        if (!gateway::isaSupported(isa))
+            continue;
+        gateway::RecordBatch batch;
+        size_t used = 0;
+        double seconds = fastest(options.rounds, [&]()
+        {
+            batch.records.clear();
+            batch.text.clear();
+            used = gateway::decodeRecords(records.data(), records.size(), batch, isa);
+        });
+        bool same = used == records.size() && sameRecords(batch, expected);
+        report(gateway::isaName(isa), batch.records.size(), records.size(), seconds, baseline);
+        if (!same)
+        {
+            printf("  %s: differs from CaptureDecoder\n", gateway::isaName(isa));
+            ok = false;
+        }
+    }
+
+    // Status replies, ReplyParser a reply at a time first
+    std::vector<std::string> texts = replyTexts(options);
+    std::string replies;
+    for (const std::string &text : texts)
+        replies += text;
+    std::vector<gateway::StatusReply> parsed;
+    baseline = fastest(options.rounds, [&]()
+    {
+        parsed.clear();
+        Collector collector(parsed);
+        gateway::ReplyParser parser;
+        for (const std::string &text : texts)
+        {
+            parser.expect(gateway::Command::Status, "status", 6);
+            parser.feed(text.data(), text.size(), collector);
+        }
+    });
+    printf("%zu status replies, %zu bytes:\n", parsed.size(), replies.size());
+    report("ReplyParser", parsed.size(), replies.size(), baseline, baseline);
+    for (gateway::Isa isa : isas)
+    {
+        if (!gateway::isaSupported(isa))
+            continue;
+        std::vector<gateway::StatusReply> batch;
+        double seconds = fastest(options.rounds, [&]()
+        {
+            batch.clear();
+            gateway::decodeStatusReplies(replies.data(), replies.size(), batch, isa);
+        });
+        report(gateway::isaName(isa), batch.size(), replies.size(), seconds, baseline);
+        if (!sameReplies(batch, parsed))
+        {
+            printf("  %s: differs from ReplyParser\n", gateway::isaName(isa));
+            ok = false;
+        }
+        const char cut[] = "status\r\nVolume: 100.0\r\n";
+        batch.clear();
+        if (gateway::decodeStatusReplies(cut, sizeof(cut) - 1, batch, isa) != 0 || !batch.empty() ||
+            !sameReplies(splitReplies(replies, isa), parsed))
+        {
+            printf("  %s: differs from ReplyParser with replies split across buffers\n", gateway::isaName(isa));
+            ok = false;
+        }
+    }
+
+    printf("check %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,523 @@
+// Gateway
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "gateway.h"
+
+namespace gateway {
+
+namespace {
+
+const uint64_t NS = 1000000000ULL;
+
+// Stats are published to other threads no more often than this
+const uint64_t PUBLISH_NS = NS / 10;
+
+// epoll data for the reactor's own descriptors; links use their index
+const uint32_t TIMER_TOKEN = 0xFFFFFFFF;
+const uint32_t WAKE_TOKEN = 0xFFFFFFFE;
+
+uint64_t monotonicNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * NS + (uint64_t)now.tv_nsec;
+}
+
+double wallSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / NS;
+}
+
+double threadCpuSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / NS;
+}
+
+uint64_t toNs(double seconds)
+{
+    return (uint64_t)(seconds * (double)NS);
+}
+
+// The first deadline after now on a cadence of period from due
+uint64_t nextOnCadence(uint64_t due, uint64_t period, uint64_t now)
+{
+    if (due > now)
+        return due;
+    return due + ((now - due) / period + 1) * period;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// GatewayStats
+//-----------------------------------------------------------------------------
+
+void GatewayStats::merge(const GatewayStats &other)
+{
+    commands += other.commands;
+    replies += other.replies;
+    failures += other.failures;
+    timeouts += other.timeouts;
+    stray += other.stray;
+    overlong += other.overlong;
+    rxBytes += other.rxBytes;
+    txBytes += other.txBytes;
+    wakeups += other.wakeups;
+    cpuSeconds += other.cpuSeconds;
+    latency.merge(other.latency);
+}
+
+//-----------------------------------------------------------------------------
+// Reactor
+//-----------------------------------------------------------------------------
+
+class Gateway::Reactor : public ReplySink
+{
+public:
+    Reactor(const GatewayOptions &options, GatewayListener *listener)
+        : options_(options),
+          listener_(listener),
+          statusPeriod_(std::max<uint64_t>(1, toNs(options.statusPeriod))),
+          historyPeriod_(toNs(options.historyPeriod)),
+          timeout_(std::max<uint64_t>(1, toNs(options.timeout)))
+    {
+    }
+
+    ~Reactor()
+    {
+        stop();
+        for (int fd : { epoll_, timer_, wake_ })
+            if (fd >= 0)
+                close(fd);
+    }
+
+    void add(Link *link) { links_.push_back(link); }
+
+    bool start(uint64_t origin, size_t total, std::string &error);
+    void stop();
+
+    // From one thread at a time
+    const GatewayStats &stats() { return published_.read(); }
+
+    void onStatus(const StatusReply &reply) override;
+    void onHistory(const HistoryReply &reply) override;
+    void onFailed(const char *line) override;
+
+private:
+    struct Deadline
+    {
+        uint64_t due;
+        uint32_t link;
+        uint32_t generation;
+
+        bool operator>(const Deadline &other) const { return due > other.due; }
+    };
+
+    void run();
+    void schedule(uint32_t index, uint64_t due);
+    void scheduleIdle(uint32_t index, uint64_t now);
+    void expire(uint64_t now);
+    void poll(uint32_t index, uint64_t now);
+    void complete(Link &link, uint64_t now);
+    void readLink(uint32_t index);
+    void armTimer();
+    void publish(bool force);
+    void publishLink(Link &link, uint64_t now);
+
+    GatewayOptions options_;
+    GatewayListener *listener_;
+    uint64_t statusPeriod_;
+    uint64_t historyPeriod_;
+    uint64_t timeout_;
+
+    std::vector<Link *> links_;
+    std::vector<Deadline> heap_;      // Min-heap on due
+    int epoll_ = -1;
+    int timer_ = -1;
+    int wake_ = -1;
+    uint64_t armed_ = 0;
+    std::thread thread_;
+
+    // The link being read and when, for the ReplySink callbacks
+    uint32_t current_ = 0;
+    uint64_t readAt_ = 0;
+
+    GatewayStats stats_;
+    double cpuStart_ = 0;
+    uint64_t publishedAt_ = 0;
+    Snapshot<GatewayStats> published_;
+};
+
+bool Gateway::Reactor::start(uint64_t origin, size_t total, std::string &error)
+{
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ < 0 || timer_ < 0 || wake_ < 0)
+    {
+        error = std::string("reactor: ") + strerror(errno);
+        return false;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = TIMER_TOKEN;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, timer_, &event);
+    event.data.u32 = WAKE_TOKEN;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+
+    for (uint32_t i = 0; i < links_.size(); i++)
+    {
+        Link &link = *links_[i];
+        event.data.u32 = i;
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, link.fd, &event) != 0)
+        {
+            error = link.path + ": " + strerror(errno);
+            return false;
+        }
+        // Staggered by the link's place in the whole gateway; the first
+        // History sweep follows the first status reply
+        link.nextStatus = origin + statusPeriod_ * link.id / std::max<size_t>(1, total);
+        link.nextHistory = historyPeriod_ ? link.nextStatus : ~0ULL;
+        schedule(i, link.nextStatus);
+    }
+
+    thread_ = std::thread(&Reactor::run, this);
+    return true;
+}
+
+void Gateway::Reactor::stop()
+{
+    if (!thread_.joinable())
+        return;
+    uint64_t one = 1;
+    ssize_t written = write(wake_, &one, sizeof(one));
+    (void)written;
+    thread_.join();
+}
+
+void Gateway::Reactor::schedule(uint32_t index, uint64_t due)
+{
+    Link &link = *links_[index];
+    link.generation++;
+    heap_.push_back({ due, index, link.generation });
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<Deadline>());
+}
+
+// Next poll of a link with nothing outstanding
+void Gateway::Reactor::scheduleIdle(uint32_t index, uint64_t now)
+{
+    Link &link = *links_[index];
+    if (link.historyPot)
+        schedule(index, now);
+    else
+        schedule(index, std::min(link.nextStatus, link.nextHistory));
+}
+
+void Gateway::Reactor::poll(uint32_t index, uint64_t now)
+{
+    Link &link = *links_[index];
+    char text[24];
+    int length;
+    if (!link.historyPot && now >= link.nextHistory && now < link.nextStatus)
+        link.historyPot = 1;
+    if (link.historyPot)
+    {
+        link.pending = Command::History;
+        length = snprintf(text, sizeof(text), "History %u", link.historyPot);
+    }
+    else
+    {
+        link.pending = Command::Status;
+        length = snprintf(text, sizeof(text), "status");
+    }
+    link.parser.expect(link.pending, text, (size_t)length, link.historyPot);
+    link.sentAt = now;
+    text[length++] = '\r';
+
+    // A command is far smaller than the tty's buffer, which is empty between
+    // replies; if it does not all go, the command times out
+    ssize_t written = write(link.fd, text, (size_t)length);
+    if (written > 0)
+        stats_.txBytes += (uint64_t)written;
+    stats_.commands++;
+    schedule(index, now + timeout_);
+}
+
+// The outstanding command is done, one way or another
+void Gateway::Reactor::complete(Link &link, uint64_t now)
+{
+    if (link.pending == Command::Status)
+    {
+        link.nextStatus = nextOnCadence(link.nextStatus, statusPeriod_, now);
+    }
+    else if (link.pending == Command::History)
+    {
+        if (++link.historyPot > link.pots)
+        {
+            link.historyPot = 0;
+            link.nextHistory = nextOnCadence(link.nextHistory, historyPeriod_, now);
+        }
+    }
+    link.pending = Command::None;
+}
+
+void Gateway::Reactor::expire(uint64_t now)
+{
+    while (!heap_.empty() && heap_.front().due <= now)
+    {
+        Deadline deadline = heap_.front();
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<Deadline>());
+        heap_.pop_back();
+        Link &link = *links_[deadline.link];
+        if (deadline.generation != link.generation)
+            continue;
+        if (link.pending == Command::None)
+        {
+            poll(deadline.link, now);
+            continue;
+        }
+        Command command = link.pending;
+        link.parser.reset();
+        stats_.timeouts++;
+        link.readings.timeouts++;
+        publishLink(link, 0);
+        complete(link, now);
+        if (listener_)
+            listener_->onTimeout(link, command);
+        scheduleIdle(deadline.link, now);
+    }
+}
+
+void Gateway::Reactor::readLink(uint32_t index)
+{
+    Link &link = *links_[index];
+    char buffer[4096];
+    current_ = index;
+    uint64_t stray = link.parser.stray();
+    uint64_t overlong = link.parser.overlong();
+    for (;;)
+    {
+        ssize_t n = read(link.fd, buffer, sizeof(buffer));
+        if (n > 0)
+        {
+            stats_.rxBytes += (uint64_t)n;
+            readAt_ = monotonicNs();
+            link.parser.feed(buffer, (size_t)n, *this);
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            break;
+        // Hung up: stop watching it, and let its commands time out
+        epoll_ctl(epoll_, EPOLL_CTL_DEL, link.fd, nullptr);
+        break;
+    }
+    stats_.stray += link.parser.stray() - stray;
+    stats_.overlong += link.parser.overlong() - overlong;
+}
+
+void Gateway::Reactor::onStatus(const StatusReply &reply)
+{
+    Link &link = *links_[current_];
+    stats_.replies++;
+    stats_.latency.record((readAt_ - link.sentAt) / 1000);
+    if (reply.pots)
+        link.pots = reply.pots;
+    link.readings.status = reply;
+    publishLink(link, readAt_);
+    complete(link, readAt_);
+    if (listener_)
+        listener_->onStatus(link, reply);
+    scheduleIdle(current_, readAt_);
+}
+
+void Gateway::Reactor::onHistory(const HistoryReply &reply)
+{
+    Link &link = *links_[current_];
+    stats_.replies++;
+    stats_.latency.record((readAt_ - link.sentAt) / 1000);
+    publishLink(link, readAt_);
+    complete(link, readAt_);
+    if (listener_)
+        listener_->onHistory(link, reply);
+    scheduleIdle(current_, readAt_);
+}
+
+void Gateway::Reactor::onFailed(const char *)
+{
+    Link &link = *links_[current_];
+    stats_.failures++;
+    link.readings.failures++;
+    publishLink(link, 0);
+    complete(link, readAt_);
+    scheduleIdle(current_, readAt_);
+}
+
+void Gateway::Reactor::armTimer()
+{
+    uint64_t due = heap_.empty() ? 0 : std::max<uint64_t>(1, heap_.front().due);
+    if (due == armed_)
+        return;
+    struct itimerspec spec = {};
+    spec.it_value.tv_sec = (time_t)(due / NS);
+    spec.it_value.tv_nsec = (long)(due % NS);
+    timerfd_settime(timer_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    armed_ = due;
+}
+
+void Gateway::Reactor::publish(bool force)
+{
+    uint64_t now = monotonicNs();
+    if (!force && now - publishedAt_ < PUBLISH_NS)
+        return;
+    publishedAt_ = now;
+    stats_.cpuSeconds = threadCpuSeconds() - cpuStart_;
+    published_.back() = stats_;
+    published_.publish();
+}
+
+// After a reply read at now, or with now 0 after a failure or timeout
+void Gateway::Reactor::publishLink(Link &link, uint64_t now)
+{
+    LinkReadings &readings = link.readings;
+    if (now)
+    {
+        readings.seen = wallSeconds();
+        readings.latency = (uint32_t)std::min<uint64_t>((now - link.sentAt) / 1000, UINT32_MAX);
+        readings.replies++;
+    }
+    link.published.back() = readings;
+    link.published.publish();
+}
+
+void Gateway::Reactor::run()
+{
+    cpuStart_ = threadCpuSeconds();
+    struct epoll_event events[64];
+    bool running = true;
+    while (running)
+    {
+        armTimer();
+        int ready = epoll_wait(epoll_, events, 64, -1);
+        stats_.wakeups++;
+        for (int i = 0; i < ready; i++)
+        {
+            uint32_t token = events[i].data.u32;
+            if (token == WAKE_TOKEN)
+            {
+                running = false;
+            }
+            else if (token == TIMER_TOKEN)
+            {
+                uint64_t expirations;
+                ssize_t n = read(timer_, &expirations, sizeof(expirations));
+                (void)n;
+                armed_ = 0;
+            }
+            else
+            {
+                readLink(token);
+            }
+        }
+        expire(monotonicNs());
+        publish(false);
+    }
+    publish(true);
+}
+
+//-----------------------------------------------------------------------------
+// Gateway
+//-----------------------------------------------------------------------------
+
+Gateway::Gateway(const GatewayOptions &options, GatewayListener *listener)
+    : options_(options),
+      listener_(listener)
+{
+}
+
+Gateway::~Gateway()
+{
+    stop();
+    reactors_.clear();
+    for (auto &link : links_)
+        close(link->fd);
+}
+
+bool Gateway::add(const std::string &path, std::string &error)
+{
+    int fd;
+    if (!openSerial(path, fd, error))
+        return false;
+    links_.emplace_back(new Link);
+    Link &link = *links_.back();
+    link.id = (unsigned)(links_.size() - 1);
+    link.fd = fd;
+    link.path = path;
+    return true;
+}
+
+bool Gateway::start(std::string &error)
+{
+    unsigned threads = std::max(1u, options_.threads);
+    for (unsigned i = 0; i < threads; i++)
+        reactors_.emplace_back(new Reactor(options_, listener_));
+    for (auto &link : links_)
+        reactors_[link->id % threads]->add(link.get());
+    uint64_t origin = monotonicNs();
+    for (auto &reactor : reactors_)
+        if (!reactor->start(origin, links_.size(), error))
+            return false;
+    return true;
+}
+
+void Gateway::stop()
+{
+    for (auto &reactor : reactors_)
+        reactor->stop();
+}
+
+GatewayStats Gateway::stats() const
+{
+    std::lock_guard<std::mutex> guard(readLock_);
+    GatewayStats total;
+    for (auto &reactor : reactors_)
+        total.merge(reactor->stats());
+    return total;
+}
+
+void Gateway::readings(std::vector<LinkReadings> &out) const
+{
+    std::lock_guard<std::mutex> guard(readLock_);
+    out.resize(links_.size());
+    for (size_t i = 0; i < links_.size(); i++)
+        out[i] = links_[i]->published.read();
+}
+
+}
@@ -0,0 +1,125 @@
+// Gateway
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Polls many pots over their serial links from a few threads.  Links are
+// dealt out round-robin to reactors, one per thread; each reactor waits on
+// its own epoll set for its links, a timerfd and a stop eventfd, so a
+// thread costs nothing while its pots are quiet and a thousand links need
+// no more threads than one.
+//
+// Every link is sent "status" once per status period and, once per history
+// period, "History N" for each of its pots in turn.  One command is
+// outstanding on a link at a time: a link waits for the reply, or for the
+// timeout, before it is sent the next.  First polls are staggered across
+// the period so a fleet's replies do not all arrive together.  A reactor
+// keeps its deadlines in a binary heap; a link has one entry at a time, the
+// next poll or the timeout of the command outstanding, and entries left
+// behind when a reply comes in early are recognised by a generation count
+// and skipped.
+//
+// Replies are parsed as they are read (reply.h) and handed to a listener on
+// the reactor's thread.  The latency of a reply is from the write of its
+// command to the read that completed it.
+//
+// What each link last reported, and each reactor's stats, are published
+// through snapshot buffers (snapshot.h), so that reading them from another
+// thread, however often, never holds up a reactor.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_GATEWAY_H_
+#define GATEWAY_GATEWAY_H_
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+#include "link.h"
+#include "reply.h"
+
+namespace gateway {
+
+struct GatewayOptions
+{
+    unsigned threads = 1;
+    double statusPeriod = 60;         // Seconds
+    double historyPeriod = 3600;      // Seconds, 0 for none
+    double timeout = 2;               // Seconds
+};
+
+// Called on reactor threads, so from several threads at once when there
+// are several
+class GatewayListener
+{
+public:
+    virtual ~GatewayListener() {}
+    virtual void onStatus(const Link &, const StatusReply &) {}
+    virtual void onHistory(const Link &, const HistoryReply &) {}
+    virtual void onTimeout(const Link &, Command) {}
+};
+
+struct GatewayStats
+{
+    uint64_t commands = 0;
+    uint64_t replies = 0;
+    uint64_t failures = 0;            // "No such pot", "Invalid command"
+    uint64_t timeouts = 0;
+    uint64_t stray = 0;               // Lines that were not part of a reply
+    uint64_t overlong = 0;            // Lines too long for the line buffer
+    uint64_t rxBytes = 0;
+    uint64_t txBytes = 0;
+    uint64_t wakeups = 0;             // Returns from epoll_wait
+    double cpuSeconds = 0;            // Of the reactor threads
+    Histogram latency;                // Microseconds
+
+    void merge(const GatewayStats &other);
+};
+
+class Gateway
+{
+public:
+    explicit Gateway(const GatewayOptions &options, GatewayListener *listener = nullptr);
+    ~Gateway();
+
+    Gateway(const Gateway &) = delete;
+    Gateway &operator=(const Gateway &) = delete;
+
+    // Opens a pot's serial device; before start()
+    bool add(const std::string &path, std::string &error);
+
+    size_t size() const { return links_.size(); }
+    const Link &link(size_t index) const { return *links_[index]; }
+
+    bool start(std::string &error);
+    void stop();
+
+    // Since start(), summed over the reactors; brought up to date by each
+    // reactor at most every 100 ms
+    GatewayStats stats() const;
+
+    // What each link has reported, in link order, as of its last reply or
+    // timeout
+    void readings(std::vector<LinkReadings> &out) const;
+
+private:
+    class Reactor;
+
+    GatewayOptions options_;
+    GatewayListener *listener_;
+    std::vector<std::unique_ptr<Link>> links_;
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    mutable std::mutex readLock_;     // Readers of the snapshots take turns
+};
+
+}
+
+#endif
@@ -0,0 +1,180 @@
+// Gateway Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs the gateway (gateway.h) against a fleet of simulated pots on
+// pseudo-terminals (ptyfarm.h) in one process, and reports what polling
+// them costs the gateway and how long replies take.
+//
+//   flowerpot_gateway_bench [--pots N] [--seconds S] [--status SECONDS]
+//                           [--history SECONDS] [--threads N]
+//                           [--farm-threads N] [--tick SECONDS]
+//                           [--warmup SECONDS]
+//
+//   --pots          simulated pots (default 1000)
+//   --seconds       seconds to measure for (default 10)
+//   --status        status poll period per pot (default 1)
+//   --history       History poll period per pot, 0 for none (default 0)
+//   --threads       gateway reactor threads (default 1)
+//   --farm-threads  threads stepping the pots (default 1)
+//   --tick          seconds between steps of the pots (default 0.005)
+//   --warmup        seconds the pots run before the gateway starts, for
+//                   them to boot (default 1)
+//
+// CPU per message is the reactor threads' own CPU time over the replies
+// they parsed, so it leaves out the simulation.  Latency is from the write
+// of a command to the read that completed its reply, and so includes the
+// pot's time to answer, the UART time of the reply and up to a tick of the
+// farm's stepping; with the farm and gateway on the same cores it also
+// includes waiting for a core.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "firmware.h"
+#include "gateway.h"
+#include "ptyfarm.h"
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_gateway_bench [--pots N] [--seconds S] [--status SECONDS]\n"
+        "                               [--history SECONDS] [--threads N]\n"
+        "                               [--farm-threads N] [--tick SECONDS]\n"
+        "                               [--warmup SECONDS]\n");
+    exit(2);
+}
+
+double processCpuSeconds()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+           (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+}
+
+void sleepSeconds(double seconds)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::PtyFarmOptions farmOptions;
+    farmOptions.pots = 1000;
+    gateway::GatewayOptions options;
+    options.statusPeriod = 1;
+    options.historyPeriod = 0;
+    double seconds = 10;
+    double warmup = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            farmOptions.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--seconds") == 0)
+            seconds = atof(value);
+        else if (strcmp(arg, "--status") == 0)
+            options.statusPeriod = atof(value);
+        else if (strcmp(arg, "--history") == 0)
+            options.historyPeriod = atof(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--farm-threads") == 0)
+            farmOptions.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--tick") == 0)
+            farmOptions.tick = atof(value);
+        else if (strcmp(arg, "--warmup") == 0)
+            warmup = atof(value);
+        else
+            usage();
+    }
+    if (farmOptions.pots == 0 || seconds <= 0 || options.statusPeriod <= 0 || options.threads == 0 ||
+        farmOptions.tick <= 0 || farmOptions.tick > 1 || options.historyPeriod < 0 || warmup < 0)
+        usage();
+
+    std::string error;
+    sim::PtyFarm farm(farmOptions, sim::PlantParameters(), sim::flowerpotFirmware());
+    if (!farm.open(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::atomic<bool> stop(false);
+    std::thread farmThread([&farm, &stop]() { farm.run(stop); });
+    sleepSeconds(warmup);
+
+    gateway::Gateway gateway(options);
+    for (size_t i = 0; i < farm.size(); i++)
+    {
+        if (!gateway.add(farm.path(i), error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            stop = true;
+            farmThread.join();
+            return 1;
+        }
+    }
+
+    double cpuStart = processCpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    if (!gateway.start(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        stop = true;
+        farmThread.join();
+        return 1;
+    }
+    sleepSeconds(seconds);
+    gateway.stop();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = processCpuSeconds() - cpuStart;
+    stop = true;
+    farmThread.join();
+
+    gateway::GatewayStats stats = gateway.stats();
+    const gateway::Histogram &latency = stats.latency;
+    printf("%u pots, status every %g s, %u gateway thread%s, %.1f s\n", farmOptions.pots,
+           options.statusPeriod, options.threads, options.threads == 1 ? "" : "s", wall);
+    printf("commands %llu  replies %llu (%.0f/s)  failed %llu  timeouts %llu  stray lines %llu\n",
+           (unsigned long long)stats.commands, (unsigned long long)stats.replies, stats.replies / wall,
+           (unsigned long long)stats.failures, (unsigned long long)stats.timeouts,
+           (unsigned long long)stats.stray);
+    printf("bytes rx %llu  tx %llu  wakeups %llu (%.1f replies each)\n",
+           (unsigned long long)stats.rxBytes, (unsigned long long)stats.txBytes,
+           (unsigned long long)stats.wakeups,
+           stats.wakeups ? (double)stats.replies / (double)stats.wakeups : 0.0);
+    printf("gateway cpu %.3f s (%.2f%% of a core), %.2f us per reply; process cpu %.3f s\n",
+           stats.cpuSeconds, 100 * stats.cpuSeconds / wall,
+           stats.replies ? 1e6 * stats.cpuSeconds / (double)stats.replies : 0.0, cpu);
+    printf("latency us  p50 %llu  p90 %llu  p99 %llu  max %llu  mean %.0f\n",
+           (unsigned long long)latency.quantile(0.5), (unsigned long long)latency.quantile(0.9),
+           (unsigned long long)latency.quantile(0.99), (unsigned long long)latency.max(),
+           latency.count() ? (double)latency.sum() / (double)latency.count() : 0.0);
+    return stats.replies ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+// Gateway Daemon
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Polls pots over their serial links (see gateway.h) until interrupted and
+// writes what they report to stdout.
+//
+//   flowerpot_gateway [--threads N] [--status SECONDS] [--history SECONDS]
+//                     [--timeout SECONDS] [--stats SECONDS]
+//                     [--store DIRECTORY] [--flush SECONDS]
+//                     [--anomaly NAME=VALUE]... [--metrics PORT]
+//                     [--dir DIRECTORY] [DEVICE]...
+//
+//   --threads  reactor threads (default 1)
+//   --status   status poll period per pot (default 60)
+//   --history  History poll period per pot, 0 for none (default 3600)
+//   --timeout  seconds to wait for a reply (default 2)
+//   --stats    print gateway statistics to stderr this often, 0 for only
+//              at exit (default 0)
+//   --store    append the status readings to the telemetry store in
+//              DIRECTORY as well (see store.h)
+//   --flush    write the store's partial chunks out this often; a crash
+//              loses what came since (default 3600)
+//   --anomaly  set an option of the anomaly detector (see anomaly.h), such
+//              as --anomaly flat-hours=12
+//   --metrics  serve metrics for Prometheus at http://127.0.0.1:PORT/metrics,
+//              on a free port for 0 (see metrics.h)
+//   --dir      poll every device in DIRECTORY as well, such as the links
+//              flowerpot_pots --dir makes
+//
+// Output is comma separated, one line per pot of a status reply and one per
+// History reply:
+//
+//   status,TIME,DEVICE,POT,MOISTURE,LIGHT,VOLUME,BATTERY
+//   history,TIME,DEVICE,POT,V1 V2 ... V15
+//   timeout,TIME,DEVICE,COMMAND
+//   anomaly,TIME,DEVICE,POT,KIND,raised|cleared,VALUE
+//
+// TIME is Unix seconds with milliseconds.  Status replies are watched for
+// anomalies as they come in; KIND is flatline, no-response, unwatered or
+// leak, and POT is 0 for the board as a whole.  In the store, pot P of the N'th
+// device given, from 0, is pot N * 8 + P - 1.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "anomaly.h"
+#include "gateway.h"
+#include "metrics.h"
+#include "store.h"
+
+namespace {
+
+volatile sig_atomic_t interrupted = 0;
+
+void onInterrupt(int)
+{
+    interrupted = 1;
+}
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_gateway [--threads N] [--status SECONDS] [--history SECONDS]\n"
+        "                         [--timeout SECONDS] [--stats SECONDS]\n"
+        "                         [--store DIRECTORY] [--flush SECONDS]\n"
+        "                         [--anomaly NAME=VALUE]... [--metrics PORT]\n"
+        "                         [--dir DIRECTORY] [DEVICE]...\n");
+    exit(2);
+}
+
+double wallSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+const char *commandName(gateway::Command command)
+{
+    return command == gateway::Command::History ? "History" : "status";
+}
+
+// Lines are written whole under a lock, since reactors call from their own
+// threads
+class CsvListener : public gateway::GatewayListener, public gateway::AnomalySink
+{
+public:
+    CsvListener(gateway::StoreWriter *store, const gateway::AnomalyOptions &anomalyOptions)
+        : store_(store), anomalies_(anomalyOptions, *this)
+    {
+    }
+
+    void onStatus(const gateway::Link &link, const gateway::StatusReply &reply) override
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        double time = wallSeconds();
+        link_ = &link;
+        anomalies_.observe(link.id, (int64_t)(time * 1000), reply);
+        for (unsigned pot = 0; pot < reply.pots; pot++)
+        {
+            printf("status,%.3f,%s,%u,%.1f,%.1f,%.1f,%.1f\n", time, link.path.c_str(), pot + 1,
+                   reply.moisture[pot], reply.light, reply.volume, reply.battery);
+            if (store_)
+                storeStatus(link.id * gateway::kMaxPots + pot, (int64_t)(time * 1000), reply, pot);
+        }
+        fflush(stdout);
+    }
+
+    void onHistory(const gateway::Link &link, const gateway::HistoryReply &reply) override
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        printf("history,%.3f,%s,%u,", wallSeconds(), link.path.c_str(), reply.pot);
+        for (unsigned i = 0; i < reply.count; i++)
+            printf(i ? " %u" : "%u", reply.value[i]);
+        printf("\n");
+        fflush(stdout);
+    }
+
+    void onTimeout(const gateway::Link &link, gateway::Command command) override
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        printf("timeout,%.3f,%s,%s\n", wallSeconds(), link.path.c_str(), commandName(command));
+        fflush(stdout);
+    }
+
+    // From observe(), under the lock
+    void onAnomaly(const gateway::Anomaly &anomaly) override
+    {
+        printf("anomaly,%.3f,%s,%u,%s,%s,%.1f\n", (double)anomaly.time / 1000, link_->path.c_str(), anomaly.pot,
+               gateway::anomalyKindName(anomaly.kind), anomaly.raised ? "raised" : "cleared", anomaly.value);
+    }
+
+    bool flush()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return !store_ || store_->flush();
+    }
+
+private:
+    void storeStatus(uint32_t id, int64_t time, const gateway::StatusReply &reply, unsigned pot)
+    {
+        bool ok = store_->append(id, gateway::Metric::Moisture, time, reply.moisture[pot]) &&
+                  store_->append(id, gateway::Metric::Light, time, reply.light) &&
+                  store_->append(id, gateway::Metric::Volume, time, reply.volume) &&
+                  store_->append(id, gateway::Metric::Battery, time, reply.battery);
+        if (!ok)
+            fprintf(stderr, "store: %s\n", store_->error().c_str());
+    }
+
+    gateway::StoreWriter *store_;
+    gateway::AnomalyDetector anomalies_;
+    const gateway::Link *link_ = nullptr;
+    std::mutex lock_;
+};
+
+void printStats(const gateway::GatewayStats &stats)
+{
+    fprintf(stderr,
+            "%llu commands, %llu replies, %llu failed, %llu timeouts, %llu stray lines; "
+            "rx %llu B, tx %llu B; latency p50 %llu us p99 %llu us max %llu us; cpu %.3f s\n",
+            (unsigned long long)stats.commands, (unsigned long long)stats.replies,
+            (unsigned long long)stats.failures, (unsigned long long)stats.timeouts,
+            (unsigned long long)stats.stray, (unsigned long long)stats.rxBytes,
+            (unsigned long long)stats.txBytes, (unsigned long long)stats.latency.quantile(0.5),
+            (unsigned long long)stats.latency.quantile(0.99), (unsigned long long)stats.latency.max(),
+            stats.cpuSeconds);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    gateway::GatewayOptions options;
+    double statsPeriod = 0;
+    double flushPeriod = 3600;
+    const char *storeDirectory = nullptr;
+    int metricsPort = -1;
+    gateway::AnomalyOptions anomalyOptions;
+    std::string error;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] != '-')
+        {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--status") == 0)
+            options.statusPeriod = atof(value);
+        else if (strcmp(arg, "--history") == 0)
+            options.historyPeriod = atof(value);
+        else if (strcmp(arg, "--timeout") == 0)
+            options.timeout = atof(value);
+        else if (strcmp(arg, "--stats") == 0)
+            statsPeriod = atof(value);
+        else if (strcmp(arg, "--store") == 0)
+            storeDirectory = value;
+        else if (strcmp(arg, "--flush") == 0)
+            flushPeriod = atof(value);
+        else if (strcmp(arg, "--anomaly") == 0)
+        {
+            if (!anomalyOptions.set(value, error))
+            {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+        else if (strcmp(arg, "--metrics") == 0)
+            metricsPort = atoi(value);
+        else if (strcmp(arg, "--dir") == 0)
+        {
+            if (!gateway::listDirectory(value, paths))
+            {
+                fprintf(stderr, "%s: %s\n", value, strerror(errno));
+                return 1;
+            }
+        }
+        else
+            usage();
+    }
+    if (paths.empty() || options.threads == 0 || options.statusPeriod <= 0 || options.timeout <= 0 ||
+        options.historyPeriod < 0 || statsPeriod < 0 || flushPeriod <= 0 ||
+        metricsPort > 65535)
+        usage();
+
+    gateway::StoreWriter store;
+    if (storeDirectory && !store.open(storeDirectory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    CsvListener listener(storeDirectory ? &store : nullptr, anomalyOptions);
+    gateway::Gateway gateway(options, &listener);
+    for (const std::string &path : paths)
+    {
+        if (!gateway.add(path, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = onInterrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    if (!gateway.start(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    fprintf(stderr, "polling %zu pots on %u threads\n", gateway.size(), options.threads);
+    gateway::MetricsServer metrics(gateway);
+    if (metricsPort >= 0)
+    {
+        if (!metrics.start((uint16_t)metricsPort, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            gateway.stop();
+            return 1;
+        }
+        fprintf(stderr, "metrics at http://127.0.0.1:%u/metrics\n", metrics.port());
+    }
+
+    double nextStats = wallSeconds() + statsPeriod;
+    double nextFlush = wallSeconds() + flushPeriod;
+    while (!interrupted)
+    {
+        usleep(100000);
+        if (statsPeriod > 0 && wallSeconds() >= nextStats)
+        {
+            printStats(gateway.stats());
+            nextStats += statsPeriod;
+        }
+        if (wallSeconds() >= nextFlush)
+        {
+            listener.flush();
+            nextFlush += flushPeriod;
+        }
+    }
+    metrics.stop();
+    gateway.stop();
+    printStats(gateway.stats());
+    if (storeDirectory && !store.close())
+    {
+        fprintf(stderr, "store: %s\n", store.error().c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Latency Histogram
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "histogram.h"
+
+namespace gateway {
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void Histogram::clear()
+{
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+}
+
+unsigned Histogram::bucket(uint64_t value)
+{
+    if (value < kSub)
+        return (unsigned)value;
+    unsigned power = 63 - (unsigned)__builtin_clzll(value);
+    unsigned sub = (unsigned)(value >> (power - 3)) & (kSub - 1);
+    return (power - 2) * kSub + sub;
+}
+
+uint64_t Histogram::upper(unsigned i)
+{
+    if (i < kSub)
+        return i;
+    unsigned power = i / kSub + 2;
+    uint64_t lower = (uint64_t)(kSub + i % kSub) << (power - 3);
+    return lower + ((uint64_t)1 << (power - 3)) - 1;
+}
+
+void Histogram::record(uint64_t value)
+{
+    counts_[bucket(value)]++;
+    count_++;
+    sum_ += value;
+    if (value > max_)
+        max_ = value;
+}
+
+void Histogram::merge(const Histogram &other)
+{
+    for (unsigned i = 0; i < kBuckets; i++)
+        counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.max_ > max_)
+        max_ = other.max_;
+}
+
+uint64_t Histogram::quantile(double q) const
+{
+    if (count_ == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(q * (double)(count_ - 1)) + 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < kBuckets; i++)
+    {
+        seen += counts_[i];
+        if (seen >= rank)
+            return upper(i) < max_ ? upper(i) : max_;
+    }
+    return max_;
+}
+
+}
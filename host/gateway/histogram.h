@@ -0,0 +1,57 @@
+// Latency Histogram
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Counts values, such as latencies in microseconds, in log-linear buckets:
+// exact below 8, then eight buckets for each power of two, so a quantile is
+// within 12.5% of the true value.  Recording is a few instructions and no
+// allocation; histograms from several threads are merged for reports.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_HISTOGRAM_H_
+#define GATEWAY_HISTOGRAM_H_
+
+#include <stdint.h>
+
+namespace gateway {
+
+class Histogram
+{
+public:
+    static const unsigned kSub = 8;   // Buckets per power of two
+    static const unsigned kBuckets = 62 * kSub;
+
+    Histogram() { clear(); }
+
+    void clear();
+    void record(uint64_t value);
+    void merge(const Histogram &other);
+
+    uint64_t count() const { return count_; }
+    uint64_t sum() const { return sum_; }
+    uint64_t max() const { return max_; }
+
+    // Upper end of the bucket holding the q'th value, q in [0, 1]
+    uint64_t quantile(double q) const;
+
+    // Bucket i holds values up to upper(i), from upper(i - 1) + 1
+    uint64_t bucketCount(unsigned i) const { return counts_[i]; }
+    static uint64_t upper(unsigned i);
+    static unsigned bucket(uint64_t value);
+
+private:
+    uint64_t counts_[kBuckets];
+    uint64_t count_;
+    uint64_t sum_;
+    uint64_t max_;
+};
+
+}
+
+#endif
@@ -0,0 +1,117 @@
+// Serial Link
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <iterator>
+
+#include "link.h"
+
+namespace gateway {
+
+namespace {
+
+struct Speed
+{
+    uint32_t baud;
+    speed_t constant;
+};
+
+const Speed SPEEDS[] =
+{
+    { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 }, { 115200, B115200 },
+    { 230400, B230400 }, { 460800, B460800 }, { 500000, B500000 }, { 576000, B576000 },
+    { 921600, B921600 }, { 1000000, B1000000 }, { 1152000, B1152000 }, { 1500000, B1500000 },
+    { 2000000, B2000000 }, { 2500000, B2500000 },
+};
+
+const Speed *findSpeed(uint32_t baud)
+{
+    const Speed *speed = std::find_if(std::begin(SPEEDS), std::end(SPEEDS),
+                                      [baud](const Speed &s) { return s.baud == baud; });
+    return speed == std::end(SPEEDS) ? nullptr : speed;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+bool openSerial(const std::string &path, int &fd, std::string &error)
+{
+    fd = open(path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0)
+    {
+        error = path + ": not a serial device: " + strerror(errno);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    cfmakeraw(&tty);
+    cfsetspeed(&tty, B115200);
+    tty.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+    tty.c_cflag |= CS8 | CLOCAL | CREAD;
+    tcsetattr(fd, TCSANOW, &tty);
+    tcflush(fd, TCIOFLUSH);
+    return true;
+}
+
+bool setSerialSpeed(int fd, uint32_t baud, std::string &error)
+{
+    const Speed *speed = findSpeed(baud);
+    if (!speed)
+    {
+        error = "no termios speed for " + std::to_string(baud) + " baud";
+        return false;
+    }
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0 || cfsetspeed(&tty, speed->constant) != 0 || tcsetattr(fd, TCSADRAIN, &tty) != 0)
+    {
+        error = std::string("cannot set ") + std::to_string(baud) + " baud: " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool isSerialSpeed(uint32_t baud)
+{
+    return findSpeed(baud) != nullptr;
+}
+
+bool listDirectory(const char *directory, std::vector<std::string> &paths)
+{
+    DIR *dir = opendir(directory);
+    if (!dir)
+        return false;
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir))
+        if (entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const std::string &name : names)
+        paths.push_back(std::string(directory) + "/" + name);
+    return true;
+}
+
+}
@@ -0,0 +1,73 @@
+// Serial Link
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// A pot's serial device, opened non-blocking and raw at the firmware's
+// 115200 8N1, and what the gateway keeps per pot: the reply parser, the
+// command outstanding, when the next polls are due and what it last heard,
+// which the link's reactor publishes for other threads to read.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_LINK_H_
+#define GATEWAY_LINK_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "reply.h"
+#include "snapshot.h"
+
+namespace gateway {
+
+// Opens path as a raw 115200 8N1 serial device with O_NONBLOCK
+bool openSerial(const std::string &path, int &fd, std::string &error);
+
+// Sets an open serial device to a standard termios speed (tcsetattr after
+// what is queued has gone); false for a speed termios has no constant for
+bool setSerialSpeed(int fd, uint32_t baud, std::string &error);
+bool isSerialSpeed(uint32_t baud);
+
+// Appends every entry of a directory, in name order, such as the links
+// flowerpot_pots --dir makes; false if it cannot be read
+bool listDirectory(const char *directory, std::vector<std::string> &paths);
+
+// What the gateway has heard from a link
+struct LinkReadings
+{
+    StatusReply status = {};          // The last status reply; pots is 0 before one
+    double seen = 0;                  // Unix seconds of the last reply, 0 for none
+    uint32_t latency = 0;             // Microseconds, of the last reply
+    uint64_t replies = 0;
+    uint64_t failures = 0;
+    uint64_t timeouts = 0;
+};
+
+struct Link
+{
+    unsigned id = 0;                  // Index in the gateway
+    int fd = -1;
+    std::string path;
+    ReplyParser parser;
+
+    Command pending = Command::None;
+    uint64_t sentAt = 0;              // Nanoseconds, monotonic
+    uint64_t nextStatus = 0;
+    uint64_t nextHistory = ~0ULL;
+    uint8_t pots = 1;                 // From the last status reply
+    uint8_t historyPot = 0;           // Next pot of a History sweep, 0 for none
+    uint32_t generation = 0;          // Of the link's entry in the timer heap
+
+    LinkReadings readings;            // The reactor's own copy
+    Snapshot<LinkReadings> published;
+};
+
+}
+
+#endif
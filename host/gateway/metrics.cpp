@@ -0,0 +1,459 @@
+// Metrics Endpoint
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+namespace gateway {
+
+namespace {
+
+// Requests are a line and a few headers; anything longer is not a scraper
+const size_t MAX_REQUEST = 8192;
+
+const char *CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+// Bucket bounds of the latency histogram, in microseconds: Prometheus'
+// defaults up to 5 s, and 1 and 2.5 ms below them since a reply over the
+// UART takes a few milliseconds
+const uint64_t LATENCY_BOUNDS[] = { 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+                                    1000000, 2500000, 5000000 };
+
+struct Counter
+{
+    const char *name;
+    const char *help;
+    uint64_t GatewayStats::*field;
+};
+
+const Counter COUNTERS[] =
+{
+    { "commands",   "Commands written to pots",                         &GatewayStats::commands },
+    { "replies",    "Replies parsed",                                   &GatewayStats::replies },
+    { "failures",   "Replies reporting a failed command",               &GatewayStats::failures },
+    { "timeouts",   "Commands that got no reply in time",               &GatewayStats::timeouts },
+    { "rx_bytes",   "Bytes read from pots",                             &GatewayStats::rxBytes },
+    { "tx_bytes",   "Bytes written to pots",                            &GatewayStats::txBytes },
+    { "wakeups",    "Returns from epoll_wait in the reactors",          &GatewayStats::wakeups },
+};
+
+double wallSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// A label value, with the escapes the format asks for
+void appendLabel(std::string &out, const std::string &value)
+{
+    for (char c : value)
+    {
+        if (c == '\\' || c == '"')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+            out += "\\n";
+        else
+            out += c;
+    }
+}
+
+void appendHeader(std::string &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+// name{device="...",pot="N"} value, with pot 0 for none; readings are floats
+// and are printed to a float's precision
+void appendSample(std::string &out, const char *name, const std::string &device, unsigned pot, double value,
+                  int digits = 15)
+{
+    char text[48];
+    out += name;
+    out += "{device=\"";
+    appendLabel(out, device);
+    if (pot)
+    {
+        snprintf(text, sizeof(text), "\",pot=\"%u", pot);
+        out += text;
+    }
+    snprintf(text, sizeof(text), "\"} %.*g\n", digits, value);
+    out += text;
+}
+
+void appendValue(std::string &out, const char *name, double value)
+{
+    char text[128];
+    snprintf(text, sizeof(text), "%s %.15g\n", name, value);
+    out += text;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// MetricsServer
+//-----------------------------------------------------------------------------
+
+MetricsServer::MetricsServer(const Gateway &gateway)
+    : gateway_(gateway),
+      scrapes_(0)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+    for (auto &entry : connections_)
+        close(entry.first);
+    for (int fd : { listen_, epoll_, wake_ })
+        if (fd >= 0)
+            close(fd);
+}
+
+bool MetricsServer::start(uint16_t port, std::string &error)
+{
+    listen_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_ < 0 || epoll_ < 0 || wake_ < 0)
+    {
+        error = std::string("metrics: ") + strerror(errno);
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    socklen_t length = sizeof(address);
+    if (bind(listen_, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_, 64) != 0 ||
+        getsockname(listen_, (struct sockaddr *)&address, &length) != 0)
+    {
+        error = "metrics: port " + std::to_string(port) + ": " + strerror(errno);
+        return false;
+    }
+    port_ = ntohs(address.sin_port);
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listen_;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, listen_, &event);
+    event.data.fd = wake_;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+
+    lastScrape_ = wallSeconds();
+    thread_ = std::thread(&MetricsServer::run, this);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if (!thread_.joinable())
+        return;
+    uint64_t one = 1;
+    ssize_t written = write(wake_, &one, sizeof(one));
+    (void)written;
+    thread_.join();
+}
+
+void MetricsServer::run()
+{
+    struct epoll_event events[64];
+    bool running = true;
+    while (running)
+    {
+        int ready = epoll_wait(epoll_, events, 64, -1);
+        for (int i = 0; i < ready; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wake_)
+            {
+                running = false;
+                continue;
+            }
+            if (fd == listen_)
+            {
+                accept();
+                continue;
+            }
+            auto found = connections_.find(fd);
+            if (found == connections_.end())
+                continue;
+            Connection &connection = found->second;
+            if (connection.response.empty())
+                readRequest(fd, connection);
+            else if (!writeResponse(fd, connection))
+                drop(fd);
+        }
+    }
+}
+
+void MetricsServer::accept()
+{
+    while (true)
+    {
+        int fd = accept4(listen_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        connections_[fd] = Connection();
+    }
+}
+
+void MetricsServer::readRequest(int fd, Connection &connection)
+{
+    char buffer[2048];
+    while (true)
+    {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+        {
+            drop(fd);
+            return;
+        }
+        if (n < 0)
+        {
+            if (errno == EAGAIN)
+                return;
+            continue;
+        }
+        connection.request.append(buffer, (size_t)n);
+        if (connection.request.find("\r\n\r\n") != std::string::npos ||
+            connection.request.size() > MAX_REQUEST)
+            break;
+    }
+
+    respond(connection);
+    struct epoll_event event = {};
+    event.events = EPOLLOUT;
+    event.data.fd = fd;
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, fd, &event);
+    if (!writeResponse(fd, connection))
+        drop(fd);
+}
+
+// Builds the response to the request, whole
+void MetricsServer::respond(Connection &connection)
+{
+    const std::string &request = connection.request;
+    size_t method = request.find(' ');
+    size_t path = method == std::string::npos ? method : request.find_first_of(" ?", method + 1);
+    const char *status = "400 Bad Request";
+    const char *allow = "";
+    std::string body;
+    if (request.size() > MAX_REQUEST || path == std::string::npos)
+        body = "bad request\n";
+    else if (request.compare(method + 1, path - method - 1, "/metrics") != 0)
+    {
+        status = "404 Not Found";
+        body = "try /metrics\n";
+    }
+    else if (request.compare(0, method, "GET") != 0)
+    {
+        status = "405 Method Not Allowed";
+        allow = "Allow: GET\r\n";
+        body = "only GET\n";
+    }
+    else
+    {
+        status = "200 OK";
+        render(body);
+        scrapes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    char header[256];
+    snprintf(header, sizeof(header),
+             "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%sConnection: close\r\n\r\n", status,
+             CONTENT_TYPE, body.size(), allow);
+    connection.response.reserve(strlen(header) + body.size());
+    connection.response = header;
+    connection.response += body;
+}
+
+// False once the connection is done with, written or broken
+bool MetricsServer::writeResponse(int fd, Connection &connection)
+{
+    while (connection.sent < connection.response.size())
+    {
+        ssize_t n = send(fd, connection.response.data() + connection.sent,
+                         connection.response.size() - connection.sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EAGAIN)
+            return true;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        connection.sent += (size_t)n;
+    }
+    return false;
+}
+
+void MetricsServer::drop(int fd)
+{
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
+
+void MetricsServer::render(std::string &out)
+{
+    GatewayStats stats = gateway_.stats();
+    gateway_.readings(readings_);
+    out.clear();
+    out.reserve(readings_.size() * 1024);
+
+    appendHeader(out, "flowerpot_moisture_percent", "gauge", "Soil moisture of a pot");
+    for (size_t i = 0; i < readings_.size(); i++)
+    {
+        const StatusReply &status = readings_[i].status;
+        for (unsigned pot = 0; pot < status.pots; pot++)
+            appendSample(out, "flowerpot_moisture_percent", gateway_.link(i).path, pot + 1, status.moisture[pot], 7);
+    }
+    appendHeader(out, "flowerpot_pump_on", "gauge", "Whether a pot's pump is running");
+    for (size_t i = 0; i < readings_.size(); i++)
+    {
+        const StatusReply &status = readings_[i].status;
+        if (!status.pumpsReported)
+            continue;
+        for (unsigned pot = 0; pot < status.pots; pot++)
+            appendSample(out, "flowerpot_pump_on", gateway_.link(i).path, pot + 1, (status.pumps >> pot) & 1);
+    }
+
+    struct BoardGauge
+    {
+        const char *name;
+        const char *help;
+        float StatusReply::*field;
+    };
+    static const BoardGauge BOARD_GAUGES[] =
+    {
+        { "flowerpot_light_percent",      "Light on the board",            &StatusReply::light },
+        { "flowerpot_volume_milliliters", "Water left in the reservoir",   &StatusReply::volume },
+        { "flowerpot_battery_volts",      "Battery voltage",               &StatusReply::battery },
+    };
+    for (const BoardGauge &gauge : BOARD_GAUGES)
+    {
+        appendHeader(out, gauge.name, "gauge", gauge.help);
+        for (size_t i = 0; i < readings_.size(); i++)
+            if (readings_[i].status.pots)
+                appendSample(out, gauge.name, gateway_.link(i).path, 0, readings_[i].status.*gauge.field, 7);
+    }
+    appendHeader(out, "flowerpot_pots", "gauge", "Pots the board reports");
+    for (size_t i = 0; i < readings_.size(); i++)
+        if (readings_[i].status.pots)
+            appendSample(out, "flowerpot_pots", gateway_.link(i).path, 0, readings_[i].status.pots);
+
+    appendHeader(out, "flowerpot_last_seen_timestamp_seconds", "gauge", "Unix time of the last reply");
+    for (size_t i = 0; i < readings_.size(); i++)
+        if (readings_[i].seen)
+            appendSample(out, "flowerpot_last_seen_timestamp_seconds", gateway_.link(i).path, 0, readings_[i].seen);
+    appendHeader(out, "flowerpot_link_latency_seconds", "gauge", "Command to reply time of the last reply");
+    for (size_t i = 0; i < readings_.size(); i++)
+        if (readings_[i].seen)
+            appendSample(out, "flowerpot_link_latency_seconds", gateway_.link(i).path, 0,
+                         readings_[i].latency / 1e6);
+
+    struct LinkCounter
+    {
+        const char *name;
+        const char *help;
+        uint64_t LinkReadings::*field;
+    };
+    static const LinkCounter LINK_COUNTERS[] =
+    {
+        { "flowerpot_link_replies_total",   "Replies from the board",             &LinkReadings::replies },
+        { "flowerpot_link_failures_total",  "Failed commands on the board",       &LinkReadings::failures },
+        { "flowerpot_link_timeouts_total",  "Commands the board did not answer",  &LinkReadings::timeouts },
+    };
+    for (const LinkCounter &counter : LINK_COUNTERS)
+    {
+        appendHeader(out, counter.name, "counter", counter.help);
+        for (size_t i = 0; i < readings_.size(); i++)
+            appendSample(out, counter.name, gateway_.link(i).path, 0, (double)(readings_[i].*counter.field));
+    }
+
+    char name[96];
+    for (const Counter &counter : COUNTERS)
+    {
+        snprintf(name, sizeof(name), "flowerpot_gateway_%s_total", counter.name);
+        appendHeader(out, name, "counter", counter.help);
+        appendValue(out, name, (double)(stats.*counter.field));
+    }
+    appendHeader(out, "flowerpot_gateway_cpu_seconds_total", "counter", "CPU time of the reactor threads");
+    appendValue(out, "flowerpot_gateway_cpu_seconds_total", stats.cpuSeconds);
+    appendHeader(out, "flowerpot_gateway_parse_errors_total", "counter", "Lines read that were not replies");
+    appendValue(out, "flowerpot_gateway_parse_errors_total{kind=\"stray\"}", (double)stats.stray);
+    appendValue(out, "flowerpot_gateway_parse_errors_total{kind=\"overlong\"}", (double)stats.overlong);
+
+    double now = wallSeconds();
+    double rate = now > lastScrape_ && stats.replies >= lastReplies_
+                      ? (double)(stats.replies - lastReplies_) / (now - lastScrape_)
+                      : 0;
+    lastReplies_ = stats.replies;
+    lastScrape_ = now;
+    appendHeader(out, "flowerpot_gateway_replies_per_second", "gauge", "Replies a second since the last scrape");
+    appendValue(out, "flowerpot_gateway_replies_per_second", rate);
+    appendHeader(out, "flowerpot_gateway_links", "gauge", "Serial links polled");
+    appendValue(out, "flowerpot_gateway_links", (double)gateway_.size());
+
+    // The histogram's buckets are finer than these bounds; one straddling a
+    // bound is counted above it
+    const Histogram &latency = stats.latency;
+    const char *HISTOGRAM = "flowerpot_gateway_latency_seconds";
+    appendHeader(out, HISTOGRAM, "histogram", "Command to reply time");
+    uint64_t below = 0;
+    unsigned bucket = 0;
+    for (uint64_t bound : LATENCY_BOUNDS)
+    {
+        for (; bucket < Histogram::kBuckets && Histogram::upper(bucket) <= bound; bucket++)
+            below += latency.bucketCount(bucket);
+        snprintf(name, sizeof(name), "%s_bucket{le=\"%g\"}", HISTOGRAM, bound / 1e6);
+        appendValue(out, name, (double)below);
+    }
+    snprintf(name, sizeof(name), "%s_bucket{le=\"+Inf\"}", HISTOGRAM);
+    appendValue(out, name, (double)latency.count());
+    snprintf(name, sizeof(name), "%s_sum", HISTOGRAM);
+    appendValue(out, name, latency.sum() / 1e6);
+    snprintf(name, sizeof(name), "%s_count", HISTOGRAM);
+    appendValue(out, name, (double)latency.count());
+}
+
+}
@@ -0,0 +1,111 @@
+// Metrics Endpoint
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Serves what a gateway (gateway.h) knows over HTTP, in the Prometheus text
+// exposition format (version 0.0.4), for a scraper on the same machine:
+//
+//   GET /metrics
+//
+// Every pot reports, labelled with its device and, for what is per pot, the
+// pot number from 1:
+//
+//   flowerpot_moisture_percent{device,pot}       gauge
+//   flowerpot_pump_on{device,pot}                gauge, 1 while pumping
+//   flowerpot_light_percent{device}              gauge
+//   flowerpot_volume_milliliters{device}         gauge
+//   flowerpot_battery_volts{device}              gauge
+//   flowerpot_pots{device}                       gauge
+//   flowerpot_last_seen_timestamp_seconds        gauge, of the last reply
+//   flowerpot_link_latency_seconds{device}       gauge, of the last reply
+//   flowerpot_link_replies_total{device}         counter
+//   flowerpot_link_failures_total{device}        counter
+//   flowerpot_link_timeouts_total{device}        counter
+//
+// Readings appear once a pot has answered a status command, and
+// flowerpot_pump_on only from firmware that reports its pumps.  The gateway
+// itself reports its counters as flowerpot_gateway_*_total, its parse errors
+// as flowerpot_gateway_parse_errors_total{kind="stray"|"overlong"}, the
+// replies a second since the previous scrape, and its reply latency as the
+// histogram flowerpot_gateway_latency_seconds.
+//
+// A scrape reads the gateway's snapshots (snapshot.h) and never takes a
+// lock a reactor takes, so scraping as often as anyone likes does not slow
+// polling down; the stats are up to 100 ms old and the readings are as of
+// each link's last reply.  The server is one thread waiting on epoll, and
+// listens on the loopback interface only: there is nothing here to keep
+// anyone else out.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_METRICS_H_
+#define GATEWAY_METRICS_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gateway.h"
+
+namespace gateway {
+
+class MetricsServer
+{
+public:
+    explicit MetricsServer(const Gateway &gateway);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer &) = delete;
+    MetricsServer &operator=(const MetricsServer &) = delete;
+
+    // Listens on 127.0.0.1:port, or a free port for 0
+    bool start(uint16_t port, std::string &error);
+    void stop();
+
+    uint16_t port() const { return port_; }
+    uint64_t scrapes() const { return scrapes_.load(std::memory_order_relaxed); }
+
+    // The body of a scrape; from the server's thread once started
+    void render(std::string &out);
+
+private:
+    struct Connection
+    {
+        std::string request;
+        std::string response;
+        size_t sent = 0;
+    };
+
+    void run();
+    void accept();
+    void readRequest(int fd, Connection &connection);
+    void respond(Connection &connection);
+    bool writeResponse(int fd, Connection &connection);
+    void drop(int fd);
+
+    const Gateway &gateway_;
+    int listen_ = -1;
+    int epoll_ = -1;
+    int wake_ = -1;
+    uint16_t port_ = 0;
+    std::thread thread_;
+    std::unordered_map<int, Connection> connections_;
+    std::atomic<uint64_t> scrapes_;
+
+    // For render(): the readings, and the replies counted at the last scrape
+    std::vector<LinkReadings> readings_;
+    uint64_t lastReplies_ = 0;
+    double lastScrape_ = 0;
+};
+
+}
+
+#endif
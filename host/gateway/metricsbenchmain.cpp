@@ -0,0 +1,244 @@
+// Metrics Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Polls a fleet of simulated pots on pseudo-terminals (ptyfarm.h) with the
+// gateway (gateway.h) twice, first on its own and then while a scraper
+// hammers its metrics endpoint (metrics.h), and reports what the scraping
+// cost polling and what a scrape costs.
+//
+//   flowerpot_metrics_bench [--pots N] [--seconds S] [--status SECONDS]
+//                           [--rate SCRAPES] [--farm-threads N]
+//                           [--tick SECONDS] [--warmup SECONDS]
+//
+//   --pots          simulated pots (default 1000)
+//   --seconds       seconds to measure each run for (default 10)
+//   --status        status poll period per pot (default 1)
+//   --rate          scrapes a second, 0 for one after another (default 0)
+//   --farm-threads  threads stepping the pots (default 1)
+//   --tick          seconds between steps of the pots (default 0.005)
+//   --warmup        seconds the pots run before the first run, for them to
+//                   boot (default 1)
+//
+// A scrape is timed from connecting to the end of the response.  The run
+// fails unless every scrape was answered 200 and the last one had a moisture
+// reading for every pot.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "firmware.h"
+#include "gateway.h"
+#include "metrics.h"
+#include "ptyfarm.h"
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_metrics_bench [--pots N] [--seconds S] [--status SECONDS]\n"
+        "                               [--rate SCRAPES] [--farm-threads N]\n"
+        "                               [--tick SECONDS] [--warmup SECONDS]\n");
+    exit(2);
+}
+
+void sleepSeconds(double seconds)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+// GET /metrics, whole response into response; false if it could not be had
+bool scrape(uint16_t port, std::string &response)
+{
+    response.clear();
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    const char request[] = "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    bool ok = connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0 &&
+              write(fd, request, sizeof(request) - 1) == (ssize_t)(sizeof(request) - 1);
+    char buffer[65536];
+    ssize_t n;
+    while (ok && (n = read(fd, buffer, sizeof(buffer))) > 0)
+        response.append(buffer, (size_t)n);
+    close(fd);
+    return ok;
+}
+
+struct Run
+{
+    double wall = 0;
+    gateway::GatewayStats stats;
+    uint64_t scrapes = 0;
+    uint64_t failed = 0;              // Not answered 200
+    uint64_t bytes = 0;               // Of the last body
+    gateway::Histogram scrapeTime;    // Microseconds
+    std::string last;
+};
+
+// Polls the farm for seconds, scraping at rate a second when scraping
+bool measure(sim::PtyFarm &farm, const gateway::GatewayOptions &options, double seconds, bool scraping,
+             double rate, Run &run, std::string &error)
+{
+    gateway::Gateway gateway(options);
+    for (size_t i = 0; i < farm.size(); i++)
+        if (!gateway.add(farm.path(i), error))
+            return false;
+    gateway::MetricsServer metrics(gateway);
+    if (!gateway.start(error) || (scraping && !metrics.start(0, error)))
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::duration<double>(seconds);
+    std::string response;
+    uint64_t due = 0;
+    while (std::chrono::steady_clock::now() < end)
+    {
+        if (!scraping)
+        {
+            sleepSeconds(0.05);
+            continue;
+        }
+        if (rate > 0)
+        {
+            auto next = start + std::chrono::duration<double>((double)due++ / rate);
+            std::this_thread::sleep_until(next);
+        }
+        auto begin = std::chrono::steady_clock::now();
+        bool ok = scrape(metrics.port(), response);
+        run.scrapeTime.record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - begin).count());
+        run.scrapes++;
+        size_t body = response.find("\r\n\r\n");
+        if (!ok || response.compare(0, 12, "HTTP/1.1 200") != 0 || body == std::string::npos)
+        {
+            run.failed++;
+            continue;
+        }
+        run.bytes = response.size() - body - 4;
+    }
+    if (scraping && scrape(metrics.port(), response))
+        run.last = response;
+    metrics.stop();
+    gateway.stop();
+    run.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    run.stats = gateway.stats();
+    return true;
+}
+
+void report(const char *name, const Run &run)
+{
+    const gateway::Histogram &latency = run.stats.latency;
+    printf("%-9s replies %llu (%.0f/s)  timeouts %llu  latency us p50 %llu p99 %llu max %llu  "
+           "gateway cpu %.3f s\n",
+           name, (unsigned long long)run.stats.replies, run.stats.replies / run.wall,
+           (unsigned long long)run.stats.timeouts, (unsigned long long)latency.quantile(0.5),
+           (unsigned long long)latency.quantile(0.99), (unsigned long long)latency.max(),
+           run.stats.cpuSeconds);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::PtyFarmOptions farmOptions;
+    farmOptions.pots = 1000;
+    gateway::GatewayOptions options;
+    options.statusPeriod = 1;
+    options.historyPeriod = 0;
+    double seconds = 10;
+    double rate = 0;
+    double warmup = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            farmOptions.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--seconds") == 0)
+            seconds = atof(value);
+        else if (strcmp(arg, "--status") == 0)
+            options.statusPeriod = atof(value);
+        else if (strcmp(arg, "--rate") == 0)
+            rate = atof(value);
+        else if (strcmp(arg, "--farm-threads") == 0)
+            farmOptions.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--tick") == 0)
+            farmOptions.tick = atof(value);
+        else if (strcmp(arg, "--warmup") == 0)
+            warmup = atof(value);
+        else
+            usage();
+    }
+    if (farmOptions.pots == 0 || seconds <= 0 || options.statusPeriod <= 0 || rate < 0 ||
+        farmOptions.tick <= 0 || farmOptions.tick > 1 || warmup < 0)
+        usage();
+
+    std::string error;
+    sim::PtyFarm farm(farmOptions, sim::PlantParameters(), sim::flowerpotFirmware());
+    if (!farm.open(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::atomic<bool> stop(false);
+    std::thread farmThread([&farm, &stop]() { farm.run(stop); });
+    sleepSeconds(warmup);
+
+    Run quiet;
+    Run scraped;
+    bool ok = measure(farm, options, seconds, false, rate, quiet, error) &&
+              measure(farm, options, seconds, true, rate, scraped, error);
+    stop = true;
+    farmThread.join();
+    if (!ok)
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    size_t series = 0;
+    for (size_t at = scraped.last.find("\nflowerpot_moisture_percent{"); at != std::string::npos;
+         at = scraped.last.find("\nflowerpot_moisture_percent{", at + 1))
+        series++;
+    const gateway::Histogram &scrapeTime = scraped.scrapeTime;
+    printf("%u pots, status every %g s, %.1f s a run\n", farmOptions.pots, options.statusPeriod, seconds);
+    report("quiet", quiet);
+    report("scraped", scraped);
+    printf("scrapes %llu (%.1f/s)  failed %llu  body %llu B  scrape us p50 %llu p99 %llu max %llu\n",
+           (unsigned long long)scraped.scrapes, scraped.scrapes / scraped.wall,
+           (unsigned long long)scraped.failed, (unsigned long long)scraped.bytes,
+           (unsigned long long)scrapeTime.quantile(0.5), (unsigned long long)scrapeTime.quantile(0.99),
+           (unsigned long long)scrapeTime.max());
+    printf("last scrape: %zu moisture series for %u pots: %s\n", series, farmOptions.pots,
+           series >= farmOptions.pots ? "ok" : "MISSING");
+    return scraped.failed == 0 && scraped.scrapes && series >= farmOptions.pots ? 0 : 1;
+}
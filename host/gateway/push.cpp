@@ -0,0 +1,411 @@
+// Config Push
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "link.h"
+#include "push.h"
+
+namespace gateway {
+
+namespace {
+
+const char *RESULT_NAMES[] = { "ok", "mismatch", "refused", "timeout", "error" };
+
+template <size_t N>
+bool startsWith(const char *line, size_t length, const char (&prefix)[N])
+{
+    return length >= N - 1 && memcmp(line, prefix, N - 1) == 0;
+}
+
+double monotonicSeconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+std::string potName(uint8_t pot)
+{
+    return "pot " + std::to_string(pot);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+const char *pushResultName(PushResult result)
+{
+    return RESULT_NAMES[(unsigned)result];
+}
+
+std::vector<std::string> pushCommands(const PushConfig &config)
+{
+    std::vector<std::string> commands = { "pots" };
+    char text[40];
+    const char *pot = config.pot ? " " : "";
+    std::string number = config.pot ? std::to_string(config.pot) : "";
+    if (config.water)
+    {
+        snprintf(text, sizeof(text), "water %u %u %u %u%s%s", config.waterStart / 60, config.waterStart % 60,
+                 config.waterEnd / 60, config.waterEnd % 60, pot, number.c_str());
+        commands.push_back(text);
+    }
+    if (config.level)
+    {
+        snprintf(text, sizeof(text), "LEVEL %u%s%s", config.levelPercent, pot, number.c_str());
+        commands.push_back(text);
+    }
+    if (config.water)
+        commands.push_back("window");
+    if (config.level)
+        commands.push_back("LEVEL");
+    return commands;
+}
+
+//-----------------------------------------------------------------------------
+// PushSession
+//-----------------------------------------------------------------------------
+
+PushSession::PushSession(const PushConfig &config, size_t window)
+    : config_(config), window_(window), commands_(pushCommands(config))
+{
+    kinds_.push_back(Kind::Pots);
+    if (config.water)
+        kinds_.push_back(Kind::Water);
+    if (config.level)
+        kinds_.push_back(Kind::Level);
+    if (config.water)
+        kinds_.push_back(Kind::ReadWindows);
+    if (config.level)
+        kinds_.push_back(Kind::ReadLevels);
+}
+
+void PushSession::next(std::string &out)
+{
+    while (!done_ && sent_ < commands_.size())
+    {
+        size_t length = commands_[sent_].size() + 1;
+        bool idle = sent_ == replied_;
+        if (!idle && (window_ == 0 || unechoed_ + length > window_))
+            break;
+        out += commands_[sent_];
+        out += '\r';
+        unechoed_ += length;
+        sent_++;
+        ahead_ = std::max(ahead_, (uint32_t)(sent_ - replied_));
+    }
+}
+
+void PushSession::feed(const char *data, size_t length)
+{
+    const char *end = data + length;
+    while (data < end && !done_)
+    {
+        const char *newline = (const char *)memchr(data, '\n', (size_t)(end - data));
+        const char *stop = newline ? newline : end;
+        for (; data < stop; data++)
+        {
+            if (*data == '\r' || discarding_)
+                continue;
+            if (length_ == ReplyParser::kLineMax)
+            {
+                discarding_ = true;
+                continue;
+            }
+            line_[length_++] = *data;
+        }
+        if (!newline)
+            return;
+        data++;
+        if (!discarding_)
+        {
+            line_[length_] = 0;
+            line(line_, length_);
+        }
+        length_ = 0;
+        discarding_ = false;
+    }
+}
+
+void PushSession::expire()
+{
+    if (!done_)
+        fail(PushResult::Timeout, replied_ < sent_ ? "no reply to " + commands_[replied_] : "no reply");
+}
+
+void PushSession::report(PushReport &report) const
+{
+    report.result = result_;
+    report.detail = detail_;
+    report.pots = pots_;
+    report.commands = (uint32_t)replied_;
+    report.ahead = ahead_;
+}
+
+void PushSession::line(const char *text, size_t length)
+{
+    // Lines before the echo of the command due are left over from before
+    if (replied_ == sent_)
+        return;
+    const std::string &command = commands_[replied_];
+    if (!echoed_)
+    {
+        if (length == command.size() && memcmp(text, command.data(), length) == 0)
+        {
+            echoed_ = true;
+            unechoed_ -= length + 1;
+        }
+        return;
+    }
+    if (startsWith(text, length, "No such pot") || startsWith(text, length, "Invalid command"))
+    {
+        fail(PushResult::Refused, command + ": " + text);
+        return;
+    }
+
+    unsigned pot, number, h1, m1, h2, m2, value;
+    int matched = 0;
+    char days[8];
+    switch (kinds_[replied_])
+    {
+    case Kind::Pots:
+        if (sscanf(text, "pots : %u", &value) == 1)
+        {
+            pots_ = (uint8_t)std::min(value, kMaxPots);
+            if (config_.pot > pots_)
+                fail(PushResult::Refused, "no " + potName(config_.pot) + " of " + std::to_string(pots_));
+            else
+                answered();
+        }
+        break;
+    case Kind::Water:
+        if (startsWith(text, length, "time1 changed"))
+            answered();
+        break;
+    case Kind::Level:
+        if (startsWith(text, length, "Level changed"))
+            answered();
+        break;
+    case Kind::ReadWindows:
+        // "pot N window W : HH:MM-HH:MM DAYS" for each window, then
+        // "pot N : ..." to end each pot
+        if (sscanf(text, "pot %u window %u : %u:%u-%u:%u %7s", &pot, &number, &h1, &m1, &h2, &m2, days) == 7)
+        {
+            if (pot >= 1 && pot <= pots_)
+            {
+                Pot &p = pot_[pot - 1];
+                if (number == 1 && h1 * 60 + m1 == config_.waterStart && h2 * 60 + m2 == config_.waterEnd &&
+                    strcmp(days, "1234567") == 0)
+                    p.window = true;
+                else
+                    p.windows++;
+            }
+        }
+        else if (sscanf(text, "pot %u :%n", &pot, &matched) == 1 && matched && pot == pots_)
+        {
+            answered();
+        }
+        break;
+    case Kind::ReadLevels:
+        if (sscanf(text, "pot %u level : %u", &pot, &value) == 2 && pot >= 1 && pot <= pots_)
+        {
+            pot_[pot - 1].levelRead = true;
+            pot_[pot - 1].level = (uint16_t)value;
+            if (pot == pots_)
+                answered();
+        }
+        break;
+    }
+}
+
+void PushSession::answered()
+{
+    replied_++;
+    echoed_ = false;
+    if (replied_ == commands_.size())
+        verify();
+}
+
+void PushSession::fail(PushResult result, const std::string &detail)
+{
+    result_ = result;
+    detail_ = detail;
+    done_ = true;
+}
+
+void PushSession::verify()
+{
+    done_ = true;
+    for (uint8_t i = 0; i < pots_; i++)
+    {
+        if (config_.pot && config_.pot != i + 1)
+            continue;
+        const Pot &pot = pot_[i];
+        std::string name = potName((uint8_t)(i + 1));
+        if (config_.water && (!pot.window || pot.windows))
+        {
+            fail(PushResult::Mismatch, name + (pot.window ? " has other windows" : " window not set"));
+            return;
+        }
+        if (config_.level && (!pot.levelRead || pot.level != config_.levelPercent))
+        {
+            fail(PushResult::Mismatch, name + " level " + std::to_string(pot.level));
+            return;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Pusher
+//-----------------------------------------------------------------------------
+
+void Pusher::run(const std::vector<std::string> &paths, const PushConfig &config, std::vector<PushReport> &reports)
+{
+    reports.assign(paths.size(), PushReport());
+    for (size_t i = 0; i < paths.size(); i++)
+        reports[i].path = paths[i];
+    unsigned threads = std::max(1u, std::min(options_.threads, (unsigned)paths.size()));
+    std::vector<std::thread> workers;
+    for (unsigned shard = 1; shard < threads; shard++)
+        workers.emplace_back(&Pusher::runShard, this, std::cref(paths), std::cref(config), std::ref(reports), shard);
+    runShard(paths, config, reports, 0);
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+// Links shard, shard + threads, ... on this thread, each writing only its
+// own report
+void Pusher::runShard(const std::vector<std::string> &paths, const PushConfig &config,
+                      std::vector<PushReport> &reports, unsigned shard)
+{
+    struct Active
+    {
+        size_t index;
+        int fd;
+        PushSession session;
+        std::string out;              // Not yet written
+        double started;
+        double heard;                 // Last read, or the first write
+        bool writable;                // Waiting for EPOLLOUT
+    };
+
+    unsigned threads = std::max(1u, std::min(options_.threads, (unsigned)paths.size()));
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<std::unique_ptr<Active>> links;
+    size_t remaining = 0;
+    double now = monotonicSeconds();
+    for (size_t i = shard; i < paths.size(); i += threads)
+    {
+        std::string error;
+        int fd;
+        if (!openSerial(paths[i], fd, error))
+        {
+            reports[i].result = PushResult::Error;
+            reports[i].detail = error;
+            continue;
+        }
+        links.emplace_back(new Active{ i, fd, PushSession(config, options_.window), std::string(), now, now, false });
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = links.size() - 1;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+        remaining++;
+    }
+
+    // Writes what the window allows, and asks for EPOLLOUT while a write is
+    // held up
+    auto pump = [epoll](Active &link, uint64_t slot)
+    {
+        link.session.next(link.out);
+        if (!link.out.empty())
+        {
+            ssize_t written = write(link.fd, link.out.data(), link.out.size());
+            if (written > 0)
+                link.out.erase(0, (size_t)written);
+        }
+        bool blocked = !link.out.empty();
+        if (blocked != link.writable)
+        {
+            struct epoll_event event = {};
+            event.events = blocked ? EPOLLIN | EPOLLOUT : EPOLLIN;
+            event.data.u64 = slot;
+            epoll_ctl(epoll, EPOLL_CTL_MOD, link.fd, &event);
+            link.writable = blocked;
+        }
+    };
+
+    // Stops watching a link once its push is over
+    auto finish = [epoll, &remaining, &reports](Active &link, double now)
+    {
+        epoll_ctl(epoll, EPOLL_CTL_DEL, link.fd, nullptr);
+        reports[link.index].seconds = now - link.started;
+        remaining--;
+    };
+
+    for (size_t i = 0; i < links.size(); i++)
+        pump(*links[i], i);
+
+    struct epoll_event events[64];
+    char buffer[4096];
+    double nextScan = now + 0.05;
+    while (remaining)
+    {
+        int count = epoll_wait(epoll, events, 64, 50);
+        now = monotonicSeconds();
+        for (int e = 0; e < count; e++)
+        {
+            uint64_t slot = events[e].data.u64;
+            Active &link = *links[slot];
+            if (link.session.done())
+                continue;
+            if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                ssize_t n;
+                while ((n = read(link.fd, buffer, sizeof(buffer))) > 0)
+                    link.session.feed(buffer, (size_t)n);
+                link.heard = now;
+            }
+            pump(link, slot);
+            if (link.session.done())
+                finish(link, now);
+        }
+        if (now < nextScan)
+            continue;
+        nextScan = now + 0.05;
+        for (auto &link : links)
+        {
+            if (!link->session.done() && now - link->heard > options_.timeout)
+            {
+                link->session.expire();
+                finish(*link, now);
+            }
+        }
+    }
+
+    for (auto &link : links)
+    {
+        link->session.report(reports[link->index]);
+        close(link->fd);
+    }
+    close(epoll);
+}
+
+}
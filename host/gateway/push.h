@@ -0,0 +1,173 @@
+// Config Push
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Pushes a watering window and level to many pots at once and reads them
+// back.  Each link is sent, in order:
+//
+//   pots                      how many pots the board has, for the read-back
+//   water H1 M1 H2 M2 [pot]   if a window is being set
+//   LEVEL N [pot]             if a level is being set
+//   window                    reads every pot's windows back
+//   LEVEL                     reads every pot's level back
+//
+// Commands are pipelined: a link is sent the next command without waiting
+// for the echo of the last, as long as the bytes not yet echoed fit in the
+// window.  The board reads commands from UART0's 16-byte receive FIFO one
+// line at a time and echoes each line once it has read it, so a window of
+// 16 bytes never overruns the FIFO, while the board is busy answering the
+// last command.  Replies come back in order and are matched to commands
+// by their echoes.
+//
+// A link succeeds if every command is accepted and what is read back is
+// what was pushed on every pot it was pushed to: the window from H1:M1 to
+// H2:M2 every day and no other, and the level.  A link that sends nothing
+// for the timeout while a reply is due has timed out.
+//
+// Links are dealt out round-robin to threads, each with its own epoll set.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_PUSH_H_
+#define GATEWAY_PUSH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "reply.h"
+
+namespace gateway {
+
+struct PushConfig
+{
+    bool water = false;
+    uint16_t waterStart = 0;          // Minutes after midnight
+    uint16_t waterEnd = 0;
+    bool level = false;
+    uint16_t levelPercent = 0;
+    uint8_t pot = 0;                  // 0 for every pot
+};
+
+struct PushOptions
+{
+    unsigned threads = 1;
+    size_t window = 16;               // Bytes sent ahead of their echoes, 0
+                                      // to wait for each reply
+    double timeout = 5;               // Seconds
+};
+
+enum class PushResult : uint8_t
+{
+    Ok,
+    Mismatch,                         // Read back differs from what was pushed
+    Refused,                          // "No such pot" or "Invalid command"
+    Timeout,
+    Error                             // The device could not be opened
+};
+
+const char *pushResultName(PushResult result);
+
+struct PushReport
+{
+    std::string path;
+    PushResult result = PushResult::Error;
+    std::string detail;               // What went wrong, if anything
+    uint8_t pots = 0;
+    uint32_t commands = 0;            // Answered
+    uint32_t ahead = 0;               // Most commands unanswered at once
+    double seconds = 0;               // From the first write to the last reply
+};
+
+// The commands a config is pushed and read back with, without the '\r'
+std::vector<std::string> pushCommands(const PushConfig &config);
+
+// One link's push: what to write next and what its replies say
+class PushSession
+{
+public:
+    PushSession(const PushConfig &config, size_t window);
+
+    // Appends as many whole commands as the window allows, each ending in
+    // '\r'; always at least one when none is unanswered
+    void next(std::string &out);
+
+    // Takes bytes read from the link
+    void feed(const char *data, size_t length);
+
+    bool done() const { return done_; }
+    bool waiting() const { return !done_ && replied_ < sent_; }
+
+    // Ends the push as timed out
+    void expire();
+
+    // Fills in the result, pots, commands and ahead of a report
+    void report(PushReport &report) const;
+
+private:
+    enum class Kind : uint8_t
+    {
+        Pots,
+        Water,
+        Level,
+        ReadWindows,
+        ReadLevels
+    };
+
+    struct Pot
+    {
+        uint8_t windows;              // Read back, other than the one pushed
+        bool window;                  // The pushed window was read back
+        bool levelRead;
+        uint16_t level;
+    };
+
+    void line(const char *text, size_t length);
+    void answered();
+    void fail(PushResult result, const std::string &detail);
+    void verify();
+
+    PushConfig config_;
+    size_t window_;
+    std::vector<std::string> commands_;
+    std::vector<Kind> kinds_;
+    size_t sent_ = 0;                 // Commands written
+    size_t replied_ = 0;              // Commands answered
+    size_t unechoed_ = 0;             // Bytes of commands not yet echoed
+    bool echoed_ = false;             // Of the command being answered
+    uint32_t ahead_ = 0;
+    char line_[ReplyParser::kLineMax + 1];
+    size_t length_ = 0;
+    bool discarding_ = false;
+    uint8_t pots_ = 0;
+    Pot pot_[kMaxPots] = {};
+    bool done_ = false;
+    PushResult result_ = PushResult::Ok;
+    std::string detail_;
+};
+
+class Pusher
+{
+public:
+    explicit Pusher(const PushOptions &options) : options_(options) {}
+
+    // Pushes config to every device and returns when each has finished,
+    // with a report per device in the same order
+    void run(const std::vector<std::string> &paths, const PushConfig &config, std::vector<PushReport> &reports);
+
+private:
+    void runShard(const std::vector<std::string> &paths, const PushConfig &config,
+                  std::vector<PushReport> &reports, unsigned shard);
+
+    PushOptions options_;
+};
+
+}
+
+#endif
@@ -0,0 +1,168 @@
+// Config Push Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Pushes a watering window and level (push.h) to a fleet of simulated pots
+// on pseudo-terminals (ptyfarm.h) in one process, once waiting for each
+// reply and then pipelined, and reports how long each took.
+//
+//   flowerpot_push_bench [--pots N] [--window BYTES] [--threads N]
+//                        [--farm-threads N] [--tick SECONDS]
+//                        [--warmup SECONDS]
+//
+//   --pots          simulated pots (default 1000)
+//   --window        bytes sent ahead of their echoes in the pipelined push
+//                   (default 16)
+//   --threads       push threads (default 1)
+//   --farm-threads  threads stepping the pots (default 1)
+//   --tick          seconds between steps of the pots (default 0.005)
+//   --warmup        seconds the pots run before the first push, for them to
+//                   boot (default 1)
+//
+// Each push sets a different window and level, so every read-back has to
+// show the new values.  The exit status is 1 unless every pot is ok in
+// every push.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "firmware.h"
+#include "ptyfarm.h"
+#include "push.h"
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_push_bench [--pots N] [--window BYTES] [--threads N]\n"
+        "                            [--farm-threads N] [--tick SECONDS]\n"
+        "                            [--warmup SECONDS]\n");
+    exit(2);
+}
+
+// Pushes once and prints how it went; false unless every pot is ok
+bool push(const std::vector<std::string> &paths, const gateway::PushOptions &options,
+          const gateway::PushConfig &config, const char *name)
+{
+    auto start = std::chrono::steady_clock::now();
+    gateway::Pusher pusher(options);
+    std::vector<gateway::PushReport> reports;
+    pusher.run(paths, config, reports);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t ok = 0;
+    uint64_t commands = 0;
+    uint32_t ahead = 0;
+    std::vector<double> seconds;
+    const gateway::PushReport *failed = nullptr;
+    for (const gateway::PushReport &report : reports)
+    {
+        ok += report.result == gateway::PushResult::Ok;
+        commands += report.commands;
+        ahead = std::max(ahead, report.ahead);
+        seconds.push_back(report.seconds);
+        if (report.result != gateway::PushResult::Ok && !failed)
+            failed = &report;
+    }
+    std::sort(seconds.begin(), seconds.end());
+    printf("%-10s %zu of %zu ok in %.2f s, %llu commands (%.0f/s), up to %u ahead; per pot p50 %.0f ms "
+           "max %.0f ms\n",
+           name, ok, reports.size(), wall, (unsigned long long)commands, (double)commands / wall, ahead,
+           seconds[seconds.size() / 2] * 1e3, seconds.back() * 1e3);
+    if (failed)
+        printf("           %s: %s %s\n", failed->path.c_str(), gateway::pushResultName(failed->result),
+               failed->detail.c_str());
+    return ok == reports.size();
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::PtyFarmOptions farmOptions;
+    farmOptions.pots = 1000;
+    gateway::PushOptions options;
+    double warmup = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            farmOptions.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--window") == 0)
+            options.window = (size_t)atol(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--farm-threads") == 0)
+            farmOptions.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--tick") == 0)
+            farmOptions.tick = atof(value);
+        else if (strcmp(arg, "--warmup") == 0)
+            warmup = atof(value);
+        else
+            usage();
+    }
+    if (farmOptions.pots == 0 || options.window == 0 || options.threads == 0 || farmOptions.tick <= 0 ||
+        farmOptions.tick > 1 || warmup < 0)
+        usage();
+
+    std::string error;
+    sim::PtyFarm farm(farmOptions, sim::PlantParameters(), sim::flowerpotFirmware());
+    if (!farm.open(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::atomic<bool> stop(false);
+    std::thread farmThread([&farm, &stop]() { farm.run(stop); });
+    std::this_thread::sleep_for(std::chrono::duration<double>(warmup));
+
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < farm.size(); i++)
+        paths.push_back(farm.path(i));
+
+    gateway::PushConfig config;
+    config.water = true;
+    config.level = true;
+    config.waterStart = 6 * 60;
+    config.waterEnd = 7 * 60 + 30;
+    config.levelPercent = 40;
+    gateway::PushOptions serial = options;
+    serial.window = 0;
+    printf("%u pots, %u push thread%s\n", farmOptions.pots, options.threads, options.threads == 1 ? "" : "s");
+    bool ok = push(paths, serial, config, "serial");
+
+    config.waterStart = 21 * 60;
+    config.waterEnd = 23 * 60 + 15;
+    config.levelPercent = 35;
+    char name[32];
+    snprintf(name, sizeof(name), "window %zu", options.window);
+    ok = push(paths, options, config, name) && ok;
+
+    stop = true;
+    farmThread.join();
+    printf("check      %s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// Config Push Tool
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL over USB serial
+
+// Sets the watering window, the level or both on many pots at once and
+// reads them back (see push.h), in place of typing "water" and "LEVEL" into
+// each pot's terminal.
+//
+//   flowerpot_push [--water HH:MM-HH:MM] [--level PERCENT] [--pot N]
+//                  [--window BYTES] [--timeout SECONDS] [--threads N]
+//                  [--dir DIRECTORY] [DEVICE]...
+//
+//   --water    water every day from the first time to the second, in place
+//              of any other windows
+//   --level    water below this moisture percent
+//   --pot      push to this pot of each board only (default every pot)
+//   --window   bytes of commands sent ahead of their echoes (default 16,
+//              the board's receive FIFO); 0 waits for each reply
+//   --timeout  seconds a link may be silent while a reply is due (default 5)
+//   --threads  threads (default 1)
+//   --dir      push to every device in DIRECTORY as well, such as the links
+//              flowerpot_pots --dir makes
+//
+// Output is a line per device:
+//
+//   DEVICE,RESULT,POTS,SECONDS,DETAIL
+//
+// RESULT is ok, mismatch, refused, timeout or error.  A summary goes to
+// stderr, and the exit status is 1 unless every device is ok.  The gateway
+// should not be polling the same devices at the time.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "link.h"
+#include "push.h"
+
+namespace {
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_push [--water HH:MM-HH:MM] [--level PERCENT] [--pot N]\n"
+        "                      [--window BYTES] [--timeout SECONDS] [--threads N]\n"
+        "                      [--dir DIRECTORY] [DEVICE]...\n");
+    exit(2);
+}
+
+// "HH:MM-HH:MM" as minutes after midnight
+bool parseWindow(const char *text, uint16_t &start, uint16_t &end)
+{
+    unsigned h1, m1, h2, m2;
+    int used = 0;
+    if (sscanf(text, "%u:%u-%u:%u%n", &h1, &m1, &h2, &m2, &used) != 4 || text[used] != 0 || h1 > 23 ||
+        h2 > 23 || m1 > 59 || m2 > 59)
+        return false;
+    start = (uint16_t)(h1 * 60 + m1);
+    end = (uint16_t)(h2 * 60 + m2);
+    return true;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    gateway::PushOptions options;
+    gateway::PushConfig config;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (arg[0] != '-')
+        {
+            paths.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--water") == 0)
+        {
+            if (!parseWindow(value, config.waterStart, config.waterEnd))
+                usage();
+            config.water = true;
+        }
+        else if (strcmp(arg, "--level") == 0)
+        {
+            config.level = true;
+            config.levelPercent = (uint16_t)atoi(value);
+        }
+        else if (strcmp(arg, "--pot") == 0)
+            config.pot = (uint8_t)atoi(value);
+        else if (strcmp(arg, "--window") == 0)
+            options.window = (size_t)atol(value);
+        else if (strcmp(arg, "--timeout") == 0)
+            options.timeout = atof(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--dir") == 0)
+        {
+            if (!gateway::listDirectory(value, paths))
+            {
+                fprintf(stderr, "%s: %s\n", value, strerror(errno));
+                return 1;
+            }
+        }
+        else
+            usage();
+    }
+    if (paths.empty() || (!config.water && !config.level) || config.pot > gateway::kMaxPots ||
+        config.levelPercent > 100 || options.threads == 0 || options.timeout <= 0)
+        usage();
+
+    auto start = std::chrono::steady_clock::now();
+    gateway::Pusher pusher(options);
+    std::vector<gateway::PushReport> reports;
+    pusher.run(paths, config, reports);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned counts[5] = {};
+    for (const gateway::PushReport &report : reports)
+    {
+        printf("%s,%s,%u,%.3f,%s\n", report.path.c_str(), gateway::pushResultName(report.result), report.pots,
+               report.seconds, report.detail.c_str());
+        counts[(unsigned)report.result]++;
+    }
+    fprintf(stderr, "%zu devices in %.2f s: %u ok, %u mismatch, %u refused, %u timeout, %u error\n",
+            reports.size(), seconds, counts[0], counts[1], counts[2], counts[3], counts[4]);
+    return counts[0] == reports.size() ? 0 : 1;
+}
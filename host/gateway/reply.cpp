@@ -0,0 +1,279 @@
+// Reply Parser
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "reply.h"
+
+namespace gateway {
+
+namespace {
+
+// Length of a string literal, for matching line prefixes
+template <size_t N>
+constexpr size_t lengthOf(const char (&)[N])
+{
+    return N - 1;
+}
+
+template <size_t N>
+bool startsWith(const char *line, size_t length, const char (&prefix)[N])
+{
+    return length >= N - 1 && memcmp(line, prefix, N - 1) == 0;
+}
+
+// The number after the first ':', or false if there is none
+bool valueAfterColon(const char *line, const char *end, float &value)
+{
+    const char *colon = (const char *)memchr(line, ':', (size_t)(end - line));
+    return colon && parseDecimal(colon + 1, end, value);
+}
+
+const double POWERS_OF_TEN[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+                                 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Up to 18 significant digits are kept, more than a float needs
+const char *parseDecimal(const char *text, const char *end, float &value)
+{
+    const char *p = text;
+    while (p < end && *p == ' ')
+        p++;
+    bool negative = p < end && *p == '-';
+    if (negative)
+        p++;
+    uint64_t mantissa = 0;
+    unsigned digits = 0;
+    int scale = 0;
+    const char *first = p;
+    for (; p < end && (unsigned)(*p - '0') < 10; p++)
+    {
+        if (digits < 18)
+        {
+            mantissa = mantissa * 10 + (unsigned)(*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+        {
+            scale++;
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && (unsigned)(*p - '0') < 10; p++)
+        {
+            // Digits past the 18th place are too small to matter, even
+            // after leading zeros
+            if (digits < 18 && scale > -18)
+            {
+                mantissa = mantissa * 10 + (unsigned)(*p - '0');
+                digits += mantissa != 0;
+                scale--;
+            }
+        }
+    }
+    if (p == first || (p == first + 1 && *first == '.') || scale > 18)
+        return nullptr;
+    double result = (double)mantissa;
+    result = scale < 0 ? result / POWERS_OF_TEN[-scale] : result * POWERS_OF_TEN[scale];
+    value = (float)(negative ? -result : result);
+    return p;
+}
+
+StatusLine parseStatusLine(const char *line, size_t length, StatusReply &reply)
+{
+    const char *end = line + length;
+    float value;
+    if (startsWith(line, length, "Volume:"))
+    {
+        if (!parseDecimal(line + lengthOf("Volume:"), end, reply.volume))
+            return StatusLine::Unknown;
+    }
+    else if (startsWith(line, length, "lightpercentage") && valueAfterColon(line, end, value))
+    {
+        reply.light = value;
+    }
+    else if (startsWith(line, length, "moisturepercentage") && valueAfterColon(line, end, value))
+    {
+        // "moisturepercentage : X" from a single pot, "moisturepercentage N : X"
+        // from several
+        const char *p = line + lengthOf("moisturepercentage");
+        unsigned pot = 0;
+        while (p < end && *p == ' ')
+            p++;
+        for (; p < end && (unsigned)(*p - '0') < 10; p++)
+            pot = pot * 10 + (unsigned)(*p - '0');
+        unsigned index = pot == 0 ? reply.pots : pot - 1;
+        if (index < kMaxPots)
+        {
+            reply.moisture[index] = value;
+            if (index + 1 > reply.pots)
+                reply.pots = (uint8_t)(index + 1);
+        }
+    }
+    else if (startsWith(line, length, "pumps :"))
+    {
+        const char *p = line + lengthOf("pumps :");
+        while (p < end && *p == ' ')
+            p++;
+        reply.pumps = 0;
+        for (unsigned pot = 0; p < end && pot < kMaxPots && (*p == '0' || *p == '1'); p++, pot++)
+            reply.pumps |= (uint8_t)((*p - '0') << pot);
+        reply.pumpsReported = true;
+    }
+    else if (startsWith(line, length, "batteryvoltage") && valueAfterColon(line, end, value))
+    {
+        reply.battery = value;
+        return StatusLine::Last;
+    }
+    else
+    {
+        return StatusLine::Unknown;
+    }
+    return StatusLine::Field;
+}
+
+//-----------------------------------------------------------------------------
+// ReplyParser
+//-----------------------------------------------------------------------------
+
+void ReplyParser::expect(Command command, const char *text, size_t length, uint8_t pot)
+{
+    command_ = command;
+    state_ = State::Echo;
+    echoLength_ = length < sizeof(echo_) ? length : sizeof(echo_);
+    memcpy(echo_, text, echoLength_);
+    memset(&status_, 0, sizeof(status_));
+    history_.pot = pot;
+    history_.count = 0;
+}
+
+void ReplyParser::reset()
+{
+    length_ = 0;
+    discarding_ = false;
+    command_ = Command::None;
+    state_ = State::Echo;
+    echoLength_ = 0;
+}
+
+void ReplyParser::feed(const char *data, size_t length, ReplySink &sink)
+{
+    const char *end = data + length;
+    while (data < end)
+    {
+        // Copy up to the next '\n' in one go
+        const char *newline = (const char *)memchr(data, '\n', (size_t)(end - data));
+        const char *stop = newline ? newline : end;
+        for (; data < stop; data++)
+        {
+            if (*data == '\r' || discarding_)
+                continue;
+            if (length_ == kLineMax)
+            {
+                discarding_ = true;
+                overlong_++;
+                continue;
+            }
+            line_[length_++] = *data;
+        }
+        if (!newline)
+            return;
+        data++;
+        if (!discarding_)
+        {
+            line_[length_] = 0;
+            line(sink);
+        }
+        length_ = 0;
+        discarding_ = false;
+    }
+}
+
+void ReplyParser::finish()
+{
+    command_ = Command::None;
+    state_ = State::Echo;
+}
+
+void ReplyParser::line(ReplySink &sink)
+{
+    lines_++;
+    if (command_ == Command::None)
+    {
+        stray_++;
+        return;
+    }
+    if (state_ == State::Echo)
+    {
+        if (length_ == echoLength_ && memcmp(line_, echo_, length_) == 0)
+            state_ = State::Body;
+        else
+            stray_++;
+        return;
+    }
+    if (startsWith(line_, length_, "No such pot") || startsWith(line_, length_, "Invalid command"))
+    {
+        finish();
+        sink.onFailed(line_);
+        return;
+    }
+    if (command_ == Command::Status)
+        statusLine(sink);
+    else
+        historyLine(sink);
+}
+
+void ReplyParser::statusLine(ReplySink &sink)
+{
+    StatusLine line = parseStatusLine(line_, length_, status_);
+    if (line == StatusLine::Unknown)
+    {
+        stray_++;
+    }
+    else if (line == StatusLine::Last)
+    {
+        finish();
+        sink.onStatus(status_);
+    }
+}
+
+void ReplyParser::historyLine(ReplySink &sink)
+{
+    if (state_ == State::Body)
+    {
+        if (startsWith(line_, length_, "Moisture Light and Volume"))
+            state_ = State::Values;
+        else
+            stray_++;
+        return;
+    }
+    const char *p = line_;
+    while (history_.count < kHistoryValues)
+    {
+        char *end;
+        unsigned long value = strtoul(p, &end, 10);
+        if (end == p)
+            break;
+        history_.value[history_.count++] = (uint16_t)value;
+        p = end;
+    }
+    finish();
+    sink.onHistory(history_);
+}
+
+}
@@ -0,0 +1,147 @@
+// Reply Parser
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Turns what a pot sends back over its serial link into replies, a read at
+// a time.  Bytes are gathered into a fixed line buffer until a '\n' ('\r'
+// is dropped, since the firmware ends its lines "\n\r" and some "\n"); a
+// line is handled in place and nothing is allocated.
+//
+// The gateway sends one command at a time and calls expect() as it does.
+// The pot echoes the command, so the reply starts at the first line that
+// matches it; lines before that, and lines that arrive with no command
+// outstanding, are counted as stray.  A status reply is:
+//
+//   status
+//   Volume: 212.199997 mililiters
+//   lightpercentage : 62.4
+//   moisturepercentage : 41.0          (or "moisturepercentage N : X" per pot)
+//   pumps : 0                          (a digit per pot, 1 while it runs)
+//   batteryvoltage :  9.1
+//
+// and a History reply is the header "Moisture Light and Volume
+// Respectively" and a line of 15 numbers.  "No such pot" or "Invalid
+// command" in place of a reply fails the command.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_REPLY_H_
+#define GATEWAY_REPLY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gateway {
+
+const unsigned kMaxPots = 8;          // CHANNELS_MAX in the firmware
+const unsigned kHistoryValues = 15;
+
+enum class Command : uint8_t
+{
+    None,
+    Status,
+    History
+};
+
+struct StatusReply
+{
+    float volume;                     // Milliliters
+    float light;                      // Percent
+    float battery;                    // Volts
+    uint8_t pots;
+    bool pumpsReported;               // Firmware from before the pumps line
+                                      // leaves it out
+    uint8_t pumps;                    // Bit per pot, set while its pump runs
+    float moisture[kMaxPots];         // Percent
+};
+
+struct HistoryReply
+{
+    uint8_t pot;                      // 1-based
+    uint8_t count;
+    uint16_t value[kHistoryValues];   // Moisture, light and volume in turn
+};
+
+// Parses a decimal number such as " 41.0", "-3.25" or "212.199997" from
+// text up to end, skipping leading spaces; returns the end of the number,
+// or nullptr if there is none.  Unlike strtof it does no locale lookup and
+// needs no terminator.
+const char *parseDecimal(const char *text, const char *end, float &value);
+
+enum class StatusLine : uint8_t
+{
+    Unknown,
+    Field,
+    Last                              // batteryvoltage, which ends a reply
+};
+
+// Adds a line of a status reply, without its line ending, to reply
+StatusLine parseStatusLine(const char *line, size_t length, StatusReply &reply);
+
+class ReplySink
+{
+public:
+    virtual ~ReplySink() {}
+    virtual void onStatus(const StatusReply &reply) = 0;
+    virtual void onHistory(const HistoryReply &reply) = 0;
+    virtual void onFailed(const char *line) = 0;
+};
+
+class ReplyParser
+{
+public:
+    static const size_t kLineMax = 160;
+
+    ReplyParser() { reset(); }
+
+    // A command of length bytes (without its '\r') has been sent; pot is the
+    // pot a History command asked for
+    void expect(Command command, const char *text, size_t length, uint8_t pot = 1);
+
+    // Forgets the outstanding command and any partial line
+    void reset();
+
+    void feed(const char *data, size_t length, ReplySink &sink);
+
+    bool waiting() const { return command_ != Command::None; }
+
+    // Since construction
+    uint64_t lines() const { return lines_; }
+    uint64_t stray() const { return stray_; }
+    uint64_t overlong() const { return overlong_; }
+
+private:
+    enum class State : uint8_t
+    {
+        Echo,
+        Body,
+        Values                        // History header seen
+    };
+
+    void line(ReplySink &sink);
+    void statusLine(ReplySink &sink);
+    void historyLine(ReplySink &sink);
+    void finish();
+
+    char line_[kLineMax + 1];
+    size_t length_;
+    bool discarding_;                 // Rest of an overlong line
+    Command command_;
+    State state_;
+    char echo_[32];
+    size_t echoLength_;
+    StatusReply status_;
+    HistoryReply history_;
+    uint64_t lines_ = 0;
+    uint64_t stray_ = 0;
+    uint64_t overlong_ = 0;
+};
+
+}
+
+#endif
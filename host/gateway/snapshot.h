@@ -0,0 +1,68 @@
+// Snapshot Buffer
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Hands a value from one writer thread to readers without either waiting
+// on the other: a triple buffer.  The writer fills its back buffer and
+// publishes it by swapping it with the middle one; the reader swaps the
+// middle one for its front buffer when it holds something newer.  Each
+// buffer belongs to one side at a time, so neither ever sees the other
+// half-way through a copy, and a reader that is slow only ever sees an
+// older value.
+//
+// There is one writer and one reader at a time.  Several reader threads
+// must take turns, under a lock of their own that the writer never takes.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_SNAPSHOT_H_
+#define GATEWAY_SNAPSHOT_H_
+
+#include <stdint.h>
+#include <atomic>
+
+namespace gateway {
+
+template <class T>
+class Snapshot
+{
+public:
+    Snapshot() : buffers_(), middle_(1), back_(0), front_(2) {}
+
+    Snapshot(const Snapshot &) = delete;
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    // Writer: fill in the whole of back(), then publish() it
+    T &back() { return buffers_[back_]; }
+
+    void publish()
+    {
+        back_ = middle_.exchange((uint8_t)(back_ | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: the value last published, or T() before the first
+    const T &read()
+    {
+        if (middle_.load(std::memory_order_relaxed) & FRESH)
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return buffers_[front_];
+    }
+
+private:
+    static const uint8_t INDEX = 3;
+    static const uint8_t FRESH = 4;
+
+    T buffers_[3];
+    std::atomic<uint8_t> middle_;     // Index of the middle buffer, and FRESH
+    uint8_t back_;                    // Writer's
+    uint8_t front_;                   // Reader's
+};
+
+}
+
+#endif
@@ -0,0 +1,661 @@
+// Telemetry Store
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "store.h"
+
+namespace gateway {
+
+namespace {
+
+const char DATA_MAGIC[8] = { 'F', 'P', 'D', 'A', 'T', 'A', '0', '1' };
+const char INDEX_MAGIC[8] = { 'F', 'P', 'I', 'N', 'D', 'X', '0', '1' };
+const size_t MAGIC_SIZE = 8;
+
+// Index entries are held back until the chunks they describe are written
+const size_t PENDING_ENTRIES = 4096;
+
+const char *METRIC_NAMES[] = { "moisture", "light", "volume", "battery" };
+
+static_assert(sizeof(ChunkEntry) == 48, "ChunkEntry is an on-disk layout");
+
+uint64_t seriesKey(uint32_t pot, Metric metric)
+{
+    return (uint64_t)pot << 8 | (uint8_t)metric;
+}
+
+int32_t toTenths(float value)
+{
+    return (int32_t)lrintf(value * 10);
+}
+
+// Bits needed for an unsigned value
+unsigned bitsFor(uint32_t value)
+{
+    return value ? 32 - (unsigned)__builtin_clz(value) : 0;
+}
+
+// Appends fields of up to 64 bits, least significant bit first, whole
+// 64-bit words at a time
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+    void put(uint64_t value, unsigned bits)
+    {
+        if (bits == 0)
+            return;
+        if (bits < 64)
+            value &= (1ULL << bits) - 1;
+        word_ |= value << used_;
+        if (used_ + bits >= 64)
+        {
+            emit();
+            word_ = used_ ? value >> (64 - used_) : 0;
+            used_ = used_ + bits - 64;
+        }
+        else
+        {
+            used_ += bits;
+        }
+    }
+
+    // Pads to a whole word
+    void finish()
+    {
+        if (used_)
+            emit();
+        word_ = 0;
+        used_ = 0;
+    }
+
+private:
+    void emit()
+    {
+        uint8_t bytes[8];
+        memcpy(bytes, &word_, 8);
+        out_.insert(out_.end(), bytes, bytes + 8);
+    }
+
+    std::vector<uint8_t> &out_;
+    uint64_t word_ = 0;
+    unsigned used_ = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+    // Up to 57 bits, without consuming them
+    uint64_t peek(unsigned bits) const
+    {
+        size_t byte = position_ >> 3;
+        uint64_t word;
+        if (byte + 8 <= size_)
+        {
+            memcpy(&word, data_ + byte, 8);
+        }
+        else
+        {
+            word = 0;
+            if (byte < size_)
+                memcpy(&word, data_ + byte, size_ - byte);
+        }
+        word >>= position_ & 7;
+        return bits < 64 ? word & ((1ULL << bits) - 1) : word;
+    }
+
+    void skip(unsigned bits) { position_ += bits; }
+
+    uint64_t get(unsigned bits)
+    {
+        if (bits > 56)
+        {
+            uint64_t low = get(32);
+            return low | get(bits - 32) << 32;
+        }
+        uint64_t value = peek(bits);
+        position_ += bits;
+        return value;
+    }
+
+    int64_t getSigned(unsigned bits)
+    {
+        uint64_t value = get(bits);
+        if (bits < 64 && (value >> (bits - 1) & 1))
+            value |= ~0ULL << bits;
+        return (int64_t)value;
+    }
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+// Maps a whole file read-only; a file of size 0 maps to nullptr
+bool mapFile(const std::string &path, const uint8_t *&map, size_t &size, std::string &error)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = (size_t)info.st_size;
+    map = nullptr;
+    if (size)
+    {
+        void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            error = path + ": " + strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        map = (const uint8_t *)address;
+    }
+    ::close(fd);
+    return true;
+}
+
+// Opens a store file for appending and checks or writes its magic; returns
+// its size
+FILE *openAppend(const std::string &path, const char *magic, uint64_t &size, std::string &error)
+{
+    FILE *file = fopen(path.c_str(), "ab+");
+    if (!file)
+    {
+        error = path + ": " + strerror(errno);
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    size = (uint64_t)ftell(file);
+    if (size == 0)
+    {
+        fwrite(magic, 1, MAGIC_SIZE, file);
+        size = MAGIC_SIZE;
+        return file;
+    }
+    char found[MAGIC_SIZE];
+    fseek(file, 0, SEEK_SET);
+    if (fread(found, 1, MAGIC_SIZE, file) != MAGIC_SIZE || memcmp(found, magic, MAGIC_SIZE) != 0)
+    {
+        error = path + ": not a telemetry store";
+        fclose(file);
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    return file;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Metrics
+//-----------------------------------------------------------------------------
+
+const char *metricName(Metric metric)
+{
+    return (unsigned)metric < (unsigned)Metric::Count ? METRIC_NAMES[(unsigned)metric] : "?";
+}
+
+bool parseMetric(const char *name, Metric &metric)
+{
+    for (unsigned i = 0; i < (unsigned)Metric::Count; i++)
+    {
+        if (strcmp(name, METRIC_NAMES[i]) == 0)
+        {
+            metric = (Metric)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// Chunks
+//-----------------------------------------------------------------------------
+
+size_t encodeChunk(const int64_t *times, const int32_t *values, size_t count, std::vector<uint8_t> &out,
+                   ChunkEntry &entry)
+{
+    size_t start = out.size();
+    BitWriter bits(out);
+
+    // Delta of delta: '0' for no change, '10', '110' and '1110' for 7, 9
+    // and 12 bit changes, '1111' for a full 64 bits
+    int64_t delta = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        int64_t next = times[i] - times[i - 1];
+        int64_t change = next - delta;
+        delta = next;
+        if (change == 0)
+        {
+            bits.put(0, 1);
+        }
+        else if (change >= -64 && change < 64)
+        {
+            bits.put(1, 2);
+            bits.put((uint64_t)change, 7);
+        }
+        else if (change >= -256 && change < 256)
+        {
+            bits.put(3, 3);
+            bits.put((uint64_t)change, 9);
+        }
+        else if (change >= -2048 && change < 2048)
+        {
+            bits.put(7, 4);
+            bits.put((uint64_t)change, 12);
+        }
+        else
+        {
+            bits.put(15, 4);
+            bits.put((uint64_t)change, 64);
+        }
+    }
+    bits.finish();
+
+    // The first value, then the change from each value to the next, less
+    // the smallest change
+    int32_t smallest = 0;
+    int32_t largest = 0;
+    for (size_t i = 1; i < count; i++)
+    {
+        int32_t change = values[i] - values[i - 1];
+        smallest = i == 1 ? change : std::min(smallest, change);
+        largest = i == 1 ? change : std::max(largest, change);
+    }
+    unsigned width = bitsFor((uint32_t)(largest - smallest));
+    bits.put((uint32_t)values[0], 32);
+    bits.put((uint32_t)smallest, 32);
+    for (size_t i = 1; i < count; i++)
+        bits.put((uint32_t)(values[i] - values[i - 1] - smallest), width);
+    bits.finish();
+
+    entry.width = (uint8_t)width;
+    entry.count = (uint16_t)count;
+    entry.first = times[0];
+    entry.last = times[count - 1];
+    entry.minimum = *std::min_element(values, values + count);
+    entry.maximum = *std::max_element(values, values + count);
+    entry.lastValue = values[count - 1];
+    entry.size = (uint32_t)(out.size() - start);
+    return entry.size;
+}
+
+void decodeChunk(const uint8_t *chunk, const ChunkEntry &entry, int64_t *times, int32_t *values)
+{
+    size_t valueBytes = 8 + ((size_t)(entry.count - 1) * entry.width + 63) / 64 * 8;
+    size_t timeBytes = entry.size - valueBytes;
+
+    BitReader timeBits(chunk, timeBytes);
+    int64_t time = entry.first;
+    int64_t delta = 0;
+    times[0] = time;
+    unsigned i = 1;
+    while (i < entry.count)
+    {
+        // A run of unchanged gaps, the usual case, is a run of 0 bits
+        uint64_t next = timeBits.peek(56);
+        unsigned zeros = next ? (unsigned)__builtin_ctzll(next) : 56;
+        if (zeros > 1)
+        {
+            unsigned end = i + std::min(zeros, entry.count - i);
+            timeBits.skip(end - i);
+            for (; i < end; i++)
+            {
+                time += delta;
+                times[i] = time;
+            }
+            continue;
+        }
+        unsigned ones = (unsigned)__builtin_ctzll(~next);
+        if (ones == 0)
+        {
+            timeBits.skip(1);
+        }
+        else if (ones == 1)
+        {
+            timeBits.skip(2);
+            delta += timeBits.getSigned(7);
+        }
+        else if (ones == 2)
+        {
+            timeBits.skip(3);
+            delta += timeBits.getSigned(9);
+        }
+        else if (ones == 3)
+        {
+            timeBits.skip(4);
+            delta += timeBits.getSigned(12);
+        }
+        else
+        {
+            timeBits.skip(4);
+            delta += timeBits.getSigned(64);
+        }
+        time += delta;
+        times[i++] = time;
+    }
+
+    BitReader valueBits(chunk + timeBytes, valueBytes);
+    int32_t value = (int32_t)valueBits.get(32);
+    int32_t smallest = (int32_t)valueBits.get(32);
+    values[0] = value;
+    for (unsigned i = 1; i < entry.count; i++)
+    {
+        value += smallest + (int32_t)valueBits.get(entry.width);
+        values[i] = value;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// StoreWriter
+//-----------------------------------------------------------------------------
+
+StoreWriter::~StoreWriter()
+{
+    close();
+}
+
+bool StoreWriter::open(const std::string &directory, std::string &error)
+{
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        error = directory + ": " + strerror(errno);
+        return false;
+    }
+    uint64_t indexSize;
+    data_ = openAppend(directory + "/data", DATA_MAGIC, offset_, error);
+    if (!data_)
+        return false;
+    index_ = openAppend(directory + "/index", INDEX_MAGIC, indexSize, error);
+    if (!index_)
+    {
+        fclose(data_);
+        data_ = nullptr;
+        return false;
+    }
+
+    // Drop a torn entry left by a writer that stopped part way
+    uint64_t whole = MAGIC_SIZE + (indexSize - MAGIC_SIZE) / sizeof(ChunkEntry) * sizeof(ChunkEntry);
+    if (whole != indexSize && ftruncate(fileno(index_), (off_t)whole) != 0)
+    {
+        error = directory + "/index: " + strerror(errno);
+        return false;
+    }
+    setvbuf(data_, nullptr, _IOFBF, 1 << 20);
+    return true;
+}
+
+bool StoreWriter::append(uint32_t pot, Metric metric, int64_t time, float value)
+{
+    uint64_t key = seriesKey(pot, metric);
+    Series &series = series_[key];
+    if (series.times.empty())
+    {
+        series.times.reserve(kChunkSamples);
+        series.values.reserve(kChunkSamples);
+    }
+    series.times.push_back(time);
+    series.values.push_back(toTenths(value));
+    samples_++;
+    if (series.times.size() == kChunkSamples)
+        return seal(key, series);
+    return true;
+}
+
+bool StoreWriter::seal(uint64_t key, Series &series)
+{
+    if (series.times.empty())
+        return true;
+    ChunkEntry entry = {};
+    encoded_.clear();
+    encodeChunk(series.times.data(), series.values.data(), series.times.size(), encoded_, entry);
+    entry.offset = offset_;
+    entry.pot = (uint32_t)(key >> 8);
+    entry.metric = (uint8_t)key;
+    series.times.clear();
+    series.values.clear();
+
+    if (fwrite(encoded_.data(), 1, encoded_.size(), data_) != encoded_.size())
+    {
+        error_ = strerror(errno);
+        return false;
+    }
+    offset_ += encoded_.size();
+    bytes_ += encoded_.size() + sizeof(entry);
+    chunks_++;
+    pending_.push_back(entry);
+    return pending_.size() < PENDING_ENTRIES || writeIndex();
+}
+
+// The chunks go to the kernel before the entries that point at them
+bool StoreWriter::writeIndex()
+{
+    if (fflush(data_) != 0)
+    {
+        error_ = strerror(errno);
+        return false;
+    }
+    if (fwrite(pending_.data(), sizeof(ChunkEntry), pending_.size(), index_) != pending_.size() ||
+        fflush(index_) != 0)
+    {
+        error_ = strerror(errno);
+        return false;
+    }
+    pending_.clear();
+    return true;
+}
+
+bool StoreWriter::flush()
+{
+    if (!data_)
+        return false;
+    for (auto &series : series_)
+        if (!seal(series.first, series.second))
+            return false;
+    return writeIndex();
+}
+
+bool StoreWriter::close()
+{
+    if (!data_)
+        return true;
+    bool ok = flush();
+    fclose(data_);
+    fclose(index_);
+    data_ = nullptr;
+    index_ = nullptr;
+    series_.clear();
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// StoreReader
+//-----------------------------------------------------------------------------
+
+StoreReader::~StoreReader()
+{
+    close();
+}
+
+void StoreReader::close()
+{
+    if (data_)
+        munmap((void *)data_, dataSize_);
+    if (entries_)
+        munmap((void *)((const uint8_t *)entries_ - MAGIC_SIZE), indexSize_);
+    data_ = nullptr;
+    entries_ = nullptr;
+    dataSize_ = 0;
+    indexSize_ = 0;
+    count_ = 0;
+    series_.clear();
+    for (auto &pots : pots_)
+        pots.clear();
+    samples_ = 0;
+    decoded_ = 0;
+}
+
+bool StoreReader::open(const std::string &directory, std::string &error)
+{
+    close();
+    const uint8_t *index;
+    if (!mapFile(directory + "/data", data_, dataSize_, error) ||
+        !mapFile(directory + "/index", index, indexSize_, error))
+        return false;
+    if (dataSize_ < MAGIC_SIZE || memcmp(data_, DATA_MAGIC, MAGIC_SIZE) != 0 ||
+        indexSize_ < MAGIC_SIZE || memcmp(index, INDEX_MAGIC, MAGIC_SIZE) != 0)
+    {
+        if (index)
+            munmap((void *)index, indexSize_);
+        error = directory + ": not a telemetry store";
+        return false;
+    }
+    entries_ = (const ChunkEntry *)(index + MAGIC_SIZE);
+
+    // Entries stop at the first that does not fit, which can only be one
+    // a writer was part way through
+    size_t entries = (indexSize_ - MAGIC_SIZE) / sizeof(ChunkEntry);
+    first_ = INT64_MAX;
+    last_ = INT64_MIN;
+    for (count_ = 0; count_ < entries; count_++)
+    {
+        const ChunkEntry &entry = entries_[count_];
+        if (entry.offset < MAGIC_SIZE || entry.offset + entry.size > dataSize_ || entry.count == 0 ||
+            entry.count > kChunkSamples || entry.metric >= (uint8_t)Metric::Count || entry.width > 32)
+            break;
+        std::vector<uint32_t> &chunks = series_[seriesKey(entry.pot, (Metric)entry.metric)];
+        if (chunks.empty())
+            pots_[entry.metric].push_back(entry.pot);
+        chunks.push_back((uint32_t)count_);
+        samples_ += entry.count;
+        first_ = std::min(first_, entry.first);
+        last_ = std::max(last_, entry.last);
+    }
+    if (count_ == 0)
+        first_ = last_ = 0;
+
+    // A writer seals the chunks of a series in order, so this is only work
+    // for a store that was written to by more than one writer at a time
+    for (auto &series : series_)
+    {
+        std::vector<uint32_t> &chunks = series.second;
+        auto earlier = [this](uint32_t a, uint32_t b) { return entries_[a].first < entries_[b].first; };
+        if (!std::is_sorted(chunks.begin(), chunks.end(), earlier))
+            std::stable_sort(chunks.begin(), chunks.end(), earlier);
+    }
+    for (auto &pots : pots_)
+        std::sort(pots.begin(), pots.end());
+    return true;
+}
+
+size_t StoreReader::query(uint32_t pot, Metric metric, int64_t from, int64_t to, std::vector<Sample> &out) const
+{
+    auto found = series_.find(seriesKey(pot, metric));
+    if (found == series_.end())
+        return 0;
+    const std::vector<uint32_t> &chunks = found->second;
+
+    // The first chunk that ends at or after from
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), from,
+                                  [this](uint32_t i, int64_t time) { return entries_[i].last < time; });
+    size_t before = out.size();
+    int64_t times[kChunkSamples];
+    int32_t values[kChunkSamples];
+    for (; chunk != chunks.end() && entries_[*chunk].first <= to; ++chunk)
+    {
+        const ChunkEntry &entry = entries_[*chunk];
+        decodeChunk(data_ + entry.offset, entry, times, values);
+        decoded_.fetch_add(1, std::memory_order_relaxed);
+        for (unsigned i = 0; i < entry.count; i++)
+            if (times[i] >= from && times[i] <= to)
+                out.push_back({ times[i], (float)values[i] / 10 });
+    }
+    return out.size() - before;
+}
+
+size_t StoreReader::query(uint32_t pot, Metric metric, int64_t from, int64_t to, std::vector<int64_t> &times,
+                          std::vector<int32_t> &values) const
+{
+    auto found = series_.find(seriesKey(pot, metric));
+    if (found == series_.end())
+        return 0;
+    const std::vector<uint32_t> &chunks = found->second;
+
+    // Chunks are decoded straight into the columns, and only the two at the
+    // ends of the range need trimming
+    auto chunk = std::lower_bound(chunks.begin(), chunks.end(), from,
+                                  [this](uint32_t i, int64_t time) { return entries_[i].last < time; });
+    size_t before = times.size();
+    for (; chunk != chunks.end() && entries_[*chunk].first <= to; ++chunk)
+    {
+        const ChunkEntry &entry = entries_[*chunk];
+        size_t at = times.size();
+        times.resize(at + entry.count);
+        values.resize(at + entry.count);
+        decodeChunk(data_ + entry.offset, entry, &times[at], &values[at]);
+        decoded_.fetch_add(1, std::memory_order_relaxed);
+        if (entry.first < from || entry.last > to)
+        {
+            size_t kept = at;
+            for (size_t i = at; i < times.size(); i++)
+            {
+                if (times[i] >= from && times[i] <= to)
+                {
+                    times[kept] = times[i];
+                    values[kept++] = values[i];
+                }
+            }
+            times.resize(kept);
+            values.resize(kept);
+        }
+    }
+    return times.size() - before;
+}
+
+void StoreReader::latest(Metric metric, std::vector<std::pair<uint32_t, Sample>> &out) const
+{
+    for (uint32_t pot : pots_[(unsigned)metric])
+    {
+        const ChunkEntry &entry = entries_[series_.at(seriesKey(pot, metric)).back()];
+        out.push_back({ pot, { entry.last, (float)entry.lastValue / 10 } });
+    }
+}
+
+void StoreReader::below(Metric metric, float threshold, std::vector<std::pair<uint32_t, Sample>> &out) const
+{
+    int32_t limit = toTenths(threshold);
+    for (uint32_t pot : pots_[(unsigned)metric])
+    {
+        const ChunkEntry &entry = entries_[series_.at(seriesKey(pot, metric)).back()];
+        if (entry.lastValue < limit)
+            out.push_back({ pot, { entry.last, (float)entry.lastValue / 10 } });
+    }
+}
+
+}
@@ -0,0 +1,206 @@
+// Telemetry Store
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// An append-only columnar store for what the gateway reads from pots.  A
+// series is one metric of one pot; its samples are cut into chunks of up to
+// kChunkSamples, and each chunk holds its timestamps and its values as two
+// separate bit streams:
+//
+//   timestamps  milliseconds; the first in full, then each as the change
+//               in the gap between samples (delta of delta), in 1 bit when
+//               the gap is unchanged and in 9, 12, 16 or 68 bits otherwise
+//   values      tenths, to which the firmware prints all but the volume;
+//               the first in full, then the change from each to the next,
+//               less the smallest change, in just enough bits for the
+//               largest (frame of reference bit packing of the deltas)
+//
+// A pot polled every minute with the same few values costs one bit or two
+// per sample.
+//
+// A store is a directory of two files.  "data" holds the chunks one after
+// another; "index" holds a fixed-size entry per chunk with its series, time
+// span, value range and last value.  Both are only ever appended to, and a
+// chunk's index entry is written after the chunk, so a reader that finds an
+// entry finds its chunk whole; a torn entry at the end of the index, from a
+// writer that stopped part way, is ignored.  The reader maps both files and
+// keeps, per series, its chunks in time order.  A range query reads only
+// the index entries that overlap the range and decodes only those chunks;
+// "which pots are below X now" reads only the last index entry of each
+// series.
+//
+// Samples of a series must be appended in time order.  The writer keeps up
+// to a chunk of samples of every series in memory until the chunk is full,
+// or until flush(), which writes out every partial chunk.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef GATEWAY_STORE_H_
+#define GATEWAY_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gateway {
+
+enum class Metric : uint8_t
+{
+    Moisture,                         // Percent
+    Light,                            // Percent
+    Volume,                           // Milliliters
+    Battery,                          // Volts
+    Count
+};
+
+const char *metricName(Metric metric);
+bool parseMetric(const char *name, Metric &metric);
+
+const unsigned kChunkSamples = 1024;
+
+struct Sample
+{
+    int64_t time;                     // Unix milliseconds
+    float value;
+};
+
+// What the index holds per chunk, as it is on disk
+struct ChunkEntry
+{
+    uint64_t offset;                  // In the data file
+    uint32_t pot;
+    uint8_t metric;
+    uint8_t width;                    // Bits per value after the first
+    uint16_t count;
+    int64_t first;                    // Time of the first sample
+    int64_t last;                     // And the last
+    int32_t minimum;                  // Tenths
+    int32_t maximum;
+    int32_t lastValue;
+    uint32_t size;                    // Bytes in the data file
+};
+
+// Encodes samples (times in order, values in tenths) as a chunk; returns
+// its size
+size_t encodeChunk(const int64_t *times, const int32_t *values, size_t count, std::vector<uint8_t> &out,
+                   ChunkEntry &entry);
+
+// Decodes a chunk that encodeChunk() made
+void decodeChunk(const uint8_t *chunk, const ChunkEntry &entry, int64_t *times, int32_t *values);
+
+class StoreWriter
+{
+public:
+    StoreWriter() {}
+    ~StoreWriter();
+
+    StoreWriter(const StoreWriter &) = delete;
+    StoreWriter &operator=(const StoreWriter &) = delete;
+
+    // Creates the directory if need be and appends to what is there
+    bool open(const std::string &directory, std::string &error);
+
+    // Appends a sample; false if a write failed
+    bool append(uint32_t pot, Metric metric, int64_t time, float value);
+
+    // Writes every partial chunk out and the files to the kernel
+    bool flush();
+    bool close();
+
+    const std::string &error() const { return error_; }
+
+    // Since open()
+    uint64_t samples() const { return samples_; }
+    uint64_t chunks() const { return chunks_; }
+    uint64_t bytes() const { return bytes_; }
+
+private:
+    struct Series
+    {
+        std::vector<int64_t> times;
+        std::vector<int32_t> values;
+    };
+
+    bool seal(uint64_t key, Series &series);
+    bool writeIndex();
+
+    FILE *data_ = nullptr;
+    FILE *index_ = nullptr;
+    uint64_t offset_ = 0;
+    std::unordered_map<uint64_t, Series> series_;
+    std::vector<uint8_t> encoded_;
+    std::vector<ChunkEntry> pending_;  // Entries of chunks not yet flushed
+    std::string error_;
+    uint64_t samples_ = 0;
+    uint64_t chunks_ = 0;
+    uint64_t bytes_ = 0;
+};
+
+class StoreReader
+{
+public:
+    StoreReader() {}
+    ~StoreReader();
+
+    StoreReader(const StoreReader &) = delete;
+    StoreReader &operator=(const StoreReader &) = delete;
+
+    // Maps what the store holds now
+    bool open(const std::string &directory, std::string &error);
+    void close();
+
+    uint64_t samples() const { return samples_; }
+    size_t chunks() const { return count_; }
+    size_t series() const { return series_.size(); }
+    uint64_t dataBytes() const { return dataSize_; }
+    int64_t first() const { return first_; }
+    int64_t last() const { return last_; }
+
+    // Appends the samples of a pot's metric from from to to, inclusive;
+    // returns how many
+    size_t query(uint32_t pot, Metric metric, int64_t from, int64_t to, std::vector<Sample> &out) const;
+
+    // The same into separate columns, values in tenths as stored
+    size_t query(uint32_t pot, Metric metric, int64_t from, int64_t to, std::vector<int64_t> &times,
+                 std::vector<int32_t> &values) const;
+
+    // Pots that have the metric, in order
+    const std::vector<uint32_t> &pots(Metric metric) const { return pots_[(unsigned)metric]; }
+
+    // Last sample of every pot that has the metric, in pot order
+    void latest(Metric metric, std::vector<std::pair<uint32_t, Sample>> &out) const;
+
+    // Pots whose last sample of the metric is below threshold
+    void below(Metric metric, float threshold, std::vector<std::pair<uint32_t, Sample>> &out) const;
+
+    // Chunks decoded since open(); queries may run on several threads at once
+    uint64_t decoded() const { return decoded_.load(std::memory_order_relaxed); }
+
+private:
+    const uint8_t *data_ = nullptr;
+    size_t dataSize_ = 0;
+    const ChunkEntry *entries_ = nullptr;
+    size_t indexSize_ = 0;
+    size_t count_ = 0;
+
+    // Index entries of each series in time order
+    std::unordered_map<uint64_t, std::vector<uint32_t>> series_;
+    std::vector<uint32_t> pots_[(unsigned)Metric::Count];
+    uint64_t samples_ = 0;
+    int64_t first_ = 0;
+    int64_t last_ = 0;
+    mutable std::atomic<uint64_t> decoded_{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,302 @@
+// Telemetry Store Benchmark
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Fills a telemetry store (store.h) with a fleet's readings and times
+// ingest, opening and the two queries the store is for: one pot's moisture
+// over the last week, and every pot whose volume is below 50 ml now.
+//
+//   flowerpot_store_bench [--pots N] [--samples N] [--period SECONDS]
+//                         [--jitter MS] [--queries N] [--dir DIRECTORY]
+//                         [--keep]
+//
+//   --pots     pots (default 1000)
+//   --samples  samples of each metric of each pot (default 10080, a week
+//              at one a minute)
+//   --period   seconds between a pot's samples (default 60)
+//   --jitter   each timestamp is off by up to this many milliseconds either
+//              way, as a gateway's reply times are (default 2)
+//   --queries  week queries to time, each for a random pot (default 1000)
+//   --dir      store to write (default /tmp/flowerpot_store_bench); it is
+//              emptied first and removed after unless --keep
+//
+// Samples arrive as a gateway would store them, every metric of every pot
+// for one poll before the next poll.  The readings follow a day's light, a
+// two-day drying cycle and a weekly refill with a little noise, all worked
+// out from the pot and sample number so every sample a query returns is
+// checked against what was stored; the exit status is 1 if any differ.
+//
+// --pots 10000 --samples 25000 makes a billion samples.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "store.h"
+
+namespace {
+
+const int64_t START_MS = 1767225600000;   // 2026-01-01
+const int64_t WEEK_MS = 7 * 86400000LL;
+
+struct Options
+{
+    uint32_t pots = 1000;
+    uint32_t samples = 10080;
+    uint32_t period = 60;
+    uint32_t jitter = 2;
+    unsigned queries = 1000;
+    std::string directory = "/tmp/flowerpot_store_bench";
+    bool keep = false;
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_store_bench [--pots N] [--samples N] [--period SECONDS]\n"
+        "                             [--jitter MS] [--queries N] [--dir DIRECTORY]\n"
+        "                             [--keep]\n");
+    exit(2);
+}
+
+uint32_t mix(uint32_t pot, uint32_t sample, uint32_t salt)
+{
+    uint64_t x = (uint64_t)pot << 32 ^ sample ^ (uint64_t)salt << 56;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+}
+
+int64_t sampleTime(const Options &options, uint32_t pot, uint32_t sample)
+{
+    int64_t jitter = options.jitter ? (int64_t)(mix(pot, sample, 9) % (2 * options.jitter + 1)) - options.jitter : 0;
+    return START_MS + (int64_t)sample * options.period * 1000 + pot * 7 + jitter;
+}
+
+// In tenths
+int32_t sampleValue(const Options &options, uint32_t pot, gateway::Metric metric, uint32_t sample)
+{
+    int64_t seconds = (int64_t)sample * options.period + pot * 977;
+    int32_t noise = (int32_t)(mix(pot, sample, (uint32_t)metric) % 3) - 1;
+    switch (metric)
+    {
+    case gateway::Metric::Moisture:
+        return 600 - (int32_t)(300 * (seconds % 172800) / 172800) + noise;
+    case gateway::Metric::Light:
+    {
+        double day = (double)(seconds % 86400) / 86400;
+        if (day < 0.25 || day > 0.75)
+            return 0;
+        return (int32_t)(900 * sin(M_PI * (day - 0.25) * 2)) + noise;
+    }
+    case gateway::Metric::Volume:
+        return 15000 - (int32_t)(15000 * (seconds % 604800) / 604800) + noise;
+    default:
+        return 91 + noise;
+    }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void removeStore(const std::string &directory)
+{
+    unlink((directory + "/data").c_str());
+    unlink((directory + "/index").c_str());
+    rmdir(directory.c_str());
+}
+
+// Every sample of a query against the model; the samples asked for are a
+// run of whole sample numbers
+bool check(const Options &options, uint32_t pot, gateway::Metric metric, int64_t from, int64_t to,
+           const std::vector<gateway::Sample> &samples)
+{
+    size_t next = 0;
+    for (uint32_t sample = 0; sample < options.samples; sample++)
+    {
+        int64_t time = sampleTime(options, pot, sample);
+        if (time < from || time > to)
+            continue;
+        if (next == samples.size() || samples[next].time != time ||
+            lrintf(samples[next].value * 10) != sampleValue(options, pot, metric, sample))
+        {
+            fprintf(stderr, "pot %u %s sample %u: wrong or missing\n", pot, gateway::metricName(metric), sample);
+            return false;
+        }
+        next++;
+    }
+    if (next != samples.size())
+    {
+        fprintf(stderr, "pot %u %s: %zu samples too many\n", pot, gateway::metricName(metric), samples.size() - next);
+        return false;
+    }
+    return true;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--keep") == 0)
+        {
+            options.keep = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            options.pots = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--samples") == 0)
+            options.samples = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--period") == 0)
+            options.period = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--jitter") == 0)
+            options.jitter = (uint32_t)atoi(value);
+        else if (strcmp(arg, "--queries") == 0)
+            options.queries = (unsigned)atoi(value);
+        else if (strcmp(arg, "--dir") == 0)
+            options.directory = value;
+        else
+            usage();
+    }
+    if (options.pots == 0 || options.samples == 0 || options.period == 0 ||
+        options.jitter * 2 >= options.period * 1000)
+        usage();
+
+    // Ingest
+    removeStore(options.directory);
+    std::string error;
+    gateway::StoreWriter writer;
+    if (!writer.open(options.directory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t sample = 0; sample < options.samples; sample++)
+    {
+        for (uint32_t pot = 0; pot < options.pots; pot++)
+        {
+            int64_t time = sampleTime(options, pot, sample);
+            for (unsigned m = 0; m < (unsigned)gateway::Metric::Count; m++)
+            {
+                gateway::Metric metric = (gateway::Metric)m;
+                if (!writer.append(pot, metric, time, (float)sampleValue(options, pot, metric, sample) / 10))
+                {
+                    fprintf(stderr, "%s\n", writer.error().c_str());
+                    return 1;
+                }
+            }
+        }
+    }
+    if (!writer.close())
+    {
+        fprintf(stderr, "%s\n", writer.error().c_str());
+        return 1;
+    }
+    double ingest = secondsSince(start);
+    double samples = (double)writer.samples();
+    printf("ingest  %.0f samples in %.2f s: %.1f M samples/s, %.1f ns each\n", samples, ingest,
+           samples / ingest / 1e6, 1e9 * ingest / samples);
+    printf("size    %llu chunks, %.1f MB, %.3f bytes per sample\n", (unsigned long long)writer.chunks(),
+           (double)writer.bytes() / 1e6, (double)writer.bytes() / samples);
+
+    // Open
+    start = std::chrono::steady_clock::now();
+    gateway::StoreReader reader;
+    if (!reader.open(options.directory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    printf("open    %.2f ms for %zu series\n", 1e3 * secondsSince(start), reader.series());
+
+    // One pot's moisture over the last week, for random pots
+    bool ok = true;
+    std::mt19937 random(1);
+    std::vector<gateway::Sample> result;
+    std::vector<double> times;
+    uint64_t returned = 0;
+    int64_t to = reader.last();
+    for (unsigned q = 0; q < options.queries; q++)
+    {
+        uint32_t pot = random() % options.pots;
+        result.clear();
+        start = std::chrono::steady_clock::now();
+        reader.query(pot, gateway::Metric::Moisture, to - WEEK_MS, to, result);
+        times.push_back(1e3 * secondsSince(start));
+        returned += result.size();
+        if (q < 20)
+            ok = ok && check(options, pot, gateway::Metric::Moisture, to - WEEK_MS, to, result);
+    }
+    if (!times.empty())
+    {
+        std::sort(times.begin(), times.end());
+        printf("week    %u queries, %.0f samples each: median %.3f ms, max %.3f ms (%llu chunks decoded)\n",
+               options.queries, (double)returned / options.queries, times[times.size() / 2], times.back(),
+               (unsigned long long)reader.decoded());
+    }
+
+    // Every pot with less than 50 ml left
+    std::vector<std::pair<uint32_t, gateway::Sample>> low;
+    start = std::chrono::steady_clock::now();
+    reader.below(gateway::Metric::Volume, 50, low);
+    printf("below   %zu of %u pots under 50 ml in %.3f ms\n", low.size(), options.pots,
+           1e3 * secondsSince(start));
+    uint32_t last = options.samples - 1;
+    size_t expected = 0;
+    for (uint32_t pot = 0; pot < options.pots; pot++)
+        expected += sampleValue(options, pot, gateway::Metric::Volume, last) < 500;
+    if (low.size() != expected)
+    {
+        fprintf(stderr, "below: %zu pots, expected %zu\n", low.size(), expected);
+        ok = false;
+    }
+
+    // Whole series of a few pots, every metric
+    for (uint32_t pot = 0; pot < std::min<uint32_t>(options.pots, 4) && ok; pot++)
+    {
+        for (unsigned m = 0; m < (unsigned)gateway::Metric::Count && ok; m++)
+        {
+            result.clear();
+            reader.query(pot * (options.pots / 4 + 1) % options.pots, (gateway::Metric)m, INT64_MIN, INT64_MAX,
+                         result);
+            ok = check(options, pot * (options.pots / 4 + 1) % options.pots, (gateway::Metric)m, INT64_MIN,
+                       INT64_MAX, result);
+        }
+    }
+    printf("check   %s\n", ok ? "ok" : "FAILED");
+
+    reader.close();
+    if (!options.keep)
+        removeStore(options.directory);
+    return ok ? 0 : 1;
+}
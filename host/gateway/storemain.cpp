@@ -0,0 +1,147 @@
+// Telemetry Store Queries
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Answers questions from a telemetry store (see store.h), such as the one
+// flowerpot_gateway --store writes.
+//
+//   flowerpot_store DIRECTORY info
+//   flowerpot_store DIRECTORY series POT METRIC [--days D]
+//   flowerpot_store DIRECTORY latest METRIC
+//   flowerpot_store DIRECTORY below METRIC VALUE
+//
+//   info    samples, series, chunks, size and time span
+//   series  a pot's samples of a metric over the last D days of the store
+//           (default 7), as TIME,VALUE lines
+//   latest  every pot's last sample of a metric, as POT,TIME,VALUE lines
+//   below   the pots whose last sample of a metric is below VALUE
+//
+// METRIC is moisture, light, volume or battery; TIME is Unix milliseconds.
+// How long the store took to open and the query took goes to stderr.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "store.h"
+
+namespace {
+
+const int64_t DAY_MS = 86400000;
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_store DIRECTORY info\n"
+        "       flowerpot_store DIRECTORY series POT METRIC [--days D]\n"
+        "       flowerpot_store DIRECTORY latest METRIC\n"
+        "       flowerpot_store DIRECTORY below METRIC VALUE\n");
+    exit(2);
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+gateway::Metric metricArgument(const char *name)
+{
+    gateway::Metric metric;
+    if (!gateway::parseMetric(name, metric))
+    {
+        fprintf(stderr, "unknown metric %s\n", name);
+        exit(2);
+    }
+    return metric;
+}
+
+void printPots(const std::vector<std::pair<uint32_t, gateway::Sample>> &pots)
+{
+    for (const auto &pot : pots)
+        printf("%u,%lld,%.1f\n", pot.first, (long long)pot.second.time, pot.second.value);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+        usage();
+    const char *directory = argv[1];
+    const char *command = argv[2];
+
+    auto start = std::chrono::steady_clock::now();
+    gateway::StoreReader store;
+    std::string error;
+    if (!store.open(directory, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    fprintf(stderr, "opened in %.2f ms\n", millisecondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    if (strcmp(command, "info") == 0 && argc == 3)
+    {
+        printf("%llu samples in %zu series, %zu chunks, %llu bytes (%.2f bytes per sample)\n",
+               (unsigned long long)store.samples(), store.series(), store.chunks(),
+               (unsigned long long)store.dataBytes(),
+               store.samples() ? (double)store.dataBytes() / (double)store.samples() : 0.0);
+        printf("from %lld to %lld (%.2f days)\n", (long long)store.first(), (long long)store.last(),
+               (double)(store.last() - store.first()) / DAY_MS);
+    }
+    else if (strcmp(command, "series") == 0 && (argc == 5 || argc == 7))
+    {
+        double days = 7;
+        if (argc == 7)
+        {
+            if (strcmp(argv[5], "--days") != 0)
+                usage();
+            days = atof(argv[6]);
+        }
+        std::vector<gateway::Sample> samples;
+        int64_t to = store.last();
+        store.query((uint32_t)strtoul(argv[3], nullptr, 0), metricArgument(argv[4]),
+                    to - (int64_t)(days * DAY_MS), to, samples);
+        double query = millisecondsSince(start);
+        for (const gateway::Sample &sample : samples)
+            printf("%lld,%.1f\n", (long long)sample.time, sample.value);
+        fprintf(stderr, "%zu samples from %llu chunks in %.3f ms\n", samples.size(),
+                (unsigned long long)store.decoded(), query);
+    }
+    else if (strcmp(command, "latest") == 0 && argc == 4)
+    {
+        std::vector<std::pair<uint32_t, gateway::Sample>> pots;
+        store.latest(metricArgument(argv[3]), pots);
+        double query = millisecondsSince(start);
+        printPots(pots);
+        fprintf(stderr, "%zu pots in %.3f ms\n", pots.size(), query);
+    }
+    else if (strcmp(command, "below") == 0 && argc == 5)
+    {
+        std::vector<std::pair<uint32_t, gateway::Sample>> pots;
+        store.below(metricArgument(argv[3]), (float)atof(argv[4]), pots);
+        double query = millisecondsSince(start);
+        printPots(pots);
+        fprintf(stderr, "%zu pots in %.3f ms\n", pots.size(), query);
+    }
+    else
+    {
+        usage();
+    }
+    return 0;
+}
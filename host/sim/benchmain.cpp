@@ -0,0 +1,238 @@
+// Benchmark Runner
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs the benchmark build of the firmware (bench.h) and prints its report,
+// or compares two reports.
+//
+//   flowerpot_bench [--uart] [--output FILE] [--baseline FILE] [--threshold PCT]
+//   flowerpot_bench --compare OLD NEW [--threshold PCT]
+//
+//   --uart       copy all of the firmware's UART output to stderr
+//   --output     write the report to FILE instead of stdout
+//   --baseline   compare the report with an earlier one
+//   --compare    compare two saved reports
+//   --threshold  median increase counted as a regression, in percent
+//                (default 10)
+//
+// A report is the "bench," lines of the output, so a serial log from the
+// target can be compared as it is.  Comparisons are by median, routine and
+// clock; the exit status is 1 if any median regressed.  Simulated cycles
+// are exact and repeat from run to run, so they also diff cleanly between
+// builds; host nanoseconds vary with the machine and its load.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "firmware.h"
+#include "scenario.h"
+
+namespace {
+
+// The benchmark build finishes well within this
+const uint64_t LIMIT_CYCLES = 3600 * sim::kCyclesPerSecond;
+
+const char PREFIX[] = "bench,";
+
+struct Result
+{
+    std::string routine;
+    std::string clock;
+    unsigned long runs;
+    unsigned long min;
+    unsigned long median;
+    unsigned long p99;
+};
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: flowerpot_bench [--uart] [--output FILE] [--baseline FILE] [--threshold PCT]\n"
+            "       flowerpot_bench --compare OLD NEW [--threshold PCT]\n");
+    exit(2);
+}
+
+// Result lines of a report; the header and any other text are skipped
+std::vector<Result> parseReport(const std::string &text)
+{
+    std::vector<Result> results;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        std::string clean;
+        for (char c : line)
+            if (c != '\r')
+                clean += c;
+        if (clean.compare(0, sizeof(PREFIX) - 1, PREFIX) != 0)
+            continue;
+
+        char routine[64], clock[16];
+        Result result;
+        if (sscanf(clean.c_str() + sizeof(PREFIX) - 1, "%63[^,],%15[^,],%lu,%lu,%lu,%lu", routine, clock,
+                   &result.runs, &result.min, &result.median, &result.p99) != 6)
+            continue;
+        result.routine = routine;
+        result.clock = clock;
+        results.push_back(result);
+    }
+    return results;
+}
+
+bool readFile(const char *path, std::string &text, std::string &error)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, length);
+    fclose(file);
+    return true;
+}
+
+const Result *find(const std::vector<Result> &results, const Result &like)
+{
+    for (const Result &result : results)
+        if (result.routine == like.routine && result.clock == like.clock)
+            return &result;
+    return nullptr;
+}
+
+// Returns the number of regressions
+unsigned compare(const std::vector<Result> &before, const std::vector<Result> &after, double threshold)
+{
+    unsigned regressions = 0;
+    printf("%-14s %-8s %12s %12s %9s\n", "routine", "clock", "old median", "new median", "change");
+    for (const Result &result : after)
+    {
+        const Result *old = find(before, result);
+        if (!old)
+        {
+            printf("%-14s %-8s %12s %12lu %9s\n", result.routine.c_str(), result.clock.c_str(), "-",
+                   result.median, "new");
+            continue;
+        }
+        double change = old->median ? 100.0 * ((double)result.median - old->median) / old->median : 0;
+        bool regressed = result.median > old->median && change > threshold;
+        printf("%-14s %-8s %12lu %12lu %+8.1f%%%s\n", result.routine.c_str(), result.clock.c_str(),
+               old->median, result.median, change, regressed ? "  REGRESSION" : "");
+        if (regressed)
+            regressions++;
+    }
+    for (const Result &result : before)
+        if (!find(after, result))
+            printf("%-14s %-8s %12lu %12s %9s\n", result.routine.c_str(), result.clock.c_str(),
+                   result.median, "-", "gone");
+    return regressions;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    bool echoUart = false;
+    const char *output = nullptr;
+    const char *baseline = nullptr;
+    const char *oldReport = nullptr;
+    const char *newReport = nullptr;
+    double threshold = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--uart") == 0)
+            echoUart = true;
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baseline = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc)
+        {
+            oldReport = argv[++i];
+            newReport = argv[++i];
+        }
+        else
+            usage();
+    }
+
+    std::string error;
+    if (oldReport)
+    {
+        std::string before, after;
+        if (!readFile(oldReport, before, error) || !readFile(newReport, after, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        return compare(parseReport(before), parseReport(after), threshold) ? 1 : 0;
+    }
+
+    sim::StaticBoard board;
+    sim::Simulation simulation(board, sim::flowerpotFirmware());
+    std::string text;
+    simulation.machine().setTxSink([&](uint8_t c)
+    {
+        text += (char)c;
+        if (echoUart)
+            fputc(c, stderr);
+    });
+    while (!simulation.halted() && simulation.machine().now() < LIMIT_CYCLES)
+        simulation.runFor(sim::kCyclesPerSecond);
+    if (!simulation.halted())
+    {
+        fprintf(stderr, "benchmarks did not finish in %s\n", sim::formatTime(LIMIT_CYCLES).c_str());
+        return 1;
+    }
+
+    std::vector<Result> results = parseReport(text);
+    FILE *file = output ? fopen(output, "w") : stdout;
+    if (!file)
+    {
+        perror(output);
+        return 1;
+    }
+    fprintf(file, "%sroutine,clock,n,min,median,p99\n", PREFIX);
+    for (const Result &result : results)
+        fprintf(file, "%s%s,%s,%lu,%lu,%lu,%lu\n", PREFIX, result.routine.c_str(), result.clock.c_str(),
+                result.runs, result.min, result.median, result.p99);
+    if (output)
+        fclose(file);
+
+    if (baseline)
+    {
+        std::string before;
+        if (!readFile(baseline, before, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        return compare(parseReport(before), results, threshold) ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Capture Recorder
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, EK-TM4C123GXL on a serial port
+
+// Reads the UART0 stream of a device that is capturing (see capture.h in the
+// firmware and replay.h) and writes it to a capture file for
+// flowerpot_replay.  The device's text output is copied to stdout.
+//
+//   flowerpot_capture [--baud N] [--quiet] SOURCE CAPTURE
+//
+//   SOURCE   serial port (set to raw 8N1 at --baud, default 115200), a
+//            file holding a raw UART0 stream, or - for stdin
+//   --quiet  do not copy the device's text to stdout
+//
+// Arm the device with "capture ON" and reset it with this running.  Stop
+// with Ctrl-C; the file is complete up to the last whole record.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <string>
+
+#include "replay.h"
+
+namespace {
+
+volatile sig_atomic_t interrupted = 0;
+
+void usage()
+{
+    fprintf(stderr, "usage: flowerpot_capture [--baud N] [--quiet] SOURCE CAPTURE\n");
+    exit(2);
+}
+
+void onInterrupt(int)
+{
+    interrupted = 1;
+}
+
+speed_t baudConstant(unsigned baud)
+{
+    switch (baud)
+    {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return B0;
+    }
+}
+
+bool configureSerial(int fd, unsigned baud, std::string &error)
+{
+    struct termios tty;
+    speed_t speed = baudConstant(baud);
+    if (speed == B0)
+    {
+        error = "unsupported baud rate";
+        return false;
+    }
+    if (tcgetattr(fd, &tty) != 0)
+    {
+        error = strerror(errno);
+        return false;
+    }
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tty) != 0)
+    {
+        error = strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    unsigned baud = 115200;
+    bool quiet = false;
+    const char *source = nullptr;
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--quiet") == 0)
+            quiet = true;
+        else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+            baud = (unsigned)atoi(argv[++i]);
+        else if (!source)
+            source = argv[i];
+        else if (!output)
+            output = argv[i];
+        else
+            usage();
+    }
+    if (!source || !output)
+        usage();
+
+    int fd = strcmp(source, "-") == 0 ? 0 : open(source, O_RDONLY | O_NOCTTY);
+    if (fd < 0)
+    {
+        perror(source);
+        return 1;
+    }
+    std::string error;
+    if (isatty(fd) && !configureSerial(fd, baud, error))
+    {
+        fprintf(stderr, "%s: %s\n", source, error.c_str());
+        return 1;
+    }
+
+    sim::CaptureWriter writer;
+    if (!writer.open(output, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    uint64_t kinds[sim::CAP_KINDS] = {};
+    uint64_t first = 0, last = 0;
+    bool timed = false;
+    sim::CaptureDecoder decoder(
+        [&](const sim::CaptureRecord &record)
+        {
+            if (record.kind != sim::CAP_TX && record.kind != sim::CAP_STATS)
+            {
+                if (!timed)
+                    first = record.time;
+                timed = true;
+                last = record.time;
+            }
+            kinds[record.kind]++;
+            writer.write(record);
+        },
+        [quiet](uint8_t c)
+        {
+            if (!quiet)
+                putchar(c);
+        });
+
+    struct sigaction action = {};
+    action.sa_handler = onInterrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    uint8_t buffer[4096];
+    while (!interrupted)
+    {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            break;
+        decoder.put(buffer, (size_t)length);
+        if (!quiet)
+            fflush(stdout);
+    }
+    decoder.flush();
+    if (fd != 0)
+        close(fd);
+    if (!writer.close(error))
+    {
+        fprintf(stderr, "%s: %s\n", output, error.c_str());
+        return 1;
+    }
+
+    fprintf(stderr, "%llu records over %.3f s:", (unsigned long long)decoder.records(),
+            (double)(last - first) / sim::kCaptureTicksPerSecond);
+    for (unsigned kind = 0; kind < sim::CAP_KINDS; kind++)
+        if (kinds[kind])
+            fprintf(stderr, " %llu %s", (unsigned long long)kinds[kind], sim::captureKindName(kind));
+    fprintf(stderr, "\n");
+    if (!kinds[sim::CAP_BOOT])
+        fprintf(stderr, "no BOOT record: reset the device while capturing to replay from power-on\n");
+    return 0;
+}
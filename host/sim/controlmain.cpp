@@ -0,0 +1,204 @@
+// Control Comparison
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs the same pots under each watering policy (channel.h) and compares
+// the water they use and how long the soil spends outside the band from
+// the level to band above it.  The band is judged on the soil itself, not
+// on the probe, so a lagging probe (--set probe-lag=SECONDS) shows up as
+// overshoot.  What the soil drained below and what it holds at the end
+// over what it started with account for the water not transpired.
+//
+//   flowerpot_control [--days N] [--pots N] [--level PCT] [--band PCT]
+//                     [--set NAME=VALUE]...
+//
+//   --days   virtual days to run each policy (default 3)
+//   --pots   pots on the board (default 4)
+//   --level  moisture level the pots are watered below (default 30)
+//   --band   width of the band above it, in percent (default 10)
+//   --set    override a plant parameter (see flowerpot_plant --list)
+//
+// The window is set to the whole day.  After the run each policy's "control" reply is shown,
+// with the gain and settle time the controller learned for each pot.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#include "firmware.h"
+#include "plant.h"
+#include "simulation.h"
+
+namespace {
+
+const uint64_t SAMPLE_CYCLES = 10 * sim::kCyclesPerSecond;
+const uint64_t DAY_SECONDS = 86400;
+
+struct Options
+{
+    double days = 3;
+    unsigned pots = 4;
+    double level = 30;
+    double band = 10;
+};
+
+struct Result
+{
+    double pumpedMl = 0;
+    double transpiredMl = 0;
+    double drainedMl = 0;
+    double storedMl = 0;              // Left in the soil over what it started with
+    uint64_t pumpRuns = 0;
+    double pumpSeconds = 0;
+    double below = 0;                 // pot-seconds under the level
+    double above = 0;                 // pot-seconds over the band
+    double total = 0;
+    double peak = 0;                  // highest soil moisture, percent
+    std::string control;              // reply to "control"
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_control [--days N] [--pots N] [--level PCT] [--band PCT]\n"
+        "                         [--set NAME=VALUE]...\n");
+    exit(2);
+}
+
+void send(sim::Machine &machine, uint64_t when, const std::string &text)
+{
+    machine.schedule(when, [text](sim::Machine &m) { m.receive(text.data(), text.size()); });
+}
+
+Result run(const sim::PlantParameters &parameters, const Options &options, const char *policy)
+{
+    Result result;
+    sim::PlantBoard board(parameters, options.pots);
+    sim::Simulation simulation(board, sim::flowerpotFirmware());
+    sim::Machine &machine = simulation.machine();
+    machine.setRxFlowControl(true);
+    machine.setRtc((uint32_t)(parameters.startHour * 3600));
+
+    std::string text;
+    bool keep = false;
+    machine.setTxSink([&text, &keep](uint8_t c) { if (keep) text += (char)c; });
+
+    char setup[128];
+    snprintf(setup, sizeof(setup), "control %s\rpots %u\rLEVEL %d\rwater 0 0 23 59\r", policy, options.pots,
+             (int)options.level);
+    send(machine, sim::kCyclesPerSecond, setup);
+
+    std::function<void(sim::Machine &)> sample = [&](sim::Machine &m)
+    {
+        uint64_t now = m.now();
+        for (unsigned pot = 0; pot < options.pots; pot++)
+        {
+            double moisture = board.moisturePercent(now, pot);
+            if (moisture < options.level)
+                result.below += (double)SAMPLE_CYCLES / sim::kCyclesPerSecond;
+            else if (moisture > options.level + options.band)
+                result.above += (double)SAMPLE_CYCLES / sim::kCyclesPerSecond;
+            result.total += (double)SAMPLE_CYCLES / sim::kCyclesPerSecond;
+            result.peak = std::max(result.peak, moisture);
+        }
+        m.schedule(now + SAMPLE_CYCLES, sample);
+    };
+    // Start once the firmware has been told its pots
+    machine.schedule(2 * sim::kCyclesPerSecond, sample);
+
+    uint64_t end = (uint64_t)(options.days * DAY_SECONDS * sim::kCyclesPerSecond);
+    simulation.runUntil(end);
+    keep = true;
+    send(machine, end, "control\r");
+    simulation.runUntil(end + 2 * sim::kCyclesPerSecond);
+
+    result.pumpedMl = board.pumpedMl();
+    result.transpiredMl = board.transpiredMl();
+    result.drainedMl = board.drainedMl();
+    for (unsigned pot = 0; pot < options.pots; pot++)
+        result.storedMl += (board.theta(machine.now(), pot) - parameters.soilStart) * parameters.soilCapacityMl;
+    result.pumpRuns = board.pumpRuns();
+    result.pumpSeconds = board.pumpSeconds(machine.now());
+    size_t reply = text.find("control : ");
+    result.control = reply == std::string::npos ? text : text.substr(reply);
+    return result;
+}
+
+double percent(double part, double whole)
+{
+    return whole > 0 ? 100 * part / whole : 0;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::PlantParameters parameters;
+    Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(arg, "--days") == 0)
+            options.days = atof(value);
+        else if (strcmp(arg, "--pots") == 0)
+        {
+            options.pots = (unsigned)atoi(value);
+            if (options.pots < 1 || options.pots > sim::kMaxPots)
+                usage();
+        }
+        else if (strcmp(arg, "--level") == 0)
+            options.level = atof(value);
+        else if (strcmp(arg, "--band") == 0)
+            options.band = atof(value);
+        else if (strcmp(arg, "--set") == 0)
+        {
+            std::string error;
+            if (!parameters.set(value, error))
+            {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+        else
+            usage();
+    }
+    if (options.days <= 0)
+        usage();
+
+    const char *policies[] = { "FIXED", "PI" };
+    Result results[2];
+    for (unsigned i = 0; i < 2; i++)
+        results[i] = run(parameters, options, policies[i]);
+
+    printf("%u pots, %g days, band %g-%g%%\n\n", options.pots, options.days, options.level,
+           options.level + options.band);
+    printf("policy  pumped ml  pump runs  pump s  below %%  above %%  in band %%  peak %%  transpired ml  drained ml  stored ml\n");
+    for (unsigned i = 0; i < 2; i++)
+    {
+        const Result &r = results[i];
+        printf("%-6s  %9.0f  %9llu  %6.0f  %7.1f  %7.1f  %9.1f  %6.1f  %13.0f  %10.0f  %9.0f\n", policies[i],
+               r.pumpedMl, (unsigned long long)r.pumpRuns, r.pumpSeconds, percent(r.below, r.total),
+               percent(r.above, r.total), 100 - percent(r.below + r.above, r.total), r.peak, r.transpiredMl,
+               r.drainedMl, r.storedMl);
+    }
+    for (unsigned i = 0; i < 2; i++)
+        printf("\n%s", results[i].control.c_str());
+    return 0;
+}
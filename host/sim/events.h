@@ -0,0 +1,108 @@
+// Simulator Event Queue
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Time-ordered queue of pending events for the discrete-event simulator.
+// Events scheduled for the same cycle fire in the order they were scheduled.
+// An event carries a kind and a generation; the owner cancels all pending
+// events of a kind by bumping its generation and dropping stale ones as they
+// come off the queue.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_EVENTS_H_
+#define SIM_EVENTS_H_
+
+#include <stdint.h>
+#include <vector>
+
+namespace sim {
+
+struct Event
+{
+    uint64_t time;
+    uint64_t sequence;
+    uint32_t kind;
+    uint32_t generation;
+    uint64_t tag;
+};
+
+class EventQueue
+{
+public:
+    EventQueue() : sequence_(0) {}
+
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+    uint64_t nextTime() const { return heap_.empty() ? ~0ULL : heap_.front().time; }
+
+    void schedule(uint64_t time, uint32_t kind, uint32_t generation = 0, uint64_t tag = 0)
+    {
+        Event event = { time, sequence_++, kind, generation, tag };
+        heap_.push_back(event);
+        siftUp(heap_.size() - 1);
+    }
+
+    Event pop()
+    {
+        Event top = heap_.front();
+        heap_.front() = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty())
+            siftDown(0);
+        return top;
+    }
+
+    void clear() { heap_.clear(); }
+
+private:
+    static bool before(const Event &a, const Event &b)
+    {
+        return a.time < b.time || (a.time == b.time && a.sequence < b.sequence);
+    }
+
+    void siftUp(size_t i)
+    {
+        Event event = heap_[i];
+        while (i > 0)
+        {
+            size_t parent = (i - 1) / 2;
+            if (!before(event, heap_[parent]))
+                break;
+            heap_[i] = heap_[parent];
+            i = parent;
+        }
+        heap_[i] = event;
+    }
+
+    void siftDown(size_t i)
+    {
+        Event event = heap_[i];
+        size_t n = heap_.size();
+        for (;;)
+        {
+            size_t child = 2 * i + 1;
+            if (child >= n)
+                break;
+            if (child + 1 < n && before(heap_[child + 1], heap_[child]))
+                child++;
+            if (!before(heap_[child], event))
+                break;
+            heap_[i] = heap_[child];
+            i = child;
+        }
+        heap_[i] = event;
+    }
+
+    std::vector<Event> heap_;
+    uint64_t sequence_;
+};
+
+}
+
+#endif
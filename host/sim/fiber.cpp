@@ -0,0 +1,137 @@
+// Simulator Fiber
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "fiber.h"
+#include "simhw.h"
+
+namespace sim {
+
+namespace {
+
+thread_local Fiber *currentFiber = nullptr;
+
+}
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+Fiber::Fiber(std::function<void()> body, size_t stackSize)
+    : body_(body),
+      stack_(nullptr),
+      stackSize_(stackSize),
+      started_(false),
+      running_(false),
+      finished_(false)
+{
+    // Stack pages are only committed as the firmware touches them; the lowest
+    // page is a guard so an overflow faults instead of corrupting the heap
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    stackSize_ = (stackSize_ + page - 1) / page * page + page;
+    stack_ = mmap(nullptr, stackSize_, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (stack_ == MAP_FAILED)
+    {
+        perror("sim: fiber stack");
+        abort();
+    }
+    mprotect(stack_, page, PROT_NONE);
+}
+
+Fiber::~Fiber()
+{
+    munmap(stack_, stackSize_);
+}
+
+void Fiber::entry(unsigned low, unsigned high)
+{
+    Fiber *fiber = (Fiber *)(((uintptr_t)high << 32) | low);
+    fiber->body_();
+    fiber->finished_ = true;
+    fiber->running_ = false;
+    setcontext(&fiber->caller_);
+}
+
+void Fiber::resume()
+{
+    if (finished_ || running_)
+        return;
+    if (!started_)
+    {
+        started_ = true;
+        getcontext(&context_);
+        context_.uc_stack.ss_sp = stack_;
+        context_.uc_stack.ss_size = stackSize_;
+        context_.uc_link = nullptr;
+        uintptr_t self = (uintptr_t)this;
+        makecontext(&context_, (void (*)())entry, 2, (unsigned)self, (unsigned)(self >> 32));
+    }
+    running_ = true;
+    Fiber *outer = currentFiber;
+    currentFiber = this;
+    swapcontext(&caller_, &context_);
+    currentFiber = outer;
+}
+
+void Fiber::suspend()
+{
+    running_ = false;
+    swapcontext(&context_, &caller_);
+}
+
+Fiber *Fiber::current()
+{
+    return currentFiber;
+}
+
+void *Fiber::stackBottom() const
+{
+    return (char *)stack_ + sysconf(_SC_PAGESIZE);
+}
+
+void *Fiber::stackTop() const
+{
+    return (char *)stack_ + stackSize_;
+}
+
+}
+
+// flowerpot_host runs the firmware on the main thread, not on a fiber
+extern "C" void simStackBounds(uint32_t **bottom, uint32_t **top)
+{
+    sim::Fiber *fiber = sim::Fiber::current();
+    *bottom = nullptr;
+    *top = nullptr;
+    if (fiber)
+    {
+        *bottom = (uint32_t *)fiber->stackBottom();
+        *top = (uint32_t *)fiber->stackTop();
+        return;
+    }
+    pthread_attr_t attr;
+    void *stack;
+    size_t size;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0)
+        return;
+    if (pthread_attr_getstack(&attr, &stack, &size) == 0)
+    {
+        *bottom = (uint32_t *)stack;
+        *top = (uint32_t *)((char *)stack + size);
+    }
+    pthread_attr_destroy(&attr);
+}
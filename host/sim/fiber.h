@@ -0,0 +1,66 @@
+// Simulator Fiber
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// A stack of its own for firmware whose main() never returns.  The owner
+// resumes the fiber, the firmware runs until something on its side (an event
+// scheduled by the owner) calls suspend(), and control comes back to the
+// owner.  A suspended fiber may be resumed from any thread.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_FIBER_H_
+#define SIM_FIBER_H_
+
+#include <stddef.h>
+#include <ucontext.h>
+#include <functional>
+
+namespace sim {
+
+class Fiber
+{
+public:
+    explicit Fiber(std::function<void()> body, size_t stackSize = 128 * 1024);
+    ~Fiber();
+
+    Fiber(const Fiber &) = delete;
+    Fiber &operator=(const Fiber &) = delete;
+
+    // Run the fiber until it suspends or its body returns
+    void resume();
+
+    // Called from inside the fiber: return control to resume()'s caller
+    void suspend();
+
+    bool running() const { return running_; }
+    bool finished() const { return finished_; }
+
+    // The fiber running on this thread, or null
+    static Fiber *current();
+
+    // Usable stack, guard page excluded
+    void *stackBottom() const;
+    void *stackTop() const;
+
+private:
+    static void entry(unsigned low, unsigned high);
+
+    std::function<void()> body_;
+    void *stack_;
+    size_t stackSize_;
+    ucontext_t context_;
+    ucontext_t caller_;
+    bool started_;
+    bool running_;
+    bool finished_;
+};
+
+}
+
+#endif
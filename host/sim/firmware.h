@@ -0,0 +1,37 @@
+// Host Firmware Entry Points
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// The firmware library is compiled with main renamed to firmwareMain, and
+// startup_host.c provides its interrupt vectors.  Only programs linked with
+// the firmware library include this header.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_FIRMWARE_H_
+#define SIM_FIRMWARE_H_
+
+#include <stdint.h>
+
+#include "simulation.h"
+
+extern "C" int firmwareMain(void);
+extern "C" void (* const simVectors[])(void);
+extern "C" const uint32_t simVectorCount;
+
+namespace sim {
+
+inline Firmware flowerpotFirmware()
+{
+    Firmware firmware = { firmwareMain, simVectors, simVectorCount };
+    return firmware;
+}
+
+}
+
+#endif
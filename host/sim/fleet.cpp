@@ -0,0 +1,177 @@
+// Fleet Simulation
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "fleet.h"
+
+namespace sim {
+
+namespace {
+
+const char POLL_COMMAND[] = "status\r";
+
+// Uniform in [1 - spread, 1 + spread]
+double jitter(std::mt19937 &random, double spread)
+{
+    double unit = (double)random() / 4294967296.0;
+    return 1 + spread * (2 * unit - 1);
+}
+
+}
+
+PlantParameters spreadParameters(const PlantParameters &base, uint32_t seed, unsigned id, double spread)
+{
+    std::mt19937 random(seed * 2654435761u + id);
+    PlantParameters parameters = base;
+    parameters.soilCapacityMl *= jitter(random, spread);
+    parameters.soilStart *= jitter(random, spread);
+    parameters.transpireDayMlPerHour *= jitter(random, spread);
+    parameters.transpireNightMlPerHour *= jitter(random, spread);
+    parameters.pumpMlPerSecond *= jitter(random, spread);
+    parameters.reservoirMl *= jitter(random, spread);
+    parameters.lightPeakPercent *= jitter(random, spread / 2);
+    return parameters;
+}
+
+//-----------------------------------------------------------------------------
+// FleetOptions
+//-----------------------------------------------------------------------------
+
+FleetOptions::FleetOptions()
+    : pots(1000),
+      threads(0),
+      epoch(3600 * kCyclesPerSecond),
+      pollPeriod(15 * 60 * kCyclesPerSecond),
+      seed(1),
+      spread(0.2),
+      exact(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Pot
+//-----------------------------------------------------------------------------
+
+Pot::Pot(unsigned id, const PlantParameters &parameters, const Firmware &firmware)
+    : id_(id),
+      board_(parameters),
+      simulation_(board_, firmware),
+      polls_(0),
+      rxBytes_(0),
+      txBytes_(0)
+{
+    Machine &machine = simulation_.machine();
+    machine.setRxFlowControl(true);
+    machine.setRtc((uint32_t)(parameters.startHour * 3600));
+    machine.setTxSink([this](uint8_t) { txBytes_++; });
+}
+
+void Pot::startPolling(uint64_t first, uint64_t period)
+{
+    machine().schedule(first, [this, period](Machine &) { poll(period); });
+}
+
+void Pot::poll(uint64_t period)
+{
+    Machine &machine = simulation_.machine();
+    machine.receive(POLL_COMMAND, strlen(POLL_COMMAND));
+    polls_++;
+    rxBytes_ += strlen(POLL_COMMAND);
+    machine.schedule(machine.now() + period, [this, period](Machine &) { poll(period); });
+}
+
+//-----------------------------------------------------------------------------
+// Fleet
+//-----------------------------------------------------------------------------
+
+Fleet::Fleet(const FleetOptions &options, const PlantParameters &base, const Firmware &firmware)
+    : options_(options),
+      pool_(options.threads),
+      now_(0),
+      last_()
+{
+    for (unsigned id = 0; id < options_.pots; id++)
+    {
+        PlantParameters parameters = spreadParameters(base, options_.seed, id, options_.spread);
+        pots_.emplace_back(new Pot(id, parameters, firmware));
+        Pot &pot = *pots_.back();
+        pot.machine().setLoopSkipping(!options_.exact);
+        if (options_.pollPeriod)
+            pot.startPolling(options_.pollPeriod * id / options_.pots + kCyclesPerSecond, options_.pollPeriod);
+    }
+}
+
+FleetEpoch Fleet::step(uint64_t limit)
+{
+    uint64_t end = std::min(now_ + options_.epoch, limit);
+    auto start = std::chrono::steady_clock::now();
+    pool_.parallelFor(pots_.size(), [this, end](size_t index, unsigned)
+    {
+        pots_[index]->simulation().runUntil(end);
+    });
+    now_ = end;
+
+    FleetEpoch epoch;
+    epoch.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Totals now = totals();
+    epoch.end = end;
+    epoch.polls = now.polls - last_.polls;
+    epoch.rxBytes = now.rxBytes - last_.rxBytes;
+    epoch.txBytes = now.txBytes - last_.txBytes;
+    epoch.pumpRuns = now.pumpRuns - last_.pumpRuns;
+    epoch.pumpedMl = now.pumpedMl - last_.pumpedMl;
+    epoch.wilting = 0;
+    for (auto &pot : pots_)
+        if (pot->board().theta(end) < pot->board().parameters().wiltingPoint)
+            epoch.wilting++;
+    last_ = now;
+    return epoch;
+}
+
+Fleet::Totals Fleet::totals()
+{
+    Totals sum = {};
+    for (auto &pot : pots_)
+    {
+        sum.polls += pot->polls();
+        sum.rxBytes += pot->rxBytes();
+        sum.txBytes += pot->txBytes();
+        sum.pumpRuns += pot->board().pumpRuns();
+        sum.pumpedMl += pot->board().pumpedMl();
+    }
+    return sum;
+}
+
+uint64_t Fleet::checksum()
+{
+    uint64_t sum = 0;
+    for (auto &pot : pots_)
+    {
+        Machine &machine = pot->machine();
+        double theta = pot->board().theta(now_);
+        uint64_t bits;
+        memcpy(&bits, &theta, sizeof(bits));
+        uint64_t h = (uint64_t)pot->id() * 0x9E3779B97F4A7C15ULL;
+        h = (h ^ machine.now()) * 0x100000001B3ULL;
+        h = (h ^ pot->txBytes()) * 0x100000001B3ULL;
+        h = (h ^ pot->board().pumpRuns()) * 0x100000001B3ULL;
+        h = (h ^ machine.eepromWrites()) * 0x100000001B3ULL;
+        h = (h ^ bits) * 0x100000001B3ULL;
+        sum += h;
+    }
+    return sum;
+}
+
+}
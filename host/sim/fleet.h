@@ -0,0 +1,133 @@
+// Fleet Simulation
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Many independent pots, each the unmodified firmware on its own simulated
+// machine (register file, RTC, EEPROM) wired to its own plant model, stepped
+// together in virtual time.  Every epoch each pot runs up to the epoch's end
+// on a work-stealing thread pool; fleet-wide figures are collected at the
+// barrier between epochs.
+//
+// A gateway polls every pot with "status" once per poll period, staggered
+// across the fleet, and counts the bytes that cross the UART both ways.
+//
+// Plant parameters are spread around a base set from a per-pot seed, so the
+// results do not depend on how many threads ran the fleet.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_FLEET_H_
+#define SIM_FLEET_H_
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "plant.h"
+#include "pool.h"
+#include "simulation.h"
+
+namespace sim {
+
+struct FleetOptions
+{
+    FleetOptions();
+
+    unsigned pots;
+    unsigned threads;                 // 0: one per hardware thread
+    uint64_t epoch;                   // virtual cycles between barriers
+    uint64_t pollPeriod;              // gateway status poll, 0 for none
+    uint32_t seed;
+    double spread;                    // relative spread of plant parameters
+    bool exact;                       // run every idle loop pass
+};
+
+// Plant parameters for pot id of a fleet, each spread around base by up to
+// the given fraction
+PlantParameters spreadParameters(const PlantParameters &base, uint32_t seed, unsigned id, double spread);
+
+class Pot
+{
+public:
+    Pot(unsigned id, const PlantParameters &parameters, const Firmware &firmware);
+
+    unsigned id() const { return id_; }
+    PlantBoard &board() { return board_; }
+    Simulation &simulation() { return simulation_; }
+    Machine &machine() { return simulation_.machine(); }
+
+    // Gateway traffic since power-on
+    uint64_t polls() const { return polls_; }
+    uint64_t rxBytes() const { return rxBytes_; }
+    uint64_t txBytes() const { return txBytes_; }
+
+    void startPolling(uint64_t first, uint64_t period);
+
+private:
+    void poll(uint64_t period);
+
+    unsigned id_;
+    PlantBoard board_;
+    Simulation simulation_;
+    uint64_t polls_;
+    uint64_t rxBytes_;
+    uint64_t txBytes_;
+};
+
+// Fleet-wide totals for one epoch
+struct FleetEpoch
+{
+    uint64_t end;                     // virtual time reached
+    uint64_t polls;
+    uint64_t rxBytes;
+    uint64_t txBytes;
+    uint64_t pumpRuns;
+    double pumpedMl;
+    unsigned wilting;                 // pots below wilting point at the end
+    double wall;                      // seconds spent stepping
+};
+
+class Fleet
+{
+public:
+    Fleet(const FleetOptions &options, const PlantParameters &base, const Firmware &firmware);
+
+    size_t size() const { return pots_.size(); }
+    Pot &pot(size_t index) { return *pots_[index]; }
+    unsigned threads() const { return pool_.threads(); }
+    uint64_t steals() const { return pool_.steals(); }
+    uint64_t now() const { return now_; }
+
+    // Run every pot to the end of the next epoch (or to limit, if sooner)
+    FleetEpoch step(uint64_t limit = ~0ULL);
+
+    // Order-independent digest of every pot's state, for comparing runs
+    uint64_t checksum();
+
+private:
+    struct Totals
+    {
+        uint64_t polls;
+        uint64_t rxBytes;
+        uint64_t txBytes;
+        uint64_t pumpRuns;
+        double pumpedMl;
+    };
+
+    Totals totals();
+
+    FleetOptions options_;
+    ThreadPool pool_;
+    std::vector<std::unique_ptr<Pot>> pots_;
+    uint64_t now_;
+    Totals last_;
+};
+
+}
+
+#endif
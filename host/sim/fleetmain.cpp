@@ -0,0 +1,195 @@
+// Fleet Runner
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs a fleet of pots (see fleet.h) and reports gateway traffic, watering
+// and throughput per virtual day.
+//
+//   flowerpot_fleet [--pots N] [--threads N] [--days D] [--epoch DURATION]
+//                   [--poll DURATION] [--seed N] [--spread FRACTION]
+//                   [--set NAME=VALUE]... [--exact] [--scaling]
+//
+//   --pots     number of pots (default 1000)
+//   --threads  worker threads (default one per hardware thread)
+//   --days     virtual days to run (default 1)
+//   --epoch    virtual time between fleet barriers (default 1h)
+//   --poll     gateway status poll period per pot, 0 for none (default 15m)
+//   --spread   relative spread of the plant parameters (default 0.2)
+//   --set      override a base plant parameter (see flowerpot_plant --list)
+//   --scaling  run the same fleet with 1, 2, 4, ... threads up to --threads
+//              and report the speed-up; the checksums must agree
+//
+// Throughput is reported as pot-days simulated per second of wall time and
+// as the number of pots that could be simulated in real time.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "firmware.h"
+#include "fleet.h"
+#include "scenario.h"
+
+namespace {
+
+struct Result
+{
+    double wall;
+    uint64_t checksum;
+    uint64_t steals;
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_fleet [--pots N] [--threads N] [--days D] [--epoch DURATION]\n"
+        "                       [--poll DURATION] [--seed N] [--spread FRACTION]\n"
+        "                       [--set NAME=VALUE]... [--exact] [--scaling]\n");
+    exit(2);
+}
+
+Result run(const sim::FleetOptions &options, const sim::PlantParameters &base, double days, bool report)
+{
+    auto start = std::chrono::steady_clock::now();
+    sim::Fleet fleet(options, base, sim::flowerpotFirmware());
+    uint64_t end = (uint64_t)(days * 86400 * sim::kCyclesPerSecond);
+    const uint64_t dayCycles = 86400 * sim::kCyclesPerSecond;
+
+    if (report)
+        printf("day  polls     gateway rx  gateway tx  pump runs  pumped l  wilting  wall s\n");
+    sim::FleetEpoch day = {};
+    while (fleet.now() < end)
+    {
+        sim::FleetEpoch epoch = fleet.step(end);
+        day.polls += epoch.polls;
+        day.rxBytes += epoch.rxBytes;
+        day.txBytes += epoch.txBytes;
+        day.pumpRuns += epoch.pumpRuns;
+        day.pumpedMl += epoch.pumpedMl;
+        day.wall += epoch.wall;
+        if (report && (epoch.end % dayCycles == 0 || epoch.end == end))
+        {
+            printf("%3llu  %8llu  %10llu  %10llu  %9llu  %8.1f  %7u  %6.2f\n",
+                   (unsigned long long)((epoch.end + dayCycles - 1) / dayCycles),
+                   (unsigned long long)day.polls, (unsigned long long)day.rxBytes,
+                   (unsigned long long)day.txBytes, (unsigned long long)day.pumpRuns,
+                   day.pumpedMl / 1000, epoch.wilting, day.wall);
+            day = {};
+        }
+    }
+
+    Result result;
+    result.wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.checksum = fleet.checksum();
+    result.steals = fleet.steals();
+    return result;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::FleetOptions options;
+    sim::PlantParameters base;
+    double days = 1;
+    bool scaling = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        std::string error;
+        if (strcmp(arg, "--exact") == 0)
+            options.exact = true;
+        else if (strcmp(arg, "--scaling") == 0)
+            scaling = true;
+        else if (!value)
+            usage();
+        else if (strcmp(arg, "--pots") == 0)
+            options.pots = (unsigned)atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(argv[++i]);
+        else if (strcmp(arg, "--days") == 0)
+            days = atof(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(arg, "--spread") == 0)
+            options.spread = atof(argv[++i]);
+        else if (strcmp(arg, "--epoch") == 0)
+        {
+            if (!sim::parseDuration(argv[++i], options.epoch) || options.epoch == 0)
+                usage();
+        }
+        else if (strcmp(arg, "--poll") == 0)
+        {
+            if (!sim::parseDuration(argv[++i], options.pollPeriod))
+                usage();
+        }
+        else if (strcmp(arg, "--set") == 0)
+        {
+            if (!base.set(argv[++i], error))
+            {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+        else
+            usage();
+    }
+    if (options.pots == 0 || days <= 0)
+        usage();
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    double potDays = options.pots * days;
+
+    if (!scaling)
+    {
+        options.threads = threads;
+        Result result = run(options, base, days, true);
+        printf("%u pots x %g days on %u threads in %.3f s: %.0f pot-days/s, %.0f pots in real time "
+               "(%llu steals, checksum %016llx)\n",
+               options.pots, days, threads, result.wall, potDays / result.wall,
+               potDays * 86400 / result.wall, (unsigned long long)result.steals,
+               (unsigned long long)result.checksum);
+        return 0;
+    }
+
+    printf("threads  wall s  pot-days/s  pots in real time  speed-up  checksum\n");
+    double single = 0;
+    uint64_t expected = 0;
+    int status = 0;
+    for (unsigned n = 1; ; n = std::min(n * 2, threads))
+    {
+        options.threads = n;
+        Result result = run(options, base, days, false);
+        if (n == 1)
+        {
+            single = result.wall;
+            expected = result.checksum;
+        }
+        bool same = result.checksum == expected;
+        printf("%7u  %6.2f  %10.0f  %17.0f  %8.2f  %016llx%s\n", n, result.wall, potDays / result.wall,
+               potDays * 86400 / result.wall, single / result.wall,
+               (unsigned long long)result.checksum, same ? "" : " MISMATCH");
+        if (!same)
+            status = 1;
+        if (n == threads)
+            break;
+    }
+    return status;
+}
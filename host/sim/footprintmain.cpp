@@ -0,0 +1,363 @@
+// Footprint Report
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Reads the map file the TI linker writes (-m, Debug/extracredit.map in the
+// CCS project) and shows where the flash and RAM go, module by module and
+// library object by library object, against a budget.
+//
+//   flowerpot_footprint MAP [--budget FILE] [--threshold PCT] [--update]
+//
+//   --budget     a budget written earlier with --update
+//   --threshold  growth of a memory's total over its budget that fails the
+//                check, in percent (default 1)
+//   --update     write the map's figures to the budget file instead
+//
+// The budget is text, one line each:
+//
+//   memory <name> <bytes used>
+//   module <name> <code> <ro data> <rw data>
+//
+// Memory totals are the used column of the map's memory configuration, so
+// alignment holes and initialization tables count.  Only they are checked;
+// modules are listed with their change to show where growth came from.  The
+// exit status is 1 if a memory grew past the threshold.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Module
+{
+    unsigned long code = 0;
+    unsigned long ro = 0;
+    unsigned long rw = 0;
+};
+
+struct Footprint
+{
+    std::map<std::string, unsigned long> used;      // By memory
+    std::map<std::string, unsigned long> length;
+    std::map<std::string, Module> modules;
+    std::vector<std::string> order;                  // Modules as in the map
+};
+
+void usage()
+{
+    fprintf(stderr, "usage: flowerpot_footprint MAP [--budget FILE] [--threshold PCT] [--update]\n");
+    exit(2);
+}
+
+bool readLines(const char *path, std::vector<std::string> &lines, std::string &error)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+    std::string line;
+    int c;
+    while ((c = fgetc(file)) != EOF)
+    {
+        if (c == '\n')
+        {
+            lines.push_back(line);
+            line.clear();
+        }
+        else if (c != '\r')
+            line += (char)c;
+    }
+    if (!line.empty())
+        lines.push_back(line);
+    fclose(file);
+    return true;
+}
+
+std::string trim(const std::string &text)
+{
+    size_t start = text.find_first_not_of(' ');
+    if (start == std::string::npos)
+        return "";
+    return text.substr(start, text.find_last_not_of(' ') - start + 1);
+}
+
+// Library objects are named <library>:<object>
+std::string libraryName(const std::string &path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void addModule(Footprint &footprint, const std::string &name, const Module &module)
+{
+    if (footprint.modules.find(name) == footprint.modules.end())
+        footprint.order.push_back(name);
+    footprint.modules[name] = module;
+}
+
+bool parseMap(const std::vector<std::string> &lines, Footprint &footprint, std::string &error)
+{
+    enum { OTHER, MEMORY, MODULES } part = OTHER;
+    std::string library;
+    for (const std::string &line : lines)
+    {
+        if (trim(line) == "MEMORY CONFIGURATION")
+        {
+            part = MEMORY;
+            continue;
+        }
+        if (trim(line) == "MODULE SUMMARY")
+        {
+            part = MODULES;
+            continue;
+        }
+        // Any other heading ends the part; rules under headings do not
+        if (!line.empty() && line[0] != ' ' && line[0] != '-')
+        {
+            part = OTHER;
+            continue;
+        }
+
+        char name[256];
+        unsigned long origin, length, used, code, ro, rw;
+        if (part == MEMORY && sscanf(line.c_str(), " %255s %lx %lx %lx", name, &origin, &length, &used) == 4)
+        {
+            footprint.used[name] = used;
+            footprint.length[name] = length;
+        }
+        else if (part == MODULES)
+        {
+            std::string text = trim(line);
+            if (text.empty() || text[0] == '-' || text[0] == '+' || text.compare(0, 6, "Module") == 0 ||
+                text.compare(0, 6, "Total:") == 0 || text.compare(0, 12, "Grand Total:") == 0)
+                continue;
+            if (text.compare(0, 6, "Stack:") == 0)
+            {
+                if (sscanf(text.c_str() + 6, "%lu %lu %lu", &code, &ro, &rw) == 3)
+                    addModule(footprint, "(stack)", {code, ro, rw});
+                continue;
+            }
+            if (text.compare(0, 17, "Linker Generated:") == 0)
+            {
+                if (sscanf(text.c_str() + 17, "%lu %lu %lu", &code, &ro, &rw) == 3)
+                    addModule(footprint, "(linker)", {code, ro, rw});
+                continue;
+            }
+            if (sscanf(text.c_str(), "%255s %lu %lu %lu", name, &code, &ro, &rw) == 4)
+            {
+                std::string module = library.empty() ? name : library + ":" + name;
+                addModule(footprint, module, {code, ro, rw});
+            }
+            else
+                // A directory of objects, or a library
+                library = text == "./" ? "" : libraryName(text);
+        }
+    }
+    if (footprint.used.empty() || footprint.modules.empty())
+    {
+        error = "no memory configuration or module summary; not a TI linker map";
+        return false;
+    }
+    return true;
+}
+
+bool parseBudget(const std::vector<std::string> &lines, Footprint &budget, std::string &error)
+{
+    unsigned number = 0;
+    for (const std::string &line : lines)
+    {
+        number++;
+        std::string text = trim(line);
+        if (text.empty() || text[0] == '#')
+            continue;
+        char name[256];
+        unsigned long used, code, ro, rw;
+        if (sscanf(text.c_str(), "memory %255s %lu", name, &used) == 2)
+            budget.used[name] = used;
+        else if (sscanf(text.c_str(), "module %255s %lu %lu %lu", name, &code, &ro, &rw) == 4)
+            addModule(budget, name, {code, ro, rw});
+        else
+        {
+            error = "budget line " + std::to_string(number) + ": " + text;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeBudget(const char *path, const Footprint &footprint, std::string &error)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+    fprintf(file, "# Flash and RAM budget, written by flowerpot_footprint --update\n");
+    fprintf(file, "# memory <name> <bytes used>\n");
+    fprintf(file, "# module <name> <code> <ro data> <rw data>\n");
+    for (const auto &memory : footprint.used)
+        fprintf(file, "memory %s %lu\n", memory.first.c_str(), memory.second);
+    for (const std::string &name : footprint.order)
+    {
+        const Module &module = footprint.modules.at(name);
+        fprintf(file, "module %s %lu %lu %lu\n", name.c_str(), module.code, module.ro, module.rw);
+    }
+    fclose(file);
+    return true;
+}
+
+void printChange(const char *column, unsigned long now, unsigned long before)
+{
+    if (now != before)
+        printf("  %s %+ld", column, (long)now - (long)before);
+}
+
+void printModules(const Footprint &footprint, const Footprint *budget)
+{
+    int width = 6;
+    for (const std::string &name : footprint.order)
+        width = std::max(width, (int)name.size());
+    printf("%-*s %7s %7s %7s\n", width, "module", "code", "ro", "rw");
+    for (const std::string &name : footprint.order)
+    {
+        const Module &module = footprint.modules.at(name);
+        printf("%-*s %7lu %7lu %7lu", width, name.c_str(), module.code, module.ro, module.rw);
+        if (budget)
+        {
+            auto old = budget->modules.find(name);
+            if (old == budget->modules.end())
+                printf("  new");
+            else
+            {
+                printChange("code", module.code, old->second.code);
+                printChange("ro", module.ro, old->second.ro);
+                printChange("rw", module.rw, old->second.rw);
+            }
+        }
+        printf("\n");
+    }
+    if (budget)
+        for (const std::string &name : budget->order)
+            if (footprint.modules.find(name) == footprint.modules.end())
+                printf("%-*s %7s %7s %7s  gone\n", width, name.c_str(), "-", "-", "-");
+}
+
+// Returns the number of memories over budget
+unsigned printMemories(const Footprint &footprint, const Footprint *budget, double threshold)
+{
+    unsigned over = 0;
+    printf("\n%-8s %10s %10s %7s", "memory", "used", "length", "free");
+    if (budget)
+        printf(" %10s %9s", "budget", "change");
+    printf("\n");
+    for (const auto &memory : footprint.used)
+    {
+        unsigned long length = footprint.length.at(memory.first);
+        printf("%-8s %10lu %10lu %6.1f%%", memory.first.c_str(), memory.second, length,
+               length ? 100.0 * (length - memory.second) / length : 0);
+        if (budget)
+        {
+            auto old = budget->used.find(memory.first);
+            if (old == budget->used.end())
+                printf(" %10s %9s", "-", "new");
+            else
+            {
+                double change = old->second ? 100.0 * ((double)memory.second - old->second) / old->second : 0;
+                bool grew = memory.second > old->second && change > threshold;
+                printf(" %10lu %+8.1f%%%s", old->second, change, grew ? "  OVER BUDGET" : "");
+                if (grew)
+                    over++;
+            }
+        }
+        printf("\n");
+    }
+    return over;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    const char *mapPath = nullptr;
+    const char *budgetPath = nullptr;
+    double threshold = 1;
+    bool update = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+            budgetPath = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--update") == 0)
+            update = true;
+        else if (argv[i][0] == '-' || mapPath)
+            usage();
+        else
+            mapPath = argv[i];
+    }
+    if (!mapPath || (update && !budgetPath))
+        usage();
+
+    std::vector<std::string> lines;
+    Footprint footprint;
+    std::string error;
+    if (!readLines(mapPath, lines, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (!parseMap(lines, footprint, error))
+    {
+        fprintf(stderr, "%s: %s\n", mapPath, error.c_str());
+        return 1;
+    }
+
+    if (update)
+    {
+        if (!writeBudget(budgetPath, footprint, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    Footprint budget;
+    if (budgetPath)
+    {
+        std::vector<std::string> budgetLines;
+        if (!readLines(budgetPath, budgetLines, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (!parseBudget(budgetLines, budget, error))
+        {
+            fprintf(stderr, "%s: %s\n", budgetPath, error.c_str());
+            return 1;
+        }
+    }
+    printModules(footprint, budgetPath ? &budget : nullptr);
+    return printMemories(footprint, budgetPath ? &budget : nullptr, threshold) ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+// Host Runner
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM (register file stand-in)
+// System Clock:    40 MHz (virtual)
+
+// Runs the unmodified firmware against the simulated machine.  UART0 is
+// connected to stdin/stdout (newlines are sent as carriage returns, which is
+// what the command line expects), and the sensors read constant values set
+// on the command line.
+//
+//   flowerpot_host [--moisture PCT] [--light PCT] [--battery V] [--volume ML]
+//                  [--rtc SECONDS] [--run-for SECONDS] [--linger SECONDS]
+//                  [--realtime]
+//
+// Without --realtime the virtual clock runs as fast as the host allows.  The
+// program exits --linger virtual seconds after stdin reaches end of file, or
+// after --run-for virtual seconds.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "machine.h"
+
+extern "C" int firmwareMain(void);
+extern "C" void (* const simVectors[])(void);
+extern "C" const uint32_t simVectorCount;
+
+namespace {
+
+std::mutex inputLock;
+std::string input;
+bool inputClosed = false;
+
+void readStdin()
+{
+    char buffer[256];
+    for (;;)
+    {
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        std::lock_guard<std::mutex> guard(inputLock);
+        if (n <= 0)
+        {
+            inputClosed = true;
+            return;
+        }
+        for (ssize_t i = 0; i < n; i++)
+            input.push_back(buffer[i] == '\n' ? '\r' : buffer[i]);
+    }
+}
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_host [--moisture PCT] [--light PCT] [--battery V] [--volume ML]\n"
+        "                      [--rtc SECONDS] [--run-for SECONDS] [--linger SECONDS]\n"
+        "                      [--realtime]\n");
+    exit(2);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::StaticBoard board;
+    double runFor = 0;
+    double linger = 2;
+    double rtc = 0;
+    bool realtime = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--realtime")
+        {
+            realtime = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        double value = atof(argv[++i]);
+        if (arg == "--moisture")
+            board.setMoisturePercent(value);
+        else if (arg == "--light")
+            board.setLightPercent(value);
+        else if (arg == "--battery")
+            board.setBatteryVoltage(value);
+        else if (arg == "--volume")
+            board.setVolumeMilliliters(value);
+        else if (arg == "--rtc")
+            rtc = value;
+        else if (arg == "--run-for")
+            runFor = value;
+        else if (arg == "--linger")
+            linger = value;
+        else
+            usage();
+    }
+
+    sim::Machine machine(board);
+    machine.setVectorTable(simVectors, simVectorCount);
+    machine.setRxFlowControl(true);
+    machine.setRtc((uint32_t)rtc);
+    machine.setTxSink([](uint8_t c) { putchar(c); });
+
+    std::thread(readStdin).detach();
+
+    auto wallStart = std::chrono::steady_clock::now();
+    double closedAt = -1;
+    machine.setPollHook([&](sim::Machine &m)
+    {
+        {
+            std::lock_guard<std::mutex> guard(inputLock);
+            if (!input.empty())
+            {
+                m.receive(input.data(), input.size());
+                input.clear();
+            }
+            if (inputClosed && closedAt < 0)
+                closedAt = m.seconds();
+        }
+        bool done = (runFor > 0 && m.seconds() >= runFor)
+                 || (closedAt >= 0 && m.rxPending() == 0 && m.seconds() >= closedAt + linger);
+        if (done)
+        {
+            fflush(stdout);
+            exit(0);
+        }
+        if (realtime)
+        {
+            auto due = wallStart + std::chrono::microseconds((uint64_t)(m.seconds() * 1e6));
+            std::this_thread::sleep_until(due);
+            fflush(stdout);
+        }
+    }, sim::kCyclesPerSecond / 1000);
+
+    sim::bind(&machine);
+    return firmwareMain();
+}
@@ -0,0 +1,1163 @@
+// Simulated TM4C123 Machine
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+// Target uC:       TM4C123GH6PM (register file stand-in)
+// System Clock:    40 MHz (virtual)
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "tm4c123gh6pm.h"
+#include "machine.h"
+
+namespace sim {
+
+namespace {
+
+// Peripheral bases
+const uint32_t GPIOA = 0x40004000;
+const uint32_t GPIOB = 0x40005000;
+const uint32_t GPIOC = 0x40006000;
+const uint32_t GPIOD = 0x40007000;
+const uint32_t GPIOE = 0x40024000;
+const uint32_t GPIOF = 0x40025000;
+const uint32_t UART0 = 0x4000C000;
+const uint32_t TIMER1 = 0x40031000;
+const uint32_t TIMER2 = 0x40032000;
+const uint32_t ADC0 = 0x40038000;
+const uint32_t COMP = 0x4003C000;
+const uint32_t EEPROM = 0x400AF000;
+const uint32_t HIB = 0x400FC000;
+const uint32_t DWT = 0xE0001000;
+const uint32_t BITBAND = 0x42000000;
+
+// Register offsets
+const uint32_t GPIO_DATA = 0x3FC;
+const uint32_t UART_DR = 0x000;
+const uint32_t UART_RSR = 0x004;
+const uint32_t UART_FR = 0x018;
+const uint32_t UART_IBRD = 0x024;
+const uint32_t UART_FBRD = 0x028;
+const uint32_t TIMER_CTL = 0x00C;
+const uint32_t TIMER_IMR = 0x018;
+const uint32_t TIMER_RIS = 0x01C;
+const uint32_t TIMER_MIS = 0x020;
+const uint32_t TIMER_ICR = 0x024;
+const uint32_t TIMER_TAILR = 0x028;
+const uint32_t TIMER_TAR = 0x048;
+const uint32_t TIMER_TAV = 0x050;
+const uint32_t ADC_ACTSS = 0x000;
+const uint32_t ADC_RIS = 0x004;
+const uint32_t ADC_PSSI = 0x028;
+const uint32_t ADC_SAC = 0x030;
+const uint32_t ADC_SSMUX3 = 0x0A0;
+const uint32_t ADC_SSFIFO3 = 0x0A8;
+const uint32_t ADC_SSFSTAT3 = 0x0AC;
+const uint32_t COMP_ACSTAT0 = 0x020;
+const uint32_t EE_SIZE = 0x000;
+const uint32_t EE_BLOCK = 0x004;
+const uint32_t EE_OFFSET = 0x008;
+const uint32_t EE_RDWR = 0x010;
+const uint32_t EE_RDWRINC = 0x014;
+const uint32_t EE_DONE = 0x018;
+const uint32_t EE_SUPP = 0x01C;
+const uint32_t HIB_RTCC = 0x000;
+const uint32_t HIB_RTCLD = 0x00C;
+const uint32_t HIB_CTL = 0x010;
+const uint32_t HIB_RIS = 0x018;
+const uint32_t HIB_MIS = 0x01C;
+const uint32_t HIB_RTCSS = 0x028;
+const uint32_t HIB_DATA = 0x030;
+const uint32_t DWT_CTRL = 0x000;
+const uint32_t DWT_CYCCNT = 0x004;
+const uint32_t NVIC_EN0 = 0xE000E100;
+
+// Pins
+const unsigned SPEAKER_PIN = 3;                      // PA3
+const unsigned DEINT_PIN = 5;                        // PE5
+
+// DR's framing error bit, above the data
+const uint16_t DR_FE = 0x100;
+
+// Marks a DR value handed to the firmware so a write of any byte is seen
+const uint32_t DR_UNREAD = 0x40000000;
+
+// Marks a write-only register so a write of any value is seen
+const uint32_t UNWRITTEN = 0xDEADBEEF;
+
+const uint32_t DWT_CTRL_CYCCNTENA = 0x00000001;
+
+const uint64_t NEVER = ~0ULL;
+const uint64_t LOOP_HASH_SEED = 0xCBF29CE484222325ULL;
+const uint64_t LOOP_HASH_PRIME = 0x100000001B3ULL;
+const unsigned UART_FIFO_DEPTH = 16;
+const unsigned ADC_FIFO_DEPTH = 1;
+const uint64_t EEPROM_WRITE_CYCLES = 110 * kCyclesPerMicrosecond;
+const unsigned EEPROM_BLOCKS = 32;
+const unsigned EEPROM_WORDS = 16;
+
+thread_local Machine *boundMachine = nullptr;
+
+// A character sent with bits of sent cycles as a receiver with bits of
+// sampled cycles reads it: start bit, 8 data bits LSB first and a stop bit,
+// the line idle after, each sampled in the middle of the receiver's bit
+// time.  Returns the data with DR_FE set if the stop bit was sampled low.
+uint16_t resample(uint8_t c, double sent, double sampled)
+{
+    uint32_t frame = 0x200u | (uint32_t)c << 1;
+    uint16_t seen = 0;
+    for (unsigned bit = 1; bit <= 9; bit++)
+    {
+        unsigned at = (unsigned)((bit + 0.5) * sampled / sent);
+        uint32_t level = at < 10 ? frame >> at & 1 : 1;
+        if (bit <= 8)
+            seen |= (uint16_t)(level << (bit - 1));
+        else if (!level)
+            seen |= DR_FE;
+    }
+    return seen;
+}
+
+bool isGpio(uint32_t base)
+{
+    return base == GPIOA || base == GPIOB || base == GPIOC || base == GPIOD || base == GPIOE || base == GPIOF;
+}
+
+Port gpioPort(uint32_t base)
+{
+    switch (base)
+    {
+    case GPIOA: return PORT_A;
+    case GPIOB: return PORT_B;
+    case GPIOC: return PORT_C;
+    case GPIOD: return PORT_D;
+    case GPIOE: return PORT_E;
+    default:    return PORT_F;
+    }
+}
+
+}
+
+const PotWiring kPotWiring[kMaxPots] =
+{
+    { PORT_A, 2, 1 },
+    { PORT_A, 4, 3 },
+    { PORT_A, 5, 4 },
+    { PORT_A, 6, 5 },
+    { PORT_A, 7, 6 },
+    { PORT_B, 0, 7 },
+    { PORT_B, 1, 9 },
+    { PORT_B, 2, 10 },
+};
+
+//-----------------------------------------------------------------------------
+// Sensor transfer functions
+//-----------------------------------------------------------------------------
+
+// main.c: percent = ((raw + 0.5) / 4096) * 100
+uint16_t percentToAdc(double percent)
+{
+    double raw = percent / 100.0 * 4096.0 - 0.5;
+    return (uint16_t)std::min(4095.0, std::max(0.0, raw + 0.5));
+}
+
+// main.c: volts = ((raw + 0.5) / 4096) * 3.3 * (47000 + 100000) / 47000
+uint16_t batteryToAdc(double volts)
+{
+    double pin = volts * 47000.0 / (47000.0 + 100000.0);
+    double raw = pin / 3.3 * 4096.0 - 0.5;
+    return (uint16_t)std::min(4095.0, std::max(0.0, raw + 0.5));
+}
+
+// main.c: ml = 0.5330 * (timer - 322), timer counting 25 ns cycles from
+// the TAV reset until the comparator output falls
+uint32_t volumeToDischargeCycles(double ml)
+{
+    double timer = std::max(0.0, ml) / 0.5330 + 322.0;
+    return (uint32_t)(timer + 0.5);
+}
+
+StaticBoard::StaticBoard()
+{
+    memset(ain_, 0, sizeof(ain_));
+    setMoisturePercent(50);
+    setLightPercent(50);
+    setBatteryVoltage(5);
+    setVolumeMilliliters(500);
+}
+
+void StaticBoard::setMoisturePercent(double percent)
+{
+    ain_[1] = percentToAdc(percent);
+}
+
+void StaticBoard::setLightPercent(double percent)
+{
+    ain_[2] = percentToAdc(percent);
+}
+
+void StaticBoard::setBatteryVoltage(double volts)
+{
+    ain_[0] = batteryToAdc(volts);
+}
+
+void StaticBoard::setVolumeMilliliters(double ml)
+{
+    discharge_ = volumeToDischargeCycles(ml);
+}
+
+uint16_t StaticBoard::adcSample(unsigned ain, uint64_t now)
+{
+    (void)now;
+    return ain < 12 ? ain_[ain] : 0;
+}
+
+uint32_t StaticBoard::dischargeCycles(uint64_t now)
+{
+    (void)now;
+    return discharge_;
+}
+
+uint64_t StaticBoard::inputsSteadyUntil(uint64_t from)
+{
+    (void)from;
+    return NEVER;
+}
+
+//-----------------------------------------------------------------------------
+// Machine
+//-----------------------------------------------------------------------------
+
+Machine::Machine(Board &board)
+    : board_(board),
+      inputs_(nullptr),
+      hasPending_(false),
+      bitband_(0),
+      lastRead_(0),
+      lastValue_(0),
+      spinReads_(0),
+      inIsr_(false),
+      now_(0),
+      vectors_(nullptr),
+      vectorCount_(0),
+      nextHostEvent_(0),
+      pollPeriod_(0),
+      loopSkipping_(true),
+      loopQuiet_(false),
+      loopStart_(0),
+      loopRtcFirst_(NEVER),
+      loopRtcLast_(NEVER),
+      loopHash_(LOOP_HASH_SEED),
+      lastLoopHash_(0),
+      lastLoopLength_(0),
+      skippedLoops_(0),
+      skippedCycles_(0),
+      speakerToggles_(0),
+      adcDone_(0),
+      adcConverting_(false),
+      rxScheduled_(false),
+      rxFlowControl_(false),
+      rxOverruns_(0),
+      hostBaud_(0),
+      rxFramingErrors_(0),
+      txFramingErrors_(0),
+      timer1Start_(0),
+      timer1Base_(0),
+      timer2Next_(NEVER),
+      timer2Interrupts_(0),
+      timer2Starts_(0),
+      compLowAt_(0),
+      compHigh_(false),
+      rtcBase_(0),
+      rtcStart_(0),
+      eepromBusyUntil_(0),
+      eepromBusy_(false),
+      eepromWrites_(0),
+      cyccntStart_(0),
+      cyccntBase_(0)
+{
+    memset(generation_, 0, sizeof(generation_));
+    memset(eeprom_, 0xFF, sizeof(eeprom_));
+    reg(TIMER1 + TIMER_TAILR) = 0xFFFFFFFF;
+    reg(TIMER2 + TIMER_TAILR) = 0xFFFFFFFF;
+    reg(HIB + HIB_RTCLD) = UNWRITTEN;
+}
+
+Machine::~Machine()
+{
+    if (boundMachine == this)
+        boundMachine = nullptr;
+}
+
+void Machine::setVectorTable(void (* const *vectors)(void), unsigned count)
+{
+    vectors_ = vectors;
+    vectorCount_ = count;
+}
+
+uint32_t *Machine::storage(uint32_t address)
+{
+    unsigned region;
+    if ((address >> 20) == 0x400)
+        region = 0;
+    else if ((address >> 20) == 0xE00)
+        region = 256;
+    else
+    {
+        fprintf(stderr, "sim: access to unmapped address 0x%08X\n", address);
+        abort();
+    }
+    std::unique_ptr<Page> &page = pages_[region + ((address >> 12) & 0xFF)];
+    if (!page)
+    {
+        page.reset(new Page);
+        memset(page->word, 0, sizeof(page->word));
+    }
+    return &page->word[(address & 0xFFF) >> 2];
+}
+
+volatile uint32_t *Machine::access(uint32_t address)
+{
+    settle();
+    if (now_ + kAccessCycles < events_.nextTime())
+        now_ += kAccessCycles;
+    else
+        advanceTo(now_ + kAccessCycles);
+    if (address == UART0 + UART_FR)
+        loopBoundary();
+    pollWait(address);
+
+    uint32_t *slot;
+    if ((address >> 25) == (BITBAND >> 25))
+    {
+        uint32_t offset = address - BITBAND;
+        uint32_t byte = 0x40000000 + offset / 32;
+        uint32_t word = byte & ~3u;
+        unsigned bit = (offset % 32) / 4 + (byte & 3) * 8;
+        uint32_t *target = storage(word);
+        refresh(word, target);
+        bitband_ = (*target >> bit) & 1;
+        slot = &bitband_;
+    }
+    else
+    {
+        slot = storage(address);
+        refresh(address, slot);
+    }
+
+    pending_.address = address;
+    pending_.slot = slot;
+    pending_.value = *slot;
+    hasPending_ = true;
+    return slot;
+}
+
+void Machine::delayCycles(uint64_t cycles)
+{
+    settle();
+    advanceTo(now_ + cycles);
+}
+
+void Machine::waitMicrosecond(uint32_t us)
+{
+    settle();
+    advanceTo(now_ + (uint64_t)us * kCyclesPerMicrosecond);
+}
+
+void *Machine::global(const void *key, size_t size)
+{
+    for (auto &entry : globals_)
+        if (entry.first == key)
+            return entry.second.get();
+    globals_.emplace_back(key, std::unique_ptr<uint8_t[]>(new uint8_t[size]()));
+    return globals_.back().second.get();
+}
+
+// Apply the effect of the last access handed out to the firmware
+void Machine::settle()
+{
+    if (!hasPending_)
+        return;
+    hasPending_ = false;
+    uint32_t value = *pending_.slot;
+    // A pass is identified by what it read and wrote, not by what a write
+    // replaced (Timer1 has counted on across a skip).  The seconds read from
+    // the RTC are left out too: passes are never skipped past the second
+    // they started in, so one that only differs from the pass before in the
+    // seconds it read is repeated within its own second.  The cycle counter
+    // is only read for timestamps and is left out as well.
+    bool seconds = pending_.address == HIB + HIB_RTCC && value == pending_.value;
+    bool cycles = pending_.address == DWT + DWT_CYCCNT && value == pending_.value;
+    loopHash_ = (loopHash_ ^ (((uint64_t)pending_.address << 32) | (seconds || cycles ? 0 : value)))
+                * LOOP_HASH_PRIME;
+    loopHash_ = (loopHash_ ^ (now_ - loopStart_)) * LOOP_HASH_PRIME;
+    if (value != pending_.value)
+    {
+        lastRead_ = 0;
+        written(pending_.address, pending_.value, value);
+    }
+    else
+    {
+        if (lastRead_ != pending_.address || lastValue_ != value)
+            spinReads_ = 0;
+        lastRead_ = pending_.address;
+        lastValue_ = value;
+        consumed(pending_.address);
+    }
+}
+
+// Bring a register's storage up to date before the firmware sees it
+void Machine::refresh(uint32_t address, uint32_t *slot)
+{
+    uint32_t base = address & ~0xFFFu;
+    uint32_t offset = address & 0xFFF;
+
+    if (isGpio(base))
+    {
+        if (offset < GPIO_DATA)
+            *slot = reg(base + GPIO_DATA) & ((offset >> 2) & 0xFF);
+        return;
+    }
+
+    switch (base)
+    {
+    case UART0:
+        if (offset == UART_FR)
+        {
+            uartUpdate();
+            uint32_t fr = 0;
+            if (txFifo_.size() > UART_FIFO_DEPTH)
+                fr |= UART_FR_TXFF;
+            if (txFifo_.size() <= 1)
+                fr |= UART_FR_TXFE;
+            if (!txFifo_.empty())
+                fr |= UART_FR_BUSY;
+            if (rxFifo_.empty())
+                fr |= UART_FR_RXFE;
+            if (rxFifo_.size() >= UART_FIFO_DEPTH)
+                fr |= UART_FR_RXFF;
+            uint32_t c;
+            if (inputs_ && inputs_->peek(IN_UART, c))
+                fr &= ~UART_FR_RXFE;
+            *slot = fr;
+        }
+        else if (offset == UART_DR && !replay(IN_UART, slot))
+            *slot = (rxFifo_.empty() ? 0 : rxFifo_.front()) | DR_UNREAD;
+        else if (offset == UART_DR)
+            *slot |= DR_UNREAD;
+        break;
+
+    case TIMER1:
+        if (offset == TIMER_TAV && replay(IN_TIMER1, slot))
+            break;
+        if (offset == TIMER_TAV || offset == TIMER_TAR)
+            *slot = timer1Value();
+        else if (offset == TIMER_ICR)
+            *slot = 0;
+        break;
+
+    case TIMER2:
+        if (offset == TIMER_TAV || offset == TIMER_TAR)
+            *slot = timer2Next_ == NEVER ? reg(TIMER2 + TIMER_TAILR) : (uint32_t)(timer2Next_ - now_);
+        else if (offset == TIMER_MIS)
+            *slot = reg(TIMER2 + TIMER_RIS) & reg(TIMER2 + TIMER_IMR);
+        else if (offset == TIMER_ICR)
+            *slot = 0;
+        break;
+
+    case ADC0:
+        if (offset == ADC_ACTSS)
+            *slot = adcConverting_ ? (*slot | ADC_ACTSS_BUSY) : (*slot & ~ADC_ACTSS_BUSY);
+        else if (offset == ADC_SSFSTAT3)
+            *slot = adcFifo_.empty() ? ADC_SSFSTAT3_EMPTY : (adcFifo_.size() >= ADC_FIFO_DEPTH ? ADC_SSFSTAT3_FULL : 0);
+        else if (offset == ADC_SSFIFO3 && !replay(IN_ADC, slot))
+            *slot = adcFifo_.empty() ? 0 : adcFifo_.front();
+        else if (offset == ADC_RIS)
+            *slot = adcFifo_.empty() ? 0 : ADC_RIS_INR3;
+        else if (offset == ADC_PSSI)
+            *slot = 0;
+        break;
+
+    case COMP:
+        if (offset == COMP_ACSTAT0)
+        {
+            bool deint = (reg(GPIOE + GPIO_DATA) >> DEINT_PIN) & 1;
+            *slot = (deint || compHigh_) ? COMP_ACSTAT0_OVAL : 0;
+        }
+        break;
+
+    case HIB:
+        if (offset == HIB_RTCC)
+        {
+            if (loopRtcFirst_ == NEVER)
+                loopRtcFirst_ = now_;
+            loopRtcLast_ = now_;
+            if (replay(IN_RTC, slot))
+                break;
+            if (reg(HIB + HIB_CTL) & HIB_CTL_RTCEN)
+                *slot = rtcBase_ + (uint32_t)((now_ - rtcStart_) / kCyclesPerSecond);
+        }
+        else if (offset == HIB_RTCSS)
+        {
+            loopQuiet_ = false;
+            *slot = (uint32_t)(((now_ - rtcStart_) % kCyclesPerSecond) * 32768 / kCyclesPerSecond);
+        }
+        else if (offset == HIB_CTL)
+            *slot |= HIB_CTL_WRC;
+        else if (offset == HIB_RIS || offset == HIB_MIS)
+            *slot |= HIB_MIS_WC;
+        else if (offset == HIB_RTCLD)
+            *slot = UNWRITTEN;
+        break;
+
+    case EEPROM:
+        if (offset == EE_DONE)
+            *slot = eepromBusy_ ? EEPROM_EEDONE_WORKING : 0;
+        else if ((offset == EE_RDWR || offset == EE_RDWRINC) && !replay(IN_EEPROM, slot))
+            *slot = eeprom_[reg(EEPROM + EE_BLOCK) % EEPROM_BLOCKS][reg(EEPROM + EE_OFFSET) % EEPROM_WORDS];
+        else if (offset == EE_SIZE)
+            *slot = (EEPROM_BLOCKS << 16) | (EEPROM_BLOCKS * EEPROM_WORDS);
+        else if (offset == EE_SUPP)
+            *slot = 0;
+        break;
+
+    case DWT:
+        if (offset == DWT_CYCCNT)
+            *slot = cycleCount();
+        break;
+    }
+}
+
+// A register handed out was modified by the firmware
+void Machine::written(uint32_t address, uint32_t old, uint32_t value)
+{
+    if ((address >> 25) == (BITBAND >> 25))
+    {
+        uint32_t offset = address - BITBAND;
+        uint32_t byte = 0x40000000 + offset / 32;
+        uint32_t word = byte & ~3u;
+        unsigned bit = (offset % 32) / 4 + (byte & 3) * 8;
+        uint32_t *target = storage(word);
+        uint32_t before = *target;
+        if (value & 1)
+            *target |= 1u << bit;
+        else
+            *target &= ~(1u << bit);
+        written(word, before, *target);
+        return;
+    }
+
+    uint32_t base = address & ~0xFFFu;
+    uint32_t offset = address & 0xFFF;
+
+    if (isGpio(base))
+    {
+        if (offset <= GPIO_DATA)
+            gpioWritten(address, old, value);
+        return;
+    }
+
+    switch (base)
+    {
+    case UART0:
+        if (offset == UART_DR)
+            uartTransmit((uint8_t)value);
+        else if (offset == UART_RSR)
+            reg(UART0 + UART_RSR) = 0;
+        break;
+
+    case TIMER1:
+        if (offset == TIMER_TAV)
+        {
+            timer1Base_ = value;
+            timer1Start_ = now_;
+        }
+        else if (offset == TIMER_CTL && ((old ^ value) & TIMER_CTL_TAEN))
+        {
+            if (value & TIMER_CTL_TAEN)
+                timer1Start_ = now_;
+            else
+            {
+                reg(TIMER1 + TIMER_CTL) = old;
+                timer1Base_ = timer1Value();
+                reg(TIMER1 + TIMER_CTL) = value;
+            }
+        }
+        else if (offset == TIMER_ICR)
+            reg(TIMER1 + TIMER_RIS) &= ~value;
+        break;
+
+    case TIMER2:
+        if (offset == TIMER_CTL && ((old ^ value) & TIMER_CTL_TAEN))
+        {
+            cancel(EV_TIMER2);
+            timer2Next_ = NEVER;
+            if (value & TIMER_CTL_TAEN)
+            {
+                timer2Starts_++;
+                timer2Next_ = now_ + std::max<uint32_t>(reg(TIMER2 + TIMER_TAILR), 1) + 1;
+                schedule(timer2Next_, EV_TIMER2);
+            }
+        }
+        else if (offset == TIMER_TAILR && timer2Next_ != NEVER)
+        {
+            // TAILD clear: the new load value takes effect immediately
+            cancel(EV_TIMER2);
+            timer2Next_ = now_ + std::max<uint32_t>(value, 1) + 1;
+            schedule(timer2Next_, EV_TIMER2);
+        }
+        else if (offset == TIMER_ICR)
+            reg(TIMER2 + TIMER_RIS) &= ~value;
+        break;
+
+    case ADC0:
+        if (offset == ADC_PSSI && (value & ADC_PSSI_SS3))
+        {
+            // 1 Msps, one conversion per averaged sample
+            cancel(EV_ADC_DONE);
+            adcConverting_ = true;
+            adcDone_ = now_ + (1ull << (reg(ADC0 + ADC_SAC) & 7)) * kCyclesPerMicrosecond;
+            schedule(adcDone_, EV_ADC_DONE);
+        }
+        break;
+
+    case HIB:
+        if (offset == HIB_RTCLD)
+        {
+            loopQuiet_ = false;
+            rtcBase_ = value;
+            rtcStart_ = now_;
+            reg(HIB + HIB_RTCC) = value;
+        }
+        else if (offset == HIB_CTL && ((old ^ value) & HIB_CTL_RTCEN))
+        {
+            if (value & HIB_CTL_RTCEN)
+            {
+                rtcBase_ = reg(HIB + HIB_RTCC);
+                rtcStart_ = now_;
+            }
+            else
+                reg(HIB + HIB_RTCC) = rtcBase_ + (uint32_t)((now_ - rtcStart_) / kCyclesPerSecond);
+        }
+        break;
+
+    case EEPROM:
+        if (offset == EE_RDWR || offset == EE_RDWRINC)
+        {
+            uint32_t &block = reg(EEPROM + EE_BLOCK);
+            uint32_t &word = reg(EEPROM + EE_OFFSET);
+            eeprom_[block % EEPROM_BLOCKS][word % EEPROM_WORDS] = value;
+            cancel(EV_EEPROM_DONE);
+            eepromBusy_ = true;
+            eepromBusyUntil_ = now_ + EEPROM_WRITE_CYCLES;
+            schedule(eepromBusyUntil_, EV_EEPROM_DONE);
+            eepromWrites_++;
+            loopQuiet_ = false;
+            if (offset == EE_RDWRINC)
+                word = (word + 1) % EEPROM_WORDS;
+        }
+        break;
+
+    // Counts whenever CYCCNTENA is set; TRCENA in DEMCR is not checked
+    case DWT:
+        if (offset == DWT_CYCCNT)
+        {
+            cyccntBase_ = value;
+            cyccntStart_ = now_;
+        }
+        else if (offset == DWT_CTRL && ((old ^ value) & DWT_CTRL_CYCCNTENA))
+        {
+            if (value & DWT_CTRL_CYCCNTENA)
+                cyccntStart_ = now_;
+            else
+            {
+                reg(DWT + DWT_CTRL) = old;
+                cyccntBase_ = cycleCount();
+                reg(DWT + DWT_CTRL) = value;
+            }
+        }
+        break;
+    }
+}
+
+// A register handed out was only read
+void Machine::consumed(uint32_t address)
+{
+    if (address == UART0 + UART_DR)
+    {
+        if (inputs_)
+            inputs_->consume(IN_UART);
+        else if (!rxFifo_.empty())
+            rxFifo_.pop_front();
+    }
+    else if (address == ADC0 + ADC_SSFIFO3)
+    {
+        if (inputs_)
+            inputs_->consume(IN_ADC);
+        if (!adcFifo_.empty())
+            adcFifo_.pop_front();
+    }
+    else if (address == EEPROM + EE_RDWR || address == EEPROM + EE_RDWRINC)
+    {
+        if (inputs_)
+            inputs_->consume(IN_EEPROM);
+        if (address == EEPROM + EE_RDWRINC)
+        {
+            uint32_t &word = reg(EEPROM + EE_OFFSET);
+            word = (word + 1) % EEPROM_WORDS;
+        }
+    }
+    else if (inputs_ && address == TIMER1 + TIMER_TAV)
+        inputs_->consume(IN_TIMER1);
+    else if (inputs_ && address == HIB + HIB_RTCC)
+        inputs_->consume(IN_RTC);
+}
+
+// Hand out the next recorded input in place of the modelled value
+bool Machine::replay(Input input, uint32_t *slot)
+{
+    uint32_t value;
+    if (!inputs_ || !inputs_->peek(input, value))
+        return false;
+    *slot = value;
+    return true;
+}
+
+// Skip ahead over busy-wait loops on status registers
+void Machine::pollWait(uint32_t address)
+{
+    uint64_t until = now_;
+    switch (address)
+    {
+    case EEPROM + EE_DONE:
+        if (eepromBusy_)
+            until = eepromBusyUntil_;
+        break;
+    case ADC0 + ADC_ACTSS:
+    case ADC0 + ADC_SSFSTAT3:
+        if (adcConverting_)
+            until = adcDone_;
+        break;
+    case COMP + COMP_ACSTAT0:
+        if (compHigh_ && !((reg(GPIOE + GPIO_DATA) >> DEINT_PIN) & 1))
+            until = compLowAt_;
+        break;
+    case UART0 + UART_FR:
+        // A loop re-reading FR with nothing else in between is waiting on it
+        if (lastRead_ == address && ++spinReads_ >= 2)
+        {
+            uartUpdate();
+            until = events_.nextTime();
+            if (txFifo_.size() > UART_FIFO_DEPTH)
+                until = std::min(until, txFifo_.front());
+            if (until == NEVER)
+                until = now_;
+        }
+        break;
+    }
+    if (until > now_)
+        advanceTo(until);
+}
+
+// Called at each read of UART0 FR, which the main loop polls once per pass
+void Machine::loopBoundary()
+{
+    uint64_t length = now_ - loopStart_;
+    uint64_t from = loopStart_;
+    bool repeated = loopSkipping_ && !inputs_ && loopQuiet_ && length > 0
+                    && length == lastLoopLength_ && loopHash_ == lastLoopHash_;
+    lastLoopHash_ = loopHash_;
+    lastLoopLength_ = loopQuiet_ ? length : 0;
+
+    if (repeated)
+    {
+        // Both passes read the same values, so further passes will too
+        // until something they read can change
+        uint64_t until = std::min(events_.nextTime(), board_.inputsSteadyUntil(from));
+        uint64_t loops = until > now_ ? (until - now_) / length : 0;
+
+        // Each skipped pass must read the RTC in the second this one did
+        if (loopRtcFirst_ != NEVER && (reg(HIB + HIB_CTL) & HIB_CTL_RTCEN))
+        {
+            uint64_t first = std::max(loopRtcFirst_, rtcStart_) - rtcStart_;
+            uint64_t next = rtcStart_ + (first / kCyclesPerSecond + 1) * kCyclesPerSecond;
+            uint64_t last = now_ + (loopRtcLast_ - from);
+            loops = std::min(loops, next > last ? (next - 1 - last) / length + 1 : 0);
+        }
+
+        uartUpdate();
+        if (!txFifo_.empty() || adcConverting_ || compHigh_ || eepromBusy_)
+            loops = 0;
+        if (loops)
+        {
+            now_ += loops * length;
+            skippedLoops_ += loops;
+            skippedCycles_ += loops * length;
+        }
+    }
+
+    loopStart_ = now_;
+    loopHash_ = LOOP_HASH_SEED;
+    loopQuiet_ = true;
+    loopRtcFirst_ = NEVER;
+    loopRtcLast_ = NEVER;
+}
+
+//-----------------------------------------------------------------------------
+// Time and events
+//-----------------------------------------------------------------------------
+
+void Machine::schedule(uint64_t when, EventKind kind)
+{
+    events_.schedule(when, kind, generation_[kind]);
+}
+
+void Machine::schedule(uint64_t when, std::function<void(Machine &)> callback)
+{
+    uint64_t id = nextHostEvent_++;
+    hostEvents_[id] = callback;
+    events_.schedule(std::max(when, now_), EV_HOST, 0, id);
+}
+
+void Machine::setPollHook(std::function<void(Machine &)> hook, uint64_t periodCycles)
+{
+    cancel(EV_POLL);
+    pollHook_ = hook;
+    pollPeriod_ = std::max<uint64_t>(periodCycles, 1);
+    if (hook)
+        schedule(now_ + pollPeriod_, EV_POLL);
+}
+
+void Machine::advanceTo(uint64_t target)
+{
+    while (events_.nextTime() <= target)
+    {
+        Event event = events_.pop();
+        if (event.kind != EV_HOST && event.generation != generation_[event.kind])
+            continue;
+        now_ = std::max(now_, event.time);
+        fire(event);
+    }
+    now_ = std::max(now_, target);
+}
+
+void Machine::fire(const Event &event)
+{
+    // Anything arriving from outside the loop may change what it reads
+    if (event.kind != EV_ADC_DONE && event.kind != EV_COMP_LOW && event.kind != EV_EEPROM_DONE)
+        loopQuiet_ = false;
+
+    switch (event.kind)
+    {
+    case EV_TIMER2:
+    {
+        uint32_t period = std::max<uint32_t>(reg(TIMER2 + TIMER_TAILR), 1) + 1;
+        timer2Next_ = now_ + period;
+        schedule(timer2Next_, EV_TIMER2);
+        reg(TIMER2 + TIMER_RIS) |= TIMER_RIS_TATORIS;
+        if ((reg(TIMER2 + TIMER_IMR) & TIMER_IMR_TATOIM)
+            && (reg(NVIC_EN0) & (1u << (INT_TIMER2A - 16))))
+        {
+            timer2Interrupts_++;
+            interrupt(INT_TIMER2A);
+        }
+        break;
+    }
+    case EV_UART_RX:
+        rxScheduled_ = false;
+        uartReceived();
+        break;
+    case EV_ADC_DONE:
+    {
+        adcConverting_ = false;
+        unsigned ain = reg(ADC0 + ADC_SSMUX3) & 0xF;
+        if (adcFifo_.size() < ADC_FIFO_DEPTH)
+            adcFifo_.push_back(board_.adcSample(ain, now_) & 0xFFF);
+        break;
+    }
+    case EV_EEPROM_DONE:
+        eepromBusy_ = false;
+        break;
+    case EV_COMP_LOW:
+        compHigh_ = false;
+        break;
+    case EV_HOST:
+    {
+        auto found = hostEvents_.find(event.tag);
+        std::function<void(Machine &)> callback = std::move(found->second);
+        hostEvents_.erase(found);
+        callback(*this);
+        break;
+    }
+    case EV_POLL:
+        schedule(now_ + pollPeriod_, EV_POLL);
+        pollHook_(*this);
+        break;
+    }
+}
+
+void Machine::interrupt(unsigned vector)
+{
+    if (inIsr_ || vector >= vectorCount_ || !vectors_[vector])
+        return;
+    inIsr_ = true;
+    loopQuiet_ = false;
+    vectors_[vector]();
+    settle();
+    inIsr_ = false;
+}
+
+void Machine::setRtc(uint32_t seconds)
+{
+    rtcBase_ = seconds;
+    rtcStart_ = now_;
+    reg(HIB + HIB_RTCC) = seconds;
+}
+
+void Machine::setHibernationData(unsigned word, uint32_t value)
+{
+    reg(HIB + HIB_DATA + 4 * (word % 16)) = value;
+}
+
+uint32_t Machine::rtcSeconds()
+{
+    uint32_t rtc = reg(HIB + HIB_RTCC);
+    refresh(HIB + HIB_RTCC, &rtc);
+    return rtc;
+}
+
+//-----------------------------------------------------------------------------
+// Peripherals
+//-----------------------------------------------------------------------------
+
+void Machine::gpioWritten(uint32_t address, uint32_t old, uint32_t value)
+{
+    uint32_t base = address & ~0xFFFu;
+    uint32_t offset = address & 0xFFF;
+    uint32_t &data = reg(base + GPIO_DATA);
+    uint32_t before;
+    if (offset == GPIO_DATA)
+        before = old;
+    else
+    {
+        uint32_t mask = (offset >> 2) & 0xFF;
+        before = data;
+        data = (data & ~mask) | (value & mask);
+    }
+
+    uint32_t changed = (before ^ data) & 0xFF;
+    Port port = gpioPort(base);
+    for (unsigned pin = 0; changed; pin++, changed >>= 1)
+    {
+        if (!(changed & 1))
+            continue;
+        bool level = (data >> pin) & 1;
+        if (port == PORT_A && pin == SPEAKER_PIN)
+            speakerToggles_++;
+        if (port != PORT_E || pin != DEINT_PIN)
+            loopQuiet_ = false;
+        if (port == PORT_E && pin == DEINT_PIN && !level)
+        {
+            // Capacitor charged while DEINT was high; output stays high
+            // until it has discharged below the reference
+            cancel(EV_COMP_LOW);
+            compHigh_ = true;
+            compLowAt_ = now_ + board_.dischargeCycles(now_);
+            schedule(compLowAt_, EV_COMP_LOW);
+        }
+        board_.pinChanged(port, pin, level, now_);
+    }
+}
+
+uint32_t Machine::timer1Value() const
+{
+    uint32_t *ctl = const_cast<Machine *>(this)->storage(TIMER1 + TIMER_CTL);
+    if (!(*ctl & TIMER_CTL_TAEN))
+        return timer1Base_;
+    return timer1Base_ + (uint32_t)(now_ - timer1Start_);
+}
+
+uint32_t Machine::cycleCount() const
+{
+    uint32_t *ctl = const_cast<Machine *>(this)->storage(DWT + DWT_CTRL);
+    if (!(*ctl & DWT_CTRL_CYCCNTENA))
+        return cyccntBase_;
+    return cyccntBase_ + (uint32_t)(now_ - cyccntStart_);
+}
+
+uint64_t Machine::uartCharCycles() const
+{
+    // 10 bit times of 16 sample clocks at IBRD + FBRD/64 system clocks each
+    uint32_t *ibrd = const_cast<Machine *>(this)->storage(UART0 + UART_IBRD);
+    uint32_t *fbrd = const_cast<Machine *>(this)->storage(UART0 + UART_FBRD);
+    uint64_t divisor64 = (uint64_t)*ibrd * 64 + (*fbrd & 63);
+    if (divisor64 == 0)
+        divisor64 = 21 * 64 + 45;
+    return (10 * 16 * divisor64 + 63) / 64;
+}
+
+uint64_t Machine::hostCharCycles() const
+{
+    return hostBaud_ ? 10ull * kSysClockHz / hostBaud_ : uartCharCycles();
+}
+
+uint32_t Machine::baudRate() const
+{
+    return (uint32_t)(10ull * kSysClockHz / uartCharCycles());
+}
+
+void Machine::uartTransmit(uint8_t c)
+{
+    uartUpdate();
+    uint64_t start = txFifo_.empty() ? now_ : txFifo_.back();
+    txFifo_.push_back(start + uartCharCycles());
+    loopQuiet_ = false;
+    if (!txSink_)
+        return;
+    if (hostBaud_)
+    {
+        uint16_t seen = resample(c, uartCharCycles() / 10.0, (double)kSysClockHz / hostBaud_);
+        txFramingErrors_ += (seen & DR_FE) != 0;
+        c = (uint8_t)seen;
+    }
+    txSink_(c);
+}
+
+void Machine::uartUpdate()
+{
+    while (!txFifo_.empty() && txFifo_.front() <= now_)
+        txFifo_.pop_front();
+}
+
+bool Machine::txIdle()
+{
+    uartUpdate();
+    return txFifo_.empty();
+}
+
+void Machine::receive(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    rxPending_.insert(rxPending_.end(), bytes, bytes + length);
+    if (!rxScheduled_ && !rxPending_.empty())
+    {
+        rxScheduled_ = true;
+        schedule(now_ + hostCharCycles(), EV_UART_RX);
+    }
+}
+
+// One character time has passed on the RX line
+void Machine::uartReceived()
+{
+    if (rxPending_.empty())
+        return;
+    if (rxFifo_.size() < UART_FIFO_DEPTH)
+    {
+        uint16_t c = rxPending_.front();
+        rxPending_.pop_front();
+        if (hostBaud_)
+        {
+            c = resample((uint8_t)c, (double)kSysClockHz / hostBaud_, uartCharCycles() / 10.0);
+            if (c & DR_FE)
+            {
+                rxFramingErrors_++;
+                reg(UART0 + UART_RSR) |= UART_RSR_FE;
+            }
+        }
+        rxFifo_.push_back(c);
+    }
+    else if (!rxFlowControl_)
+    {
+        rxPending_.pop_front();
+        rxOverruns_++;
+        reg(UART0 + UART_RSR) |= UART_RSR_OE;
+    }
+    if (!rxPending_.empty())
+    {
+        rxScheduled_ = true;
+        schedule(now_ + hostCharCycles(), EV_UART_RX);
+    }
+}
+
+bool Machine::pumpOn(unsigned pot) const
+{
+    static const uint32_t BASES[PORT_COUNT] = { GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF };
+    const PotWiring &wiring = kPotWiring[pot];
+    return (*const_cast<Machine *>(this)->storage(BASES[wiring.pumpPort] + GPIO_DATA) >> wiring.pumpPin) & 1;
+}
+
+bool Machine::speakerLevel() const
+{
+    return (*const_cast<Machine *>(this)->storage(GPIOA + GPIO_DATA) >> SPEAKER_PIN) & 1;
+}
+
+uint32_t Machine::eepromWord(unsigned block, unsigned offset) const
+{
+    return eeprom_[block % EEPROM_BLOCKS][offset % EEPROM_WORDS];
+}
+
+//-----------------------------------------------------------------------------
+// Thread binding
+//-----------------------------------------------------------------------------
+
+Machine *current()
+{
+    return boundMachine;
+}
+
+void bind(Machine *machine)
+{
+    boundMachine = machine;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// simhw.h
+//-----------------------------------------------------------------------------
+
+extern "C" void *simRegister(uint32_t address)
+{
+    return (void *)sim::boundMachine->access(address);
+}
+
+extern "C" void simDelayCycles(uint32_t cycles)
+{
+    sim::boundMachine->delayCycles(cycles);
+}
+
+extern "C" void simWaitMicrosecond(uint32_t us)
+{
+    sim::boundMachine->waitMicrosecond(us);
+}
+
+extern "C" void *simGlobal(const void *key, uint32_t size)
+{
+    return sim::boundMachine->global(key, size);
+}
+
+extern "C" uint64_t simSkippedLoops(void)
+{
+    return sim::boundMachine->skippedLoops();
+}
+
+extern "C" uint64_t simSkippedCycles(void)
+{
+    return sim::boundMachine->skippedCycles();
+}
+
+extern "C" uint64_t simHostNanoseconds(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
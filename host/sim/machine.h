@@ -0,0 +1,365 @@
+// Simulated TM4C123 Machine
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+// Target uC:       TM4C123GH6PM (register file stand-in)
+// System Clock:    40 MHz (virtual)
+
+// Peripherals modelled:
+//   SYSCTL, NVIC:  plain storage
+//   GPIO A/C/E/F:  DATA (including bit-band aliases), output changes reported
+//                  to the board (PA2 pump, PA3 speaker, PE5 DEINT)
+//   ADC0 SS3:      processor-triggered single sample from the board's inputs
+//   UART0:         16-deep TX/RX FIFOs paced at the programmed baud rate;
+//                  framing errors (RSR FE, DR bit 8) when the host side's
+//                  rate differs
+//   TIMER1:        32-bit count-up free-running counter
+//   TIMER2:        32-bit periodic count-down with time-out interrupt
+//   COMP0:         output high until the board's discharge time after DEINT
+//                  falls
+//   HIB:           RTC seconds counter with load register
+//   EEPROM:        32 blocks of 16 words with write programming delay
+
+// Register accesses are resolved through Machine::access(), which returns a
+// pointer to the register's storage.  The effect of a write (or of a read with
+// side effects, such as popping a FIFO) is applied when the firmware makes its
+// next register access or waits, by comparing the storage with the value it
+// held when the pointer was handed out.
+
+// Time only moves when the firmware touches a register (kAccessCycles) or
+// waits.  Everything that happens on its own -- timer time-outs, UART
+// characters arriving, ADC conversions, EEPROM programming, the comparator
+// falling, and host callbacks -- is an event on a single queue, processed in
+// time order as the clock advances.  Busy-wait loops on status registers are
+// skipped by advancing straight to the event that ends them.
+
+// An InputSource, when set, supplies the values of the reads a capture
+// records (see replay.h) in their recorded order, in place of the board's.
+
+// The firmware's main loop polls UART0 FR once per pass.  When a pass that
+// produced no output read and wrote exactly what the previous pass did, and
+// nothing it reads can change before a given time (no pending event, the
+// RTC second, the board's inputs), the passes up to that time are skipped
+// as well.  This assumes the idle pass depends only on what it reads from
+// the registers; setLoopSkipping(false) runs every pass.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_MACHINE_H_
+#define SIM_MACHINE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "events.h"
+
+namespace sim {
+
+const uint32_t kSysClockHz = 40000000;
+const uint64_t kCyclesPerMicrosecond = kSysClockHz / 1000000;
+const uint64_t kCyclesPerSecond = kSysClockHz;
+
+// Approximate cost of one register access plus surrounding instructions
+const uint64_t kAccessCycles = 4;
+
+// GPIO ports used by the flowerpot
+enum Port { PORT_A, PORT_B, PORT_C, PORT_D, PORT_E, PORT_F, PORT_COUNT };
+
+// Pump pin and moisture input of each pot, as in board.cpp
+struct PotWiring
+{
+    Port pumpPort;
+    unsigned pumpPin;
+    unsigned moistureAin;
+};
+
+const unsigned kMaxPots = 8;
+extern const PotWiring kPotWiring[kMaxPots];
+
+//-----------------------------------------------------------------------------
+// Board: the outside world wired to the pins
+//-----------------------------------------------------------------------------
+
+class Board
+{
+public:
+    virtual ~Board() {}
+
+    // Raw 12-bit ADC result for analog input AINn at time now
+    virtual uint16_t adcSample(unsigned ain, uint64_t now) = 0;
+
+    // Cycles from DEINT falling until the comparator output goes low
+    virtual uint32_t dischargeCycles(uint64_t now) = 0;
+
+    // Called when a GPIO output pin changes level
+    virtual void pinChanged(Port port, unsigned pin, bool level, uint64_t now)
+    {
+        (void)port; (void)pin; (void)level; (void)now;
+    }
+
+    // Latest time up to which adcSample() and dischargeCycles() keep
+    // returning what they return at from.  Repeated idle loops are only
+    // skipped this far, and DEINT changes inside them are not reported.
+    virtual uint64_t inputsSteadyUntil(uint64_t from) { return from; }
+};
+
+// Board with constant sensor readings
+class StaticBoard : public Board
+{
+public:
+    StaticBoard();
+
+    void setMoisturePercent(double percent);
+    void setLightPercent(double percent);
+    void setBatteryVoltage(double volts);
+    void setVolumeMilliliters(double ml);
+
+    uint16_t adcSample(unsigned ain, uint64_t now) override;
+    uint32_t dischargeCycles(uint64_t now) override;
+    uint64_t inputsSteadyUntil(uint64_t from) override;
+
+private:
+    uint16_t ain_[12];
+    uint32_t discharge_;
+};
+
+// Sensor transfer functions matching the conversions in main.c
+uint16_t percentToAdc(double percent);
+uint16_t batteryToAdc(double volts);
+uint32_t volumeToDischargeCycles(double ml);
+
+//-----------------------------------------------------------------------------
+// InputSource: recorded inputs fed back to the firmware
+//-----------------------------------------------------------------------------
+
+// Reads whose values are replayed
+enum Input
+{
+    IN_ADC,                           // ADC0 SSFIFO3
+    IN_TIMER1,                        // TIMER1 TAV
+    IN_RTC,                           // HIB RTCC
+    IN_UART,                          // UART0 DR (and FR RXFE)
+    IN_EEPROM                         // EEPROM EERDWR
+};
+
+class InputSource
+{
+public:
+    virtual ~InputSource() {}
+
+    // Value of the next recorded input, if it is of the given kind
+    virtual bool peek(Input input, uint32_t &value) = 0;
+
+    // The firmware has read an input of the given kind
+    virtual void consume(Input input) = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Machine
+//-----------------------------------------------------------------------------
+
+class Machine
+{
+public:
+    explicit Machine(Board &board);
+    ~Machine();
+
+    Machine(const Machine &) = delete;
+    Machine &operator=(const Machine &) = delete;
+
+    // Interrupt handlers indexed by interrupt number (INT_*)
+    void setVectorTable(void (* const *vectors)(void), unsigned count);
+
+    // Firmware-facing hooks (see simhw.h)
+    volatile uint32_t *access(uint32_t address);
+    void delayCycles(uint64_t cycles);
+    void waitMicrosecond(uint32_t us);
+    void *global(const void *key, size_t size);
+
+    // Virtual time
+    uint64_t now() const { return now_; }
+    double seconds() const { return (double)now_ / kCyclesPerSecond; }
+    void setRtc(uint32_t seconds);
+    uint32_t rtcSeconds();
+
+    // Battery-backed hibernation memory (HIB_DATA), kept across resets
+    void setHibernationData(unsigned word, uint32_t value);
+
+    // Replay recorded inputs instead of sampling the board (nullptr to
+    // stop).  Idle loops are not skipped while replaying.
+    void setInputSource(InputSource *inputs) { inputs_ = inputs; }
+
+    // UART0 link to the host side
+    void receive(const void *data, size_t length);
+    void setRxFlowControl(bool on) { rxFlowControl_ = on; }
+    void setTxSink(std::function<void(uint8_t)> sink) { txSink_ = sink; }
+    size_t rxPending() const { return rxPending_.size() + rxFifo_.size(); }
+    bool txIdle();
+    uint32_t baudRate() const;
+    uint64_t rxOverruns() const { return rxOverruns_; }
+
+    // The host side's rate, 0 (the default) for whatever the board's is.
+    // At another rate each character is seen as its receiver would sample
+    // it: the middle of each of its own bit times from the start bit, a
+    // stop bit sampled low being a framing error.  One character still
+    // arrives for each one sent.
+    void setHostBaudRate(uint32_t baud) { hostBaud_ = baud; }
+    uint64_t rxFramingErrors() const { return rxFramingErrors_; }
+    uint64_t txFramingErrors() const { return txFramingErrors_; }
+
+    // Host callbacks, run on the firmware's thread at the given virtual time
+    void schedule(uint64_t when, std::function<void(Machine &)> callback);
+    void setPollHook(std::function<void(Machine &)> hook, uint64_t periodCycles);
+
+    // Skipping of repeated idle loops (on by default)
+    void setLoopSkipping(bool on) { loopSkipping_ = on; }
+    uint64_t skippedLoops() const { return skippedLoops_; }
+    uint64_t skippedCycles() const { return skippedCycles_; }
+
+    // Observable outputs
+    bool pumpOn(unsigned pot = 0) const;
+    bool speakerLevel() const;
+    uint64_t speakerToggles() const { return speakerToggles_; }
+    uint64_t timer2Interrupts() const { return timer2Interrupts_; }
+    uint64_t timer2Starts() const { return timer2Starts_; }
+    uint32_t eepromWord(unsigned block, unsigned offset) const;
+    uint64_t eepromWrites() const { return eepromWrites_; }
+
+private:
+    struct Page { uint32_t word[1024]; };
+    struct Pending
+    {
+        uint32_t address;
+        uint32_t *slot;
+        uint32_t value;
+    };
+
+    uint32_t *storage(uint32_t address);
+    uint32_t &reg(uint32_t address) { return *storage(address); }
+    void settle();
+    void refresh(uint32_t address, uint32_t *slot);
+    void written(uint32_t address, uint32_t old, uint32_t value);
+    void consumed(uint32_t address);
+    void pollWait(uint32_t address);
+    void loopBoundary();
+
+    enum EventKind
+    {
+        EV_TIMER2,
+        EV_UART_RX,
+        EV_ADC_DONE,
+        EV_EEPROM_DONE,
+        EV_COMP_LOW,
+        EV_HOST,
+        EV_POLL,
+        EV_KINDS
+    };
+
+    void advanceTo(uint64_t target);
+    void schedule(uint64_t when, EventKind kind);
+    void cancel(EventKind kind) { generation_[kind]++; }
+    void fire(const Event &event);
+    void interrupt(unsigned vector);
+
+    void gpioWritten(uint32_t address, uint32_t old, uint32_t value);
+    uint32_t timer1Value() const;
+    uint32_t cycleCount() const;
+    void uartTransmit(uint8_t c);
+    void uartReceived();
+    void uartUpdate();
+    uint64_t uartCharCycles() const;
+    uint64_t hostCharCycles() const;
+
+    bool replay(Input input, uint32_t *slot);
+
+    Board &board_;
+    InputSource *inputs_;
+    std::array<std::unique_ptr<Page>, 512> pages_;
+    Pending pending_;
+    bool hasPending_;
+    uint32_t bitband_;
+    uint32_t lastRead_;
+    uint32_t lastValue_;
+    unsigned spinReads_;
+    bool inIsr_;
+    uint64_t now_;
+    void (* const *vectors_)(void);
+    unsigned vectorCount_;
+
+    EventQueue events_;
+    uint32_t generation_[EV_KINDS];
+    std::unordered_map<uint64_t, std::function<void(Machine &)>> hostEvents_;
+    uint64_t nextHostEvent_;
+    std::function<void(Machine &)> pollHook_;
+    uint64_t pollPeriod_;
+
+    bool loopSkipping_;
+    bool loopQuiet_;
+    uint64_t loopStart_;
+    uint64_t loopRtcFirst_;           // RTC reads in this pass
+    uint64_t loopRtcLast_;
+    uint64_t loopHash_;
+    uint64_t lastLoopHash_;
+    uint64_t lastLoopLength_;
+    uint64_t skippedLoops_;
+    uint64_t skippedCycles_;
+
+    uint64_t speakerToggles_;
+
+    uint64_t adcDone_;
+    bool adcConverting_;
+    std::deque<uint16_t> adcFifo_;
+
+    std::deque<uint8_t> rxPending_;
+    std::deque<uint16_t> rxFifo_;     // Bit 8 set on a framing error
+    bool rxScheduled_;
+    bool rxFlowControl_;
+    uint64_t rxOverruns_;
+    uint32_t hostBaud_;
+    uint64_t rxFramingErrors_;
+    uint64_t txFramingErrors_;
+    std::deque<uint64_t> txFifo_;
+    std::function<void(uint8_t)> txSink_;
+
+    uint64_t timer1Start_;
+    uint32_t timer1Base_;
+    uint64_t timer2Next_;
+    uint64_t timer2Interrupts_;
+    uint64_t timer2Starts_;
+
+    uint64_t compLowAt_;
+    bool compHigh_;
+
+    uint32_t rtcBase_;
+    uint64_t rtcStart_;
+
+    uint32_t eeprom_[32][16];
+    uint64_t eepromBusyUntil_;
+    bool eepromBusy_;
+    uint64_t eepromWrites_;
+
+    uint64_t cyccntStart_;
+    uint32_t cyccntBase_;
+
+    // Firmware globals (simGlobal); a handful, looked up on every use
+    std::vector<std::pair<const void *, std::unique_ptr<uint8_t[]>>> globals_;
+};
+
+// Machine used by firmware running on the calling thread
+Machine *current();
+void bind(Machine *machine);
+
+}
+
+#endif
@@ -0,0 +1,407 @@
+// Plant Model
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#include "plant.h"
+
+namespace sim {
+
+namespace {
+
+const unsigned BATTERY_AIN = 0;
+const unsigned LIGHT_AIN = 2;
+const uint64_t STEP_CYCLES = kCyclesPerSecond;
+const double STEP_HOURS = 1.0 / 3600;
+
+// How far inputsSteadyUntil() looks ahead
+const unsigned STEADY_HORIZON_STEPS = 3600;
+
+struct Parameter
+{
+    const char *name;
+    double PlantParameters::*field;
+};
+
+const Parameter PARAMETERS[] =
+{
+    { "soil-capacity",      &PlantParameters::soilCapacityMl },
+    { "soil-start",         &PlantParameters::soilStart },
+    { "field-capacity",     &PlantParameters::fieldCapacity },
+    { "drainage",           &PlantParameters::drainagePerHour },
+    { "wilting-point",      &PlantParameters::wiltingPoint },
+    { "stress-point",       &PlantParameters::stressPoint },
+    { "transpire-day",      &PlantParameters::transpireDayMlPerHour },
+    { "transpire-night",    &PlantParameters::transpireNightMlPerHour },
+    { "pot-spread",         &PlantParameters::potSpread },
+    { "start-hour",         &PlantParameters::startHour },
+    { "sunrise",            &PlantParameters::sunriseHour },
+    { "sunset",             &PlantParameters::sunsetHour },
+    { "light-peak",         &PlantParameters::lightPeakPercent },
+    { "light-dark",         &PlantParameters::lightDarkPercent },
+    { "moisture-dry",       &PlantParameters::moistureDryPercent },
+    { "moisture-wet",       &PlantParameters::moistureWetPercent },
+    { "probe-lag",          &PlantParameters::probeLagSeconds },
+    { "pump-flow",          &PlantParameters::pumpMlPerSecond },
+    { "reservoir",          &PlantParameters::reservoirMl },
+    { "battery",            &PlantParameters::batteryVolts },
+    { "battery-sag",        &PlantParameters::batterySagVoltsPerDay },
+    { "leak",               &PlantParameters::leakMlPerHour },
+    { "pump-fail",          &PlantParameters::pumpFailHour },
+    { "probe-fail",         &PlantParameters::probeFailHour },
+};
+
+}
+
+//-----------------------------------------------------------------------------
+// PlantParameters
+//-----------------------------------------------------------------------------
+
+// A 1 l pot with a small herb on a windowsill
+PlantParameters::PlantParameters()
+    : soilCapacityMl(400),
+      soilStart(0.38),
+      fieldCapacity(0.7),
+      drainagePerHour(0.5),
+      wiltingPoint(0.1),
+      stressPoint(0.3),
+      transpireDayMlPerHour(5),
+      transpireNightMlPerHour(0.3),
+      potSpread(0.4),
+      startHour(6),
+      sunriseHour(6),
+      sunsetHour(20),
+      lightPeakPercent(85),
+      lightDarkPercent(2),
+      moistureDryPercent(5),
+      moistureWetPercent(85),
+      probeLagSeconds(0),
+      pumpMlPerSecond(4),
+      reservoirMl(1500),
+      batteryVolts(6),
+      batterySagVoltsPerDay(0.02),
+      leakMlPerHour(0),
+      pumpFailHour(0),
+      probeFailHour(0)
+{
+}
+
+bool PlantParameters::set(const std::string &assignment, std::string &error)
+{
+    size_t equals = assignment.find('=');
+    std::string name = assignment.substr(0, equals);
+    for (const Parameter &parameter : PARAMETERS)
+    {
+        if (name != parameter.name)
+            continue;
+        char *end;
+        const char *text = equals == std::string::npos ? "" : assignment.c_str() + equals + 1;
+        double value = strtod(text, &end);
+        if (*text == '\0' || *end != '\0')
+        {
+            error = "bad value in '" + assignment + "'";
+            return false;
+        }
+        this->*parameter.field = value;
+        return true;
+    }
+    error = "unknown plant parameter '" + name + "'";
+    return false;
+}
+
+std::string PlantParameters::describe() const
+{
+    std::string text;
+    for (const Parameter &parameter : PARAMETERS)
+    {
+        char line[64];
+        snprintf(line, sizeof(line), "%-18s %g\n", parameter.name, this->*parameter.field);
+        text += line;
+    }
+    return text;
+}
+
+//-----------------------------------------------------------------------------
+// PlantBoard
+//-----------------------------------------------------------------------------
+
+PlantBoard::PlantBoard(const PlantParameters &parameters, unsigned pots)
+    : parameters_(parameters),
+      steadyFrom_(1),
+      steadyUntil_(0)
+{
+    pots = std::min(std::max(pots, 1u), kMaxPots);
+    state_.time = 0;
+    state_.reservoir = parameters_.reservoirMl;
+    state_.stuckProbe = -1;
+    double soil = parameters_.soilStart * parameters_.soilCapacityMl;
+    state_.pots.assign(pots, Pot { soil, soil, 0, 0, 0 });
+    pumps_.assign(pots, Pump { false, 0, 0, 0, 0 });
+    for (unsigned pot = 0; pot < pots; pot++)
+    {
+        double place = pots > 1 ? (double)pot / (pots - 1) - 0.5 : 0;
+        transpireScale_.push_back(std::max(0.0, 1 + parameters_.potSpread * place));
+    }
+}
+
+uint16_t PlantBoard::adcSample(unsigned ain, uint64_t now)
+{
+    advance(now);
+    Readings r = readings(state_);
+    if (ain == BATTERY_AIN)
+        return r.battery;
+    if (ain == LIGHT_AIN)
+        return r.light;
+    for (unsigned pot = 0; pot < pots(); pot++)
+        if (kPotWiring[pot].moistureAin == ain)
+            return r.moisture[pot];
+    return 0;
+}
+
+uint32_t PlantBoard::dischargeCycles(uint64_t now)
+{
+    advance(now);
+    return readings(state_).discharge;
+}
+
+void PlantBoard::pinChanged(Port port, unsigned pin, bool level, uint64_t now)
+{
+    unsigned pot;
+    for (pot = 0; pot < pots(); pot++)
+        if (kPotWiring[pot].pumpPort == port && kPotWiring[pot].pumpPin == pin)
+            break;
+    if (pot == pots() || level == pumps_[pot].on)
+        return;
+    advance(now);
+    Pump &p = pumps_[pot];
+    if (level)
+    {
+        p.runs++;
+        p.onSince = now;
+        p.from = now;
+    }
+    else
+    {
+        pump(state_, pot, std::max(p.from, state_.time), now);
+        p.onCycles += now - p.onSince;
+    }
+    p.on = level;
+    steadyUntil_ = 0;
+}
+
+uint64_t PlantBoard::inputsSteadyUntil(uint64_t from)
+{
+    // Readings may already have moved on since from
+    advance(from);
+    if (state_.time > from)
+        return from;
+    if (from >= steadyFrom_ && from <= steadyUntil_)
+        return steadyUntil_;
+
+    // Step a copy forward until one of the readings moves
+    State ahead = state_;
+    Readings now = readings(ahead);
+    unsigned steps;
+    for (steps = 0; steps < STEADY_HORIZON_STEPS; steps++)
+    {
+        step(ahead);
+        if (!(readings(ahead) == now))
+            break;
+    }
+    steadyFrom_ = from;
+    steadyUntil_ = ahead.time - 1;
+    return steadyUntil_;
+}
+
+double PlantBoard::theta(uint64_t now, unsigned pot)
+{
+    advance(now);
+    return state_.pots[pot].soil / parameters_.soilCapacityMl;
+}
+
+double PlantBoard::reservoirMl(uint64_t now)
+{
+    advance(now);
+    return state_.reservoir;
+}
+
+double PlantBoard::moisturePercent(uint64_t now, unsigned pot)
+{
+    double dry = parameters_.moistureDryPercent;
+    return dry + (parameters_.moistureWetPercent - dry) * theta(now, pot);
+}
+
+double PlantBoard::lightPercent(uint64_t now) const
+{
+    double dark = parameters_.lightDarkPercent;
+    return dark + (parameters_.lightPeakPercent - dark) * lightFraction(now);
+}
+
+double PlantBoard::batteryVolts(uint64_t now) const
+{
+    double days = (double)now / kCyclesPerSecond / 86400;
+    return parameters_.batteryVolts - parameters_.batterySagVoltsPerDay * days;
+}
+
+double PlantBoard::pumpedMl() const
+{
+    double total = 0;
+    for (const Pot &pot : state_.pots)
+        total += pot.pumped;
+    return total;
+}
+
+double PlantBoard::transpiredMl() const
+{
+    double total = 0;
+    for (const Pot &pot : state_.pots)
+        total += pot.transpired;
+    return total;
+}
+
+double PlantBoard::drainedMl() const
+{
+    double total = 0;
+    for (const Pot &pot : state_.pots)
+        total += pot.drained;
+    return total;
+}
+
+uint64_t PlantBoard::pumpRuns() const
+{
+    uint64_t total = 0;
+    for (const Pump &pump : pumps_)
+        total += pump.runs;
+    return total;
+}
+
+double PlantBoard::pumpSeconds(uint64_t now) const
+{
+    double total = 0;
+    for (unsigned pot = 0; pot < pots(); pot++)
+        total += pumpSeconds(now, pot);
+    return total;
+}
+
+double PlantBoard::pumpSeconds(uint64_t now, unsigned pot) const
+{
+    const Pump &p = pumps_[pot];
+    uint64_t cycles = p.onCycles + (p.on ? now - p.onSince : 0);
+    return (double)cycles / kCyclesPerSecond;
+}
+
+// Commit whole steps up to the one containing now
+void PlantBoard::advance(uint64_t now)
+{
+    while (state_.time + STEP_CYCLES <= now)
+    {
+        step(state_);
+        for (Pump &pump : pumps_)
+            if (pump.on)
+                pump.from = std::max(pump.from, state_.time);
+    }
+}
+
+void PlantBoard::step(State &state) const
+{
+    const PlantParameters &p = parameters_;
+    uint64_t end = state.time + STEP_CYCLES;
+    double light = lightFraction(state.time);
+    for (unsigned n = 0; n < state.pots.size(); n++)
+    {
+        if (pumps_[n].on)
+            pump(state, n, std::max(pumps_[n].from, state.time), end);
+
+        Pot &pot = state.pots[n];
+        double theta = pot.soil / p.soilCapacityMl;
+        if (theta > p.fieldCapacity)
+        {
+            double drained = (theta - p.fieldCapacity) * p.soilCapacityMl * p.drainagePerHour * STEP_HOURS;
+            pot.soil -= drained;
+            pot.drained += drained;
+        }
+
+        double stress = (theta - p.wiltingPoint) / std::max(p.stressPoint - p.wiltingPoint, 1e-6);
+        stress = std::min(1.0, std::max(0.0, stress));
+        double rate = (p.transpireNightMlPerHour + p.transpireDayMlPerHour * light) * transpireScale_[n];
+        double transpired = std::min(pot.soil, rate * stress * STEP_HOURS);
+        pot.soil -= transpired;
+        pot.transpired += transpired;
+
+        if (p.probeLagSeconds > 1)
+            pot.probe += (pot.soil - pot.probe) / p.probeLagSeconds;
+    }
+
+    state.reservoir -= std::min(state.reservoir, p.leakMlPerHour * STEP_HOURS);
+    if (p.probeFailHour > 0 && state.stuckProbe < 0 && (double)end >= p.probeFailHour * 3600 * kCyclesPerSecond)
+    {
+        const Pot &pot = state.pots[0];
+        state.stuckProbe = p.probeLagSeconds > 1 ? pot.probe : pot.soil;
+    }
+
+    state.time = end;
+}
+
+void PlantBoard::pump(State &state, unsigned pot, uint64_t from, uint64_t until) const
+{
+    if (pot == 0 && parameters_.pumpFailHour > 0)
+        until = std::min(until, (uint64_t)(parameters_.pumpFailHour * 3600 * kCyclesPerSecond));
+    if (until <= from)
+        return;
+    double ml = parameters_.pumpMlPerSecond * (double)(until - from) / kCyclesPerSecond;
+    ml = std::min(ml, state.reservoir);
+    state.reservoir -= ml;
+    Pot &p = state.pots[pot];
+    p.soil = std::min(p.soil + ml, parameters_.soilCapacityMl);
+    p.pumped += ml;
+}
+
+// 0 at night, a half sine from sunrise to sunset
+double PlantBoard::lightFraction(uint64_t now) const
+{
+    const PlantParameters &p = parameters_;
+    double hour = fmod(p.startHour + (double)now / kCyclesPerSecond / 3600, 24);
+    if (hour <= p.sunriseHour || hour >= p.sunsetHour)
+        return 0;
+    return sin(M_PI * (hour - p.sunriseHour) / (p.sunsetHour - p.sunriseHour));
+}
+
+PlantBoard::Readings PlantBoard::readings(const State &state) const
+{
+    const PlantParameters &p = parameters_;
+    double light = p.lightDarkPercent + (p.lightPeakPercent - p.lightDarkPercent) * lightFraction(state.time);
+    Readings r = {};
+    r.battery = batteryToAdc(batteryVolts(state.time));
+    r.light = percentToAdc(light);
+    r.discharge = volumeToDischargeCycles(state.reservoir);
+    for (unsigned pot = 0; pot < state.pots.size(); pot++)
+    {
+        const Pot &at = state.pots[pot];
+        double seen = p.probeLagSeconds > 1 ? at.probe : at.soil;
+        if (pot == 0 && state.stuckProbe >= 0)
+            seen = state.stuckProbe;
+        double theta = seen / p.soilCapacityMl;
+        double moisture = p.moistureDryPercent + (p.moistureWetPercent - p.moistureDryPercent) * theta;
+        r.moisture[pot] = percentToAdc(moisture);
+    }
+    return r;
+}
+
+bool PlantBoard::Readings::operator==(const Readings &other) const
+{
+    return battery == other.battery && light == other.light && discharge == other.discharge &&
+           std::equal(moisture, moisture + kMaxPots, other.moisture);
+}
+
+}
@@ -0,0 +1,187 @@
+// Plant Model
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Closed-loop board for the simulator: a pot of soil, the plant drawing water
+// out of it, a reservoir the pump draws from, and the sensors reading all of
+// it back.  A board of several pots wires each to its own pump and moisture
+// input (kPotWiring); they share the reservoir, the light and the battery.
+//
+//   soil       water held in the pot, as a fraction of saturation (theta)
+//   drainage   water above field capacity leaves through the bottom
+//   transpire  evapotranspiration, from a night base rate plus a rate that
+//              follows the light, throttled as the soil nears wilting point
+//   light      half-sine from sunrise to sunset, zero at night
+//   pump       moves pump-flow ml/s from the reservoir into the soil while
+//              the pot's pump pin is high, until the reservoir is empty
+//   pots       pot n of N transpires 1 + pot-spread * (n / (N - 1) - 1/2)
+//              times as much as the parameters give, so they dry at
+//              different rates
+//   battery    sags linearly with time
+//
+//   faults     the reservoir can leak; pot 1's pump can stop moving water
+//              and its probe can die, reading what it last read, from a
+//              given hour after power-on
+//
+//   probe      the moisture probe sees the pot's water probe-lag seconds
+//              late (a first-order lag), as water soaks down to it
+//
+// Sensors map back through the same transfer functions as ScriptedBoard:
+// moisture percent is linear in theta between the dry and wet readings, the
+// reservoir volume sets the comparator discharge time.
+//
+// The state advances in one-second steps; readings hold for the whole step.
+// Pump water is accounted to the cycle.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_PLANT_H_
+#define SIM_PLANT_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "machine.h"
+
+namespace sim {
+
+struct PlantParameters
+{
+    PlantParameters();
+
+    // Soil
+    double soilCapacityMl;            // water held at saturation
+    double soilStart;                 // initial theta
+    double fieldCapacity;             // theta held against drainage
+    double drainagePerHour;           // fraction of the excess lost per hour
+    double wiltingPoint;              // theta where transpiration stops
+    double stressPoint;               // theta below which it is throttled
+
+    // Plant
+    double transpireDayMlPerHour;     // at full light
+    double transpireNightMlPerHour;
+    double potSpread;                 // of transpiration across pots
+
+    // Light
+    double startHour;                 // time of day at power-on
+    double sunriseHour;
+    double sunsetHour;
+    double lightPeakPercent;          // sensor reading at full light
+    double lightDarkPercent;
+
+    // Sensors
+    double moistureDryPercent;        // sensor reading at theta = 0
+    double moistureWetPercent;        // sensor reading at theta = 1
+    double probeLagSeconds;           // time constant, 0 for none
+
+    // Pump and reservoir
+    double pumpMlPerSecond;
+    double reservoirMl;
+
+    // Battery
+    double batteryVolts;
+    double batterySagVoltsPerDay;
+
+    // Faults
+    double leakMlPerHour;             // out of the reservoir
+    double pumpFailHour;              // pot 1's pump moves nothing after, 0 for never
+    double probeFailHour;             // pot 1's probe sticks after, 0 for never
+
+    // name=value with the names listed by describe()
+    bool set(const std::string &assignment, std::string &error);
+    std::string describe() const;
+};
+
+class PlantBoard : public Board
+{
+public:
+    explicit PlantBoard(const PlantParameters &parameters, unsigned pots = 1);
+
+    uint16_t adcSample(unsigned ain, uint64_t now) override;
+    uint32_t dischargeCycles(uint64_t now) override;
+    void pinChanged(Port port, unsigned pin, bool level, uint64_t now) override;
+    uint64_t inputsSteadyUntil(uint64_t from) override;
+
+    const PlantParameters &parameters() const { return parameters_; }
+    unsigned pots() const { return (unsigned)pumps_.size(); }
+
+    // State at now
+    double theta(uint64_t now, unsigned pot = 0);
+    double reservoirMl(uint64_t now);
+    double moisturePercent(uint64_t now, unsigned pot = 0);
+    double lightPercent(uint64_t now) const;
+    double batteryVolts(uint64_t now) const;
+
+    // Totals since power-on (in ml), of every pot or of one
+    double pumpedMl() const;
+    double transpiredMl() const;
+    double drainedMl() const;
+    uint64_t pumpRuns() const;
+    double pumpSeconds(uint64_t now) const;
+    double pumpedMl(unsigned pot) const { return state_.pots[pot].pumped; }
+    double transpiredMl(unsigned pot) const { return state_.pots[pot].transpired; }
+    double drainedMl(unsigned pot) const { return state_.pots[pot].drained; }
+    uint64_t pumpRuns(unsigned pot) const { return pumps_[pot].runs; }
+    double pumpSeconds(uint64_t now, unsigned pot) const;
+    bool pumpOn(unsigned pot) const { return pumps_[pot].on; }
+
+private:
+    struct Pot
+    {
+        double soil;                  // ml
+        double probe;                 // ml, as the probe sees it
+        double pumped;
+        double transpired;
+        double drained;
+    };
+
+    struct State
+    {
+        uint64_t time;                // start of the current step
+        double reservoir;             // ml
+        double stuckProbe;            // ml pot 1's dead probe sees, or < 0
+        std::vector<Pot> pots;
+    };
+
+    struct Pump
+    {
+        bool on;
+        uint64_t from;                // water delivered up to here
+        uint64_t runs;
+        uint64_t onCycles;
+        uint64_t onSince;
+    };
+
+    struct Readings
+    {
+        uint16_t battery;
+        uint16_t light;
+        uint32_t discharge;
+        uint16_t moisture[kMaxPots];
+
+        bool operator==(const Readings &other) const;
+    };
+
+    void advance(uint64_t now);
+    void step(State &state) const;
+    void pump(State &state, unsigned pot, uint64_t from, uint64_t until) const;
+    double lightFraction(uint64_t now) const;
+    Readings readings(const State &state) const;
+
+    PlantParameters parameters_;
+    State state_;
+    std::vector<Pump> pumps_;
+    std::vector<double> transpireScale_;
+    uint64_t steadyFrom_;             // cached inputsSteadyUntil() result
+    uint64_t steadyUntil_;
+};
+
+}
+
+#endif
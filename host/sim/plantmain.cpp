@@ -0,0 +1,271 @@
+// Plant Runner
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs the firmware against the plant model (see plant.h) for a number of
+// virtual days and prints one line per day: moisture range, pump runs and
+// water moved.  Use it to tune the moisture threshold, watering window and
+// dose against a given pot.
+//
+//   flowerpot_plant [--days N] [--pots N] [--set NAME=VALUE]... [--send TEXT]...
+//                   [--sample DURATION] [--csv FILE] [--uart] [--exact]
+//                   [--capture FILE] [--list]
+//
+//   --days    virtual days to run (default 30)
+//   --pots    pots on the board, 1-8 (default 1); the firmware is told with
+//             "pots N" before any --send, and each pot is summed up at the end
+//   --set     override a plant parameter; --list prints them with defaults
+//   --send    command line typed on UART0 one second after power-on, e.g.
+//             --send "LEVEL 35" or --send "water 7 0 19 0"
+//   --sample  interval of the daily statistics and CSV rows (default 10m)
+//   --csv     write time, theta, sensor readings, reservoir and pump to FILE
+//   --uart    copy the firmware's UART output to stdout
+//   --exact   run every pass of the idle loop instead of skipping repeats
+//   --capture arm the firmware's sensor capture before power-on and write
+//             what it streams to FILE (see replay.h)
+//
+// The RTC is set to start-hour at power-on.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "firmware.h"
+#include "plant.h"
+#include "replay.h"
+#include "scenario.h"
+
+namespace {
+
+struct PotTotals
+{
+    double moistureMin;
+    double moistureMax;
+};
+
+struct Day
+{
+    double moistureMin;
+    double moistureMax;
+    uint64_t pumpRuns;
+    double pumped;
+    double transpired;
+    double drained;
+};
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_plant [--days N] [--pots N] [--set NAME=VALUE]... [--send TEXT]...\n"
+        "                       [--sample DURATION] [--csv FILE] [--uart] [--exact]\n"
+        "                       [--capture FILE] [--list]\n");
+    exit(2);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::PlantParameters parameters;
+    double days = 30;
+    unsigned pots = 1;
+    uint64_t sample = 10 * 60 * sim::kCyclesPerSecond;
+    std::string commands;
+    const char *csvPath = nullptr;
+    const char *capturePath = nullptr;
+    bool echoUart = false;
+    bool exact = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        std::string error;
+        if (strcmp(arg, "--list") == 0)
+        {
+            printf("%s", parameters.describe().c_str());
+            return 0;
+        }
+        else if (strcmp(arg, "--uart") == 0)
+            echoUart = true;
+        else if (strcmp(arg, "--exact") == 0)
+            exact = true;
+        else if (!value)
+            usage();
+        else if (strcmp(arg, "--days") == 0)
+            days = atof(argv[++i]);
+        else if (strcmp(arg, "--pots") == 0)
+        {
+            pots = (unsigned)atoi(argv[++i]);
+            if (pots < 1 || pots > sim::kMaxPots)
+                usage();
+        }
+        else if (strcmp(arg, "--set") == 0)
+        {
+            if (!parameters.set(argv[++i], error))
+            {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+        else if (strcmp(arg, "--send") == 0)
+            commands += std::string(argv[++i]) + "\r";
+        else if (strcmp(arg, "--sample") == 0)
+        {
+            if (!sim::parseDuration(argv[++i], sample) || sample == 0)
+                usage();
+        }
+        else if (strcmp(arg, "--csv") == 0)
+            csvPath = argv[++i];
+        else if (strcmp(arg, "--capture") == 0)
+            capturePath = argv[++i];
+        else
+            usage();
+    }
+
+    FILE *csv = nullptr;
+    if (csvPath)
+    {
+        csv = fopen(csvPath, "w");
+        if (!csv)
+        {
+            perror(csvPath);
+            return 1;
+        }
+        fprintf(csv, "seconds,theta,moisture_pct,light_pct,reservoir_ml,pump,pumped_ml");
+        for (unsigned pot = 1; pot < pots; pot++)
+            fprintf(csv, ",moisture_pct_%u,pump_%u", pot + 1, pot + 1);
+        fprintf(csv, "\n");
+    }
+    if (pots > 1)
+        commands = "pots " + std::to_string(pots) + "\r" + commands;
+
+    sim::PlantBoard board(parameters, pots);
+    sim::Simulation simulation(board, sim::flowerpotFirmware());
+    sim::Machine &machine = simulation.machine();
+    machine.setLoopSkipping(!exact);
+    machine.setRxFlowControl(true);
+    machine.setRtc((uint32_t)(parameters.startHour * 3600));
+    sim::CaptureWriter writer;
+    sim::CaptureDecoder decoder([&writer](const sim::CaptureRecord &r) { writer.write(r); },
+                                [echoUart](uint8_t c) { if (echoUart) putchar(c); });
+    if (capturePath)
+    {
+        std::string error;
+        if (!writer.open(capturePath, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        machine.setHibernationData(0, sim::kCaptureArmed);
+        machine.setTxSink([&decoder](uint8_t c) { decoder.put(c); });
+    }
+    else if (echoUart)
+        machine.setTxSink([](uint8_t c) { putchar(c); });
+    if (!commands.empty())
+        machine.schedule(sim::kCyclesPerSecond, [&commands](sim::Machine &m)
+        {
+            m.receive(commands.data(), commands.size());
+        });
+
+    printf("day  moisture %%   pump runs  pumped ml  transpired ml  drained ml  reservoir ml\n");
+    const uint64_t dayCycles = 86400 * sim::kCyclesPerSecond;
+    Day day = { 1e9, -1e9, 0, 0, 0, 0 };
+    Day start = day;
+    std::vector<PotTotals> potTotals(pots, PotTotals { 1e9, -1e9 });
+    unsigned dayNumber = 0;
+    std::function<void(sim::Machine &)> record = [&](sim::Machine &m)
+    {
+        uint64_t now = m.now();
+        double moisture = board.moisturePercent(now);
+        for (unsigned pot = 0; pot < pots; pot++)
+        {
+            double potMoisture = board.moisturePercent(now, pot);
+            day.moistureMin = std::min(day.moistureMin, potMoisture);
+            day.moistureMax = std::max(day.moistureMax, potMoisture);
+            potTotals[pot].moistureMin = std::min(potTotals[pot].moistureMin, potMoisture);
+            potTotals[pot].moistureMax = std::max(potTotals[pot].moistureMax, potMoisture);
+        }
+        if (csv)
+        {
+            fprintf(csv, "%llu,%.4f,%.2f,%.2f,%.1f,%d,%.1f",
+                    (unsigned long long)(now / sim::kCyclesPerSecond), board.theta(now), moisture,
+                    board.lightPercent(now), board.reservoirMl(now), m.pumpOn() ? 1 : 0, board.pumpedMl());
+            for (unsigned pot = 1; pot < pots; pot++)
+                fprintf(csv, ",%.2f,%d", board.moisturePercent(now, pot), m.pumpOn(pot) ? 1 : 0);
+            fprintf(csv, "\n");
+        }
+
+        if (now >= (dayNumber + 1) * dayCycles)
+        {
+            printf("%3u  %5.1f-%5.1f  %9llu  %9.0f  %13.0f  %10.0f  %12.0f\n", dayNumber + 1,
+                   day.moistureMin, day.moistureMax,
+                   (unsigned long long)(board.pumpRuns() - start.pumpRuns),
+                   board.pumpedMl() - start.pumped, board.transpiredMl() - start.transpired,
+                   board.drainedMl() - start.drained, board.reservoirMl(now));
+            dayNumber++;
+            day = { 1e9, -1e9, 0, 0, 0, 0 };
+            for (unsigned pot = 0; pot < pots; pot++)
+            {
+                day.moistureMin = std::min(day.moistureMin, board.moisturePercent(now, pot));
+                day.moistureMax = std::max(day.moistureMax, board.moisturePercent(now, pot));
+            }
+            start = { 0, 0, board.pumpRuns(), board.pumpedMl(), board.transpiredMl(), board.drainedMl() };
+        }
+        m.schedule(now + sample, record);
+    };
+    machine.schedule(0, record);
+
+    uint64_t end = (uint64_t)(days * dayCycles);
+    auto wallStart = std::chrono::steady_clock::now();
+    simulation.runUntil(end + 1);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    if (csv)
+        fclose(csv);
+    if (capturePath)
+    {
+        std::string error;
+        decoder.flush();
+        if (!writer.close(error))
+        {
+            fprintf(stderr, "%s: %s\n", capturePath, error.c_str());
+            return 1;
+        }
+    }
+
+    if (pots > 1)
+    {
+        printf("\npot  moisture %%   pump runs  pump s  pumped ml  transpired ml  drained ml\n");
+        for (unsigned pot = 0; pot < pots; pot++)
+            printf("%3u  %5.1f-%5.1f  %9llu  %6.0f  %9.0f  %13.0f  %10.0f\n", pot + 1,
+                   potTotals[pot].moistureMin, potTotals[pot].moistureMax,
+                   (unsigned long long)board.pumpRuns(pot), board.pumpSeconds(machine.now(), pot),
+                   board.pumpedMl(pot), board.transpiredMl(pot), board.drainedMl(pot));
+    }
+
+    double simulated = (double)machine.now() / sim::kCyclesPerSecond;
+    printf("total: %llu pump runs, %.0f ml pumped, %.0f ml transpired, %.0f ml drained\n",
+           (unsigned long long)board.pumpRuns(), board.pumpedMl(), board.transpiredMl(), board.drainedMl());
+    printf("%s simulated in %.3f s (%.0fx real time, %.1f%% in skipped idle loops)\n",
+           sim::formatTime(machine.now()).c_str(), wall, wall > 0 ? simulated / wall : 0.0,
+           100.0 * machine.skippedCycles() / std::max<uint64_t>(machine.now(), 1));
+    if (capturePath)
+        printf("captured %llu records and %llu bytes of text to %s\n",
+               (unsigned long long)decoder.records(), (unsigned long long)decoder.textBytes(), capturePath);
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Work-Stealing Thread Pool
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "pool.h"
+
+namespace sim {
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(unsigned threads)
+    : body_(nullptr),
+      generation_(0),
+      busy_(0),
+      stopping_(false),
+      steals_(0)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; i++)
+    {
+        slices_.emplace_back(new Slice);
+        slices_.back()->begin = slices_.back()->end = 0;
+    }
+    for (unsigned i = 1; i < threads; i++)
+        threads_.emplace_back(&ThreadPool::loop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (std::thread &thread : threads_)
+        thread.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, unsigned)> &body)
+{
+    if (count == 0)
+        return;
+    size_t workers = slices_.size();
+    for (size_t i = 0; i < workers; i++)
+    {
+        std::lock_guard<std::mutex> guard(slices_[i]->lock);
+        slices_[i]->begin = count * i / workers;
+        slices_[i]->end = count * (i + 1) / workers;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        body_ = &body;
+        busy_ = (unsigned)workers;
+        generation_++;
+    }
+    start_.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> guard(lock_);
+    busy_--;
+    done_.wait(guard, [this]() { return busy_ == 0; });
+    body_ = nullptr;
+}
+
+void ThreadPool::loop(unsigned worker)
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            start_.wait(guard, [this, seen]() { return stopping_ || generation_ != seen; });
+            if (stopping_)
+                return;
+            seen = generation_;
+        }
+        work(worker);
+        std::lock_guard<std::mutex> guard(lock_);
+        if (--busy_ == 0)
+            done_.notify_one();
+    }
+}
+
+void ThreadPool::work(unsigned worker)
+{
+    size_t index;
+    for (;;)
+    {
+        while (take(worker, index))
+            (*body_)(index, worker);
+        if (!steal(worker))
+            return;
+    }
+}
+
+bool ThreadPool::take(unsigned worker, size_t &index)
+{
+    Slice &slice = *slices_[worker];
+    std::lock_guard<std::mutex> guard(slice.lock);
+    if (slice.begin >= slice.end)
+        return false;
+    index = slice.begin++;
+    return true;
+}
+
+// Move the back half of the largest slice left to this worker
+bool ThreadPool::steal(unsigned worker)
+{
+    for (;;)
+    {
+        size_t victim = slices_.size();
+        size_t largest = 0;
+        for (size_t i = 0; i < slices_.size(); i++)
+        {
+            if (i == worker)
+                continue;
+            std::lock_guard<std::mutex> guard(slices_[i]->lock);
+            size_t left = slices_[i]->end - std::min(slices_[i]->begin, slices_[i]->end);
+            if (left > largest)
+            {
+                largest = left;
+                victim = i;
+            }
+        }
+        if (victim == slices_.size())
+            return false;
+
+        size_t begin, end;
+        {
+            Slice &from = *slices_[victim];
+            std::lock_guard<std::mutex> guard(from.lock);
+            if (from.begin >= from.end)
+                continue;
+            size_t half = (from.end - from.begin + 1) / 2;
+            end = from.end;
+            begin = end - half;
+            from.end = begin;
+        }
+        Slice &to = *slices_[worker];
+        std::lock_guard<std::mutex> guard(to.lock);
+        to.begin = begin;
+        to.end = end;
+        steals_++;
+        return true;
+    }
+}
+
+}
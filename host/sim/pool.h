@@ -0,0 +1,83 @@
+// Work-Stealing Thread Pool
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// parallelFor() runs body(i) for every index of a range on all workers and
+// returns when they are done.  The range is dealt out as one contiguous slice
+// per worker; a worker takes indices from the front of its own slice, and
+// one that runs dry steals the back half of the largest remaining slice.
+// Slices keep neighbouring items on one worker, stealing evens out items
+// that take unequal time (a pot that is pumping versus one that is idle).
+//
+// The calling thread works as worker 0, so a pool of one thread runs
+// everything inline.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_POOL_H_
+#define SIM_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+class ThreadPool
+{
+public:
+    // threads == 0 uses one per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned threads() const { return (unsigned)slices_.size(); }
+
+    // body(index, worker) for index in [0, count)
+    void parallelFor(size_t count, const std::function<void(size_t, unsigned)> &body);
+
+    // Slices stolen since construction
+    uint64_t steals() const { return steals_.load(); }
+
+private:
+    struct Slice
+    {
+        std::mutex lock;
+        size_t begin;
+        size_t end;
+    };
+
+    void work(unsigned worker);
+    bool take(unsigned worker, size_t &index);
+    bool steal(unsigned worker);
+    void loop(unsigned worker);
+
+    std::vector<std::unique_ptr<Slice>> slices_;
+    std::vector<std::thread> threads_;
+    const std::function<void(size_t, unsigned)> *body_;
+
+    std::mutex lock_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    uint64_t generation_;
+    unsigned busy_;
+    bool stopping_;
+    std::atomic<uint64_t> steals_;
+};
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+// Pseudo-Terminal Pots
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs a fleet of simulated pots, each on its own pseudo-terminal (see
+// ptyfarm.h), in real time until interrupted, for a gateway or a terminal
+// to talk to.
+//
+//   flowerpot_pots [--pots N] [--threads N] [--tick SECONDS] [--seed N]
+//                  [--spread FRACTION] [--dir DIRECTORY]
+//
+//   --pots     number of pots (default 100)
+//   --threads  worker threads (default 1)
+//   --tick     seconds between steps (default 0.005)
+//   --spread   relative spread of the plant parameters (default 0.2)
+//   --dir      make DIRECTORY/pot0000, pot0001, ... links to the devices;
+//              otherwise their paths are printed, one per line
+//
+// For example
+//
+//   flowerpot_pots --pots 1000 --dir /tmp/pots &
+//   flowerpot_gateway --dir /tmp/pots --status 10
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "firmware.h"
+#include "ptyfarm.h"
+
+namespace {
+
+volatile sig_atomic_t interrupted = 0;
+
+void onInterrupt(int)
+{
+    interrupted = 1;
+}
+
+void usage()
+{
+    fprintf(stderr,
+        "usage: flowerpot_pots [--pots N] [--threads N] [--tick SECONDS] [--seed N]\n"
+        "                      [--spread FRACTION] [--dir DIRECTORY]\n");
+    exit(2);
+}
+
+std::string linkName(const char *directory, size_t pot)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "pot%04zu", pot);
+    return std::string(directory) + "/" + name;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::PtyFarmOptions options;
+    const char *directory = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *arg = argv[i];
+        const char *value = argv[++i];
+        if (strcmp(arg, "--pots") == 0)
+            options.pots = (unsigned)atoi(value);
+        else if (strcmp(arg, "--threads") == 0)
+            options.threads = (unsigned)atoi(value);
+        else if (strcmp(arg, "--tick") == 0)
+            options.tick = atof(value);
+        else if (strcmp(arg, "--seed") == 0)
+            options.seed = (uint32_t)strtoul(value, nullptr, 0);
+        else if (strcmp(arg, "--spread") == 0)
+            options.spread = atof(value);
+        else if (strcmp(arg, "--dir") == 0)
+            directory = value;
+        else
+            usage();
+    }
+    if (options.pots == 0 || options.tick <= 0 || options.tick > 1)
+        usage();
+
+    std::string error;
+    sim::PtyFarm farm(options, sim::PlantParameters(), sim::flowerpotFirmware());
+    if (!farm.open(error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    if (directory)
+    {
+        if (mkdir(directory, 0755) != 0 && errno != EEXIST)
+        {
+            fprintf(stderr, "%s: %s\n", directory, strerror(errno));
+            return 1;
+        }
+        for (size_t i = 0; i < farm.size(); i++)
+        {
+            std::string name = linkName(directory, i);
+            unlink(name.c_str());
+            if (symlink(farm.path(i).c_str(), name.c_str()) != 0)
+            {
+                fprintf(stderr, "%s: %s\n", name.c_str(), strerror(errno));
+                return 1;
+            }
+        }
+        fprintf(stderr, "%zu pots in %s\n", farm.size(), directory);
+    }
+    else
+    {
+        for (size_t i = 0; i < farm.size(); i++)
+            printf("%s\n", farm.path(i).c_str());
+        fflush(stdout);
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = onInterrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::atomic<bool> stop(false);
+    std::thread runner([&farm, &stop]() { farm.run(stop); });
+    while (!interrupted)
+        usleep(100000);
+    stop = true;
+    runner.join();
+
+    if (directory)
+        for (size_t i = 0; i < farm.size(); i++)
+            unlink(linkName(directory, i).c_str());
+    fprintf(stderr, "rx %llu B, tx %llu B\n", (unsigned long long)farm.rxBytes(),
+            (unsigned long long)farm.txBytes());
+    return 0;
+}
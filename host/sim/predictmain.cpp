@@ -0,0 +1,273 @@
+// Drying Prediction Check
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Runs the firmware's drying prediction (predict.h) over a recorded trace
+// and scores it against what the pot did next.
+//
+//   flowerpot_predict [--pot N] CSV
+//
+//   --pot   score pot N of a several-pot trace (default the first)
+//
+// The trace is a CSV with a header naming at least the columns seconds,
+// light_pct and moisture_pct (or moisture_pct_N), and optionally pump
+// (pump_N), such as flowerpot_plant --csv writes.  Rows are fed to the
+// predictor as the main loop would; pump rows count as a dose.
+//
+// At each sample the predictor is asked how long until the moisture has
+// dropped by 1, 2, 5 and 10 percent, and the answer is compared with the
+// first later row that far down.  Predictions whose drop is not seen before
+// the next dose or the end of the trace are not scored.  The same is done
+// with the light ignored, the mean drop of the steps standing for the
+// rate, to show what the light adds.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "predict.h"
+
+namespace {
+
+const double DROPS[] = { 1, 2, 5, 10 };
+const unsigned DROP_COUNT = sizeof(DROPS) / sizeof(DROPS[0]);
+
+struct Row
+{
+    uint32_t seconds;
+    double moisture;
+    double light;
+    bool pump;
+};
+
+struct Score
+{
+    std::vector<double> errors;       // Predicted less actual, hours
+    std::vector<double> relative;     // |error| over actual
+    unsigned missed = 0;              // Drop seen, but predicted never
+};
+
+void usage()
+{
+    fprintf(stderr, "usage: flowerpot_predict [--pot N] CSV\n");
+    exit(2);
+}
+
+std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;)
+    {
+        size_t comma = line.find(',', start);
+        fields.push_back(line.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (comma == std::string::npos)
+            return fields;
+        start = comma + 1;
+    }
+}
+
+bool readTrace(const char *path, unsigned pot, std::vector<Row> &rows, std::string &error)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+
+    std::string suffix = pot ? "_" + std::to_string(pot) : "";
+    int seconds = -1, moisture = -1, light = -1, pump = -1;
+    std::vector<std::string> header;
+    char buffer[4096];
+    if (fgets(buffer, sizeof(buffer), file))
+        header = split(std::string(buffer, strcspn(buffer, "\r\n")));
+    for (size_t i = 0; i < header.size(); i++)
+    {
+        if (header[i] == "seconds")
+            seconds = (int)i;
+        else if (header[i] == "light_pct")
+            light = (int)i;
+        else if (header[i] == "moisture_pct" + suffix)
+            moisture = (int)i;
+        else if (header[i] == "pump" + suffix)
+            pump = (int)i;
+    }
+    if (seconds < 0 || moisture < 0 || light < 0)
+    {
+        fclose(file);
+        error = std::string(path) + ": no seconds, light_pct or moisture_pct" + suffix + " column";
+        return false;
+    }
+
+    unsigned line = 1;
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        line++;
+        std::vector<std::string> fields = split(std::string(buffer, strcspn(buffer, "\r\n")));
+        if (fields.size() == 1 && fields[0].empty())
+            continue;
+        if ((int)fields.size() <= std::max(std::max(seconds, moisture), std::max(light, pump)))
+        {
+            fclose(file);
+            error = std::string(path) + ":" + std::to_string(line) + ": too few fields";
+            return false;
+        }
+        Row row;
+        row.seconds = (uint32_t)strtoul(fields[seconds].c_str(), nullptr, 10);
+        row.moisture = atof(fields[moisture].c_str());
+        row.light = atof(fields[light].c_str());
+        row.pump = pump >= 0 && atoi(fields[pump].c_str()) != 0;
+        rows.push_back(row);
+    }
+    fclose(file);
+    return true;
+}
+
+// The prediction with the light left out
+PREDICT flat(const PREDICT &predict)
+{
+    PREDICT result = predict;
+    int32_t sum = 0;
+    for (unsigned i = 0; i < predict.count; i++)
+        sum += predict.step[i].drop;
+    result.slope = 0;
+    result.base = predict.count ? sum / predict.count : 0;
+    return result;
+}
+
+// Seconds from row i until the moisture is drop lower, or -1 if a dose or
+// the end of the trace comes first
+double actualSeconds(const std::vector<Row> &rows, size_t i, double drop)
+{
+    double target = rows[i].moisture - drop;
+    for (size_t j = i + 1; j < rows.size(); j++)
+    {
+        if (rows[j].pump)
+            return -1;
+        if (rows[j].moisture <= target)
+            return rows[j].seconds - rows[i].seconds;
+    }
+    return -1;
+}
+
+void score(Score &score, uint32_t predicted, double actual)
+{
+    if (predicted == PREDICT_NEVER)
+    {
+        score.missed++;
+        return;
+    }
+    double error = (double)predicted - actual;
+    score.errors.push_back(error / 3600);
+    score.relative.push_back(actual > 0 ? fabs(error) / actual : 0);
+}
+
+double quantile(std::vector<double> values, double q)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(q * (values.size() - 1) + 0.5)];
+}
+
+void report(const char *model, double drop, const Score &score)
+{
+    std::vector<double> absolute;
+    double bias = 0;
+    unsigned close = 0;
+    for (size_t i = 0; i < score.errors.size(); i++)
+    {
+        absolute.push_back(fabs(score.errors[i]));
+        bias += score.errors[i];
+        if (score.relative[i] <= 0.2)
+            close++;
+    }
+    size_t n = score.errors.size();
+    printf("%6.0f  %-5s  %11zu  %6u  %6.2f  %14.2f  %11.2f  %10.1f\n", drop, model, n, score.missed,
+           n ? bias / n : 0, quantile(absolute, 0.5), quantile(absolute, 0.9), n ? 100.0 * close / n : 0);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    unsigned pot = 0;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--pot") == 0 && i + 1 < argc)
+        {
+            pot = (unsigned)atoi(argv[++i]);
+            if (pot < 1)
+                usage();
+        }
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+            usage();
+    }
+    if (!path)
+        usage();
+
+    std::vector<Row> rows;
+    std::string error;
+    if (!readTrace(path, pot, rows, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    PREDICT predict;
+    initPredict(&predict);
+    Score light[DROP_COUNT], mean[DROP_COUNT];
+    unsigned samples = 0;
+    bool watered = false;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        const Row &row = rows[i];
+        watered = watered || row.pump;
+        if (!predictSample(&predict, row.seconds, (float)row.moisture, (float)row.light, watered))
+            continue;
+        watered = false;
+        samples++;
+        if (predict.count < PREDICT_MIN_STEPS || row.pump)
+            continue;
+        PREDICT ignored = flat(predict);
+        for (unsigned d = 0; d < DROP_COUNT; d++)
+        {
+            double actual = actualSeconds(rows, i, DROPS[d]);
+            if (actual < 0)
+                continue;
+            int32_t margin = (int32_t)(DROPS[d] * PREDICT_ONE);
+            score(light[d], predictSeconds(&predict, row.seconds, margin), actual);
+            score(mean[d], predictSeconds(&ignored, row.seconds, margin), actual);
+        }
+    }
+
+    printf("%s: %zu rows, %u samples every %u s, %u steps fitted\n\n", path, rows.size(), samples,
+           PREDICT_PERIOD, PREDICT_STEPS);
+    printf("drop %%  model  predictions  missed  bias h  median |err| h  p90 |err| h  within 20%%\n");
+    for (unsigned d = 0; d < DROP_COUNT; d++)
+    {
+        report("light", DROPS[d], light[d]);
+        report("mean", DROPS[d], mean[d]);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Pseudo-Terminal Pots
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "ptyfarm.h"
+
+namespace sim {
+
+namespace {
+
+// A UART has no room for more; what the gateway does not read is lost
+const size_t OUT_LIMIT = 65536;
+
+// A pot is stepped every tick for this long after it was sent something,
+// long enough for any reply, and otherwise once a second
+const uint64_t BUSY_SECONDS = 2;
+
+}
+
+//-----------------------------------------------------------------------------
+// PtyFarm
+//-----------------------------------------------------------------------------
+
+PtyFarm::PtyFarm(const PtyFarmOptions &options, const PlantParameters &base, const Firmware &firmware)
+    : options_(options),
+      pool_(options.threads),
+      rxBytes_(0),
+      txBytes_(0)
+{
+    for (unsigned id = 0; id < options_.pots; id++)
+    {
+        PlantParameters parameters = spreadParameters(base, options_.seed, id, options_.spread);
+        pots_.emplace_back(new Wired);
+        Wired &wired = *pots_.back();
+        wired.pot.reset(new Pot(id, parameters, firmware));
+        wired.pot->machine().setTxSink([&wired](uint8_t c) { wired.out += (char)c; });
+    }
+}
+
+PtyFarm::~PtyFarm()
+{
+    for (auto &wired : pots_)
+    {
+        if (wired->master >= 0)
+            close(wired->master);
+        if (wired->slave >= 0)
+            close(wired->slave);
+    }
+}
+
+// Each pot's own end stays open as well, so the master does not hang up
+// while no gateway has the device open
+bool PtyFarm::open(std::string &error)
+{
+    for (auto &wired : pots_)
+    {
+        int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        {
+            error = std::string("posix_openpt: ") + strerror(errno);
+            if (master >= 0)
+                close(master);
+            return false;
+        }
+        wired->master = master;
+        wired->path = ptsname(master);
+
+        struct termios raw;
+        tcgetattr(master, &raw);
+        cfmakeraw(&raw);
+        cfsetspeed(&raw, B115200);
+        tcsetattr(master, TCSANOW, &raw);
+
+        wired->slave = ::open(wired->path.c_str(), O_RDWR | O_NOCTTY);
+        if (wired->slave < 0)
+        {
+            error = wired->path + ": " + strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+void PtyFarm::readMasters(int epoll, uint64_t busyUntil)
+{
+    struct epoll_event events[256];
+    int ready = epoll_wait(epoll, events, 256, 0);
+    char buffer[4096];
+    for (int i = 0; i < ready; i++)
+    {
+        Wired &wired = *pots_[events[i].data.u32];
+        ssize_t n;
+        while ((n = read(wired.master, buffer, sizeof(buffer))) > 0)
+        {
+            wired.pot->machine().receive(buffer, (size_t)n);
+            wired.busyUntil = busyUntil;
+            rxBytes_ += (uint64_t)n;
+        }
+    }
+}
+
+void PtyFarm::writeMasters()
+{
+    for (auto &wired : pots_)
+    {
+        if (wired->out.empty())
+            continue;
+        ssize_t n = write(wired->master, wired->out.data(), wired->out.size());
+        if (n > 0)
+        {
+            wired->out.erase(0, (size_t)n);
+            txBytes_ += (uint64_t)n;
+        }
+        if (wired->out.size() > OUT_LIMIT)
+            wired->out.clear();
+    }
+}
+
+void PtyFarm::run(const std::atomic<bool> &stop)
+{
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    for (size_t i = 0; i < pots_.size(); i++)
+    {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, pots_[i]->master, &event);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t origin = pots_.empty() ? 0 : pots_[0]->pot->machine().now();
+    auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(options_.tick));
+    uint64_t ticksPerSecond = std::max<uint64_t>(1, (uint64_t)(1 / options_.tick));
+    std::vector<size_t> due;
+    for (uint64_t ticks = 0; !stop.load(); ticks++)
+    {
+        readMasters(epoll, ticks + BUSY_SECONDS * ticksPerSecond);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t target = origin + (uint64_t)(elapsed * kCyclesPerSecond);
+        due.clear();
+        for (size_t i = 0; i < pots_.size(); i++)
+            if (ticks < pots_[i]->busyUntil || (ticks + i) % ticksPerSecond == 0)
+                due.push_back(i);
+        pool_.parallelFor(due.size(), [this, &due, target](size_t index, unsigned)
+        {
+            pots_[due[index]]->pot->simulation().runUntil(target);
+        });
+        writeMasters();
+        std::this_thread::sleep_until(start + tick * (ticks + 1));
+    }
+    close(epoll);
+}
+
+}
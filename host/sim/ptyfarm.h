@@ -0,0 +1,92 @@
+// Pseudo-Terminal Pots
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Many simulated pots, each one the unmodified firmware on its own machine
+// and plant (as in fleet.h), with UART0 wired to a pseudo-terminal.  The
+// far end of each pseudo-terminal is a serial device like the board's
+// /dev/ttyACM0, so a gateway can be run against a fleet without hardware.
+//
+// run() steps the pots in real time: once per tick it hands what the
+// gateway wrote to each pot's UART, runs the pots up to the wall clock on a
+// thread pool, then writes what they sent back.  Replies are late by up to
+// a tick on top of the UART's own time.  Only pots sent something in the
+// last two seconds are run every tick; the rest catch up once a second, so
+// anything a pot sends unasked, such as a capture stream, may be a second
+// late.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_PTYFARM_H_
+#define SIM_PTYFARM_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fleet.h"
+
+namespace sim {
+
+struct PtyFarmOptions
+{
+    unsigned pots = 100;
+    unsigned threads = 1;             // 0: one per hardware thread
+    double tick = 0.005;              // Seconds between steps
+    uint32_t seed = 1;
+    double spread = 0.2;
+};
+
+class PtyFarm
+{
+public:
+    PtyFarm(const PtyFarmOptions &options, const PlantParameters &base, const Firmware &firmware);
+    ~PtyFarm();
+
+    PtyFarm(const PtyFarm &) = delete;
+    PtyFarm &operator=(const PtyFarm &) = delete;
+
+    // Opens a pseudo-terminal per pot
+    bool open(std::string &error);
+
+    size_t size() const { return pots_.size(); }
+    const std::string &path(size_t pot) const { return pots_[pot]->path; }
+
+    // Runs until stop is set
+    void run(const std::atomic<bool> &stop);
+
+    // Since open()
+    uint64_t rxBytes() const { return rxBytes_.load(); }
+    uint64_t txBytes() const { return txBytes_.load(); }
+
+private:
+    struct Wired
+    {
+        std::unique_ptr<Pot> pot;
+        int master = -1;
+        int slave = -1;               // Held open so the master never hangs up
+        std::string path;
+        std::string out;              // Sent by the firmware, not yet written
+        uint64_t busyUntil = 0;       // Tick
+    };
+
+    void readMasters(int epoll, uint64_t busyUntil);
+    void writeMasters();
+
+    PtyFarmOptions options_;
+    ThreadPool pool_;
+    std::vector<std::unique_ptr<Wired>> pots_;
+    std::atomic<uint64_t> rxBytes_;
+    std::atomic<uint64_t> txBytes_;
+};
+
+}
+
+#endif
@@ -0,0 +1,407 @@
+// Sensor Capture and Replay
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay.h"
+
+namespace sim {
+
+namespace {
+
+const char MAGIC[8] = { 'F', 'P', 'C', 'A', 'P', 'T', 'R', '1' };
+
+struct CaptureHeader
+{
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t version;                 // CAPTURE_VERSION of the device
+};
+
+static_assert(sizeof(CaptureHeader) == sizeof(CaptureRecord), "header fills one record slot");
+
+// On the wire (capture.h)
+const uint8_t RECORD = 0xF8;
+const unsigned RECORD_SIZE = 10;
+
+uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool isInput(uint8_t kind)
+{
+    return kind >= CAP_ADC && kind <= CAP_EEPROM;
+}
+
+uint8_t inputKind(Input input)
+{
+    switch (input)
+    {
+    case IN_ADC:    return CAP_ADC;
+    case IN_TIMER1: return CAP_TIMER1;
+    case IN_RTC:    return CAP_RTC;
+    case IN_UART:   return CAP_UART;
+    default:        return CAP_EEPROM;
+    }
+}
+
+}
+
+const char *captureKindName(uint8_t kind)
+{
+    switch (kind)
+    {
+    case CAP_BOOT:   return "boot";
+    case CAP_ADC:    return "adc";
+    case CAP_TIMER1: return "timer1";
+    case CAP_RTC:    return "rtc";
+    case CAP_UART:   return "uart";
+    case CAP_EEPROM: return "eeprom";
+    case CAP_STATS:  return "stats";
+    case CAP_TX:     return "tx";
+    default:         return "?";
+    }
+}
+
+//-----------------------------------------------------------------------------
+// CaptureDecoder
+//-----------------------------------------------------------------------------
+
+CaptureDecoder::CaptureDecoder(RecordSink records, TextSink text)
+    : recordSink_(records),
+      textSink_(text),
+      count_(0),
+      time_(0),
+      timed_(false),
+      records_(0),
+      textBytes_(0),
+      truncated_(0)
+{
+}
+
+void CaptureDecoder::put(uint8_t c)
+{
+    pending_[count_++] = c;
+    while (count_ > 0)
+    {
+        uint8_t lead = pending_[0];
+        if ((lead & RECORD) != RECORD || (lead & 7) > CAP_STATS)
+        {
+            text(lead);
+            shift(1);
+            continue;
+        }
+        if (count_ < RECORD_SIZE)
+            return;
+
+        uint8_t sum = 0;
+        for (unsigned i = 0; i < RECORD_SIZE; i++)
+            sum += pending_[i];
+        if (sum != 0)
+        {
+            // Not a record after all; look for one starting further on
+            text(lead);
+            shift(1);
+            continue;
+        }
+
+        CaptureRecord record = {};
+        record.kind = lead & 7;
+        uint32_t wire = le32(&pending_[1]);
+        if (record.kind == CAP_STATS)
+            record.counter = (uint16_t)wire;
+        else
+        {
+            // Widen the 32-bit device time, which wraps every 36 hours and
+            // steps back when the clock is set
+            time_ = timed_ ? time_ + (int64_t)(int32_t)(wire - (uint32_t)time_) : wire;
+            timed_ = true;
+        }
+        record.time = time_;
+        record.value = le32(&pending_[5]);
+        records_++;
+        count_ = 0;
+        recordSink_(record);
+    }
+}
+
+void CaptureDecoder::put(const void *data, size_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++)
+        put(bytes[i]);
+}
+
+void CaptureDecoder::flush()
+{
+    // Whatever is left starts with a record's first byte
+    if (count_ > 0)
+        truncated_++;
+    count_ = 0;
+}
+
+void CaptureDecoder::text(uint8_t c)
+{
+    CaptureRecord record = {};
+    record.time = time_;
+    record.value = c;
+    record.kind = CAP_TX;
+    textBytes_++;
+    recordSink_(record);
+    if (textSink_)
+        textSink_(c);
+}
+
+void CaptureDecoder::shift(unsigned count)
+{
+    memmove(pending_, pending_ + count, count_ - count);
+    count_ -= count;
+}
+
+//-----------------------------------------------------------------------------
+// CaptureWriter
+//-----------------------------------------------------------------------------
+
+CaptureWriter::CaptureWriter()
+    : file_(nullptr),
+      records_(0),
+      versioned_(false)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    if (file_)
+        fclose(file_);
+}
+
+bool CaptureWriter::open(const char *path, std::string &error)
+{
+    file_ = fopen(path, "wb");
+    if (!file_)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+    setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    CaptureHeader header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.recordSize = sizeof(CaptureRecord);
+    header.version = 0;
+    fwrite(&header, sizeof(header), 1, file_);
+    return true;
+}
+
+void CaptureWriter::write(const CaptureRecord &record)
+{
+    // The BOOT record carries the device's format version
+    if (record.kind == CAP_BOOT && !versioned_)
+    {
+        versioned_ = true;
+        uint32_t version = record.value;
+        fseek(file_, offsetof(CaptureHeader, version), SEEK_SET);
+        fwrite(&version, sizeof(version), 1, file_);
+        fseek(file_, 0, SEEK_END);
+    }
+    fwrite(&record, sizeof(record), 1, file_);
+    records_++;
+}
+
+bool CaptureWriter::close(std::string &error)
+{
+    if (!file_)
+        return true;
+    bool ok = !ferror(file_);
+    if (fclose(file_) != 0)
+        ok = false;
+    file_ = nullptr;
+    if (!ok)
+        error = strerror(errno);
+    return ok;
+}
+
+//-----------------------------------------------------------------------------
+// CaptureFile
+//-----------------------------------------------------------------------------
+
+CaptureFile::CaptureFile()
+    : map_(nullptr),
+      length_(0),
+      records_(nullptr),
+      count_(0)
+{
+}
+
+CaptureFile::~CaptureFile()
+{
+    if (map_)
+        munmap(map_, length_);
+}
+
+bool CaptureFile::open(const char *path, std::string &error)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CaptureHeader))
+    {
+        error = std::string(path) + ": not a capture file";
+        ::close(fd);
+        return false;
+    }
+    length_ = (size_t)info.st_size;
+    map_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED)
+    {
+        map_ = nullptr;
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+
+    const CaptureHeader *header = (const CaptureHeader *)map_;
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->recordSize != sizeof(CaptureRecord))
+    {
+        error = std::string(path) + ": not a capture file";
+        return false;
+    }
+    // Replay walks the records front to back once
+    madvise(map_, length_, MADV_SEQUENTIAL);
+    records_ = (const CaptureRecord *)(header + 1);
+    count_ = (length_ - sizeof(CaptureHeader)) / sizeof(CaptureRecord);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Replay
+//-----------------------------------------------------------------------------
+
+Replay::Replay(const CaptureFile &capture)
+    : capture_(capture),
+      input_(0),
+      output_(0),
+      end_(capture.size()),
+      start_(0),
+      last_(0),
+      booted_(false),
+      inputsReplayed_(0),
+      textMatched_(0)
+{
+    // Start at power-on if the capture saw it
+    for (size_t i = 0; i < capture_.size(); i++)
+    {
+        if (capture_[i].kind == CAP_BOOT)
+        {
+            start_ = last_ = i;
+            input_ = output_ = i + 1;
+            booted_ = true;
+            break;
+        }
+    }
+    nextInput();
+}
+
+// Skip to the next input, stopping at the next reset
+void Replay::nextInput()
+{
+    while (input_ < end_ && !isInput(capture_[input_].kind))
+    {
+        if (capture_[input_].kind == CAP_BOOT)
+            end_ = input_;
+        else
+            input_++;
+    }
+}
+
+bool Replay::peek(Input input, uint32_t &value)
+{
+    if (finished() || capture_[input_].kind != inputKind(input))
+        return false;
+    value = capture_[input_].value;
+    return true;
+}
+
+void Replay::consume(Input input)
+{
+    if (finished())
+    {
+        if (stopHook_)
+            stopHook_();
+        return;
+    }
+    const CaptureRecord &record = capture_[input_];
+    if (record.kind != inputKind(input))
+    {
+        diverge(input_, std::string("firmware read ") + captureKindName(inputKind(input))
+                        + ", device read " + captureKindName(record.kind));
+        return;
+    }
+    last_ = input_++;
+    inputsReplayed_++;
+    nextInput();
+}
+
+void Replay::transmitted(uint8_t c)
+{
+    while (output_ < end_ && capture_[output_].kind != CAP_TX)
+        output_++;
+    if (output_ >= end_)
+        return;
+    uint8_t expected = (uint8_t)capture_[output_].value;
+    if (c != expected)
+    {
+        char what[64];
+        snprintf(what, sizeof(what), "firmware sent 0x%02X, device sent 0x%02X", c, expected);
+        diverge(output_, what);
+        return;
+    }
+    textMatched_++;
+    output_++;
+}
+
+double Replay::time() const
+{
+    if (capture_.size() == 0)
+        return 0;
+    return (double)capture_[last_].time / kCaptureTicksPerSecond;
+}
+
+double Replay::duration() const
+{
+    if (capture_.size() == 0)
+        return 0;
+    return (double)(int64_t)(capture_[last_].time - capture_[start_].time) / kCaptureTicksPerSecond;
+}
+
+void Replay::diverge(size_t index, const std::string &what)
+{
+    if (!divergence_.empty())
+        return;
+    char where[64];
+    snprintf(where, sizeof(where), "record %zu (%.3f s): ", index,
+             (double)capture_[index].time / kCaptureTicksPerSecond);
+    divergence_ = where + what;
+    if (stopHook_)
+        stopHook_();
+}
+
+}
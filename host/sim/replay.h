@@ -0,0 +1,215 @@
+// Sensor Capture and Replay
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// A device built with capture.c and armed with "capture ON" streams a record
+// of every input it acts on (ADC results, the volume timer count, RTC reads,
+// received characters and EEPROM reads) over UART0 from its next reset.
+// CaptureDecoder separates those records from the text around them, and
+// CaptureWriter stores both in a capture file: the inputs with their RTC
+// timestamps, and every byte of text the device sent as a TX record.
+//
+// A capture file is a 16-byte header followed by fixed-size records, so it
+// can be memory-mapped and walked in place however large it is
+// (CaptureFile).  Replay feeds the inputs back to the host build of the
+// firmware through Machine::setInputSource() in the order the device read
+// them, and checks every byte the firmware sends against the recorded text.
+// The firmware asking for a different input than the device read next, or
+// sending a different byte, is a divergence.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_REPLAY_H_
+#define SIM_REPLAY_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+
+#include "machine.h"
+
+namespace sim {
+
+// Record kinds, as in the firmware's capture.h; CAP_TX only in files.
+// CAP_STATS records are telemetry sent on request ("stats BIN"), not
+// inputs, and carry a counter number instead of a time on the wire.
+enum CaptureKind : uint8_t
+{
+    CAP_BOOT = 0,
+    CAP_ADC = 1,
+    CAP_TIMER1 = 2,
+    CAP_RTC = 3,
+    CAP_UART = 4,
+    CAP_EEPROM = 5,
+    CAP_STATS = 6,
+    CAP_TX = 7,
+    CAP_KINDS
+};
+
+// HIB_DATA value that arms capture at the next reset (capture.h)
+const uint32_t kCaptureArmed = 0xCA97A7ED;
+
+// RTC time units in a record: seconds << 15 | subseconds
+const uint64_t kCaptureTicksPerSecond = 32768;
+
+struct CaptureRecord
+{
+    uint64_t time;                    // RTC ticks, widened past 32 bits
+    uint32_t value;
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t counter;                 // STATS: the counter (stats.h)
+};
+
+static_assert(sizeof(CaptureRecord) == 16, "capture records are 16 bytes");
+
+const char *captureKindName(uint8_t kind);
+
+//-----------------------------------------------------------------------------
+// CaptureDecoder: UART0 byte stream to records
+//-----------------------------------------------------------------------------
+
+class CaptureDecoder
+{
+public:
+    typedef std::function<void(const CaptureRecord &)> RecordSink;
+    typedef std::function<void(uint8_t)> TextSink;
+
+    // Every record, text bytes as CAP_TX, goes to records; text bytes also
+    // go to text, if given
+    explicit CaptureDecoder(RecordSink records, TextSink text = nullptr);
+
+    void put(uint8_t c);
+    void put(const void *data, size_t length);
+
+    // End of stream: drops a record cut short
+    void flush();
+
+    uint64_t records() const { return records_; }
+    uint64_t textBytes() const { return textBytes_; }
+    uint64_t truncated() const { return truncated_; }
+
+private:
+    void text(uint8_t c);
+    void shift(unsigned count);
+
+    RecordSink recordSink_;
+    TextSink textSink_;
+    uint8_t pending_[10];
+    unsigned count_;
+    uint64_t time_;
+    bool timed_;
+    uint64_t records_;
+    uint64_t textBytes_;
+    uint64_t truncated_;
+};
+
+//-----------------------------------------------------------------------------
+// CaptureWriter / CaptureFile
+//-----------------------------------------------------------------------------
+
+class CaptureWriter
+{
+public:
+    CaptureWriter();
+    ~CaptureWriter();
+
+    bool open(const char *path, std::string &error);
+    void write(const CaptureRecord &record);
+    bool close(std::string &error);
+
+    uint64_t records() const { return records_; }
+
+private:
+    FILE *file_;
+    uint64_t records_;
+    bool versioned_;
+};
+
+// Read-only memory map of a capture file
+class CaptureFile
+{
+public:
+    CaptureFile();
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile &) = delete;
+    CaptureFile &operator=(const CaptureFile &) = delete;
+
+    bool open(const char *path, std::string &error);
+
+    size_t size() const { return count_; }
+    const CaptureRecord &operator[](size_t index) const { return records_[index]; }
+    const CaptureRecord *begin() const { return records_; }
+    const CaptureRecord *end() const { return records_ + count_; }
+
+private:
+    void *map_;
+    size_t length_;
+    const CaptureRecord *records_;
+    size_t count_;
+};
+
+//-----------------------------------------------------------------------------
+// Replay
+//-----------------------------------------------------------------------------
+
+class Replay : public InputSource
+{
+public:
+    explicit Replay(const CaptureFile &capture);
+
+    bool peek(Input input, uint32_t &value) override;
+    void consume(Input input) override;
+
+    // Called when the replay cannot go on: the firmware asked for an input
+    // after the last one, or diverged from the device
+    void setStopHook(std::function<void()> hook) { stopHook_ = hook; }
+
+    // A byte the firmware sent, checked against the recorded text
+    void transmitted(uint8_t c);
+
+    // Replay runs from the first BOOT record (or the start, if there is
+    // none) to the next one (or the end)
+    bool startsAtReset() const { return booted_; }
+    bool finished() const { return input_ >= end_; }
+    bool diverged() const { return !divergence_.empty(); }
+    const std::string &divergence() const { return divergence_; }
+
+    uint64_t inputsReplayed() const { return inputsReplayed_; }
+    uint64_t textMatched() const { return textMatched_; }
+
+    // Records up to the next input still to be replayed
+    size_t position() const { return input_; }
+
+    // RTC time of the last input handed out, and the device time from the
+    // start of the replay to it, in seconds
+    double time() const;
+    double duration() const;
+
+private:
+    void nextInput();
+    void diverge(size_t index, const std::string &what);
+
+    const CaptureFile &capture_;
+    size_t input_;
+    size_t output_;
+    size_t end_;
+    size_t start_;
+    size_t last_;
+    bool booted_;
+    std::function<void()> stopHook_;
+    std::string divergence_;
+    uint64_t inputsReplayed_;
+    uint64_t textMatched_;
+};
+
+}
+
+#endif
@@ -0,0 +1,196 @@
+// Capture Replayer
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs the host build of the firmware on the inputs of a capture file (see
+// replay.h) and checks that it reads them in the order the device did and
+// sends exactly the text the device sent.  Pump runs are listed with the
+// device's RTC time.
+//
+//   flowerpot_replay [--uart] [--dump] CAPTURE
+//
+//   --uart  copy the replayed firmware's UART output to stdout
+//   --dump  list the records instead of replaying them
+//
+// Exits with status 1 if the replay diverged from the device.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#include "firmware.h"
+#include "replay.h"
+#include "scenario.h"
+
+namespace {
+
+// The firmware never goes this long without reading an input
+const uint64_t STALL_CYCLES = 600 * sim::kCyclesPerSecond;
+
+// Reports each pot's pump with the device time of the input that led to it
+class ReplayBoard : public sim::StaticBoard
+{
+public:
+    explicit ReplayBoard(const sim::Replay &replay) : replay_(replay), runs_(0), on_() {}
+
+    void pinChanged(sim::Port port, unsigned pin, bool level, uint64_t now) override
+    {
+        (void)now;
+        unsigned pot;
+        for (pot = 0; pot < sim::kMaxPots; pot++)
+            if (sim::kPotWiring[pot].pumpPort == port && sim::kPotWiring[pot].pumpPin == pin)
+                break;
+        if (pot == sim::kMaxPots)
+            return;
+        // Runs are timed on the RTC, so the input before each edge dates it
+        double time = replay_.time();
+        if (level)
+        {
+            runs_++;
+            on_[pot] = time;
+            printf("pump on   %s  pot %u\n", sim::formatTime((uint64_t)(time * sim::kCyclesPerSecond)).c_str(),
+                   pot + 1);
+        }
+        else
+            printf("pump off  %s  pot %u  (%.1f s)\n",
+                   sim::formatTime((uint64_t)(time * sim::kCyclesPerSecond)).c_str(), pot + 1, time - on_[pot]);
+    }
+
+    unsigned runs() const { return runs_; }
+
+private:
+    const sim::Replay &replay_;
+    unsigned runs_;
+    double on_[sim::kMaxPots];
+};
+
+void usage()
+{
+    fprintf(stderr, "usage: flowerpot_replay [--uart] [--dump] CAPTURE\n");
+    exit(2);
+}
+
+void dump(const sim::CaptureFile &capture)
+{
+    for (size_t i = 0; i < capture.size(); i++)
+    {
+        const sim::CaptureRecord &record = capture[i];
+        printf("%10zu  %12.6f  %-6s  %u", i, (double)record.time / sim::kCaptureTicksPerSecond,
+               sim::captureKindName(record.kind), record.value);
+        if (record.kind == sim::CAP_STATS)
+            printf(" (counter %u)", record.counter);
+        if (record.kind == sim::CAP_TX || record.kind == sim::CAP_UART)
+        {
+            uint8_t c = (uint8_t)record.value;
+            if (c >= 32 && c < 127)
+                printf(" '%c'", c);
+        }
+        printf("\n");
+    }
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    bool echoUart = false;
+    bool list = false;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--uart") == 0)
+            echoUart = true;
+        else if (strcmp(argv[i], "--dump") == 0)
+            list = true;
+        else if (!path)
+            path = argv[i];
+        else
+            usage();
+    }
+    if (!path)
+        usage();
+
+    sim::CaptureFile capture;
+    std::string error;
+    if (!capture.open(path, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (list)
+    {
+        dump(capture);
+        return 0;
+    }
+
+    sim::Replay replay(capture);
+    ReplayBoard board(replay);
+    sim::Simulation simulation(board, sim::flowerpotFirmware());
+    sim::Machine &machine = simulation.machine();
+    bool stopped = false;
+    if (!replay.startsAtReset())
+        fprintf(stderr, "%s: no BOOT record, replaying from the first record\n", path);
+
+    machine.setInputSource(&replay);
+    replay.setStopHook([&]()
+    {
+        stopped = true;
+        simulation.stop();
+    });
+    machine.setTxSink([&](uint8_t c)
+    {
+        replay.transmitted(c);
+        if (echoUart)
+            putchar(c);
+    });
+
+    auto wallStart = std::chrono::steady_clock::now();
+    uint64_t replayed = 0;
+    uint64_t progress = 0;
+    while (!stopped && !simulation.halted())
+    {
+        simulation.runFor(sim::kCyclesPerSecond);
+        if (replay.inputsReplayed() != replayed)
+        {
+            replayed = replay.inputsReplayed();
+            progress = machine.now();
+        }
+        else if (machine.now() - progress > STALL_CYCLES)
+        {
+            fprintf(stderr, "firmware stopped reading inputs at record %zu\n", replay.position());
+            break;
+        }
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("%llu inputs and %llu bytes of text over %.3f s of device time replayed in %.3f s "
+           "(%s simulated), %u pump runs\n",
+           (unsigned long long)replay.inputsReplayed(), (unsigned long long)replay.textMatched(),
+           replay.duration(), wall, sim::formatTime(machine.now()).c_str(), board.runs());
+    if (replay.diverged())
+    {
+        printf("DIVERGED at %s\n", replay.divergence().c_str());
+        return 1;
+    }
+    if (!replay.finished())
+    {
+        printf("INCOMPLETE: stopped at record %zu of %zu\n", replay.position(), capture.size());
+        return 1;
+    }
+    printf("identical to the device\n");
+    return 0;
+}
@@ -0,0 +1,490 @@
+// Scenario Scripts
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "scenario.h"
+
+namespace sim {
+
+namespace {
+
+const unsigned MOTOR_PIN = 2;                        // PA2
+
+bool parseNumber(const std::string &text, double &value)
+{
+    char *end;
+    value = strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0';
+}
+
+bool compare(double left, const std::string &op, double right, bool &ok)
+{
+    if (op == "==")
+        ok = left == right;
+    else if (op == "!=")
+        ok = left != right;
+    else if (op == "<")
+        ok = left < right;
+    else if (op == "<=")
+        ok = left <= right;
+    else if (op == ">")
+        ok = left > right;
+    else if (op == ">=")
+        ok = left >= right;
+    else
+        return false;
+    return true;
+}
+
+bool isSignal(const std::string &command)
+{
+    return command == "moisture" || command == "light" || command == "battery" || command == "volume";
+}
+
+const char *const METRICS[] =
+{
+    "pump", "pump-runs", "pump-seconds", "speaker-toggles", "tones",
+    "eeprom-writes", "rx-overruns", "uart-bytes", "rtc"
+};
+
+}
+
+//-----------------------------------------------------------------------------
+// Time
+//-----------------------------------------------------------------------------
+
+// <number><unit>... with units d, h, m, s, ms; a bare number is seconds
+bool parseDuration(const std::string &text, uint64_t &cycles)
+{
+    cycles = 0;
+    size_t i = 0;
+    if (text.empty())
+        return false;
+    while (i < text.size())
+    {
+        size_t start = i;
+        while (i < text.size() && (isdigit((unsigned char)text[i]) || text[i] == '.'))
+            i++;
+        if (i == start)
+            return false;
+        double number = atof(text.substr(start, i - start).c_str());
+        std::string unit;
+        while (i < text.size() && isalpha((unsigned char)text[i]))
+            unit.push_back(text[i++]);
+        double seconds;
+        if (unit == "d")
+            seconds = number * 86400;
+        else if (unit == "h")
+            seconds = number * 3600;
+        else if (unit == "m")
+            seconds = number * 60;
+        else if (unit == "s" || unit.empty())
+            seconds = number;
+        else if (unit == "ms")
+            seconds = number / 1000;
+        else
+            return false;
+        cycles += (uint64_t)(seconds * kCyclesPerSecond + 0.5);
+    }
+    return true;
+}
+
+// hh:mm or hh:mm:ss
+bool parseClock(const std::string &text, uint32_t &seconds)
+{
+    unsigned h, m, s = 0;
+    char extra;
+    int n = sscanf(text.c_str(), "%u:%u:%u%c", &h, &m, &s, &extra);
+    if (n != 2 && n != 3)
+        return false;
+    seconds = h * 3600 + m * 60 + s;
+    return true;
+}
+
+std::string formatTime(uint64_t cycles)
+{
+    uint64_t ms = cycles / (kCyclesPerSecond / 1000);
+    uint64_t s = ms / 1000;
+    char text[40];
+    snprintf(text, sizeof(text), "%llud %02u:%02u:%02u.%03u",
+             (unsigned long long)(s / 86400), (unsigned)(s / 3600 % 24),
+             (unsigned)(s / 60 % 60), (unsigned)(s % 60), (unsigned)(ms % 1000));
+    return text;
+}
+
+//-----------------------------------------------------------------------------
+// Signal
+//-----------------------------------------------------------------------------
+
+Signal::Signal(double value)
+    : from_(value), to_(value), start_(0), end_(0)
+{
+}
+
+void Signal::set(double value, uint64_t now)
+{
+    from_ = to_ = value;
+    start_ = end_ = now;
+}
+
+void Signal::ramp(double target, uint64_t now, uint64_t duration)
+{
+    from_ = at(now);
+    to_ = target;
+    start_ = now;
+    end_ = now + duration;
+}
+
+double Signal::at(uint64_t now) const
+{
+    if (now >= end_)
+        return to_;
+    if (now <= start_)
+        return from_;
+    return from_ + (to_ - from_) * (double)(now - start_) / (double)(end_ - start_);
+}
+
+uint64_t Signal::steadyUntil(uint64_t from, uint32_t (*quantize)(double)) const
+{
+    uint32_t value = quantize(at(from));
+    if (from >= end_ || quantize(to_) == value)
+        return ~0ULL;
+
+    // A ramp is monotonic, so bisect for the first step of the output
+    uint64_t steady = from;
+    uint64_t changed = end_;
+    while (changed - steady > 1)
+    {
+        uint64_t middle = steady + (changed - steady) / 2;
+        if (quantize(at(middle)) == value)
+            steady = middle;
+        else
+            changed = middle;
+    }
+    return steady;
+}
+
+//-----------------------------------------------------------------------------
+// ScriptedBoard
+//-----------------------------------------------------------------------------
+
+ScriptedBoard::ScriptedBoard()
+    : moisture(50), light(50), battery(5), volume(500),
+      pumpRuns_(0), pumpOnCycles_(0), pumpOnSince_(0), pumpOn_(false)
+{
+}
+
+uint16_t ScriptedBoard::adcSample(unsigned ain, uint64_t now)
+{
+    switch (ain)
+    {
+    case 0:  return batteryToAdc(battery.at(now));
+    case 1:  return percentToAdc(moisture.at(now));
+    case 2:  return percentToAdc(light.at(now));
+    default: return 0;
+    }
+}
+
+uint32_t ScriptedBoard::dischargeCycles(uint64_t now)
+{
+    return volumeToDischargeCycles(volume.at(now));
+}
+
+uint64_t ScriptedBoard::inputsSteadyUntil(uint64_t from)
+{
+    uint64_t until = battery.steadyUntil(from, [](double v) -> uint32_t { return batteryToAdc(v); });
+    until = std::min(until, moisture.steadyUntil(from, [](double v) -> uint32_t { return percentToAdc(v); }));
+    until = std::min(until, light.steadyUntil(from, [](double v) -> uint32_t { return percentToAdc(v); }));
+    return std::min(until, volume.steadyUntil(from, [](double v) -> uint32_t { return volumeToDischargeCycles(v); }));
+}
+
+void ScriptedBoard::pinChanged(Port port, unsigned pin, bool level, uint64_t now)
+{
+    if (port != PORT_A || pin != MOTOR_PIN || level == pumpOn_)
+        return;
+    pumpOn_ = level;
+    if (level)
+    {
+        pumpRuns_++;
+        pumpOnSince_ = now;
+    }
+    else
+        pumpOnCycles_ += now - pumpOnSince_;
+    if (pumpChanged)
+        pumpChanged(level, now);
+}
+
+double ScriptedBoard::pumpSeconds(uint64_t now) const
+{
+    uint64_t cycles = pumpOnCycles_ + (pumpOn_ ? now - pumpOnSince_ : 0);
+    return (double)cycles / kCyclesPerSecond;
+}
+
+//-----------------------------------------------------------------------------
+// Scenario
+//-----------------------------------------------------------------------------
+
+bool Scenario::load(const std::string &path, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = path + ": cannot open";
+        return false;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    if (!parse(source.str(), error))
+    {
+        error = path + ":" + error;
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::parse(const std::string &source, std::string &error)
+{
+    steps_.clear();
+    end_ = 0;
+    uint64_t previous = 0;
+    std::istringstream lines(source);
+    std::string line;
+    for (unsigned number = 1; std::getline(lines, line); number++)
+    {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos)
+            line.erase(hash);
+        std::istringstream words(line);
+        std::string when;
+        Step step;
+        if (!(words >> when))
+            continue;
+        step.line = number;
+        if (!(words >> step.command))
+        {
+            error = std::to_string(number) + ": missing command";
+            return false;
+        }
+        std::getline(words, step.text);
+        step.text.erase(0, step.text.find_first_not_of(" \t"));
+        step.text.erase(step.text.find_last_not_of(" \t\r") + 1);
+        std::istringstream args(step.text);
+        std::string arg;
+        while (args >> arg)
+            step.args.push_back(arg);
+
+        bool relative = when[0] == '+';
+        uint64_t offset;
+        if (!parseDuration(relative ? when.substr(1) : when, offset))
+        {
+            error = std::to_string(number) + ": bad time '" + when + "'";
+            return false;
+        }
+        step.time = relative ? previous + offset : offset;
+        if (step.time < previous)
+        {
+            error = std::to_string(number) + ": time goes backwards";
+            return false;
+        }
+        previous = step.time;
+
+        // Validate now so mistakes surface before a long run
+        bool ok = true;
+        const std::vector<std::string> &a = step.args;
+        double number_;
+        uint64_t duration;
+        uint32_t clock;
+        if (isSignal(step.command))
+            ok = (a.size() == 1 || (a.size() == 3 && a[1] == "over" && parseDuration(a[2], duration)))
+                 && parseNumber(a[0], number_);
+        else if (step.command == "rtc")
+            ok = a.size() == 1 && parseClock(a[0], clock);
+        else if (step.command == "send")
+            ok = true;
+        else if (step.command == "expect")
+        {
+            if (!a.empty() && (a[0] == "uart" || a[0] == "no-uart"))
+                ok = a.size() >= 2;
+            else
+            {
+                bool known = !a.empty() && std::find(std::begin(METRICS), std::end(METRICS), a[0]) != std::end(METRICS);
+                bool result;
+                ok = known && a.size() == 3 && compare(0, a[1], 0, result) && parseNumber(a[2], number_);
+            }
+        }
+        else if (step.command == "end")
+            ok = a.empty();
+        else
+        {
+            error = std::to_string(number) + ": unknown command '" + step.command + "'";
+            return false;
+        }
+        if (!ok)
+        {
+            error = std::to_string(number) + ": bad arguments to " + step.command;
+            return false;
+        }
+        steps_.push_back(step);
+        end_ = step.time;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// ScenarioRunner
+//-----------------------------------------------------------------------------
+
+ScenarioRunner::ScenarioRunner(const Scenario &scenario, const Firmware &firmware,
+                               const ScenarioOptions &options)
+    : scenario_(scenario),
+      options_(options),
+      simulation_(board_, firmware),
+      uartCursor_(0),
+      passed_(0),
+      failed_(0)
+{
+    Machine &machine = simulation_.machine();
+    machine.setLoopSkipping(!options_.exact);
+    machine.setTxSink([this](uint8_t c)
+    {
+        uart_.push_back((char)c);
+        if (options_.echoUart)
+            putchar(c);
+    });
+    if (options_.trace)
+    {
+        board_.pumpChanged = [](bool on, uint64_t now)
+        {
+            printf("[%s] pump %s\n", formatTime(now).c_str(), on ? "on" : "off");
+        };
+    }
+}
+
+bool ScenarioRunner::run()
+{
+    Machine &machine = simulation_.machine();
+    for (const Step &step : scenario_.steps())
+        machine.schedule(step.time, [this, &step](Machine &) { execute(step); });
+    simulation_.runUntil(scenario_.endTime() + 1);
+    fflush(stdout);
+    return failed_ == 0;
+}
+
+void ScenarioRunner::execute(const Step &step)
+{
+    Machine &machine = simulation_.machine();
+    uint64_t now = machine.now();
+    const std::vector<std::string> &a = step.args;
+    if (options_.trace)
+        printf("[%s] %s %s\n", formatTime(now).c_str(), step.command.c_str(), step.text.c_str());
+
+    if (isSignal(step.command))
+    {
+        Signal &signal = step.command == "moisture" ? board_.moisture
+                       : step.command == "light" ? board_.light
+                       : step.command == "battery" ? board_.battery
+                       : board_.volume;
+        double target = atof(a[0].c_str());
+        uint64_t duration = 0;
+        if (a.size() == 3)
+            parseDuration(a[2], duration);
+        if (duration)
+            signal.ramp(target, now, duration);
+        else
+            signal.set(target, now);
+    }
+    else if (step.command == "rtc")
+    {
+        uint32_t seconds = 0;               // parse() has checked it
+        parseClock(a[0], seconds);
+        machine.setRtc(seconds);
+    }
+    else if (step.command == "send")
+    {
+        std::string line = step.text + "\r";
+        machine.receive(line.data(), line.size());
+    }
+    else if (step.command == "expect")
+    {
+        if (a[0] == "uart" || a[0] == "no-uart")
+        {
+            std::string text = step.text.substr(step.text.find(a[0]) + a[0].size());
+            text.erase(0, text.find_first_not_of(" \t"));
+            size_t found = uart_.find(text, uartCursor_);
+            bool want = a[0] == "uart";
+            if (want && found != std::string::npos)
+                uartCursor_ = found + text.size();
+            check(step, (found != std::string::npos) == want,
+                  want ? "no \"" + text + "\" in UART output" : "unexpected \"" + text + "\" in UART output");
+        }
+        else
+        {
+            double value = 0;
+            bool ok;
+            metric(a[0], value);
+            compare(value, a[1], atof(a[2].c_str()), ok);
+            char detail[96];
+            snprintf(detail, sizeof(detail), "%s is %g", a[0].c_str(), value);
+            check(step, ok, detail);
+        }
+    }
+    else if (step.command == "end")
+        simulation_.stop();
+}
+
+bool ScenarioRunner::metric(const std::string &name, double &value)
+{
+    Machine &machine = simulation_.machine();
+    uint64_t now = machine.now();
+    if (name == "pump")
+        value = machine.pumpOn();
+    else if (name == "pump-runs")
+        value = (double)board_.pumpRuns();
+    else if (name == "pump-seconds")
+        value = board_.pumpSeconds(now);
+    else if (name == "speaker-toggles")
+        value = (double)machine.speakerToggles();
+    else if (name == "tones")
+        value = (double)machine.timer2Starts();
+    else if (name == "eeprom-writes")
+        value = (double)machine.eepromWrites();
+    else if (name == "rx-overruns")
+        value = (double)machine.rxOverruns();
+    else if (name == "uart-bytes")
+        value = (double)uart_.size();
+    else if (name == "rtc")
+        value = machine.rtcSeconds();
+    else
+        return false;
+    return true;
+}
+
+void ScenarioRunner::check(const Step &step, bool ok, const std::string &detail)
+{
+    if (ok)
+    {
+        passed_++;
+        if (options_.trace)
+            printf("[%s] line %u: ok\n", formatTime(simulation_.machine().now()).c_str(), step.line);
+        return;
+    }
+    failed_++;
+    printf("[%s] line %u: FAILED expect %s (%s)\n", formatTime(simulation_.machine().now()).c_str(),
+           step.line, step.text.c_str(), detail.c_str());
+}
+
+}
@@ -0,0 +1,160 @@
+// Scenario Scripts
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// A scenario drives the simulated board over virtual time and checks what the
+// firmware does.  One step per line, '#' starts a comment:
+//
+//   <time> <command> [arguments]
+//
+// Times are durations from power-on such as 0, 90s, 15m, 2h30m or 3d, or
+// +<duration> relative to the previous step.  Commands:
+//
+//   moisture <percent> [over <duration>]   set or ramp a sensor input
+//   light <percent> [over <duration>]
+//   battery <volts> [over <duration>]
+//   volume <ml> [over <duration>]          water left in the reservoir
+//   rtc <hh:mm[:ss]>                       set the hibernation RTC
+//   send <text>                            type a command line on UART0
+//   expect <metric> <op> <value>           op is == != < <= > >=
+//   expect uart <text>                     output since the last match
+//   expect no-uart <text>                    (does not) contain text
+//   end                                    stop the run here
+//
+// Metrics: pump (0 or 1), pump-runs, pump-seconds, speaker-toggles, tones
+// (speaker timer starts), eeprom-writes, rx-overruns, uart-bytes, rtc.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_SCENARIO_H_
+#define SIM_SCENARIO_H_
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+namespace sim {
+
+// Piecewise-linear input: holds a value, or ramps between two
+class Signal
+{
+public:
+    explicit Signal(double value = 0);
+
+    void set(double value, uint64_t now);
+    void ramp(double target, uint64_t now, uint64_t duration);
+    double at(uint64_t now) const;
+
+    // Last time up to which quantize(at(t)) stays what it is at from
+    uint64_t steadyUntil(uint64_t from, uint32_t (*quantize)(double)) const;
+
+private:
+    double from_;
+    double to_;
+    uint64_t start_;
+    uint64_t end_;
+};
+
+// Board whose sensor inputs follow scripted signals
+class ScriptedBoard : public Board
+{
+public:
+    ScriptedBoard();
+
+    Signal moisture;
+    Signal light;
+    Signal battery;
+    Signal volume;
+
+    uint16_t adcSample(unsigned ain, uint64_t now) override;
+    uint32_t dischargeCycles(uint64_t now) override;
+    void pinChanged(Port port, unsigned pin, bool level, uint64_t now) override;
+    uint64_t inputsSteadyUntil(uint64_t from) override;
+
+    // Optional observer of pump transitions
+    std::function<void(bool on, uint64_t now)> pumpChanged;
+
+    uint64_t pumpRuns() const { return pumpRuns_; }
+    double pumpSeconds(uint64_t now) const;
+
+private:
+    uint64_t pumpRuns_;
+    uint64_t pumpOnCycles_;
+    uint64_t pumpOnSince_;
+    bool pumpOn_;
+};
+
+struct Step
+{
+    uint64_t time;
+    unsigned line;
+    std::string command;
+    std::vector<std::string> args;
+    std::string text;                 // everything after the command
+};
+
+class Scenario
+{
+public:
+    bool load(const std::string &path, std::string &error);
+    bool parse(const std::string &source, std::string &error);
+
+    const std::vector<Step> &steps() const { return steps_; }
+    uint64_t endTime() const { return end_; }
+
+private:
+    std::vector<Step> steps_;
+    uint64_t end_;
+};
+
+struct ScenarioOptions
+{
+    bool echoUart;                    // copy firmware UART output to stdout
+    bool trace;                       // log steps and pump changes
+    bool exact;                       // run every idle loop pass
+};
+
+class ScenarioRunner
+{
+public:
+    ScenarioRunner(const Scenario &scenario, const Firmware &firmware,
+                   const ScenarioOptions &options);
+
+    // Returns true when every expectation held
+    bool run();
+
+    unsigned passed() const { return passed_; }
+    unsigned failed() const { return failed_; }
+    uint64_t elapsed() const { return simulation_.machine().now(); }
+
+private:
+    void execute(const Step &step);
+    bool metric(const std::string &name, double &value);
+    void check(const Step &step, bool ok, const std::string &detail);
+
+    const Scenario &scenario_;
+    ScenarioOptions options_;
+    ScriptedBoard board_;
+    Simulation simulation_;
+    std::string uart_;
+    size_t uartCursor_;
+    unsigned passed_;
+    unsigned failed_;
+};
+
+// Duration parsing and formatting in virtual cycles
+bool parseDuration(const std::string &text, uint64_t &cycles);
+bool parseClock(const std::string &text, uint32_t &seconds);
+std::string formatTime(uint64_t cycles);
+
+}
+
+#endif
@@ -0,0 +1,224 @@
+// Schedule Check
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Checks the firmware's watering schedule (schedule.h) second by second
+// against a plain model of it, for a set of awkward schedules and for
+// random ones.
+//
+//   flowerpot_schedule [--random N] [--days N] [--seed N]
+//
+//   --random  random schedules to check after the fixed ones (default 100)
+//   --days    days each random schedule is checked over (default 9)
+//   --seed    seed for the random schedules (default 1)
+//
+// Every fixed schedule is checked over the first two weeks of the RTC,
+// where the day before day 0 is the Sunday of the week before, and over
+// two weeks a thousand weeks on.  A random one is checked from a random
+// second.  At every second isScheduleOpen() must agree with the model and
+// scheduleNextChange() must give the next second the model changes at, or
+// SCHEDULE_NEVER if it does not change in the next eight days.  The exit
+// status is 1 at the first disagreement.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "schedule.h"
+
+namespace {
+
+const uint32_t HOUR = 3600;
+const uint32_t LOOK_AHEAD = 8 * SCHEDULE_DAY;
+const uint32_t FAR = 1000 * SCHEDULE_WEEK;
+
+struct Case
+{
+    std::string name;
+    SCHEDULE schedule;
+};
+
+void usage()
+{
+    fprintf(stderr, "usage: flowerpot_schedule [--random N] [--days N] [--seed N]\n");
+    exit(2);
+}
+
+// Days as digits, 1 for Monday, as the "window" command takes them
+uint8_t days(const char *digits)
+{
+    uint8_t mask = 0;
+    for (; *digits; digits++)
+        mask |= 1 << (*digits - '1');
+    return mask;
+}
+
+Case make(const char *name, std::initializer_list<WINDOW> windows)
+{
+    Case c;
+    c.name = name;
+    clearSchedule(&c.schedule);
+    uint8_t n = 0;
+    for (const WINDOW &window : windows)
+        setScheduleWindow(&c.schedule, n++, window.start, window.end, window.days);
+    return c;
+}
+
+std::vector<Case> fixedCases()
+{
+    return {
+        make("empty", {}),
+        make("09:00-17:00 daily", { { 9 * HOUR, 17 * HOUR, SCHEDULE_EVERY_DAY } }),
+        make("00:00-23:59 daily", { { 0, 23 * HOUR + 59 * 60, SCHEDULE_EVERY_DAY } }),
+        make("22:00-02:30 Sat Sun", { { 22 * HOUR, 2 * HOUR + 30 * 60, days("67") } }),
+        make("23:00-01:00 Sun", { { 23 * HOUR, 1 * HOUR, days("7") } }),
+        make("20:00-00:00 Mon", { { 20 * HOUR, 0, days("1") } }),
+        make("00:00-00:01 Mon", { { 0, 60, days("1") } }),
+        make("adjacent 09-12 12-15", { { 9 * HOUR, 12 * HOUR, SCHEDULE_EVERY_DAY },
+                                       { 12 * HOUR, 15 * HOUR, SCHEDULE_EVERY_DAY } }),
+        make("overlapping 08-12 10-14", { { 8 * HOUR, 12 * HOUR, days("135") },
+                                          { 10 * HOUR, 14 * HOUR, days("12345") } }),
+        make("same start and end", { { 6 * HOUR, 6 * HOUR, SCHEDULE_EVERY_DAY } }),
+        make("overnight chain", { { 18 * HOUR, 6 * HOUR, days("5") }, { 5 * HOUR, 20 * HOUR, days("6") },
+                                  { 19 * HOUR, 7 * HOUR, days("6") }, { 6 * HOUR, 8 * HOUR, days("7") } }),
+    };
+}
+
+Case randomCase(std::mt19937 &random, unsigned n)
+{
+    Case c;
+    c.name = "random " + std::to_string(n);
+    clearSchedule(&c.schedule);
+    unsigned windows = random() % (SCHEDULE_WINDOWS + 1);
+    for (unsigned i = 0; i < windows; i++)
+    {
+        // Whole minutes mostly, so windows meet and overlap often
+        uint32_t start = random() % 2 ? random() % 1440 * 60 : random() % SCHEDULE_DAY;
+        uint32_t end = random() % 2 ? random() % 1440 * 60 : random() % SCHEDULE_DAY;
+        setScheduleWindow(&c.schedule, i, start, end, random() % 128);
+    }
+    return c;
+}
+
+// The schedule as plain intervals: each window on each of its days is open
+// from start to start plus its length, exclusive at both ends
+bool modelOpen(const SCHEDULE &schedule, uint64_t seconds)
+{
+    int64_t day = (int64_t)(seconds / SCHEDULE_DAY);
+    for (const WINDOW &window : schedule.window)
+    {
+        int64_t length = (window.end + SCHEDULE_DAY - window.start) % SCHEDULE_DAY;
+        // Day -1, before the RTC's day 0, is a Sunday
+        for (int64_t opened = day - 1; opened <= day; opened++)
+        {
+            int64_t from = opened * SCHEDULE_DAY + window.start;
+            if ((window.days >> ((opened % 7 + 7) % 7) & 1) && (int64_t)seconds > from &&
+                (int64_t)seconds < from + length)
+                return true;
+        }
+    }
+    return false;
+}
+
+std::string describe(uint32_t seconds)
+{
+    static const char *names[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
+    char text[64];
+    uint32_t time = seconds % SCHEDULE_DAY;
+    snprintf(text, sizeof(text), "%u (day %u %s %02u:%02u:%02u)", seconds, seconds / SCHEDULE_DAY,
+             names[scheduleWeekday(seconds)], time / HOUR, time / 60 % 60, time % 60);
+    return text;
+}
+
+// Checks every second from first for count seconds
+bool check(const Case &c, uint32_t first, uint32_t count)
+{
+    // The model's state from first to LOOK_AHEAD past the end, and from it
+    // the seconds to its next change
+    uint32_t span = count + LOOK_AHEAD + 1;
+    std::vector<bool> open(span);
+    for (uint32_t i = 0; i < span; i++)
+        open[i] = modelOpen(c.schedule, (uint64_t)first + i);
+    std::vector<uint32_t> next(span, SCHEDULE_NEVER);
+    for (uint32_t i = span - 1; i-- > 0;)
+        next[i] = open[i + 1] != open[i] ? 1 : next[i + 1] == SCHEDULE_NEVER ? SCHEDULE_NEVER : next[i + 1] + 1;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t seconds = first + i;
+        bool isOpen = isScheduleOpen(&c.schedule, seconds);
+        uint32_t change = scheduleNextChange(&c.schedule, seconds);
+        uint32_t expected = next[i] != SCHEDULE_NEVER && next[i] <= LOOK_AHEAD ? next[i] : SCHEDULE_NEVER;
+        if (isOpen != open[i] || change != expected)
+        {
+            printf("%s: FAILED at %s: open %d, next change %u; expected open %d, next change %u\n",
+                   c.name.c_str(), describe(seconds).c_str(), isOpen, change, (int)open[i], expected);
+            for (const WINDOW &window : c.schedule.window)
+                if (window.days)
+                    printf("  window %u-%u days 0x%02x\n", window.start, window.end, window.days);
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    unsigned randomCount = 100;
+    unsigned randomDays = 9;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+            usage();
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "--random") == 0)
+            randomCount = (unsigned)atoi(value);
+        else if (strcmp(argv[i - 1], "--days") == 0)
+            randomDays = (unsigned)atoi(value);
+        else if (strcmp(argv[i - 1], "--seed") == 0)
+            seed = (unsigned)atoi(value);
+        else
+            usage();
+    }
+    if (randomDays < 1 || randomDays > 28)
+        usage();
+
+    uint64_t checked = 0;
+    for (const Case &c : fixedCases())
+    {
+        if (!check(c, 0, 2 * SCHEDULE_WEEK) || !check(c, FAR - SCHEDULE_DAY, 2 * SCHEDULE_WEEK))
+            return 1;
+        checked += 4 * SCHEDULE_WEEK;
+        printf("%s: ok\n", c.name.c_str());
+    }
+
+    std::mt19937 random(seed);
+    for (unsigned n = 0; n < randomCount; n++)
+    {
+        Case c = randomCase(random, n);
+        uint32_t first = random() % 2 ? random() % SCHEDULE_WEEK : FAR + random() % SCHEDULE_WEEK;
+        if (!check(c, first, randomDays * SCHEDULE_DAY))
+            return 1;
+        checked += randomDays * SCHEDULE_DAY;
+    }
+    printf("%u random schedules: ok\n", randomCount);
+    printf("%llu seconds checked\n", (unsigned long long)checked);
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Host Simulator Hardware Shim
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+// Target uC:       TM4C123GH6PM (register file stand-in)
+// System Clock:    40 MHz (virtual)
+
+// Included by the generated host tm4c123gh6pm.h.  Every register macro in
+// that header resolves to simRegister(address), which returns the storage
+// for the register in the simulated machine bound to the calling thread.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIMHW_H_
+#define SIMHW_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+void *simRegister(uint32_t address);
+void simDelayCycles(uint32_t cycles);
+void simWaitMicrosecond(uint32_t us);
+uint64_t simHostNanoseconds(void);
+uint64_t simSkippedLoops(void);
+uint64_t simSkippedCycles(void);
+
+// The calling fiber's stack, guard page excluded, or outside a fiber the
+// calling thread's; both null if neither can be found
+void simStackBounds(uint32_t **bottom, uint32_t **top);
+
+// Zeroed storage for firmware state that is a global on the target, one
+// copy per simulated machine, found by the address of key
+void *simGlobal(const void *key, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+// TI compiler intrinsic used by the drivers after enabling clocks
+#define _delay_cycles(cycles) simDelayCycles(cycles)
+
+// Bit-band alias of one bit of a peripheral register
+#define BITBAND_ALIAS(reg, bit) \
+    (*((volatile uint32_t *)simRegister(0x42000000 + ((reg) - 0x40000000) * 32 + (bit) * 4)))
+
+// DWT cycle counter, which the TI header leaves out (dwt.h)
+#define DWT_CTRL_R   (*((volatile uint32_t *)simRegister(0xE0001000)))
+#define DWT_CYCCNT_R (*((volatile uint32_t *)simRegister(0xE0001004)))
+
+#endif
@@ -0,0 +1,87 @@
+// Scenario Runner
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host, simulated EK-TM4C123GXL
+
+// Runs the firmware through one or more scenario scripts (see scenario.h) in
+// virtual time and reports the expectations that failed.
+//
+//   flowerpot_sim [--uart] [--trace] [--exact] SCENARIO...
+//
+//   --uart   copy the firmware's UART output to stdout
+//   --trace  log every step, expectation and pump change with its time
+//   --exact  run every pass of the idle loop instead of skipping repeats
+//
+// Exits with status 1 if any expectation failed.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+#include "firmware.h"
+#include "scenario.h"
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    sim::ScenarioOptions options = { false, false, false };
+    int status = 0;
+    int scenarios = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--uart") == 0)
+        {
+            options.echoUart = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--trace") == 0)
+        {
+            options.trace = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--exact") == 0)
+        {
+            options.exact = true;
+            continue;
+        }
+
+        sim::Scenario scenario;
+        std::string error;
+        if (!scenario.load(argv[i], error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        sim::ScenarioRunner runner(scenario, sim::flowerpotFirmware(), options);
+        bool ok = runner.run();
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double simulated = (double)runner.elapsed() / sim::kCyclesPerSecond;
+
+        printf("%s: %s, %u passed, %u failed, %s simulated in %.3f s (%.0fx real time)\n",
+               argv[i], ok ? "ok" : "FAILED", runner.passed(), runner.failed(),
+               sim::formatTime(runner.elapsed()).c_str(), wall, wall > 0 ? simulated / wall : 0.0);
+        if (!ok)
+            status = 1;
+        scenarios++;
+    }
+
+    if (scenarios == 0)
+    {
+        fprintf(stderr, "usage: flowerpot_sim [--uart] [--trace] [--exact] SCENARIO...\n");
+        return 2;
+    }
+    return status;
+}
@@ -0,0 +1,53 @@
+// Firmware Simulation
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include "simulation.h"
+
+namespace sim {
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+Simulation::Simulation(Board &board, const Firmware &firmware)
+    : machine_(board),
+      firmware_(firmware),
+      fiber_([this]() { exitCode_ = firmware_.entry(); }),
+      run_(0),
+      exitCode_(0)
+{
+    machine_.setVectorTable(firmware_.vectors, firmware_.vectorCount);
+}
+
+void Simulation::runUntil(uint64_t cycles)
+{
+    if (halted() || cycles <= machine_.now())
+        return;
+    uint64_t run = ++run_;
+    machine_.schedule(cycles, [this, run](Machine &)
+    {
+        if (run == run_)
+            stop();
+    });
+
+    Machine *previous = current();
+    bind(&machine_);
+    fiber_.resume();
+    bind(previous);
+}
+
+void Simulation::stop()
+{
+    run_++;
+    fiber_.suspend();
+}
+
+}
@@ -0,0 +1,63 @@
+// Firmware Simulation
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// One simulated pot: a machine, the board wired to it, and the firmware
+// running on its own fiber.  runUntil() lets the firmware run until virtual
+// time reaches the given cycle count (or a host event calls stop()) and then
+// returns, leaving the firmware suspended mid-instruction where it can be
+// resumed later, from any thread.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifndef SIM_SIMULATION_H_
+#define SIM_SIMULATION_H_
+
+#include <stdint.h>
+
+#include "fiber.h"
+#include "machine.h"
+
+namespace sim {
+
+struct Firmware
+{
+    int (*entry)(void);
+    void (* const *vectors)(void);
+    uint32_t vectorCount;
+};
+
+class Simulation
+{
+public:
+    Simulation(Board &board, const Firmware &firmware);
+
+    Machine &machine() { return machine_; }
+    const Machine &machine() const { return machine_; }
+
+    void runUntil(uint64_t cycles);
+    void runFor(uint64_t cycles) { runUntil(machine_.now() + cycles); }
+
+    // Called from a host event: end the current run at the current time
+    void stop();
+
+    // The firmware returned from main()
+    bool halted() const { return fiber_.finished(); }
+    int exitCode() const { return exitCode_; }
+
+private:
+    Machine machine_;
+    Firmware firmware_;
+    Fiber fiber_;
+    uint64_t run_;
+    int exitCode_;
+};
+
+}
+
+#endif
@@ -0,0 +1,308 @@
+// Stack Usage Report
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Works out the deepest the stack can go from the call graphs GCC writes
+// with -fcallgraph-info=su, one .ci file per source file.
+//
+//   flowerpot_stack [--entry NAME] [--isr NAME]... [--frame BYTES]
+//                   [--assume NAME=BYTES]... [--limit BYTES] CI...
+//
+//   --entry   the function the reset handler calls (default main)
+//   --isr     an interrupt handler; each one may interrupt the entry's
+//             deepest chain once
+//   --frame   bytes the core stacks on interrupt entry (104 on a
+//             Cortex-M4F with the FPU enabled)
+//   --assume  stack use of a function with no figure of its own, such as
+//             one from the run-time library
+//   --limit   the stack size; the exit status is 1 above it
+//
+// Every function nothing calls is listed with its deepest chain.  The worst
+// case is the entry's chain plus every handler's chain and frame.  Calls to
+// functions without a figure, through pointers and recursive calls cannot
+// be bounded and are listed; the worst case counts them as nothing.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char INDIRECT[] = "__indirect_call";
+
+struct Function
+{
+    bool known = false;               // Has a frame size
+    bool dynamic = false;             // Frame size not bounded
+    unsigned long frame = 0;
+    std::set<std::string> callees;
+
+    // Filled in by depth()
+    enum { NEW, VISITING, DONE } state = NEW;
+    unsigned long depth = 0;
+    std::string deepest;              // Callee on the deepest chain
+    bool called = false;
+};
+
+typedef std::map<std::string, Function> Graph;
+
+struct Problems
+{
+    std::set<std::string> unknown;
+    std::set<std::string> dynamic;
+    std::set<std::string> indirect;
+    std::set<std::string> recursive;
+};
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: flowerpot_stack [--entry NAME] [--isr NAME]... [--frame BYTES]\n"
+            "                       [--assume NAME=BYTES]... [--limit BYTES] CI...\n");
+    exit(2);
+}
+
+// The value of key: "..." in a VCG line
+bool quoted(const std::string &line, const char *key, std::string &value)
+{
+    std::string start = std::string(key) + ": \"";
+    size_t at = line.find(start);
+    if (at == std::string::npos)
+        return false;
+    at += start.size();
+    size_t end = line.find('"', at);
+    if (end == std::string::npos)
+        return false;
+    value = line.substr(at, end - at);
+    return true;
+}
+
+bool readCallGraph(const char *path, Graph &graph, std::string &error)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        error = std::string(path) + ": " + strerror(errno);
+        return false;
+    }
+    std::string line;
+    int c;
+    while ((c = fgetc(file)) != EOF)
+    {
+        if (c != '\n')
+        {
+            line += (char)c;
+            continue;
+        }
+        std::string title, label, source, target;
+        if (line.compare(0, 5, "node:") == 0 && quoted(line, "title", title) && quoted(line, "label", label))
+        {
+            Function &function = graph[title];
+            // The label ends "\nN bytes (static)" or "(dynamic,bounded)"
+            // when the function is defined in this file
+            size_t at = label.rfind("\\n");
+            unsigned long frame;
+            char kind[32];
+            if (at != std::string::npos &&
+                sscanf(label.c_str() + at + 2, "%lu bytes (%31[^)])", &frame, kind) == 2)
+            {
+                function.known = true;
+                function.frame = frame;
+                function.dynamic = strcmp(kind, "static") != 0 && strcmp(kind, "dynamic,bounded") != 0;
+            }
+        }
+        else if (line.compare(0, 5, "edge:") == 0 && quoted(line, "sourcename", source) &&
+                 quoted(line, "targetname", target))
+        {
+            graph[source].callees.insert(target);
+            graph[target].called = true;
+        }
+        line.clear();
+    }
+    fclose(file);
+    return true;
+}
+
+unsigned long depth(Graph &graph, const std::string &name, Problems &problems)
+{
+    Function &function = graph[name];
+    if (function.state == Function::DONE)
+        return function.depth;
+    if (function.state == Function::VISITING)
+    {
+        problems.recursive.insert(name);
+        return 0;
+    }
+    function.state = Function::VISITING;
+    if (!function.known)
+        problems.unknown.insert(name);
+    if (function.dynamic)
+        problems.dynamic.insert(name);
+    unsigned long deepest = 0;
+    for (const std::string &callee : function.callees)
+    {
+        if (callee == INDIRECT)
+        {
+            problems.indirect.insert(name);
+            continue;
+        }
+        unsigned long calleeDepth = depth(graph, callee, problems);
+        if (calleeDepth > deepest || function.deepest.empty())
+        {
+            deepest = calleeDepth;
+            function.deepest = callee;
+        }
+    }
+    function.depth = function.frame + deepest;
+    function.state = Function::DONE;
+    return function.depth;
+}
+
+std::string chain(const Graph &graph, std::string name)
+{
+    std::string text = name;
+    std::set<std::string> seen;
+    seen.insert(name);
+    for (;;)
+    {
+        const std::string &next = graph.at(name).deepest;
+        if (next.empty() || !seen.insert(next).second)
+            break;
+        text += " > " + next;
+        name = next;
+    }
+    return text;
+}
+
+void printSet(const char *title, const std::set<std::string> &names)
+{
+    if (names.empty())
+        return;
+    printf("%s:", title);
+    for (const std::string &name : names)
+        printf(" %s", name.c_str());
+    printf("\n");
+}
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    std::string entry = "main";
+    std::vector<std::string> isrs;
+    std::map<std::string, unsigned long> assumed;
+    unsigned long frame = 0;
+    unsigned long limit = 0;
+    std::vector<const char *> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--entry") == 0 && i + 1 < argc)
+            entry = argv[++i];
+        else if (strcmp(argv[i], "--isr") == 0 && i + 1 < argc)
+            isrs.push_back(argv[++i]);
+        else if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc)
+            frame = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc)
+            limit = strtoul(argv[++i], nullptr, 0);
+        else if (strcmp(argv[i], "--assume") == 0 && i + 1 < argc)
+        {
+            const char *equals = strchr(argv[++i], '=');
+            if (!equals || equals == argv[i])
+                usage();
+            assumed[std::string(argv[i], equals - argv[i])] = strtoul(equals + 1, nullptr, 0);
+        }
+        else if (argv[i][0] == '-')
+            usage();
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+        usage();
+
+    Graph graph;
+    std::string error;
+    for (const char *path : paths)
+        if (!readCallGraph(path, graph, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    for (const auto &assumption : assumed)
+    {
+        Function &function = graph[assumption.first];
+        if (!function.known)
+        {
+            function.known = true;
+            function.frame = assumption.second;
+        }
+    }
+    if (graph.find(entry) == graph.end() || !graph[entry].known)
+    {
+        fprintf(stderr, "%s: not defined in the call graphs\n", entry.c_str());
+        return 1;
+    }
+
+    // Only what the worst case depends on is listed as not counted
+    Problems problems;
+    unsigned long worst = depth(graph, entry, problems);
+    for (const std::string &isr : isrs)
+    {
+        if (graph.find(isr) == graph.end() || !graph[isr].known)
+        {
+            fprintf(stderr, "%s: not defined in the call graphs\n", isr.c_str());
+            return 1;
+        }
+        worst += depth(graph, isr, problems) + frame;
+    }
+
+    Problems elsewhere;
+    printf("%8s  %s\n", "bytes", "deepest chain");
+    for (auto &node : graph)
+        if (!node.second.called && node.second.known)
+        {
+            unsigned long bytes = depth(graph, node.first, elsewhere);
+            const char *role = node.first == entry ? " (entry)" : "";
+            for (const std::string &isr : isrs)
+                if (node.first == isr)
+                    role = " (interrupt)";
+            printf("%8lu  %s%s\n", bytes, chain(graph, node.first).c_str(), role);
+        }
+    problems.unknown.erase(INDIRECT);
+
+    printf("\n");
+    printf("worst case: %lu bytes", worst);
+    if (!isrs.empty())
+        printf(" (%s and %zu interrupt handler%s, %lu-byte frames)", entry.c_str(), isrs.size(),
+               isrs.size() == 1 ? "" : "s", frame);
+    if (limit)
+        printf(" of %lu", limit);
+    printf("\n");
+    printSet("not counted, no figure", problems.unknown);
+    printSet("not counted, calls through pointers in", problems.indirect);
+    printSet("not counted, recursion through", problems.recursive);
+    printSet("not counted, unbounded frames in", problems.dynamic);
+
+    if (limit && worst > limit)
+    {
+        fprintf(stderr, "worst case %lu bytes is over the %lu-byte stack\n", worst, limit);
+        return 1;
+    }
+    return 0;
+}
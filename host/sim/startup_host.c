@@ -0,0 +1,31 @@
+//*****************************************************************************
+//
+// Host simulator counterpart of tm4c123gh6pm_startup_ccs.c
+//
+// The simulated machine dispatches interrupts through this table, indexed by
+// interrupt number (INT_* in tm4c123gh6pm.h).  Keep it in step with the
+// vector table in the startup file.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include "tm4c123gh6pm.h"
+
+//*****************************************************************************
+//
+// External declarations for the interrupt handlers used by the application.
+//
+//*****************************************************************************
+extern void timer1Isr();
+
+//*****************************************************************************
+//
+// The vector table.
+//
+//*****************************************************************************
+void (* const simVectors[])(void) =
+{
+    [INT_TIMER2A] = timer1Isr,              // Timer 2 subtimer A
+};
+
+const uint32_t simVectorCount = sizeof(simVectors) / sizeof(simVectors[0]);
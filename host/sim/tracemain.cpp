@@ -0,0 +1,230 @@
+// Trace Converter
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: x86-64 host
+
+// Converts the dumps the firmware's "trace" command sends (trace.h) into
+// Chrome trace-event JSON, for chrome://tracing or ui.perfetto.dev.
+//
+//   flowerpot_trace DUMP [JSON]
+//
+//   DUMP  a serial log holding one or more dumps, or - for stdin
+//   JSON  output file (default stdout)
+//
+// Every dump becomes its own process in the trace, with time starting at
+// its oldest event.  Ends of spans whose start was overwritten in the ring
+// buffer are dropped.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+namespace {
+
+const char PREFIX[] = "trace,";
+
+struct Dump
+{
+    unsigned number;
+    double cyclesPerMicrosecond;
+    bool timed;
+    uint32_t last;
+    uint64_t time;                    // Cycles since the oldest event
+    std::map<std::string, unsigned> open;     // Spans started
+};
+
+void usage()
+{
+    fprintf(stderr, "usage: flowerpot_trace DUMP [JSON]\n");
+    exit(2);
+}
+
+const char *category(const std::string &name)
+{
+    if (name == "light" || name == "moisture" || name == "battery")
+        return "sensors";
+    if (name == "getVolume")
+        return "volume";
+    if (name == "motor")
+        return "pump";
+    if (name == "command")
+        return "commands";
+    return "eeprom";
+}
+
+std::string escape(const std::string &text)
+{
+    std::string escaped;
+    for (unsigned char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += (char)c;
+        }
+        else if (c < 32 || c > 126)
+        {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", c);
+            escaped += hex;
+        }
+        else
+            escaped += (char)c;
+    }
+    return escaped;
+}
+
+// Command events carry the first characters of the command
+std::string argumentText(uint32_t argument)
+{
+    std::string text;
+    for (unsigned i = 0; i < 4 && (argument >> (8 * i)) & 0xFF; i++)
+        text += (char)((argument >> (8 * i)) & 0xFF);
+    return text;
+}
+
+class Writer
+{
+public:
+    explicit Writer(FILE *file) : file_(file), first_(true)
+    {
+        fprintf(file_, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    }
+
+    void event(const Dump &dump, const std::string &name, char phase, uint32_t argument)
+    {
+        fprintf(file_, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%u,\"tid\":1",
+                first_ ? "" : ",", escape(name).c_str(), category(name), phase,
+                dump.time / dump.cyclesPerMicrosecond, dump.number);
+        if (phase == 'i')
+            fprintf(file_, ",\"s\":\"t\"");
+        fprintf(file_, ",\"args\":{\"argument\":%u", argument);
+        if (name == "command" && phase == 'B')
+            fprintf(file_, ",\"text\":\"%s\"", escape(argumentText(argument)).c_str());
+        fprintf(file_, "}}");
+        first_ = false;
+    }
+
+    void process(const Dump &dump)
+    {
+        fprintf(file_, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"dump %u\"}}",
+                first_ ? "" : ",", dump.number, dump.number);
+        first_ = false;
+    }
+
+    void finish()
+    {
+        fprintf(file_, "\n]}\n");
+    }
+
+private:
+    FILE *file_;
+    bool first_;
+};
+
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3 || (argv[1][0] == '-' && argv[1][1] != '\0'))
+        usage();
+
+    FILE *input = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+    if (!input)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+        return 1;
+    }
+    FILE *output = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (!output)
+    {
+        fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+        return 1;
+    }
+
+    Writer writer(output);
+    Dump dump = {};
+    bool inDump = false;
+    unsigned dumps = 0;
+    unsigned long events = 0, dropped = 0;
+    char raw[256];
+    while (fgets(raw, sizeof(raw), input))
+    {
+        std::string line;
+        for (const char *p = raw; *p; p++)
+            if (*p != '\r' && *p != '\n')
+                line += *p;
+        size_t at = line.find(PREFIX);
+        if (at == std::string::npos)
+            continue;
+        const char *fields = line.c_str() + at + sizeof(PREFIX) - 1;
+
+        unsigned long recorded, clock;
+        if (sscanf(fields, "begin,%lu,%lu", &recorded, &clock) == 2)
+        {
+            dump = Dump();
+            dump.number = ++dumps;
+            dump.cyclesPerMicrosecond = clock ? clock / 1e6 : 40;
+            inDump = true;
+            writer.process(dump);
+            continue;
+        }
+        if (strncmp(fields, "end", 3) == 0)
+        {
+            inDump = false;
+            continue;
+        }
+
+        unsigned long time, argument;
+        char kind;
+        char name[32];
+        if (!inDump || sscanf(fields, "%lu,%c,%31[^,],%lu", &time, &kind, name, &argument) != 4)
+            continue;
+
+        // CYCCNT wraps every 107 s at 40 MHz; events are in order
+        uint32_t cycles = (uint32_t)time;
+        if (dump.timed)
+            dump.time += (uint32_t)(cycles - dump.last);
+        dump.timed = true;
+        dump.last = cycles;
+
+        if (kind == 'B')
+            dump.open[name]++;
+        else if (kind == 'E')
+        {
+            if (dump.open[name] == 0)
+            {
+                dropped++;
+                continue;
+            }
+            dump.open[name]--;
+        }
+        writer.event(dump, name, kind == 'I' ? 'i' : kind, (uint32_t)argument);
+        events++;
+    }
+    writer.finish();
+    if (input != stdin)
+        fclose(input);
+    if (output != stdout)
+        fclose(output);
+
+    fprintf(stderr, "%lu events from %u dump%s", events, dumps, dumps == 1 ? "" : "s");
+    if (dropped)
+        fprintf(stderr, ", %lu span ends without a start dropped", dropped);
+    fprintf(stderr, "\n");
+    return 0;
+}